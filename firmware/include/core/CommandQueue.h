@@ -0,0 +1,109 @@
+/**
+ * @file CommandQueue.h
+ * @brief Cola única de comandos remotos (WebSocket y MQTT) ejecutada en el loop.
+ *
+ * **CONCEPTO EDUCATIVO - PRODUCTORES EN OTRAS TAREAS, UN SOLO CONSUMIDOR**:
+ * Los comandos llegan desde tareas que no son el loop principal: la de
+ * AsyncTCP (WebSocket) y la del cliente MQTT. Si cada una llamara
+ * directamente al controlador de riego, dos tareas podrían mover servos a
+ * la vez. En su lugar, los productores solo encolan una copia del comando
+ * y el loop los ejecuta de uno en uno:
+ *
+ *     [AsyncTCP] --push--\
+ *                         >--> [ cola FreeRTOS ] --pop--> loop: ejecutar + responder
+ *     [MQTT]     --push--/
+ *
+ * La cola es de FreeRTOS con almacenamiento estático (sin heap) y cada
+ * elemento es de tamaño fijo. Al terminar, el loop invoca la función de
+ * finalización que dejó el productor para que responda por su propio canal.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __COMMAND_QUEUE_H__
+#define __COMMAND_QUEUE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+namespace CommandQueueConfig {
+    constexpr uint8_t QUEUE_LENGTH = 8;               // Comandos en espera como máximo
+    constexpr size_t MAX_COMMAND_LENGTH = 32;         // Nombre del comando (con '\0')
+    constexpr size_t MAX_PARAMETERS_LENGTH = 96;      // Parámetros "k1=v1&k2=v2" (con '\0')
+    constexpr uint8_t MAX_COMMANDS_PER_UPDATE = 4;    // Comandos ejecutados por vuelta del loop
+}
+
+/**
+ * @brief Canal por el que llegó el comando.
+ */
+enum class CommandSource : uint8_t {
+    WEBSOCKET,
+    MQTT
+};
+
+struct QueuedCommand;
+
+/**
+ * @brief Se llama en el loop tras ejecutar el comando, para responder al origen.
+ */
+typedef void (*CommandCompletion)(const QueuedCommand& command, bool success, void* context);
+
+struct QueuedCommand {
+    CommandSource source;
+    uint32_t clientId;                                      // Cliente WebSocket (0 en MQTT)
+    uint32_t enqueuedAt;                                    // millis() al encolar
+    char command[CommandQueueConfig::MAX_COMMAND_LENGTH];
+    char parameters[CommandQueueConfig::MAX_PARAMETERS_LENGTH];
+    CommandCompletion onComplete;
+    void* context;
+};
+
+/**
+ * @class CommandQueue
+ * @brief Cola de comandos compartida (singleton).
+ */
+class CommandQueue {
+public:
+    static CommandQueue& getInstance() {
+        static CommandQueue instance;
+        return instance;
+    }
+
+    /**
+     * @brief Encola un comando sin bloquear (segura desde cualquier tarea).
+     *
+     * Los textos no necesitan terminar en '\0' (un topic MQTT no lo hace).
+     *
+     * @return false si el comando o los parámetros no caben, o la cola está llena
+     */
+    bool push(CommandSource source, uint32_t clientId,
+              const char* command, size_t commandLength,
+              const char* parameters, size_t parametersLength,
+              CommandCompletion onComplete, void* context);
+
+    /**
+     * @brief Saca el siguiente comando sin esperar (solo desde el loop).
+     */
+    bool pop(QueuedCommand& out);
+
+    uint8_t pending() const;
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+    static const char* sourceToString(CommandSource source);
+
+private:
+    CommandQueue();
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    StaticQueue_t queueBuffer;
+    uint8_t storage[CommandQueueConfig::QUEUE_LENGTH * sizeof(QueuedCommand)];
+    QueueHandle_t handle;
+    volatile uint32_t droppedCount;
+};
+
+#endif // __COMMAND_QUEUE_H__
@@ -0,0 +1,163 @@
+#ifndef __CONFIG_BACKUP_STORE_H__
+#define __CONFIG_BACKUP_STORE_H__
+
+/**
+ * @file ConfigBackupStore.h
+ * @brief Historial de versiones de la configuración guardado como deltas binarios.
+ *
+ * **CONCEPTO EDUCATIVO - FOTOGRAMAS CLAVE + DELTAS**:
+ * Guardar cada copia de seguridad completa (JSON de ~1 KB) hace que las
+ * copias frecuentes desgasten la flash. Pero de una versión a la siguiente
+ * suelen cambiar pocos bytes, así que se hace como en el vídeo comprimido:
+ *
+ *     [FULL v3][DELTA v4][DELTA v5][DELTA v6] ...
+ *
+ * La primera versión del archivo es una imagen completa (FULL) y las demás
+ * guardan solo los tramos de bytes que cambian respecto a la anterior. Las
+ * imágenes usan ConfigCodec::BinaryLayout::FIXED, donde cada campo ocupa
+ * siempre la misma posición: cambiar el umbral de humedad produce un delta
+ * de como mucho 7 bytes (3 de cabecera de tramo + 4 del valor).
+ *
+ * Cada versión lleva el hash de su imagen: si la configuración no ha
+ * cambiado desde la última versión, store() no escribe nada. Por eso
+ * ConfigManager puede guardar una versión tras cada cambio sin coste.
+ *
+ * Formato de /config/backup/versions.bin:
+ *
+ *     BackupFileHeader | (BackupRecordHeader | payload)*
+ *     payload FULL:  imagen FIXED completa
+ *     payload DELTA: (offset u16 | longitud u8 | bytes)*
+ *
+ * Al llegar a MAX_RECORDS versiones el archivo se compacta: se reescribe con
+ * las MAX_VERSIONS más recientes, la más antigua convertida en FULL. Si el
+ * esquema cambia (otro schemaId) el historial antiguo ya no se puede leer y
+ * se descarta.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include "ConfigCodec.h"
+
+namespace BackupStoreConfig {
+    constexpr const char* STORE_PATH = "/config/backup/versions.bin";
+    constexpr const char* TEMP_PATH = "/config/backup/versions.tmp";
+    constexpr uint8_t MAX_VERSIONS = 8;            // Versiones que sobreviven a una compactación
+    constexpr uint8_t MAX_RECORDS = 16;            // Versiones en el archivo antes de compactar
+    constexpr size_t IMAGE_SIZE = ConfigCodec::MAX_BINARY_SIZE;
+    constexpr uint32_t FILE_MAGIC = 0x31424352;    // "RCB1"
+    constexpr uint32_t MIN_VALID_EPOCH = 1577836800;   // 2020-01-01: reloj en hora
+}
+
+static_assert(BackupStoreConfig::IMAGE_SIZE <= 0xFFFF, "Los offsets de los tramos son de 16 bits");
+
+/**
+ * @brief Tipo de payload de una versión.
+ */
+enum class BackupKind : uint8_t {
+    FULL = 0,
+    DELTA = 1
+};
+
+struct BackupFileHeader {
+    uint32_t magic;             // FILE_MAGIC
+    uint32_t schemaId;          // ConfigCodec::schemaId() al escribir el archivo
+};
+
+static_assert(sizeof(BackupFileHeader) == 8, "BackupFileHeader se guarda tal cual en flash");
+
+/**
+ * @brief Cabecera de cada versión en el archivo (precede al payload).
+ */
+struct BackupRecordHeader {
+    uint32_t version;           // Creciente, nunca se reutiliza
+    uint32_t timestamp;         // Hora Unix (0 = reloj sin poner en hora)
+    uint32_t contentHash;       // FNV-1a de la imagen FIXED completa
+    uint16_t payloadLength;
+    uint8_t kind;               // BackupKind
+    uint8_t reserved;
+};
+
+static_assert(sizeof(BackupRecordHeader) == 16, "BackupRecordHeader se guarda tal cual en flash");
+
+/**
+ * @brief Entrada del índice en RAM: la cabecera más su posición en el archivo.
+ */
+struct BackupVersionInfo {
+    BackupRecordHeader header;
+    uint32_t offset;            // Posición de la cabecera en el archivo
+};
+
+/**
+ * @class ConfigBackupStore
+ * @brief Versiones de la configuración con deduplicación y restauración por número.
+ */
+class ConfigBackupStore {
+public:
+    static ConfigBackupStore& getInstance() {
+        static ConfigBackupStore instance;
+        return instance;
+    }
+
+    /**
+     * @brief Lee el archivo y reconstruye el índice (SPIFFS ya montado).
+     *
+     * Un archivo truncado (corte de corriente a mitad de escritura) conserva
+     * las versiones completas anteriores al corte.
+     */
+    bool begin();
+
+    /**
+     * @brief Guarda `config` como nueva versión si difiere de la última.
+     * @param written false si era idéntica a la última versión (no se escribe nada)
+     * @return Número de versión que contiene `config`; 0 si hubo un error
+     */
+    uint32_t store(const SystemConfig& config, bool& written);
+
+    /**
+     * @brief Reconstruye una versión aplicando los deltas desde su FULL.
+     * @param version Número de versión; 0 = la más reciente
+     */
+    bool load(uint32_t version, SystemConfig& out);
+
+    /**
+     * @brief Copia el índice, de la versión más antigua a la más reciente.
+     * @return Número de versiones copiadas
+     */
+    uint8_t listVersions(BackupVersionInfo* out, uint8_t maxVersions) const;
+
+    uint8_t getVersionCount() const { return recordCount; }
+    uint32_t getLatestVersion() const;
+
+    /**
+     * @brief Bytes que ocupa el archivo en flash.
+     */
+    uint32_t getStoredBytes() const { return storedBytes; }
+
+private:
+    ConfigBackupStore();
+    ConfigBackupStore(const ConfigBackupStore&) = delete;
+    ConfigBackupStore& operator=(const ConfigBackupStore&) = delete;
+
+    /**
+     * @brief Reescribe el archivo con las `keep` versiones más recientes.
+     */
+    bool compact(uint8_t keep);
+    bool resetFile();
+    int findVersion(uint32_t version) const;
+
+    BackupVersionInfo records[BackupStoreConfig::MAX_RECORDS];
+    uint8_t recordCount;
+    uint32_t nextVersion;
+    uint32_t storedBytes;
+    bool started;
+
+    // Imagen de la última versión: base del siguiente delta sin releer la flash
+    uint8_t lastImage[BackupStoreConfig::IMAGE_SIZE];
+};
+
+#endif // __CONFIG_BACKUP_STORE_H__
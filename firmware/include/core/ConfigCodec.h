@@ -0,0 +1,158 @@
+#ifndef __CONFIG_CODEC_H__
+#define __CONFIG_CODEC_H__
+
+/**
+ * @file ConfigCodec.h
+ * @brief Codificadores, validación, defectos y diff generados desde ConfigSchema.h.
+ *
+ * Todas las funciones se generan expandiendo SYSTEM_CONFIG_FIELDS y
+ * ZONE_CONFIG_FIELDS; ninguna lista los campos a mano.
+ *
+ * **FORMATO BINARIO** (little-endian, como la memoria del ESP32):
+ *
+ *     magic u32 "RCF1" | schemaId u32 | campos del sistema | zonas
+ *     escalar: sizeof(tipo) bytes
+ *     cadena:  longitud u8 | bytes             (COMPACT)
+ *              longitud u8 | bytes | ceros     (FIXED, hasta la capacidad)
+ *
+ * En FIXED cada campo ocupa siempre la misma posición y el tamaño es
+ * MAX_BINARY_SIZE: dos versiones se pueden comparar byte a byte, que es lo
+ * que necesitan los deltas de ConfigBackupStore.
+ *
+ * schemaId es un hash de los tipos y nombres de los campos: si el esquema
+ * cambia, los binarios antiguos se rechazan en lugar de leerse desplazados.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "ConfigSchema.h"
+
+/**
+ * @brief Un identificador por campo escalar o cadena del sistema (generado).
+ */
+enum class ConfigField : uint8_t {
+#define CONFIG_FIELD_ENUM_X(type, name, def, min, max)  name,
+#define CONFIG_FIELD_ENUM_S(name, def, capacity)        name,
+    SYSTEM_CONFIG_FIELDS(CONFIG_FIELD_ENUM_X, CONFIG_FIELD_ENUM_S)
+#undef CONFIG_FIELD_ENUM_X
+#undef CONFIG_FIELD_ENUM_S
+    COUNT
+};
+
+static_assert(static_cast<uint8_t>(ConfigField::COUNT) <= 32, "ConfigDiff::fields es una máscara de 32 bits");
+
+/**
+ * @brief Qué ha cambiado entre dos configuraciones.
+ */
+struct ConfigDiff {
+    uint32_t fields;            // Bit N = ConfigField N distinto
+    uint8_t zones;              // Bit N = algún campo de la zona N distinto
+
+    bool any() const { return fields != 0 || zones != 0; }
+    bool has(ConfigField field) const { return fields & (1UL << static_cast<uint8_t>(field)); }
+};
+
+static_assert(CONFIG_SECTION_COUNT <= 16, "ConfigFingerprint::changedSections es una máscara de 16 bits");
+
+/**
+ * @brief Huella de una configuración: generación + un hash por sección.
+ *
+ * **CONCEPTO EDUCATIVO - DETECCIÓN DE CAMBIOS EN O(1)**:
+ * Comparar dos configuraciones campo a campo cuesta tanto como la
+ * configuración. Con la huella, "¿ha cambiado algo?" es comparar la
+ * generación (un entero que sube con cada cambio guardado) y "¿qué
+ * secciones han cambiado?" es comparar CONFIG_SECTION_COUNT hashes, un
+ * número fijo. Los hashes se calculan una sola vez, al aplicar el cambio.
+ */
+struct ConfigFingerprint {
+    uint32_t generation;
+    uint32_t sections[CONFIG_SECTION_COUNT];
+
+    bool sameGeneration(const ConfigFingerprint& other) const { return generation == other.generation; }
+
+    /**
+     * @return Bit N = ConfigSection N distinta
+     */
+    uint16_t changedSections(const ConfigFingerprint& other) const {
+        uint16_t mask = 0;
+        for (uint8_t s = 0; s < CONFIG_SECTION_COUNT; s++) {
+            if (sections[s] != other.sections[s]) {
+                mask |= static_cast<uint16_t>(1u << s);
+            }
+        }
+        return mask;
+    }
+};
+
+namespace ConfigCodec {
+    constexpr uint32_t BINARY_MAGIC = 0x31464352;      // "RCF1"
+
+    enum class BinaryLayout : uint8_t { COMPACT, FIXED };
+
+#define CONFIG_SIZE_X(type, name, def, min, max)    + sizeof(type)
+#define CONFIG_SIZE_S(name, def, capacity)          + 1 + (capacity)
+    /**
+     * @brief Tamaño máximo de la codificación binaria (calculado en compilación).
+     */
+    constexpr size_t MAX_BINARY_SIZE = 2 * sizeof(uint32_t)
+        SYSTEM_CONFIG_FIELDS(CONFIG_SIZE_X, CONFIG_SIZE_S)
+        + MAX_ZONES * (0 ZONE_CONFIG_FIELDS(CONFIG_SIZE_X));
+#undef CONFIG_SIZE_X
+#undef CONFIG_SIZE_S
+
+    /**
+     * @brief Hash de tipos y nombres de los campos (identifica el esquema).
+     */
+    uint32_t schemaId();
+
+    void applyDefaults(SystemConfig& config);
+
+    /**
+     * @brief Comprueba rangos y longitudes.
+     * @param error Nombre del primer campo inválido
+     */
+    bool validate(const SystemConfig& config, String& error);
+
+    void toJson(const SystemConfig& config, JsonObject out);
+
+    /**
+     * @brief Aplica sobre `config` los campos presentes en `in` (los ausentes no cambian).
+     * @param error Campo con tipo incorrecto o cadena demasiado larga
+     */
+    bool fromJson(JsonObjectConst in, SystemConfig& config, String& error);
+
+    /**
+     * @return Bytes escritos; 0 si no caben en capacity
+     */
+    size_t encodeBinary(const SystemConfig& config, uint8_t* out, size_t capacity,
+                        BinaryLayout layout = BinaryLayout::COMPACT);
+
+    bool decodeBinary(const uint8_t* in, size_t length, SystemConfig& config,
+                      BinaryLayout layout = BinaryLayout::COMPACT);
+
+    ConfigDiff diff(const SystemConfig& before, const SystemConfig& after);
+
+    /**
+     * @brief Lista los nombres cambiados ("logLevel", "zones[2]", ...).
+     */
+    void writeDiffJson(const ConfigDiff& changes, JsonArray out);
+
+    /**
+     * @brief Calcula el hash de cada sección (FNV-1a sobre los campos).
+     */
+    ConfigFingerprint fingerprint(const SystemConfig& config, uint32_t generation);
+
+    /**
+     * @brief Nombre de la sección ("NETWORK", "SAFETY", ...); las zonas devuelven "ZONE".
+     */
+    const char* sectionName(ConfigSection section);
+
+    const char* fieldName(ConfigField field);
+}
+
+#endif // __CONFIG_CODEC_H__
@@ -20,54 +20,12 @@
 #include <stdint.h>   // For standard integer types
 #include <WString.h>  // For String class - required for SystemConfig
 
-// Número de zonas del sistema (configurable pero con máximo de 5)
-constexpr uint8_t MAX_ZONES = 5;
-
-/**
- * @brief Estructura de configuración para cada zona de riego.
- */
-struct ZoneConfig {
-    uint8_t zoneNumber;           // Número de zona (1-5)
-    bool enabled;                 // Zona habilitada
-    uint32_t irrigationTimeSec;   // Tiempo de riego en segundos
-    uint32_t intervalMin;         // Intervalo entre activaciones en minutos
-    uint8_t servoOpenAngle;       // Ángulo de apertura del servo (0-180)
-    uint32_t transitionTimeMs;    // Tiempo de transición entre zonas en ms
-};
-
-/**
- * @brief Estructura de configuración global del sistema.
- */
-struct SystemConfig {
-    // Configuración de red
-    String wifiSSID;
-    String wifiPassword;
-    bool wifiAPMode;
-
-    // Configuración de RTC
-    bool rtcAutoSync;
-    String ntpServer;
-
-    // Configuración de válvula principal
-    uint32_t mainValveTimeSec;
-
-    // Configuración de sensores
-    int humidityThreshold;
-    int temperatureThreshold;
-
-    // Configuración de seguridad
-    uint32_t maxIrrigationTimeMin;
-    uint32_t emergencyTimeoutMs;
-    uint8_t maxRetryAttempts;
-
-    // Configuración de logging
-    uint8_t logLevel; // 0: ERROR, 1: WARN, 2: INFO, 3: DEBUG
-    bool logToFile;
-    uint32_t logFileSizeKB;
-
-    // Configuración de zonas
-    ZoneConfig zones[MAX_ZONES];
-};
+// SystemConfig y ZoneConfig se generan desde el esquema único
+#include "ConfigSchema.h"
+#include "ConfigCodec.h"  // ConfigFingerprint
+#include "Seqlock.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 /**
  * @class ConfigManager
@@ -78,13 +36,33 @@ private:
     static ConfigManager* instance;
     SystemConfig config;
     const char* configPath = "/config/system_config.json";
-    const char* backupPath = "/config/backup/system_config.bak";
     bool _firstBoot = true; // First boot flag
+    uint32_t generation = 0;        // Sube con cada cambio aplicado
+    ConfigFingerprint fingerprint;  // Hashes por sección de `config`
+
+    // Los cambios llegan desde AsyncTCP (HTTP) y desde el loop (serie): el
+    // mutex (recursivo: importConfig → updateConfig) los hace de uno en uno.
+    // El loop no toma el mutex: copia la configuración publicada con seqlock
+    // en commit(), que nunca está a medias aunque se esté guardando otra
+    StaticSemaphore_t writeLockBuffer;
+    SemaphoreHandle_t writeLock;
+    Seqlock<SystemConfig> published;
 
     ConfigManager(); // Constructor privado para singleton
 
+    /**
+     * @brief Aplica `newConfig` como actual: nueva generación y nueva huella.
+     */
+    void commit(const SystemConfig& newConfig);
+
     bool loadConfiguration();
     bool saveConfiguration();
+
+    /**
+     * @brief Escribe `toSave` en flash sin aplicarla: updateConfig() y
+     * resetToDefaults() solo hacen commit() si la escritura ha ido bien.
+     */
+    bool writeConfigFile(const SystemConfig& toSave);
     bool validateConfiguration() const;
     void setDefaultConfiguration();
 
@@ -110,9 +88,45 @@ public:
 
     /**
      * @brief Obtiene la configuración actual del sistema.
+     *
+     * Es una referencia al original: solo para la tarea que aplica los
+     * cambios. Desde otra tarea, usar copyConfig() o snapshotIfChanged().
      */
     const SystemConfig& getConfig() const;
 
+    /**
+     * @brief Copia la configuración publicada (seqlock), segura desde
+     * cualquier tarea aunque otra esté aplicando un cambio.
+     */
+    void copyConfig(SystemConfig& out) const;
+
+    /**
+     * @brief Generación de la configuración actual (0 = aún sin cargar).
+     *
+     * Quien guarde la generación que vio puede saber en O(1) si hay algo
+     * nuevo, sin copiar ni comparar la configuración.
+     */
+    uint32_t getGeneration() const;
+
+    /**
+     * @brief Huella actual; changedSections() contra una huella anterior
+     * dice qué secciones han cambiado.
+     */
+    const ConfigFingerprint& getFingerprint() const;
+
+    /**
+     * @brief Copia la configuración si ha cambiado desde `seenGeneration`.
+     *
+     * SystemConfig es trivialmente copiable: la copia es un memcpy sin
+     * reservas de memoria. Se copia la versión publicada (seqlock), así que
+     * es segura desde cualquier tarea aunque otra esté aplicando un cambio,
+     * y la generación devuelta es exactamente la de la copia.
+     *
+     * @param seenGeneration Entrada: última generación vista; salida: la actual
+     * @return true si había cambios y `out` se ha actualizado
+     */
+    bool snapshotIfChanged(uint32_t& seenGeneration, SystemConfig& out) const;
+
     /**
      * @brief Actualiza la configuración completa del sistema.
      */
@@ -149,14 +163,20 @@ public:
     String getConfigHash() const;
 
     /**
-     * @brief Crea una copia de seguridad de la configuración.
+     * @brief Guarda la configuración actual como versión en ConfigBackupStore.
+     *
+     * Cada cambio aplicado ya crea su versión automáticamente; si la
+     * configuración no ha cambiado desde la última, no se escribe nada.
+     *
+     * @param version Si no es nullptr, recibe el número de versión
      */
-    bool createBackup();
+    bool createBackup(uint32_t* version = nullptr);
 
     /**
-     * @brief Restaura la configuración desde una copia de seguridad.
+     * @brief Restaura una versión guardada.
+     * @param version Número de versión; 0 = la más reciente
      */
-    bool restoreBackup();
+    bool restoreBackup(uint32_t version = 0);
 };
 
 #endif // __CONFIG_MANAGER_H__
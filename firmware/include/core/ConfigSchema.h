@@ -0,0 +1,161 @@
+#ifndef __CONFIG_SCHEMA_H__
+#define __CONFIG_SCHEMA_H__
+
+/**
+ * @file ConfigSchema.h
+ * @brief Esquema único de la configuración persistente (X-macros).
+ *
+ * **CONCEPTO EDUCATIVO - X-MACROS**:
+ * Cada campo de la configuración necesita lo mismo en varios sitios: la
+ * declaración en el struct, su valor por defecto, su rango válido, su clave
+ * JSON, su codificación binaria y su comparación. Si cada sitio lista los
+ * campos a mano, tarde o temprano uno se queda atrás (un campo nuevo que no
+ * se guarda, o que no se valida).
+ *
+ * Con una X-macro la lista de campos se escribe UNA vez, y cada sitio la
+ * "expande" pasando su propia macro X:
+ *
+ *     #define DECLARAR(tipo, nombre, ...)   tipo nombre;
+ *     SYSTEM_CONFIG_FIELDS(DECLARAR, ...)   // -> bool wifiAPMode; bool rtcAutoSync; ...
+ *
+ *     #define A_JSON(tipo, nombre, ...)     out[#nombre] = config.nombre;
+ *     SYSTEM_CONFIG_FIELDS(A_JSON, ...)     // -> out["wifiAPMode"] = config.wifiAPMode; ...
+ *
+ * El resultado es código en línea recta generado por el preprocesador: sin
+ * tablas que recorrer ni búsquedas por nombre en tiempo de ejecución.
+ *
+ * Columnas:
+ *
+ *     X(tipo, campo, defecto, mínimo, máximo)    campos escalares
+ *     S(campo, defecto, capacidad)               cadenas (capacidad sin el '\0')
+ *
+ * La clave JSON es el nombre del campo. En las zonas, el defecto puede
+ * depender de `i`, el índice de la zona.
+ *
+ * Los campos se agrupan en secciones (red, RTC, ...). Las cadenas son
+ * arrays de tamaño fijo: SystemConfig no tiene punteros ni memoria
+ * dinámica, así que copiarla es un memcpy y puede guardarse tal cual en
+ * memoria RTC o compararse byte a byte.
+ *
+ * Para añadir un campo basta con añadir una fila: el struct, los defectos,
+ * la validación, JSON, binario y el diff se actualizan solos (ver
+ * ConfigCodec.cpp). El formato binario cambia de identificador al cambiar
+ * el esquema, así que un binario antiguo se descarta en lugar de leerse mal.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <WString.h>
+#include <type_traits>
+
+// Número de zonas del sistema (configurable pero con máximo de 5)
+constexpr uint8_t MAX_ZONES = 5;
+
+#define CONFIG_NETWORK_FIELDS(X, S) \
+    S(wifiSSID,                                 "",                     32) \
+    S(wifiPassword,                             "",                     64) \
+    X(bool,     wifiAPMode,                     true,                   0, 1)
+
+#define CONFIG_RTC_FIELDS(X, S) \
+    X(bool,     rtcAutoSync,                    true,                   0, 1) \
+    S(ntpServer,                                "pool.ntp.org",         63)
+
+#define CONFIG_MAIN_VALVE_FIELDS(X, S) \
+    X(uint32_t, mainValveTimeSec,               3600,                   0, 86400)
+
+#define CONFIG_SENSOR_FIELDS(X, S) \
+    X(int,      humidityThreshold,              SensorConfig::Humidity::DEFAULT_THRESHOLD, \
+                                                SensorConfig::Humidity::MIN_THRESHOLD, \
+                                                SensorConfig::Humidity::MAX_THRESHOLD) \
+    X(int,      temperatureThreshold,           35,                     -20, 60)
+
+#define CONFIG_SAFETY_FIELDS(X, S) \
+    X(uint32_t, maxIrrigationTimeMin,           SystemSafety::MAX_TOTAL_IRRIGATION_TIME, 1, 1440) \
+    X(uint32_t, emergencyTimeoutMs,             SystemSafety::EMERGENCY_STOP_TIMEOUT, 100, 60000) \
+    X(uint8_t,  maxRetryAttempts,               SystemSafety::MAX_RETRY_ATTEMPTS, 0, 10)
+
+/* logLevel: 0: ERROR, 1: WARN, 2: INFO, 3: DEBUG, 4: VERBOSE */
+#define CONFIG_LOGGING_FIELDS(X, S) \
+    X(uint8_t,  logLevel,                       2,                      0, 4) \
+    X(bool,     logToFile,                      true,                   0, 1) \
+    X(uint32_t, logFileSizeKB,                  16,                     4, 256)
+
+/**
+ * Secciones del sistema: SECTION(identificador, macro de campos). Cada zona
+ * es además una sección propia (ver ConfigSection).
+ */
+#define CONFIG_SECTIONS(SECTION) \
+    SECTION(NETWORK,    CONFIG_NETWORK_FIELDS) \
+    SECTION(RTC,        CONFIG_RTC_FIELDS) \
+    SECTION(MAIN_VALVE, CONFIG_MAIN_VALVE_FIELDS) \
+    SECTION(SENSORS,    CONFIG_SENSOR_FIELDS) \
+    SECTION(SAFETY,     CONFIG_SAFETY_FIELDS) \
+    SECTION(LOGGING,    CONFIG_LOGGING_FIELDS)
+
+#define SYSTEM_CONFIG_FIELDS(X, S) \
+    CONFIG_NETWORK_FIELDS(X, S) \
+    CONFIG_RTC_FIELDS(X, S) \
+    CONFIG_MAIN_VALVE_FIELDS(X, S) \
+    CONFIG_SENSOR_FIELDS(X, S) \
+    CONFIG_SAFETY_FIELDS(X, S) \
+    CONFIG_LOGGING_FIELDS(X, S)
+
+#define ZONE_CONFIG_FIELDS(X) \
+    X(uint8_t,  zoneNumber,                     i + 1,                  1, MAX_ZONES) \
+    X(bool,     enabled,                        true,                   0, 1) \
+    X(uint32_t, irrigationTimeSec,              ServoConfig::Timing::ZONE_TIMES[i], \
+                                                ServoConfig::Timing::MIN_IRRIGATION_TIME, \
+                                                ServoConfig::Timing::MAX_IRRIGATION_TIME) \
+    X(uint32_t, intervalMin,                    1440,                   1, 10080) \
+    X(uint8_t,  servoOpenAngle,                 ServoConfig::Angles::ZONE_ANGLES[i], 0, 180) \
+    X(uint32_t, transitionTimeMs,               ServoConfig::Timing::TRANSITION_TIME * 1000, \
+                                                0, ServoConfig::Timing::MAX_TRANSITION_TIME * 1000)
+
+// =============================================================================
+// Structs generados desde el esquema
+// =============================================================================
+
+#define CONFIG_DECLARE_SCALAR(type, name, def, min, max)    type name;
+#define CONFIG_DECLARE_STRING(name, def, capacity)          char name[(capacity) + 1];
+
+/**
+ * @brief Estructura de configuración para cada zona de riego.
+ */
+struct ZoneConfig {
+    ZONE_CONFIG_FIELDS(CONFIG_DECLARE_SCALAR)
+};
+
+/**
+ * @brief Estructura de configuración global del sistema.
+ */
+struct SystemConfig {
+    SYSTEM_CONFIG_FIELDS(CONFIG_DECLARE_SCALAR, CONFIG_DECLARE_STRING)
+
+    // Configuración de zonas
+    ZoneConfig zones[MAX_ZONES];
+};
+
+static_assert(std::is_trivially_copyable<SystemConfig>::value,
+              "SystemConfig debe poder copiarse con memcpy (snapshots, memoria RTC)");
+
+/**
+ * @brief Secciones de la configuración: las del sistema y una por zona.
+ */
+enum class ConfigSection : uint8_t {
+#define CONFIG_SECTION_ENUM(id, FIELDS) id,
+    CONFIG_SECTIONS(CONFIG_SECTION_ENUM)
+#undef CONFIG_SECTION_ENUM
+    ZONE_FIRST,
+    COUNT = ZONE_FIRST + MAX_ZONES
+};
+
+constexpr uint8_t CONFIG_SECTION_COUNT = static_cast<uint8_t>(ConfigSection::COUNT);
+
+#undef CONFIG_DECLARE_SCALAR
+#undef CONFIG_DECLARE_STRING
+
+#endif // __CONFIG_SCHEMA_H__
@@ -0,0 +1,171 @@
+/**
+ * @file ConfigStreamParser.h
+ * @brief Análisis incremental del JSON de configuración, directo sobre SystemConfig.
+ *
+ * **CONCEPTO EDUCATIVO - ANÁLISIS EN FLUJO (ESTILO SAX)**:
+ * Para importar un JSON lo habitual es juntar el cuerpo entero en un
+ * String, analizarlo en un DynamicJsonDocument y copiar de ahí los campos:
+ * tres copias del mismo dato y una memoria de pico que crece con el tamaño
+ * del cuerpo. Aquí cada byte se procesa según llega, con una máquina de
+ * estados que solo guarda:
+ *
+ * - la pila de contenedores abiertos ('{' o '['), como mucho MAX_DEPTH
+ * - la clave actual y el token en curso (cadena o número), de tamaño fijo
+ * - la configuración de destino (una copia de la actual)
+ *
+ * Cuando termina un valor, su clave se busca en el esquema (ConfigSchema.h)
+ * y se comprueban en el acto el tipo, el rango y la longitud: el primer
+ * campo inválido corta el análisis sin esperar al resto del cuerpo. La
+ * semántica es la de ConfigCodec::fromJson: solo cambian los campos
+ * presentes, las claves desconocidas (y lo que contengan) se ignoran y
+ * null equivale a ausente.
+ *
+ * Un solo análisis a la vez (instancia estática), con el mismo esquema
+ * acquire/release por token que los cursores de exportación.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __CONFIG_STREAM_PARSER_H__
+#define __CONFIG_STREAM_PARSER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include "ConfigSchema.h"
+
+namespace ConfigStreamConfig {
+    constexpr size_t MAX_BODY_BYTES = 8192;        // Tope del cuerpo (el JSON completo ocupa ~1 KB)
+    constexpr uint8_t MAX_DEPTH = 8;               // Anidamiento máximo, incluido lo ignorado
+    constexpr size_t MAX_KEY_CHARS = 31;           // Claves más largas se tratan como desconocidas
+    constexpr size_t MAX_TOKEN_CHARS = 64;         // >= capacidad de la cadena más larga del esquema
+}
+
+/**
+ * @brief Estado del análisis.
+ */
+enum class ConfigParseResult : uint8_t {
+    PENDING,        // Faltan bytes
+    COMPLETE,       // Documento cerrado y todos los campos válidos
+    INVALID,        // JSON mal formado o campo inválido (ver getError())
+    TOO_LARGE       // Supera MAX_BODY_BYTES
+};
+
+/**
+ * @class ConfigStreamParser
+ * @brief Decodificador incremental de JSON a SystemConfig.
+ */
+class ConfigStreamParser {
+public:
+    /**
+     * @brief Reserva el analizador partiendo de la configuración base.
+     * @param base Configuración sobre la que se aplican los campos recibidos
+     * @param expectedBytes Content-Length anunciado (0 si se desconoce);
+     *        si supera MAX_BODY_BYTES se rechaza antes del primer byte
+     * @return nullptr si ya hay un análisis en curso
+     */
+    static ConfigStreamParser* acquire(uint32_t& token, const SystemConfig& base, size_t expectedBytes);
+
+    /**
+     * @brief Libera el analizador (idempotente).
+     */
+    void release(uint32_t token);
+
+    /**
+     * @brief Procesa un trozo del cuerpo. Tras un error ignora lo que llegue.
+     */
+    ConfigParseResult feed(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Fin del cuerpo: COMPLETE solo si el objeto raíz se cerró.
+     */
+    ConfigParseResult finish();
+
+    /**
+     * @brief Configuración resultante (válida con COMPLETE).
+     */
+    const SystemConfig& getConfig() const { return staging; }
+
+    /**
+     * @brief Campo inválido ("zones[1].intervalMin") o "JSON" si es de sintaxis.
+     */
+    const String& getError() const { return error; }
+
+private:
+    ConfigStreamParser();
+
+    enum class Lex : uint8_t {
+        VALUE,              // Se espera un valor
+        VALUE_OR_CLOSE,     // Tras '['
+        KEY,                // Tras ',' en un objeto
+        KEY_OR_CLOSE,       // Tras '{'
+        COLON,
+        COMMA_OR_CLOSE,
+        STRING,
+        ESCAPE,             // Tras '\'
+        UNICODE,            // Dígitos de \uXXXX
+        LITERAL,            // Número, true, false o null
+        END                 // Raíz cerrada: solo espacios
+    };
+
+    enum class Scalar : uint8_t { STRING, NUMBER, BOOL_TRUE, BOOL_FALSE, NULL_VALUE };
+
+    /**
+     * @brief Posición del valor actual en el documento.
+     */
+    enum class Slot : uint8_t { ROOT, ROOT_FIELD, ZONE_ELEMENT, ZONE_FIELD, IGNORED };
+
+    void reset(const SystemConfig& base, size_t expectedBytes);
+    bool handleByte(char c);
+    bool handleStructural(char c);
+    bool beginContainer(bool object);
+    bool endContainer(bool object);
+    bool endString();
+    bool endLiteral();
+    void appendToken(char c);
+    void appendUtf8(uint32_t codepoint);
+
+    Slot currentSlot() const;
+    bool handleScalar(Scalar kind);
+    bool assignRootField(Scalar kind);
+    bool assignZoneField(Scalar kind);
+    bool isKnownField(bool zone) const;
+
+    template <typename T>
+    bool assignScalar(T& target, Scalar kind, long long min, long long max);
+    bool assignString(char* target, Scalar kind, size_t capacity);
+    bool fail(const String& field);
+
+    static ConfigStreamParser instance;
+    static uint32_t nextToken;
+
+    bool inUse;
+    uint32_t token;
+    ConfigParseResult result;
+    String error;
+    size_t received;
+    SystemConfig staging;
+
+    // Léxico
+    Lex lex;
+    bool stringIsKey;
+    uint8_t unicodeDigits;
+    uint32_t unicodeValue;
+    uint16_t pendingHighSurrogate;
+    char tokenText[ConfigStreamConfig::MAX_TOKEN_CHARS + 1];
+    size_t tokenLength;
+    bool tokenOverflow;
+
+    // Estructura
+    bool stackIsObject[ConfigStreamConfig::MAX_DEPTH];
+    uint8_t depth;
+    uint8_t skipDepth;                  // 0 = no se ignora nada
+    char key[ConfigStreamConfig::MAX_KEY_CHARS + 1];
+    bool keyOverflow;
+    bool inZones;
+    uint8_t zoneCount;                  // Zonas abiertas; la actual es zoneCount - 1
+};
+
+#endif // __CONFIG_STREAM_PARSER_H__
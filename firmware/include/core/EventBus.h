@@ -41,6 +41,7 @@ enum class EventType {
     IRRIGATION_STOPPED,
     IRRIGATION_ZONE_CHANGED,
     IRRIGATION_TIME_UPDATED,
+    IRRIGATION_PULSE_COMPLETED,     // customData: const PulseRecord*
     
     // Eventos de red
     WIFI_CONNECTED,
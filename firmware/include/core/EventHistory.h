@@ -0,0 +1,178 @@
+/**
+ * @file EventHistory.h
+ * @brief Historial persistente de eventos de riego en SPIFFS.
+ *
+ * **CONCEPTO EDUCATIVO - REGISTROS BINARIOS DE TAMAÑO FIJO**:
+ * Para analizar meses de riego no sirve el log de texto: ocupa mucho y hay
+ * que parsearlo. Aquí cada evento es un registro binario de 12 bytes
+ * (instante, zona, tipo de evento, valor) que se añade al final de un
+ * archivo. Leer el registro N es leer 12 bytes en N*12.
+ *
+ * Para no desgastar la flash con una escritura por evento, los registros se
+ * acumulan en RAM y se escriben en grupo (cuando el búfer se llena o cada
+ * FLUSH_INTERVAL_MS). El historial ocupa como mucho dos archivos: cuando el
+ * actual se llena pasa a ser el antiguo y el anterior antiguo se borra.
+ *
+ * La exportación (HistoryExport) lee los archivos desde la tarea del
+ * servidor web; mientras dura, el historial queda "fijado": las escrituras
+ * a flash se aplazan y los eventos esperan en RAM.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __EVENT_HISTORY_H__
+#define __EVENT_HISTORY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace HistoryConfig {
+    constexpr const char* HISTORY_PATH = "/history.bin";       // Archivo en curso
+    constexpr const char* HISTORY_OLD_PATH = "/history.old";   // Archivo anterior
+    constexpr size_t MAX_FILE_BYTES = 65536;                   // ~5400 eventos por archivo
+    constexpr uint8_t RAM_BUFFER_RECORDS = 16;                 // Eventos a la espera de flash
+    constexpr uint32_t FLUSH_INTERVAL_MS = 60000;              // Escritura periódica
+    constexpr uint32_t MIN_VALID_EPOCH = 1577836800;           // 2020-01-01: reloj en hora
+}
+
+/**
+ * @brief Tipos de evento registrados.
+ *
+ * Los valores se guardan en flash: añadir al final, nunca reordenar.
+ */
+enum class HistoryEvent : uint8_t {
+    BOOT = 0,               // Arranque del equipo
+    CYCLE_STARTED = 1,      // value: 1 si es automático
+    CYCLE_COMPLETED = 2,    // value: ciclos completados
+    CYCLE_STOPPED = 3,      // Parada manual del ciclo
+    ZONE_WATERED = 4,       // value: segundos regados
+    PULSE_COMPLETED = 5,    // value: segundos del pulso (ciclo y remojo)
+    MANUAL_OPEN = 6,        // value: duración pedida en segundos
+    MANUAL_CLOSE = 7,
+    SERVO_FAULT = 8,        // value: número de reintento
+    ZONE_DISABLED = 9,      // Zona deshabilitada por fallos repetidos
+    EMERGENCY_STOP = 10,
+    COUNT
+};
+
+/**
+ * @brief Bits de HistoryRecord::flags.
+ */
+namespace HistoryFlags {
+    constexpr uint8_t UPTIME_CLOCK = 0x01;  // timestamp son segundos desde el arranque (sin hora)
+}
+
+struct HistoryRecord {
+    uint32_t timestamp;     // Segundos Unix (o uptime si UPTIME_CLOCK)
+    uint8_t zone;           // 1-based; 0 = sin zona
+    uint8_t event;          // HistoryEvent
+    uint8_t flags;          // HistoryFlags
+    uint8_t reserved;
+    uint32_t value;
+};
+
+static_assert(sizeof(HistoryRecord) == 12, "HistoryRecord se guarda tal cual en flash");
+
+/**
+ * @class HistoryReader
+ * @brief Recorre los registros en orden cronológico (archivo antiguo y luego actual).
+ *
+ * Solo debe usarse con el historial fijado (EventHistory::pin).
+ */
+class HistoryReader {
+public:
+    HistoryReader() : fileIndex(0), bufferCount(0), bufferPos(0) {}
+
+    void rewind();
+    bool next(HistoryRecord& record);
+    void close();
+
+private:
+    bool refill();
+
+    static constexpr uint8_t BUFFER_RECORDS = 16;
+
+    File file;
+    uint8_t fileIndex;      // 0 = antiguo, 1 = actual, 2 = fin
+    HistoryRecord buffer[BUFFER_RECORDS];
+    uint8_t bufferCount;
+    uint8_t bufferPos;
+};
+
+/**
+ * @class EventHistory
+ * @brief Registro de eventos con escritura agrupada (singleton).
+ */
+class EventHistory {
+public:
+    static EventHistory& getInstance() {
+        static EventHistory instance;
+        return instance;
+    }
+
+    /**
+     * @brief Prepara el historial (SPIFFS ya montado) y registra el arranque.
+     */
+    bool begin();
+
+    /**
+     * @brief Añade un evento (desde el loop).
+     * @param zone Zona 1-based, 0 si el evento no es de una zona
+     */
+    void record(HistoryEvent event, uint8_t zone = 0, uint32_t value = 0);
+
+    /**
+     * @brief Escritura periódica del búfer (llamar en loop principal).
+     */
+    void update();
+
+    /**
+     * @brief Escribe en flash los eventos en RAM (salvo con el historial fijado).
+     */
+    void flush();
+
+    /**
+     * @brief Vuelca la RAM y fija los archivos para leerlos desde otra tarea.
+     */
+    void pin();
+    void unpin();
+
+    /**
+     * @brief Copia los últimos eventos en orden cronológico (desde otra tarea).
+     *
+     * Lee solo el final de los archivos (seek), no el historial entero.
+     *
+     * @return Registros copiados en `out` (como mucho `max`)
+     */
+    uint8_t readRecent(HistoryRecord* out, uint8_t max);
+
+    uint32_t getStoredBytes() const;
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+    static const char* eventToString(HistoryEvent event);
+
+private:
+    EventHistory();
+    EventHistory(const EventHistory&) = delete;
+    EventHistory& operator=(const EventHistory&) = delete;
+
+    void writePendingLocked();
+
+    HistoryRecord pending[HistoryConfig::RAM_BUFFER_RECORDS];
+    uint8_t pendingCount;
+    uint8_t pinCount;
+    bool started;
+    uint32_t lastFlush;
+    uint32_t droppedCount;
+
+    StaticSemaphore_t lockBuffer;
+    SemaphoreHandle_t lock;
+};
+
+#endif // __EVENT_HISTORY_H__
@@ -0,0 +1,159 @@
+/**
+ * @file HistoryExport.h
+ * @brief Exportación del historial en formato columnar compacto (RHC1).
+ *
+ * **CONCEPTO EDUCATIVO - ALMACENAMIENTO COLUMNAR**:
+ * En JSON cada evento repite sus claves y escribe los números como texto:
+ *
+ *     {"t":1735689600,"zone":2,"event":"zone_watered","value":300}   ~60 bytes
+ *
+ * Si en vez de fila a fila se guarda columna a columna, cada columna tiene
+ * datos parecidos entre sí y se puede codificar a su medida:
+ *
+ * - t:     diferencia con el anterior en varint (unos segundos u horas: 1-3 bytes)
+ * - zone:  diccionario de valores distintos + índices de 3 bits
+ * - event: diccionario con nombres + índices de 4 bits
+ * - flags: diccionario (casi siempre 1 valor: 0 bits por fila)
+ * - value: varint
+ *
+ * Resultado: ~4-5 bytes por evento, y opcionalmente DEFLATE encima.
+ *
+ * **FORMATO** (todos los enteros multibyte en varint LEB128):
+ *
+ *     Preámbulo (nunca comprimido): "RHC1" | versión u8 | flags u8 | 0 | 0
+ *         flags bit0 = el resto va comprimido con DEFLATE crudo
+ *     Cuerpo:
+ *         recordCount varint | columnCount u8
+ *         por columna: kind u8 | nameLen u8 | name | datos
+ *           kind 1 DELTA:   recordCount varints zigzag (delta con la fila anterior, la primera desde 0)
+ *           kind 2 DICT:    dictSize varint | dictSize valores u8 | índices empaquetados
+ *           kind 3 VARINT:  recordCount varints
+ *           kind 4 LABELED: como DICT pero cada valor va seguido de labelLen u8 | label
+ *         Los índices ocupan ceil(log2(dictSize)) bits cada uno (0 si hay un
+ *         solo valor), desde el bit menos significativo, y la columna se
+ *         completa hasta byte.
+ *
+ * El documento se genera bajo demanda, columna a columna, releyendo el
+ * historial en flash: no se guarda nunca entero en RAM. scripts/history_to_csv.py
+ * lo convierte a CSV.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __HISTORY_EXPORT_H__
+#define __HISTORY_EXPORT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "EventHistory.h"
+#include "MiniDeflate.h"
+
+namespace HistoryExportConfig {
+    constexpr uint8_t FORMAT_VERSION = 1;
+    constexpr uint8_t FLAG_DEFLATE = 0x01;
+    constexpr const char* CONTENT_TYPE = "application/octet-stream";
+    constexpr size_t RAW_CHUNK = 128;           // Bytes generados de cada vez
+    constexpr uint8_t MAX_LABEL = 24;           // Longitud máxima de una etiqueta de diccionario
+}
+
+/**
+ * @class HistoryExportCursor
+ * @brief Estado reanudable de una exportación (una a la vez, instancia estática).
+ *
+ * Igual que PrometheusCursor: el servidor pide la respuesta a trozos con
+ * fill() y el token protege contra liberaciones tardías.
+ */
+class HistoryExportCursor {
+public:
+    /**
+     * @brief Reserva el cursor y fija el historial.
+     * @param compress Aplicar DEFLATE al cuerpo
+     * @param since Solo eventos con hora Unix >= since (0 = todos)
+     * @return nullptr si ya hay una exportación en curso
+     */
+    static HistoryExportCursor* acquire(uint32_t& token, bool compress, uint32_t since);
+
+    /**
+     * @brief Libera el cursor y el historial (idempotente).
+     */
+    void release(uint32_t token);
+
+    /**
+     * @brief Escribe el siguiente trozo.
+     * @return Bytes escritos; 0 cuando la exportación ha terminado
+     */
+    size_t fill(uint8_t* out, size_t maxLength);
+
+    /**
+     * @brief Byte `kind` de cada columna (KIND_* en scripts/history_to_csv.py).
+     */
+    enum class ColumnKind : uint8_t { DELTA = 1, DICT = 2, VARINT = 3, LABELED = 4 };
+
+private:
+    enum class Phase : uint8_t { SCAN, COLUMN_HEADER, COLUMN_DICT, COLUMN_DATA, DONE };
+
+    /**
+     * @brief Diccionario de una columna: valores presentes y su índice.
+     */
+    struct Dictionary {
+        uint8_t present[32];    // Mapa de bits de los 256 valores posibles
+        uint8_t index[256];     // valor -> índice
+        uint16_t size;
+        uint8_t bits;           // Bits por índice
+
+        void clear();
+        void add(uint8_t value);
+        void build();
+        bool contains(uint8_t value) const { return present[value >> 3] & (1u << (value & 7)); }
+    };
+
+    HistoryExportCursor() : inUse(false), token(0) {}
+
+    void reset(bool compress, uint32_t since);
+    bool accept(const HistoryRecord& record) const;
+    void scan();
+    void produce();
+    void produceColumnHeader();
+    void produceColumnDictionary();
+    void produceColumnData();
+    uint32_t columnValue(const HistoryRecord& record) const;
+    Dictionary* columnDictionary();
+
+    void putByte(uint8_t b) { raw[rawLength++] = b; }
+    void putVarint(uint32_t v);
+    void putBitsPacked(uint32_t value, uint8_t count);
+    void flushPackedBits();
+
+    bool inUse;
+    uint32_t token;
+
+    bool compress;
+    uint32_t since;
+    Phase phase;
+    uint8_t preamblePos;
+
+    uint32_t recordCount;
+    uint32_t emitted;
+    uint8_t column;
+    uint16_t dictValue;         // Siguiente valor del diccionario a escribir
+    uint32_t previousTimestamp;
+    uint32_t bitAccumulator;
+    uint8_t bitCount;
+
+    Dictionary zones;
+    Dictionary events;
+    Dictionary flags;
+
+    HistoryReader reader;
+    uint8_t raw[HistoryExportConfig::RAW_CHUNK];
+    size_t rawLength;
+    size_t rawPos;
+    MiniDeflate deflater;
+
+    static HistoryExportCursor instance;
+    static uint32_t nextToken;
+};
+
+#endif // __HISTORY_EXPORT_H__
@@ -0,0 +1,217 @@
+/**
+ * @file MetricsRegistry.h
+ * @brief Registro estático de métricas y exportación en formato de texto Prometheus.
+ *
+ * **CONCEPTO EDUCATIVO - EXPOSICIÓN SIN CONSTRUIR CADENAS**:
+ * Un scrape de Prometheus cada 15 s no puede permitirse montar un String de
+ * decenas de KB en un ESP32. Aquí cada módulo registra una vez sus familias
+ * de métricas (nombre, ayuda, tipo y una función de muestreo), y la
+ * exportación se genera línea a línea bajo demanda:
+ *
+ *     # HELP riego_cycles_completed_total Ciclos de riego completados
+ *     # TYPE riego_cycles_completed_total counter
+ *     riego_cycles_completed_total 42
+ *
+ * Cada línea se compone en un búfer fijo (MetricLine) y se copia en los
+ * fragmentos que pide el servidor HTTP (respuesta chunked). No se asigna
+ * memoria dinámica: el registro es una tabla fija y los cursores de
+ * exportación salen de un pool estático.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __METRICS_REGISTRY_H__
+#define __METRICS_REGISTRY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MetricsConfig {
+    constexpr uint8_t MAX_METRIC_FAMILIES = 32;     // Familias registrables
+    constexpr size_t MAX_LINE_LENGTH = 192;          // Longitud máxima de una línea
+    constexpr uint8_t MAX_CONCURRENT_SCRAPES = 2;    // Exportaciones simultáneas
+    constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4";
+}
+
+enum class MetricType : uint8_t {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+/**
+ * @brief Resultado de pedir una muestra a una familia.
+ */
+enum class MetricSample : uint8_t {
+    EMITTED,    // Se escribió una línea
+    SKIPPED,    // Índice válido sin línea (p.ej. serie vacía); pedir el siguiente
+    DONE        // No hay más muestras
+};
+
+/**
+ * @brief Compositor de una línea de exposición en un búfer fijo.
+ *
+ * Uso típico dentro de un muestreador:
+ *
+ *     line.begin(family.name);
+ *     line.label("zone", zone + 1);
+ *     line.value(seconds);
+ *
+ * Si la línea no cabe se trunca y se descarta entera (nunca se emite una
+ * línea a medias).
+ */
+class MetricLine {
+public:
+    MetricLine() : len(0), labelsOpen(false), overflow(false) { buffer[0] = '\0'; }
+
+    void begin(const char* name, const char* suffix = nullptr);
+    void label(const char* key, const char* value);
+    void label(const char* key, uint32_t value);
+    void labelMsAsSeconds(const char* key, uint32_t milliseconds);
+
+    void value(uint64_t v);
+    void valueMsAsSeconds(uint64_t milliseconds);
+
+    /**
+     * @brief Línea de comentario (# HELP / # TYPE).
+     */
+    void comment(const char* kind, const char* name, const char* text);
+
+    void clear() { len = 0; labelsOpen = false; overflow = false; buffer[0] = '\0'; }
+    const char* c_str() const { return buffer; }
+    size_t length() const { return overflow ? 0 : len; }
+
+private:
+    void append(const char* text);
+    void append(char c);
+    void appendUnsigned(uint64_t v);
+    void appendMilliseconds(uint64_t milliseconds);
+    void closeLabels();
+
+    char buffer[MetricsConfig::MAX_LINE_LENGTH];
+    size_t len;
+    bool labelsOpen;
+    bool overflow;
+};
+
+struct MetricFamily;
+
+/**
+ * @brief Función que produce la muestra `index` de una familia.
+ *
+ * Se llama con índices crecientes desde 0 hasta que devuelve DONE. Debe ser
+ * barata y sin efectos secundarios: se ejecuta en la tarea del servidor web.
+ * El nombre de la familia y el contexto registrado llegan en `family`.
+ */
+typedef MetricSample (*MetricSampler)(const MetricFamily& family, uint16_t index, MetricLine& line);
+
+struct MetricFamily {
+    const char* name;
+    const char* help;
+    MetricType type;
+    MetricSampler sampler;
+    void* context;
+};
+
+/**
+ * @brief Muestreador de una familia con un único valor sin etiquetas.
+ */
+inline MetricSample singleSample(const MetricFamily& family, uint16_t index, MetricLine& line, uint64_t value) {
+    if (index > 0) {
+        return MetricSample::DONE;
+    }
+    line.begin(family.name);
+    line.value(value);
+    return MetricSample::EMITTED;
+}
+
+/**
+ * @class MetricsRegistry
+ * @brief Tabla fija de familias de métricas (singleton).
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance() {
+        static MetricsRegistry instance;
+        return instance;
+    }
+
+    /**
+     * @brief Registra una familia; si el nombre ya existe actualiza su contexto.
+     *
+     * Los textos deben ser literales o tener vida estática.
+     *
+     * @return false si la tabla está llena
+     */
+    bool add(const char* name, const char* help, MetricType type, MetricSampler sampler, void* context = nullptr);
+
+    /**
+     * @brief Elimina todas las familias asociadas a un contexto (al destruir su dueño).
+     */
+    void removeContext(void* context);
+
+    uint8_t size() const { return count; }
+    const MetricFamily* family(uint8_t index) const { return index < count ? &families[index] : nullptr; }
+
+    static const char* typeToString(MetricType type);
+
+private:
+    MetricsRegistry() : count(0) {}
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    MetricFamily families[MetricsConfig::MAX_METRIC_FAMILIES];
+    uint8_t count;
+};
+
+/**
+ * @class PrometheusCursor
+ * @brief Estado reanudable de una exportación en curso.
+ *
+ * El servidor pide la respuesta a trozos (fill); el cursor recuerda en qué
+ * familia, muestra y byte de la línea actual se quedó. Las instancias salen
+ * de un pool estático; el token evita que una liberación tardía (p.ej. la
+ * desconexión de un scrape ya terminado) libere un cursor reutilizado.
+ */
+class PrometheusCursor {
+public:
+    /**
+     * @brief Obtiene un cursor libre del pool.
+     * @return nullptr si ya hay MAX_CONCURRENT_SCRAPES exportaciones en curso
+     */
+    static PrometheusCursor* acquire(uint32_t& token);
+
+    /**
+     * @brief Devuelve el cursor al pool (idempotente).
+     */
+    void release(uint32_t token);
+
+    /**
+     * @brief Escribe el siguiente trozo de la exposición.
+     * @return Bytes escritos; 0 cuando la exposición ha terminado
+     */
+    size_t fill(uint8_t* out, size_t maxLen);
+
+private:
+    enum class Phase : uint8_t { HELP, TYPE, SAMPLES };
+
+    PrometheusCursor() : inUse(false), token(0) { reset(); }
+    void reset();
+    bool nextLine();
+
+    bool inUse;
+    uint32_t token;
+    bool finished;
+    uint8_t familyIndex;
+    uint16_t sampleIndex;
+    Phase phase;
+    size_t linePos;
+    MetricLine line;
+
+    static PrometheusCursor pool[MetricsConfig::MAX_CONCURRENT_SCRAPES];
+    static uint32_t nextToken;
+};
+
+#endif // __METRICS_REGISTRY_H__
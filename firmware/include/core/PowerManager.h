@@ -0,0 +1,142 @@
+/**
+ * @file PowerManager.h
+ * @brief Reposo en light sleep mientras no hay riego en marcha.
+ *
+ * **CONCEPTO EDUCATIVO - DORMIR ENTRE PLAZOS**:
+ * Sin riego pendiente, loop() daba miles de vueltas por segundo para no
+ * hacer nada: CPU a 240 MHz y radio siempre encendida, decenas de mA
+ * continuos. En instalaciones con placa solar y batería es casi todo el
+ * consumo del día. En reposo el loop no necesita girar: basta despertar
+ * cuando algo tenga que ocurrir.
+ *
+ *     ocupado:  bloqueos PM (CPU al máximo, sin light sleep), radio activa,
+ *               loop sin esperas
+ *     reposo:   sin bloqueos → el planificador baja la frecuencia y, con
+ *               todas las tareas bloqueadas, entra solo en light sleep;
+ *               WiFi en modem sleep (despierta en cada DTIM del AP, así
+ *               HTTP y WebSocket siguen respondiendo con algo más de latencia)
+ *
+ *     loop en reposo:  espera una notificación hasta el plazo más cercano
+ *                      ├── plazo vencido (LED, memoria, informe...)
+ *                      ├── comando encolado (WebSocket / MQTT) → wake()
+ *                      └── cambio en el sensor de humedad (interrupción por nivel)
+ *
+ * Las interrupciones GPIO por flanco no despiertan de light sleep; las de
+ * nivel sí. Antes de dormir se arma el nivel contrario al actual; al
+ * dispararse, la rutina de interrupción la desarma y avisa al loop.
+ *
+ * El reposo necesita CONFIG_PM_ENABLE y, para el light sleep automático,
+ * CONFIG_FREERTOS_USE_TICKLESS_IDLE en el sdkconfig. Sin ellos el loop
+ * igualmente se bloquea entre plazos (la CPU espera en WAITI en lugar de
+ * girar) y la radio usa modem sleep, pero no hay light sleep.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __POWER_MANAGER_H__
+#define __POWER_MANAGER_H__
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_pm.h>
+
+namespace PowerConfig {
+    constexpr bool ENABLE_IDLE_SLEEP = true;            // false: siempre ocupado (como antes)
+    constexpr uint16_t MAX_CPU_MHZ = 240;               // Con trabajo
+    constexpr uint16_t MIN_CPU_MHZ = 80;                // En reposo (APB sigue a 80 MHz: LEDC y UART sin cambios)
+    constexpr uint32_t IDLE_SETTLE_MS = 5000;           // Reposo continuado antes de dormir (servo cerrándose, respuestas)
+    constexpr uint32_t MAX_SLEEP_MS = 1000;             // Tope de cada espera: plazos que nadie anuncia llegan como mucho 1 s tarde
+    constexpr uint32_t MIN_SLEEP_MS = 2;                // Por debajo no compensa bloquearse
+    constexpr uint8_t UART_WAKE_THRESHOLD = 3;          // Flancos en RX que despiertan (esos bytes se pierden)
+}
+
+/**
+ * @class PowerManager
+ * @brief Alterna entre modo ocupado y reposo de bajo consumo (singleton).
+ *
+ * Uso desde el loop: SystemManager informa de si hay trabajo (setIdle) y
+ * de sus próximos plazos (wakeBy); al final de cada vuelta, idle() cede la
+ * CPU o espera hasta el plazo más cercano.
+ */
+class PowerManager {
+public:
+    static PowerManager& getInstance() {
+        static PowerManager instance;
+        return instance;
+    }
+
+    /**
+     * @brief Configura gestión de energía y fuentes de despertar.
+     *
+     * Llamar desde la tarea del loop (setup() corre en ella). Empieza en
+     * modo ocupado.
+     */
+    void begin();
+
+    /**
+     * @brief Informa de si el sistema no tiene trabajo en esta vuelta.
+     *
+     * El reposo empieza tras IDLE_SETTLE_MS seguidos sin trabajo y termina
+     * en cuanto hay trabajo.
+     *
+     * @return true si cambió el modo (ver isLowPower())
+     */
+    bool setIdle(bool idle, uint32_t now);
+
+    /**
+     * @brief Anuncia un plazo (millis()) en el que el loop debe estar despierto.
+     *
+     * Se acumula el más cercano de la vuelta; idle() lo consume.
+     */
+    void wakeBy(uint32_t deadline);
+
+    /**
+     * @brief Despierta al loop si está esperando (segura desde cualquier tarea).
+     */
+    void wake();
+
+    /**
+     * @brief Final de cada vuelta del loop: cede la CPU u, en reposo, espera.
+     */
+    void idle();
+
+    /**
+     * @brief true si la última espera terminó por un cambio del sensor (y lo consume).
+     */
+    bool takeSensorWake();
+
+    bool isLowPower() const { return lowPower; }
+    uint32_t getSleepCount() const { return sleepCount; }
+
+private:
+    PowerManager();
+    PowerManager(const PowerManager&) = delete;
+    PowerManager& operator=(const PowerManager&) = delete;
+
+    void enterLowPower();
+    void leaveLowPower();
+    void armSensorWake();
+    void disarmSensorWake();
+    void registerMetrics();
+
+    static void onSensorLevel();
+
+    static TaskHandle_t loopTask;           // Tarea que espera en idle()
+    static volatile bool sensorWoke;        // La escribe la interrupción
+
+    bool started;
+    bool lowPower;
+    bool hasIdleSince;
+    uint32_t idleSince;                     // millis() del primer setIdle(true) seguido
+    bool hasDeadline;
+    uint32_t nextDeadline;                  // Plazo más cercano anunciado en la vuelta
+    uint32_t sleepCount;                    // Esperas en reposo
+    uint32_t sleptMs;                       // Tiempo total pedido en esas esperas
+    esp_pm_lock_handle_t cpuLock;           // nullptr sin CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t noSleepLock;
+};
+
+#endif // __POWER_MANAGER_H__
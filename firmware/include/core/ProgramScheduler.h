@@ -0,0 +1,166 @@
+/**
+ * @file ProgramScheduler.h
+ * @brief Planificador cooperativo de programas escritos como protohilos.
+ *
+ * **CONCEPTO EDUCATIVO - PLANIFICACIÓN COOPERATIVA**:
+ * Cada programa es un protohilo (ver Protothread.h) que se ejecuta hasta su
+ * siguiente punto de espera y devuelve el control. El planificador recorre
+ * una tabla fija de ranuras y reanuda cada programa activo una vez por
+ * pasada del loop. No hay asignación dinámica: los programas los posee quien
+ * los define (normalmente como miembros) y el planificador solo guarda
+ * punteros a ellos.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __PROGRAM_SCHEDULER_H__
+#define __PROGRAM_SCHEDULER_H__
+
+#include <stdint.h>
+#include "Protothread.h"
+
+/**
+ * @brief Programa reanudable sobre un contexto de tipo `Context`.
+ *
+ * Las clases derivadas implementan run() usando las macros PT_* y guardan
+ * como miembros todo el estado que deba sobrevivir entre reanudaciones.
+ *
+ * @tparam Context Objeto sobre el que actúa el programa (p.ej. el controlador)
+ */
+template<typename Context>
+class ScheduledProgram {
+public:
+    virtual ~ScheduledProgram() {}
+
+    /**
+     * @brief Reanuda el programa hasta su siguiente punto de espera.
+     */
+    PtStatus resume(Context& ctx) { return run(ctx); }
+
+    /**
+     * @brief Reinicia el programa para que empiece desde el principio.
+     */
+    void restart() { pt.reset(); }
+
+    /**
+     * @brief Nombre descriptivo para logs y diagnóstico.
+     */
+    virtual const char* name() const = 0;
+
+protected:
+    virtual PtStatus run(Context& ctx) = 0;
+
+    Protothread pt;     // Estado de continuación del protohilo
+};
+
+/**
+ * @brief Tabla fija de programas concurrentes.
+ *
+ * @tparam Context Contexto que se pasa a cada programa al reanudarlo
+ * @tparam MAX_PROGRAMS Número máximo de programas simultáneos
+ */
+template<typename Context, uint8_t MAX_PROGRAMS>
+class ProgramScheduler {
+private:
+    ScheduledProgram<Context>* slots[MAX_PROGRAMS];
+
+public:
+    ProgramScheduler() { clear(); }
+
+    /**
+     * @brief Registra y arranca un programa desde el principio.
+     *
+     * Si el programa ya estaba en ejecución se reinicia en su misma ranura.
+     *
+     * @return true si había una ranura libre
+     */
+    bool start(ScheduledProgram<Context>* program) {
+        if (program == nullptr) return false;
+
+        int8_t freeSlot = -1;
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            if (slots[i] == program) {
+                program->restart();
+                return true;
+            }
+            if (slots[i] == nullptr && freeSlot < 0) {
+                freeSlot = i;
+            }
+        }
+
+        if (freeSlot < 0) return false;
+
+        program->restart();
+        slots[freeSlot] = program;
+        return true;
+    }
+
+    /**
+     * @brief Detiene un programa sin ejecutar más pasos.
+     */
+    void stop(ScheduledProgram<Context>* program) {
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            if (slots[i] == program) {
+                slots[i] = nullptr;
+                program->restart();
+            }
+        }
+    }
+
+    /**
+     * @brief Detiene todos los programas activos.
+     */
+    void stopAll() {
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            if (slots[i] != nullptr) {
+                slots[i]->restart();
+                slots[i] = nullptr;
+            }
+        }
+    }
+
+    /**
+     * @brief Vacía la tabla sin tocar los programas (usado al copiar/mover).
+     */
+    void clear() {
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            slots[i] = nullptr;
+        }
+    }
+
+    /**
+     * @brief Reanuda una vez cada programa activo y libera los terminados.
+     *
+     * Un programa puede detener a otros (o a sí mismo) durante su paso; la
+     * ranura se vuelve a comprobar antes de reanudar cada uno.
+     */
+    void runOnce(Context& ctx) {
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            ScheduledProgram<Context>* program = slots[i];
+            if (program == nullptr) continue;
+
+            if (ptFinished(program->resume(ctx)) && slots[i] == program) {
+                slots[i] = nullptr;
+            }
+        }
+    }
+
+    bool isRunning(const ScheduledProgram<Context>* program) const {
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            if (slots[i] == program) return true;
+        }
+        return false;
+    }
+
+    uint8_t activeCount() const {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+            if (slots[i] != nullptr) count++;
+        }
+        return count;
+    }
+};
+
+#endif // __PROGRAM_SCHEDULER_H__
@@ -253,7 +253,7 @@ namespace NetworkConfig {
     namespace WebServer {
         constexpr uint16_t PORT = 80;                      // Puerto del servidor web
         constexpr uint32_t REQUEST_TIMEOUT = 5000;         // Timeout de peticiones web en ms
-        constexpr uint8_t MAX_CLIENTS = 5;                 // Máximo número de clientes simultáneos
+        constexpr uint8_t MAX_CLIENTS = 5;                 // Orientativo: AdmissionControl admite según el heap
         constexpr bool ENABLE_WEBSOCKETS = true;           // Habilitar WebSockets
         constexpr bool ENABLE_REST_API = true;             // Habilitar API REST (legacy)
     }
@@ -0,0 +1,105 @@
+/**
+ * @file Protothread.h
+ * @brief Runtime mínimo de protohilos (corrutinas sin pila) para programas de riego.
+ *
+ * **CONCEPTO EDUCATIVO - PROTOHILOS**:
+ * Un protohilo permite escribir una secuencia de pasos como código lineal
+ * ("abrir válvula, esperar 5 minutos, cerrar válvula") aunque cada paso se
+ * ejecute en una llamada distinta del loop principal. La técnica (Dunkels,
+ * Contiki) se basa en un `switch` cuyo `case` se coloca en la línea donde el
+ * programa se suspendió: al reanudar, el `switch` salta directamente ahí.
+ *
+ * Ventajas frente a una máquina de estados escrita a mano:
+ * - La secuencia se lee de arriba a abajo, sin repartirla en manejadores
+ * - Cada protohilo ocupa solo unos bytes (línea de reanudación + temporizador)
+ * - Muchos programas pueden ejecutarse concurrentemente sin RTOS ni pilas
+ *
+ * **RESTRICCIONES IMPORTANTES**:
+ * - Las variables locales NO sobreviven a una suspensión: todo estado que
+ *   deba conservarse entre pasos debe ser miembro del programa.
+ * - No se puede usar `switch` propio dentro de un protohilo que contenga
+ *   puntos de espera (los `case` colisionarían).
+ * - Como máximo un punto de espera por línea de código (usa __LINE__).
+ *
+ * Se eligieron protohilos en lugar de corrutinas C++20 porque la toolchain
+ * Arduino-ESP32 compila en gnu++11 y no ofrece `co_await`.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __PROTOTHREAD_H__
+#define __PROTOTHREAD_H__
+
+#include <stdint.h>
+#include <Arduino.h>
+
+/**
+ * @brief Resultado de reanudar un protohilo.
+ */
+enum class PtStatus : uint8_t {
+    WAITING,    // Bloqueado esperando una condición o un temporizador
+    YIELDED,    // Cedió voluntariamente el control, continúa en la próxima pasada
+    EXITED,     // Terminó anticipadamente (PT_EXIT)
+    ENDED       // Llegó al final de su secuencia (PT_END)
+};
+
+/**
+ * @brief Estado de continuación de un protohilo.
+ *
+ * Solo guarda la línea donde se suspendió y el instante en que debe
+ * despertar si está dormido.
+ */
+struct Protothread {
+    uint16_t lc;            // Línea de continuación (0 = inicio)
+    unsigned long wakeAt;   // millis() en que termina el PT_SLEEP_MS en curso
+
+    Protothread() : lc(0), wakeAt(0) {}
+
+    void reset() { lc = 0; wakeAt = 0; }
+    bool isStarted() const { return lc != 0; }
+};
+
+/**
+ * @brief Indica si un estado de protohilo ha finalizado.
+ */
+inline bool ptFinished(PtStatus status) {
+    return status == PtStatus::EXITED || status == PtStatus::ENDED;
+}
+
+// =============================================================================
+// Macros del runtime
+// =============================================================================
+
+/** Abre el cuerpo del protohilo. Debe ser la primera sentencia. */
+#define PT_BEGIN(pt) switch ((pt).lc) { case 0:
+
+/** Cierra el cuerpo del protohilo y lo deja listo para reiniciar. */
+#define PT_END(pt) } (pt).reset(); return PtStatus::ENDED
+
+/** Suspende hasta que `cond` sea verdadera (se reevalúa en cada reanudación). */
+#define PT_WAIT_UNTIL(pt, cond)                 \
+    do {                                        \
+        (pt).lc = __LINE__; case __LINE__:      \
+        if (!(cond)) return PtStatus::WAITING;  \
+    } while (0)
+
+/** Cede el control una vez y continúa en la siguiente reanudación. */
+#define PT_YIELD(pt)                            \
+    do {                                        \
+        (pt).lc = __LINE__;                     \
+        return PtStatus::YIELDED; case __LINE__:;  \
+    } while (0)
+
+/** Duerme `ms` milisegundos sin bloquear el loop principal. */
+#define PT_SLEEP_MS(pt, ms)                     \
+    do {                                        \
+        (pt).wakeAt = millis() + (ms);          \
+        PT_WAIT_UNTIL(pt, (long)(millis() - (pt).wakeAt) >= 0); \
+    } while (0)
+
+/** Termina el protohilo inmediatamente. */
+#define PT_EXIT(pt) do { (pt).reset(); return PtStatus::EXITED; } while (0)
+
+#endif // __PROTOTHREAD_H__
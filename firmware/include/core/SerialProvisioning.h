@@ -0,0 +1,216 @@
+/**
+ * @file SerialProvisioning.h
+ * @brief Protocolo binario por tramas en el puerto serie para aprovisionar en fábrica.
+ *
+ * **CONCEPTO EDUCATIVO - TRAMAS COBS + CRC**:
+ * El puerto serie es un flujo de bytes sin fronteras: si se pierde o se
+ * corrompe un byte, un protocolo de líneas de texto queda desincronizado.
+ * Aquí cada mensaje viaja como una trama:
+ *
+ *     0x00 | COBS( cmd | seq | [estado] | datos | crc16 ) | 0x00
+ *
+ * - COBS (Consistent Overhead Byte Stuffing) recodifica la trama para que
+ *   no contenga ningún 0x00, así el 0x00 marca sin ambigüedad el principio
+ *   y el fin. Cuesta un byte por cada 254: con MAX_DATA elegido para que la
+ *   trama quepa en un bloque, exactamente un byte.
+ * - El CRC-16/CCITT detecta tramas corruptas, que se descartan; el host
+ *   reintenta con el mismo número de secuencia.
+ * - Los bytes fuera de trama (trazas de arranque, printDate) no molestan:
+ *   el host descarta todo lo que no decodifica con CRC válido.
+ *
+ * El host abre a 115200 baudios y pide con HELLO una velocidad mayor
+ * (hasta 921600). El ESP32 responde a la velocidad antigua y después
+ * cambia; si durante SESSION_TIMEOUT_MS no llega ninguna trama válida
+ * vuelve a 115200, así un host que no soporta la velocidad no deja el
+ * equipo inaccesible. Mientras hay sesión, el Logger no escribe en serie.
+ *
+ * Comandos (la respuesta lleva cmd | 0x80 y el mismo seq):
+ *
+ *     HELLO          u32 baudios           -> u8 versión, u32 baudios, u16 MAX_DATA, versión firmware
+ *     PING / BYE
+ *     SET_TIME       7 bytes DateTime      (AA MM DD W HH MM SS, como configure_rtc.py)
+ *     GET_TIME                             -> 7 bytes DateTime
+ *     CONFIG_BEGIN   u16 longitud JSON
+ *     CONFIG_DATA    u16 offset + trozo    (reenviar un trozo ya recibido es inocuo)
+ *     CONFIG_COMMIT                        -> ConfigManager::importConfig()
+ *     METRICS                              -> exposición Prometheus, en tramas MORE
+ *     LOGS           u32 desde, u8 nivel   -> líneas del log en flash, en tramas MORE
+ *
+ * Los volcados (METRICS, LOGS) se envían desde update() sin bloquear: solo
+ * se escribe una trama si cabe entera en el buffer de transmisión.
+ *
+ * Compatibilidad: fuera de sesión sigue aceptándose la línea de 13 dígitos
+ * AAMMDDWHHMMSS del script antiguo.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __SERIAL_PROVISIONING_H__
+#define __SERIAL_PROVISIONING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include "IRTC.h"
+
+class PrometheusCursor;
+class LogQueryCursor;
+
+namespace SerialProvisioningConfig {
+    constexpr uint8_t PROTOCOL_VERSION = 1;
+    constexpr uint32_t DEFAULT_BAUD = 115200;
+    constexpr uint32_t SUPPORTED_BAUDS[] = { 115200, 230400, 460800, 921600 };
+    constexpr uint32_t SESSION_TIMEOUT_MS = 5000;      // Sin tramas válidas: fin de sesión
+    constexpr size_t MAX_DATA = 240;                   // Datos por trama (trama en un solo bloque COBS)
+    constexpr size_t MAX_IMPORT_BYTES = 4096;          // JSON de CONFIG_BEGIN
+    constexpr uint8_t STREAM_FRAMES_PER_UPDATE = 8;    // Tope de tramas por llamada a update()
+    constexpr size_t RX_BYTES_PER_UPDATE = 512;        // Tope de bytes leídos por llamada
+    constexpr size_t TX_BUFFER_BYTES = 1024;           // Serial.setTxBufferSize() antes de begin()
+    constexpr uint8_t LEGACY_DIGITS = 13;              // AAMMDDWHHMMSS
+}
+
+/**
+ * @brief Comandos del protocolo (byte cmd de la trama).
+ */
+enum class ProvisioningCommand : uint8_t {
+    HELLO = 0x01,
+    PING = 0x02,
+    BYE = 0x03,
+    SET_TIME = 0x10,
+    GET_TIME = 0x11,
+    CONFIG_BEGIN = 0x20,
+    CONFIG_DATA = 0x21,
+    CONFIG_COMMIT = 0x22,
+    METRICS = 0x30,
+    LOGS = 0x31
+};
+
+/**
+ * @brief Estado de una respuesta.
+ */
+enum class ProvisioningStatus : uint8_t {
+    OK = 0x00,
+    MORE = 0x01,            // Trama intermedia de un volcado
+    UNKNOWN_COMMAND = 0x02,
+    BAD_LENGTH = 0x03,
+    BUSY = 0x04,            // Hay un volcado en curso
+    REJECTED = 0x05,        // Fecha o configuración no válida
+    TOO_LARGE = 0x06,
+    BAD_OFFSET = 0x07,
+    UNAVAILABLE = 0x08      // Sin RTC, sin importación iniciada...
+};
+
+/**
+ * @class SerialProvisioning
+ * @brief Receptor y emisor de tramas en Serial (singleton).
+ */
+class SerialProvisioning {
+public:
+    static SerialProvisioning& getInstance() {
+        static SerialProvisioning instance;
+        return instance;
+    }
+
+    /**
+     * @param rtc RTC para SET_TIME/GET_TIME (puede ser nullptr)
+     */
+    void begin(IRTC* rtc);
+
+    /**
+     * @brief Lee lo disponible en Serial, atiende tramas y avanza los volcados.
+     *        No bloquea: se llama en cada iteración del loop.
+     */
+    void update();
+
+    bool isSessionActive() const { return sessionActive; }
+
+    /**
+     * @brief ¿Se ha puesto en hora el RTC por serie desde la última consulta?
+     */
+    bool consumeRtcUpdate();
+
+    /**
+     * @brief COBS: codifica length bytes en out (length + length/254 + 1 como máximo).
+     * @return Bytes escritos (sin delimitadores)
+     */
+    static size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+
+    /**
+     * @return Bytes decodificados; 0 si la codificación no es válida
+     */
+    static size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out, size_t maxOut);
+
+    /**
+     * @brief CRC-16/CCITT-FALSE (polinomio 0x1021, valor inicial 0xFFFF).
+     */
+    static uint16_t crc16(const uint8_t* data, size_t length);
+
+private:
+    SerialProvisioning();
+    SerialProvisioning(const SerialProvisioning&) = delete;
+    SerialProvisioning& operator=(const SerialProvisioning&) = delete;
+
+    static constexpr size_t FRAME_OVERHEAD = 3 + sizeof(uint16_t);     // cmd, seq, estado, crc
+    static constexpr size_t MAX_FRAME = SerialProvisioningConfig::MAX_DATA + FRAME_OVERHEAD;
+    static constexpr size_t MAX_ENCODED = MAX_FRAME + MAX_FRAME / 254 + 1;
+    static constexpr size_t MAX_WIRE = MAX_ENCODED + 2;                 // Con los dos delimitadores
+
+    enum class StreamKind : uint8_t { NONE, METRICS, LOGS };
+
+    void handleByte(uint8_t byte);
+    void handleLegacyLine();
+    void handleFrame(const uint8_t* frame, size_t length);
+    void dispatch(uint8_t command, uint8_t seq, const uint8_t* data, size_t length);
+
+    void handleHello(uint8_t seq, const uint8_t* data, size_t length);
+    void handleSetTime(uint8_t seq, const uint8_t* data, size_t length);
+    void handleGetTime(uint8_t seq);
+    void handleConfigBegin(uint8_t seq, const uint8_t* data, size_t length);
+    void handleConfigData(uint8_t seq, const uint8_t* data, size_t length);
+    void handleConfigCommit(uint8_t seq);
+    void handleLogs(uint8_t seq, const uint8_t* data, size_t length);
+
+    void reply(uint8_t command, uint8_t seq, ProvisioningStatus status,
+               const uint8_t* data = nullptr, size_t length = 0);
+    void pumpStream();
+    void endStream();
+    void startSession();
+    void endSession();
+    void freeImport();
+
+    IRTC* rtc;
+    bool started;
+    bool rtcUpdated;
+
+    // Recepción: modo texto (línea de 13 dígitos) hasta la primera trama
+    // válida; vuelve a texto al terminar la sesión (BYE o SESSION_TIMEOUT_MS)
+    bool frameMode;
+    bool overflow;                      // Trama demasiado larga: descartar hasta el siguiente 0x00
+    uint8_t rxBuffer[MAX_ENCODED];
+    size_t rxLength;
+    char legacyDigits[SerialProvisioningConfig::LEGACY_DIGITS];
+    uint8_t legacyLength;
+
+    // Sesión
+    bool sessionActive;
+    bool loggerWasSerial;
+    uint32_t lastFrameTime;
+    uint32_t currentBaud;
+
+    // Importación de configuración en curso
+    char* importBuffer;
+    uint16_t importLength;
+    uint16_t importReceived;
+
+    // Volcado en curso
+    StreamKind stream;
+    uint8_t streamCommand;
+    uint8_t streamSeq;
+    uint32_t streamToken;
+    PrometheusCursor* metricsCursor;
+    LogQueryCursor* logCursor;
+};
+
+#endif // __SERIAL_PROVISIONING_H__
@@ -0,0 +1,245 @@
+/**
+ * @file StateMetrics.h
+ * @brief Métricas de permanencia y transiciones de las máquinas de estados.
+ *
+ * **CONCEPTO EDUCATIVO - MEDIR ANTES DE AJUSTAR**:
+ * Valores como SERVO_MOVEMENT_TIME_MS o TRANSITION_TIME_SECONDS se fijaron a
+ * ojo. Para ajustarlos con datos necesitamos saber cuánto tiempo pasa
+ * realmente cada válvula en OPENING/CLOSING, cuántos reintentos hay y cuánto
+ * duran los estados de error.
+ *
+ * Por cada estado se guarda:
+ * - Número de entradas al estado
+ * - Histograma logarítmico (base 2) del tiempo de permanencia: el cubo `i`
+ *   cuenta permanencias en [2^i, 2^(i+1)) ms. Registrar una muestra cuesta
+ *   una instrucción CLZ y un incremento: O(1) y sin asignar memoria.
+ * - Suma y máximo de permanencia para calcular medias
+ *
+ * Los contadores son de 32 bits y se leen desde la tarea web sin bloqueo;
+ * una lectura puede mezclar dos instantes, lo cual es aceptable para métricas.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __STATE_METRICS_H__
+#define __STATE_METRICS_H__
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "SET_PIN.h"
+
+namespace StateMetricsConfig {
+    // Cubos del histograma: el último (2^23 ms ≈ 2.3 h) es abierto
+    constexpr uint8_t DWELL_BUCKETS = 24;
+
+    // Deben coincidir con el número de valores de cada enum (ver static_assert
+    // en ServoPWMController.cpp y SystemManager.cpp)
+    constexpr uint8_t IRRIGATION_STATES = 9;
+    constexpr uint8_t SERVO_STATES = 6;
+    constexpr uint8_t SYSTEM_STATES = 5;
+
+    // Mayor bloque de la exportación JSON: un estado con los 24 cubos al
+    // máximo (~420 caracteres)
+    constexpr size_t JSON_CHUNK_BYTES = 448;
+}
+
+/**
+ * @brief Histograma logarítmico de tiempos de permanencia.
+ */
+class DwellHistogram {
+public:
+    DwellHistogram() { reset(); }
+
+    void record(uint32_t dwellMs) {
+        buckets[bucketFor(dwellMs)]++;
+        count++;
+        sumMs += dwellMs;
+        if (dwellMs > maxMs) maxMs = dwellMs;
+    }
+
+    void reset() {
+        for (uint8_t i = 0; i < StateMetricsConfig::DWELL_BUCKETS; i++) buckets[i] = 0;
+        count = 0;
+        sumMs = 0;
+        maxMs = 0;
+    }
+
+    uint32_t bucket(uint8_t index) const { return buckets[index]; }
+    uint32_t getCount() const { return count; }
+    uint64_t getSumMs() const { return sumMs; }
+    uint32_t getMaxMs() const { return maxMs; }
+
+    /**
+     * @brief Límite superior (exclusivo) del cubo en milisegundos.
+     */
+    static uint32_t bucketUpperBoundMs(uint8_t index) { return 1UL << (index + 1); }
+
+    /**
+     * @brief Cubo correspondiente a una permanencia: floor(log2(ms)).
+     */
+    static uint8_t bucketFor(uint32_t dwellMs) {
+        if (dwellMs < 2) return 0;
+        uint8_t index = 31 - __builtin_clz(dwellMs);
+        return index < StateMetricsConfig::DWELL_BUCKETS ? index : StateMetricsConfig::DWELL_BUCKETS - 1;
+    }
+
+private:
+    uint32_t buckets[StateMetricsConfig::DWELL_BUCKETS];
+    uint32_t count;
+    uint64_t sumMs;
+    uint32_t maxMs;
+};
+
+/**
+ * @brief Seguimiento de una máquina de estados con N estados.
+ *
+ * Cada transición cierra la permanencia del estado anterior en su
+ * histograma y cuenta una entrada en el nuevo. Volver al mismo estado no
+ * cuenta como transición.
+ */
+template<uint8_t N>
+class StateTracker {
+public:
+    StateTracker() : current(0), enteredAt(0), started(false) {
+        for (uint8_t i = 0; i < N; i++) entries[i] = 0;
+    }
+
+    /**
+     * @return true si hubo cambio de estado
+     */
+    bool transition(uint8_t to, uint32_t now) {
+        if (to >= N) return false;
+        if (started) {
+            if (to == current) return false;
+            dwell[current].record(now - enteredAt);
+        }
+        entries[to]++;
+        current = to;
+        enteredAt = now;
+        started = true;
+        return true;
+    }
+
+    bool isStarted() const { return started; }
+    uint8_t currentState() const { return current; }
+    uint32_t currentDwellMs(uint32_t now) const { return started ? now - enteredAt : 0; }
+    uint32_t entryCount(uint8_t state) const { return entries[state]; }
+    const DwellHistogram& histogram(uint8_t state) const { return dwell[state]; }
+
+private:
+    uint8_t current;
+    uint32_t enteredAt;
+    bool started;
+    uint32_t entries[N];
+    DwellHistogram dwell[N];
+};
+
+/**
+ * @class StateMetrics
+ * @brief Registro central (singleton) de métricas de estados del sistema.
+ *
+ * Los módulos notifican cada cambio de estado con su valor numérico; este
+ * módulo no depende de los enums de los drivers, solo de su número de valores.
+ */
+class StateMetrics {
+public:
+    static StateMetrics& getInstance() {
+        static StateMetrics instance;
+        return instance;
+    }
+
+    // Notificaciones de los módulos (O(1), sin asignación de memoria)
+    void recordIrrigationState(uint8_t state);
+    void recordServoState(uint8_t zoneIndex, uint8_t state);
+    void recordServoRetry(uint8_t zoneIndex);
+    void recordSystemState(uint8_t state);
+
+    // Acceso de solo lectura para exportadores
+    const StateTracker<StateMetricsConfig::IRRIGATION_STATES>& irrigation() const { return irrigationTracker; }
+    const StateTracker<StateMetricsConfig::SERVO_STATES>& servo(uint8_t zoneIndex) const { return servoTrackers[zoneIndex]; }
+    const StateTracker<StateMetricsConfig::SYSTEM_STATES>& system() const { return systemTracker; }
+    uint32_t servoRetries(uint8_t zoneIndex) const { return retries[zoneIndex]; }
+    uint32_t systemTransitions(uint8_t from, uint8_t to) const { return transitions[from][to]; }
+    uint8_t zoneCount() const { return NUM_SERVOS; }
+
+    // Nombres de estados para etiquetas (mismo orden que los enums)
+    static const char* irrigationStateName(uint8_t state);
+    static const char* servoStateName(uint8_t state);
+    static const char* systemStateName(uint8_t state);
+
+private:
+    StateMetrics();
+    StateMetrics(const StateMetrics&) = delete;
+    StateMetrics& operator=(const StateMetrics&) = delete;
+
+    StateTracker<StateMetricsConfig::IRRIGATION_STATES> irrigationTracker;
+    StateTracker<StateMetricsConfig::SERVO_STATES> servoTrackers[NUM_SERVOS];
+    StateTracker<StateMetricsConfig::SYSTEM_STATES> systemTracker;
+    uint32_t retries[NUM_SERVOS];
+    uint32_t transitions[StateMetricsConfig::SYSTEM_STATES][StateMetricsConfig::SYSTEM_STATES];
+};
+
+/**
+ * @class StateMetricsCursor
+ * @brief Exportación JSON reanudable de StateMetrics (una a la vez, instancia estática).
+ *
+ * Igual que PrometheusCursor: el servidor pide la respuesta chunked a
+ * trozos con fill() y el cursor compone el siguiente bloque (la cabecera
+ * de una máquina, un estado, una fila de transiciones) cuando el anterior
+ * ya salió. En memoria solo hay un bloque, nunca el documento entero. Las
+ * peticiones y desconexiones llegan por la tarea AsyncTCP: sin mutex.
+ */
+class StateMetricsCursor {
+public:
+    /**
+     * @return nullptr si ya hay una exportación en curso
+     */
+    static StateMetricsCursor* acquire(uint32_t& token);
+
+    /**
+     * @brief Devuelve el cursor (idempotente).
+     */
+    void release(uint32_t token);
+
+    /**
+     * @return Bytes escritos; 0 cuando el documento ha terminado
+     */
+    size_t fill(uint8_t* out, size_t maxLen);
+
+private:
+    enum class Phase : uint8_t { HEADER, IRRIGATION, ZONES, SYSTEM, TRANSITIONS, DONE };
+
+    /**
+     * @brief Bloque en curso; es un Print para reutilizar los escritores JSON.
+     */
+    class Chunk : public Print {
+    public:
+        Chunk() : length(0) {}
+        size_t write(uint8_t c) override;
+        void clear() { length = 0; }
+
+        char buffer[StateMetricsConfig::JSON_CHUNK_BYTES];
+        size_t length;
+    };
+
+    StateMetricsCursor() : inUse(false), token(0) {}
+    void reset();
+    bool nextChunk();
+
+    bool inUse;
+    uint32_t token;
+
+    Phase phase;
+    uint8_t zone;               // Zona en curso (fase ZONES)
+    uint8_t step;               // Bloque dentro de la máquina o fila de transiciones
+    uint32_t now;               // millis() al empezar: permanencias coherentes entre bloques
+    Chunk chunk;
+    size_t chunkPos;
+
+    static StateMetricsCursor instance;
+    static uint32_t nextToken;
+};
+
+#endif // __STATE_METRICS_H__
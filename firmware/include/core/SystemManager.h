@@ -22,6 +22,7 @@
  */
 
 #include "SystemConfig.h"
+#include "ZoneConfigBinder.h"
 // Forward declarations to avoid circular includes
 class RTC_DS1302;
 class Led;
@@ -48,6 +49,9 @@ private:
     ServoPWMController* servoController;
     WebSocketManager* wsManager;
     
+    // Cambios de zona de ConfigManager → controlador (sin reiniciar)
+    ZoneConfigBinder zoneConfigBinder;
+    
     // Estado del sistema
     SystemState currentState;
     unsigned long lastStateChange;
@@ -60,6 +64,7 @@ private:
     uint8_t consecutiveErrors;
     
     // Métodos privados para manejo de estados
+    void setState(SystemState newState);  // Cambia de estado y lo registra en StateMetrics
     void handleInitializingState();
     void handleConfigurationMode();
     void handleNormalOperationState();
@@ -71,6 +76,8 @@ private:
     void generateStatusReport();
     bool validateSystemHealth();
     void updateStatusIndicators();
+    void updatePowerMode(unsigned long currentTime);  // Reposo de bajo consumo (PowerManager)
+    void syncSystemClock();  // Pone time() a la hora del RTC (sin NTP sería 0)
 
 public:
     SystemManager(RTC_DS1302* rtc = nullptr, Led* statusLed = nullptr, ServoPWMController* servoController = nullptr);
@@ -101,6 +108,7 @@ public:
 
     // Acceso a módulos para integración con Web (solo lectura)
     ServoPWMController* getIrrigationController() const { return servoController; }
+    WebSocketManager* getWebSocketManager() const { return wsManager; }
 
     // Configuración del RTC desde web
     bool setRTCDateTime(uint8_t year, uint8_t month, uint8_t day, uint8_t dayOfWeek, uint8_t hour, uint8_t minute, uint8_t second);
@@ -0,0 +1,147 @@
+/**
+ * @file TaskDiagnostics.h
+ * @brief CPU por tarea y margen de pila de las tareas FreeRTOS.
+ *
+ * **CONCEPTO EDUCATIVO - DIMENSIONAR PILAS CON DATOS**:
+ * Cada tarea FreeRTOS tiene una pila de tamaño fijo elegido al crearla. Si
+ * se queda corta, el ESP32 se reinicia con "stack overflow"; si sobra, se
+ * desperdicia RAM. FreeRTOS lleva la cuenta de dos cosas que lo aclaran:
+ *
+ * - Marca de agua de la pila: lo mínimo que ha quedado libre desde que la
+ *   tarea arrancó (en el ESP32, en bytes).
+ * - Contador de tiempo de ejecución: microsegundos que la tarea ha tenido
+ *   la CPU (requiere configGENERATE_RUN_TIME_STATS).
+ *
+ * Cada SAMPLE_INTERVAL_MS se toma una muestra con uxTaskGetSystemState().
+ * El % de CPU se calcula sobre una ventana deslizante de WINDOW_SAMPLES
+ * muestras:
+ *
+ *     cpu = Δ tiempo de la tarea / Δ tiempo total     (en la ventana)
+ *
+ * El tiempo total es tiempo de reloj, así que el porcentaje es sobre UN
+ * núcleo: las tareas de los dos núcleos suman 200 %. La carga de cada núcleo
+ * es 100 % menos el de su tarea IDLE.
+ *
+ * Si el firmware se compila sin estadísticas de tiempo de ejecución, se
+ * siguen publicando las marcas de agua y la CPU aparece como "sin datos".
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __TASK_DIAGNOSTICS_H__
+#define __TASK_DIAGNOSTICS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+namespace TaskDiagnosticsConfig {
+    constexpr uint8_t MAX_TASKS = 24;                  // Tareas seguidas a la vez
+    constexpr uint32_t SAMPLE_INTERVAL_MS = 5000;
+    constexpr uint8_t WINDOW_SAMPLES = 6;              // Ventana de CPU: 6 x 5 s = 30 s
+    constexpr uint32_t STACK_WARNING_BYTES = 512;      // Aviso en el log por debajo de esto
+    constexpr uint8_t CORES = 2;
+    constexpr uint8_t NAME_LENGTH = 16;                // configMAX_TASK_NAME_LEN del ESP32
+    constexpr uint16_t CPU_UNKNOWN = 0xFFFF;
+    constexpr uint8_t CORE_ANY = 0xFF;                 // Tarea sin afinidad fija
+}
+
+/**
+ * @brief Resultado publicado para una tarea.
+ */
+struct TaskSnapshot {
+    char name[TaskDiagnosticsConfig::NAME_LENGTH];
+    uint8_t core;               // 0, 1 o CORE_ANY
+    uint8_t priority;
+    uint16_t cpuPermille;       // ‰ de un núcleo en la ventana; CPU_UNKNOWN si no hay datos
+    uint32_t stackFreeBytes;    // Mínimo libre histórico
+};
+
+/**
+ * @class TaskDiagnostics
+ * @brief Muestreo periódico de las tareas (singleton).
+ *
+ * update() corre en el loop; las lecturas (métricas, API web) copian los
+ * resultados publicados bajo un mutex, así nunca ven una muestra a medias.
+ */
+class TaskDiagnostics {
+public:
+    static TaskDiagnostics& getInstance() {
+        static TaskDiagnostics instance;
+        return instance;
+    }
+
+    /**
+     * @brief Registra las métricas y toma la primera muestra.
+     */
+    void begin();
+
+    /**
+     * @brief Toma una muestra si ha pasado SAMPLE_INTERVAL_MS.
+     */
+    void update();
+
+    /**
+     * @brief Copia las tareas publicadas.
+     * @return Número de tareas copiadas
+     */
+    uint8_t copyTasks(TaskSnapshot* out, uint8_t maxTasks) const;
+
+    bool getTask(uint8_t index, TaskSnapshot& out) const;
+
+    /**
+     * @return ‰ de carga del núcleo (1000 - IDLE); CPU_UNKNOWN si no hay datos
+     */
+    uint16_t getCoreLoadPermille(uint8_t core) const;
+
+    /**
+     * @brief ¿Está compilado configGENERATE_RUN_TIME_STATS?
+     */
+    static bool hasRuntimeStats();
+
+    uint32_t getWindowMs() const {
+        return TaskDiagnosticsConfig::SAMPLE_INTERVAL_MS * TaskDiagnosticsConfig::WINDOW_SAMPLES;
+    }
+
+private:
+    TaskDiagnostics();
+    TaskDiagnostics(const TaskDiagnostics&) = delete;
+    TaskDiagnostics& operator=(const TaskDiagnostics&) = delete;
+
+    static constexpr uint8_t HISTORY = TaskDiagnosticsConfig::WINDOW_SAMPLES + 1;
+
+    /**
+     * @brief Estado interno de una tarea seguida entre muestras.
+     */
+    struct TrackedTask {
+        TaskHandle_t handle;
+        uint32_t runtime[HISTORY];      // Contador acumulado en cada muestra (anillo)
+        uint8_t samples;                // Muestras desde que apareció (saturado en HISTORY)
+        bool seen;                      // Presente en la última muestra
+        bool warned;                    // Aviso de pila ya emitido
+    };
+
+    void sample();
+    int findOrAssignSlot(TaskHandle_t handle);
+    void registerMetrics();
+
+    TrackedTask tracked[TaskDiagnosticsConfig::MAX_TASKS];
+    uint32_t totalRuntime[HISTORY];
+    uint32_t sampleCount;
+    uint32_t lastSampleTime;
+    bool started;
+
+    TaskSnapshot published[TaskDiagnosticsConfig::MAX_TASKS];
+    uint8_t publishedCount;
+    uint16_t coreLoad[TaskDiagnosticsConfig::CORES];
+
+    StaticSemaphore_t lockBuffer;
+    SemaphoreHandle_t lock;
+};
+
+#endif // __TASK_DIAGNOSTICS_H__
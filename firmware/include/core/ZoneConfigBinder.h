@@ -0,0 +1,60 @@
+/**
+ * @file ZoneConfigBinder.h
+ * @brief Lleva los cambios de zona de ConfigManager al controlador en marcha.
+ *
+ * **CONCEPTO EDUCATIVO - APLICAR SOLO LO QUE CAMBIÓ, EN UN PUNTO SEGURO**:
+ * ConfigManager guarda tiempo de riego, ángulo y transición de cada zona,
+ * pero el controlador arrancaba con los valores de ZONE_CONFIGURATIONS y
+ * no se enteraba de nada hasta reiniciar. Reinicializar el controlador al
+ * guardar sería peor: cerraría la válvula que está regando.
+ *
+ * En cada vuelta del loop, antes de update() del controlador:
+ *
+ *     ¿generación nueva?   no → nada (una comparación de enteros)
+ *     sí → copia + huella de la copia
+ *          changedSections(huella aplicada) → bits ZONE_FIRST + i
+ *          aplicar solo esas zonas (applyZoneSettings)
+ *
+ * Cambiar el nombre de la red no toca ninguna zona; cambiar la zona 3 solo
+ * toca la zona 3. La huella se calcula sobre la copia, no sobre la
+ * configuración viva, para que corresponda exactamente a lo aplicado.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __ZONE_CONFIG_BINDER_H__
+#define __ZONE_CONFIG_BINDER_H__
+
+#include <stdint.h>
+#include "ConfigSchema.h"
+#include "ConfigCodec.h"
+
+class ServoPWMController;
+
+/**
+ * @class ZoneConfigBinder
+ * @brief Aplica de forma incremental la configuración de zonas al controlador.
+ */
+class ZoneConfigBinder {
+public:
+    ZoneConfigBinder();
+
+    /**
+     * @brief Aplica las zonas cambiadas desde la última llamada.
+     *
+     * La primera llamada aplica todas. Llamar solo desde el loop.
+     *
+     * @return Máscara de zonas aplicadas (bit i = zona i + 1)
+     */
+    uint16_t update(ServoPWMController& controller);
+
+private:
+    uint32_t seenGeneration;            // Última generación copiada
+    bool hasApplied;                    // false: aún no se aplicó nada
+    ConfigFingerprint applied;          // Huella de lo que tiene el controlador
+    SystemConfig snapshot;              // Copia de trabajo (fuera de la pila)
+};
+
+#endif // __ZONE_CONFIG_BINDER_H__
@@ -0,0 +1,149 @@
+/**
+ * @file IrrigationPrograms.h
+ * @brief Programas de riego escritos como protohilos sobre ServoPWMController.
+ *
+ * **CONCEPTO EDUCATIVO - PROGRAMAS COMO CÓDIGO LINEAL**:
+ * Antes, el ciclo de riego estaba repartido en un manejador por estado
+ * (inicializando, abriendo, regando, cerrando, transición, completado) que
+ * compartían campos mutables. Ahora cada secuencia se escribe de arriba a
+ * abajo, como se explicaría a una persona:
+ *
+ *     abrir válvula; esperar apertura; regar N segundos; cerrar; pausar; ...
+ *
+ * y el planificador del controlador la reanuda en cada update(). El estado
+ * visible (IrrigationState) lo sigue publicando el controlador, así que la
+ * interfaz web y los reportes no cambian.
+ *
+ * Cada programa ocupa unas decenas de bytes: su protohilo más los campos
+ * que necesita recordar entre pasos.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __IRRIGATION_PROGRAMS_H__
+#define __IRRIGATION_PROGRAMS_H__
+
+#include <stdint.h>
+#include "../core/ProgramScheduler.h"
+
+class ServoPWMController;
+
+/**
+ * @brief Tipo base de todos los programas que actúan sobre el controlador.
+ */
+typedef ScheduledProgram<ServoPWMController> IrrigationProgram;
+
+/**
+ * @brief Ciclo clásico: riega cada zona habilitada en orden.
+ *
+ * Entre zonas usa la pausa de transición de la zona saliente o, si el traspaso
+ * solapado está habilitado, la rampa HANDOFF sin tiempo muerto. Con
+ * auto-ciclo repite el recorrido tras CYCLE_RESTART_DELAY_SECONDS.
+ */
+class SequentialCycleProgram : public IrrigationProgram {
+public:
+    SequentialCycleProgram()
+        : zone(0), nextZone(0), valveAlreadyOpen(false), valvesMoved(false), lastRampWrite(0),
+          stalledZone(0) {}
+
+    const char* name() const override { return "ciclo_secuencial"; }
+
+protected:
+    PtStatus run(ServoPWMController& ctl) override;
+
+private:
+    /**
+     * @brief Avanza la rampa de traspaso solapado.
+     * @return true cuando la rampa ha terminado
+     */
+    bool stepHandoffRamp(ServoPWMController& ctl);
+
+    /**
+     * @brief Zona del traspaso con corriente de bloqueo (STALL) en su movimiento.
+     *
+     * Con las dos válvulas moviéndose a la vez, un servo bloqueado suma su
+     * corriente de rotor bloqueado a la del otro.
+     *
+     * @return Índice de la zona, o totalZones si no hay ninguna (o no hay sensado)
+     */
+    uint8_t findHandoffStall(ServoPWMController& ctl) const;
+
+    uint8_t zone;               // Zona en curso
+    uint8_t nextZone;           // Siguiente zona habilitada (totalZones si no hay)
+    bool valveAlreadyOpen;      // La zona llegó abierta por un traspaso
+    bool valvesMoved;           // Hubo que cerrar válvulas al inicializar
+    unsigned long lastRampWrite; // Última escritura PWM de la rampa
+    uint8_t stalledZone;        // Zona bloqueada que interrumpió el traspaso
+};
+
+/**
+ * @brief Ciclo y remojo: divide el riego de cada zona en pulsos intercalados.
+ *
+ * **CONCEPTO EDUCATIVO - CYCLE & SOAK**:
+ * En suelos arcillosos el agua se infiltra más despacio de lo que la aporta
+ * la válvula y el exceso escurre. Regando en pulsos cortos con pausas de
+ * remojo el agua tiene tiempo de penetrar. Para no alargar el ciclo, durante
+ * la pausa de una zona se riegan otras: siempre se elige la zona lista con
+ * menos pulsos completados, de modo que las zonas se van turnando.
+ */
+class SoakCycleProgram : public IrrigationProgram {
+public:
+    SoakCycleProgram()
+        : zone(0), soakWaitMs(0), pulseStart(0), wateredBefore(0), soakedSec(0), valvesMoved(false) {}
+
+    const char* name() const override { return "ciclo_remojo"; }
+
+protected:
+    PtStatus run(ServoPWMController& ctl) override;
+
+private:
+    /**
+     * @brief Reparte el tiempo de cada zona habilitada en pulsos.
+     */
+    void planPulses(ServoPWMController& ctl);
+
+    /**
+     * @brief Elige la siguiente zona lista para un pulso.
+     *
+     * @return Índice de la zona, o totalZones si ninguna está lista. En ese
+     *         caso soakWaitMs indica cuánto falta para que lo esté alguna
+     *         (0 si ya no quedan pulsos pendientes).
+     */
+    uint8_t selectZone(ServoPWMController& ctl);
+
+    uint8_t zone;               // Zona del pulso en curso
+    uint32_t soakWaitMs;        // Espera hasta que alguna zona termine su remojo
+    uint32_t pulseStart;        // millis() al iniciar el pulso en curso
+    uint32_t wateredBefore;     // Segundos regados por la zona antes de este pulso
+    uint32_t soakedSec;         // Remojo real antes del pulso en curso
+    bool valvesMoved;           // Hubo que cerrar válvulas al inicializar
+};
+
+/**
+ * @brief Cierra automáticamente una zona abierta manualmente tras un tiempo.
+ */
+class TimedZoneProgram : public IrrigationProgram {
+public:
+    TimedZoneProgram() : zoneIndex(0), durationSec(0) {}
+
+    /**
+     * @brief Configura la zona y la duración antes de arrancar el programa.
+     */
+    void configure(uint8_t zone, uint32_t seconds) {
+        zoneIndex = zone;
+        durationSec = seconds;
+    }
+
+    const char* name() const override { return "cierre_temporizado"; }
+
+protected:
+    PtStatus run(ServoPWMController& ctl) override;
+
+private:
+    uint8_t zoneIndex;          // Zona a cerrar (0-based)
+    uint32_t durationSec;       // Tiempo abierta en segundos
+};
+
+#endif // __IRRIGATION_PROGRAMS_H__
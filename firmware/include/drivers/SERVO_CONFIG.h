@@ -55,6 +55,64 @@ constexpr uint32_t TRANSITION_TIME_SECONDS = 10; // 10 segundos de pausa
 // Valores más altos = movimiento más suave pero más lento
 constexpr uint32_t SERVO_MOVEMENT_TIME_MS = 1000; // 1 segundo para abrir/cerrar
 
+// Pausa entre ciclos cuando el auto-ciclo está habilitado
+// Tiempo que el sistema permanece en COMPLETED antes de repetir el recorrido
+constexpr uint32_t CYCLE_RESTART_DELAY_SECONDS = 300; // 5 minutos entre ciclos
+
+// =============================================================================
+// Configuración de Traspaso Solapado entre Zonas
+// =============================================================================
+
+// Habilitar el traspaso solapado por defecto
+// En lugar de CERRAR -> PAUSA -> ABRIR, la válvula de la siguiente zona se abre
+// gradualmente mientras la actual se cierra, eliminando el tiempo muerto sin
+// flujo y el pico de presión de cada transición. Se puede cambiar en ejecución.
+constexpr bool ENABLE_OVERLAPPED_HANDOFF = false;
+
+// Duración total de la rampa de traspaso en milisegundos
+// La válvula entrante se abre durante toda la rampa; la saliente empieza a
+// cerrarse en la mitad, de modo que la apertura combinada nunca baja del 100%
+// de una válvula y la bomba nunca trabaja contra un circuito cerrado.
+constexpr uint32_t HANDOFF_RAMP_TIME_MS = 4000; // 4 segundos de rampa
+
+// Intervalo entre escrituras PWM durante la rampa
+// Valores más bajos = rampa más suave pero más escrituras al periférico LEDC
+constexpr uint32_t HANDOFF_RAMP_STEP_MS = 50;
+
+// =============================================================================
+// Configuración del Modo Ciclo y Remojo (Cycle & Soak)
+// =============================================================================
+
+// Número de pulsos en que se divide el tiempo de riego de cada zona
+// En suelos arcillosos el agua se infiltra lentamente: regar en varios pulsos
+// cortos separados por pausas de remojo evita la escorrentía superficial
+constexpr uint8_t SOAK_DEFAULT_PULSES = 3;
+constexpr uint8_t SOAK_MAX_PULSES = 10;
+
+// Pausa mínima de remojo entre dos pulsos de la misma zona en segundos
+// Durante la pausa se riegan otras zonas, así el tiempo total del ciclo
+// se mantiene cercano a la suma de los tiempos de riego
+constexpr uint32_t SOAK_MIN_INTERVAL_SECONDS = 900; // 15 minutos
+
+// Rango admitido al cambiar la pausa de remojo en ejecución
+constexpr uint32_t SOAK_INTERVAL_LIMIT_MIN_SECONDS = 60;    // 1 minuto
+constexpr uint32_t SOAK_INTERVAL_LIMIT_MAX_SECONDS = 3600;  // 1 hora
+
+// Duración mínima de un pulso en segundos
+// Si el tiempo de la zona no alcanza para todos los pulsos, se usan menos
+constexpr uint32_t SOAK_MIN_PULSE_SECONDS = 60; // 1 minuto
+
+// Número de pulsos recientes que se conservan para telemetría
+constexpr uint8_t PULSE_TELEMETRY_BUFFER_SIZE = 16;
+
+// =============================================================================
+// Configuración del Planificador de Programas
+// =============================================================================
+
+// Número máximo de programas de riego ejecutándose a la vez
+// Un ciclo completo más un cierre temporizado por zona abierta manualmente
+constexpr uint8_t MAX_CONCURRENT_PROGRAMS = 8;
+
 // =============================================================================
 // Configuración de PWM (Modulación por Ancho de Pulso)
 // =============================================================================
@@ -140,8 +198,44 @@ constexpr uint32_t STATUS_REPORT_INTERVAL_MS = 5000; // Cada 5 segundos
 // Cuando está habilitado, proporciona información adicional para debugging
 constexpr bool ENABLE_VERBOSE_LOGGING = true;
 
+// =============================================================================
+// Sensado de Corriente de Servomotores (detección de atascos)
+// =============================================================================
+
+// Fuente de medida de corriente de cada servo
+// NONE: sin sensado (no se puede verificar si la válvula se movió)
+// ADC_SHUNT: resistencia shunt + amplificador leída por ADC1
+// INA219: un INA219 por servo en el bus I2C
+enum class CurrentSenseType : uint8_t { NONE, ADC_SHUNT, INA219 };
+constexpr CurrentSenseType SERVO_CURRENT_SENSE = CurrentSenseType::NONE;
+
+// Canal de cada zona: dirección I2C (INA219) o pin ADC1 32..39 (ADC_SHUNT;
+// revisar que no choque con los sensores de SystemConfig.h).
+// Las zonas sin entrada en la tabla no se monitorean
+constexpr uint8_t SERVO_CURRENT_CHANNELS[] = {0x40, 0x41, 0x44, 0x45, 0x42};
+
+// Shunt en miliohmios y ganancia del amplificador (ADC_SHUNT). Con INA219
+// solo se usa la resistencia (el INA mide directamente la tensión del shunt)
+constexpr uint32_t SERVO_SHUNT_MILLIOHMS = 100;
+constexpr uint32_t SERVO_SHUNT_GAIN = 20;
+
+// Periodo de muestreo y ventana de la media móvil (8 x 5 ms = 40 ms)
+constexpr uint32_t SERVO_CURRENT_SAMPLE_INTERVAL_MS = 5;
+constexpr uint8_t SERVO_CURRENT_AVG_SAMPLES = 8;
+
+// Ventana de análisis tras cada movimiento; debe ser menor que
+// SERVO_MOVEMENT_TIME_MS para que el veredicto esté listo al comprobarlo
+constexpr uint32_t SERVO_CURRENT_WINDOW_MS = 800;
+
+// Umbrales de la firma de corriente (mA, sobre la media móvil)
+constexpr uint16_t SERVO_CURRENT_NO_LOAD_MAX_MA = 40;   // Pico menor: servo desconectado
+constexpr uint16_t SERVO_CURRENT_HOLD_MAX_MA = 150;     // Al final de la ventana: en reposo
+constexpr uint16_t SERVO_CURRENT_STALL_MA = 700;        // Corriente de rotor bloqueado
+constexpr uint32_t SERVO_CURRENT_STALL_MIN_MS = 250;    // Tiempo sostenido para declarar bloqueo
+
 // Habilitar verificación de posición de servomotores
-// Algunos servos pueden proporcionar retroalimentación de posición
-constexpr bool ENABLE_POSITION_FEEDBACK = false;
+// Se deriva del sensado de corriente: sin él no hay forma de saber si la
+// válvula llegó a moverse
+constexpr bool ENABLE_POSITION_FEEDBACK = SERVO_CURRENT_SENSE != CurrentSenseType::NONE;
 
 #endif // __SERVO_CONFIG_H__
@@ -0,0 +1,248 @@
+/**
+ * @file ServoCurrentMonitor.h
+ * @brief Detección de servos bloqueados, desconectados o válvulas atascadas
+ *        a partir de la corriente de alimentación de cada servo.
+ *
+ * **CONCEPTO EDUCATIVO - LA CORRIENTE COMO SENSOR DE POSICIÓN**:
+ * Un servo de hobby no informa de su posición, pero su consumo cuenta lo
+ * que pasó tras la orden de movimiento:
+ *
+ *     mA
+ *      |   ___
+ *      |  /   \                         Normal: pico de arranque y caída a
+ *      | /     \______                  la corriente de reposo
+ *      +------------------> t
+ *
+ * - Sin carga: la corriente nunca sube (servo desconectado o sin alimentación)
+ * - Bloqueo: la corriente se queda en el valor de rotor bloqueado
+ * - Atasco: el servo no llega a reposar; sigue empujando al final de la ventana
+ *
+ * Tras cada movimiento se abre una ventana de SERVO_CURRENT_WINDOW_MS; las
+ * muestras se suavizan con una media móvil y se clasifican al cerrar la
+ * ventana (o antes, en cuanto el bloqueo es evidente).
+ *
+ * El muestreo corre en un temporizador esp_timer que solo está activo
+ * mientras hay alguna ventana abierta: el loop principal no paga nada y
+ * solo consulta el veredicto ya calculado.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __SERVO_CURRENT_MONITOR_H__
+#define __SERVO_CURRENT_MONITOR_H__
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "SERVO_CONFIG.h"
+
+/**
+ * @brief Resultado del análisis de un movimiento.
+ */
+enum class MoveVerdict : uint8_t {
+    IDLE,       // Sin movimiento analizado
+    PENDING,    // Ventana de análisis abierta
+    OK,         // Firma normal: pico y vuelta a reposo
+    NO_LOAD,    // Sin consumo: servo desconectado
+    STALL,      // Corriente de bloqueo sostenida
+    JAMMED      // No vuelve a reposo: válvula atascada
+};
+
+// =============================================================================
+// Fuentes de corriente
+// =============================================================================
+
+/**
+ * @brief Origen de las lecturas de corriente de los servos.
+ */
+class CurrentSource {
+public:
+    virtual ~CurrentSource() {}
+
+    virtual bool begin() { return true; }
+
+    /**
+     * @brief Aviso de que una zona empieza a moverse (por defecto no hace nada).
+     */
+    virtual void onMoveStarted(uint8_t zoneIndex) { (void)zoneIndex; }
+
+    /**
+     * @brief Lee la corriente instantánea de una zona.
+     *
+     * Se llama desde la tarea de esp_timer, nunca desde una ISR.
+     *
+     * @param zoneIndex Índice de la zona (0-based)
+     * @param milliamps Corriente leída
+     * @return false si la zona no tiene canal o la lectura falló
+     */
+    virtual bool readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) = 0;
+};
+
+/**
+ * @brief Shunt con amplificador leído por ADC1 (un pin por zona).
+ */
+class AdcShuntCurrentSource : public CurrentSource {
+public:
+    bool begin() override;
+    bool readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) override;
+};
+
+/**
+ * @brief Un INA219 por zona; se lee solo el registro de tensión de shunt,
+ *        así que no hace falta programar la calibración.
+ */
+class Ina219CurrentSource : public CurrentSource {
+public:
+    bool begin() override;
+    bool readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) override;
+};
+
+/**
+ * @brief Reproduce trazas de corriente grabadas o sintéticas.
+ *
+ * Permite probar la detección en banco sin servos: cada zona recorre su
+ * traza desde el principio en cada movimiento y repite la última muestra
+ * cuando se acaba.
+ */
+class TraceCurrentSource : public CurrentSource {
+public:
+    TraceCurrentSource();
+
+    void setTrace(uint8_t zoneIndex, const uint16_t* samples, uint16_t length);
+    void onMoveStarted(uint8_t zoneIndex) override;
+    bool readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) override;
+
+private:
+    static constexpr uint8_t MAX_TRACES = sizeof(SERVO_CURRENT_CHANNELS) / sizeof(SERVO_CURRENT_CHANNELS[0]);
+
+    const uint16_t* traces[MAX_TRACES];
+    uint16_t lengths[MAX_TRACES];
+    uint16_t positions[MAX_TRACES];
+};
+
+// =============================================================================
+// Detector de firma
+// =============================================================================
+
+/**
+ * @brief Clasifica la corriente de un movimiento muestra a muestra.
+ *
+ * Es código puro (sin hardware ni tiempo): se le pasan muestras y devuelve
+ * un veredicto, así que una traza simulada da siempre el mismo resultado.
+ */
+class CurrentSignatureDetector {
+public:
+    CurrentSignatureDetector();
+
+    /**
+     * @brief Empieza a analizar un movimiento.
+     * @param windowSamples Número de muestras de la ventana
+     */
+    void start(uint16_t windowSamples);
+
+    /**
+     * @brief Añade una muestra.
+     * @return true cuando el veredicto está decidido
+     */
+    bool addSample(uint16_t milliamps);
+
+    MoveVerdict verdict() const { return result; }
+    uint16_t peakMilliamps() const { return peakAvg; }
+    uint16_t lastMilliamps() const { return lastAvg; }
+
+    /**
+     * @brief Analiza una traza completa (útil para pruebas en banco).
+     */
+    static MoveVerdict classify(const uint16_t* samples, uint16_t length);
+
+private:
+    MoveVerdict finish();
+
+    uint16_t ring[SERVO_CURRENT_AVG_SAMPLES];
+    uint32_t ringSum;
+    uint8_t ringHead;
+    uint8_t ringFilled;
+
+    uint16_t samplesSeen;
+    uint16_t windowSamples;
+    uint16_t stallSamples;      // Muestras consecutivas sobre el umbral de bloqueo
+    uint16_t peakAvg;
+    uint16_t lastAvg;
+    MoveVerdict result;
+};
+
+// =============================================================================
+// Monitor
+// =============================================================================
+
+/**
+ * @class ServoCurrentMonitor
+ * @brief Muestrea en segundo plano la corriente de las zonas en movimiento.
+ */
+class ServoCurrentMonitor {
+public:
+    static ServoCurrentMonitor& getInstance() {
+        static ServoCurrentMonitor instance;
+        return instance;
+    }
+
+    /**
+     * @brief Prepara la fuente configurada en SERVO_CURRENT_SENSE.
+     * @return true si el sensado quedó activo
+     */
+    bool begin();
+
+    /**
+     * @brief Sustituye la fuente de corriente (p.ej. por una TraceCurrentSource).
+     */
+    void setSource(CurrentSource* newSource);
+
+    bool isEnabled() const { return source != nullptr && timer != nullptr; }
+
+    /**
+     * @brief Abre una ventana de análisis tras ordenar un movimiento.
+     *
+     * Solo hace falta llamarlo al mover el servo; no hay que sondear nada.
+     */
+    void armMove(uint8_t zoneIndex);
+
+    /**
+     * @brief Veredicto del último movimiento de la zona.
+     */
+    MoveVerdict getVerdict(uint8_t zoneIndex) const;
+
+    uint16_t getPeakMilliamps(uint8_t zoneIndex) const;
+
+    static const char* verdictToString(MoveVerdict verdict);
+
+private:
+    ServoCurrentMonitor();
+    ServoCurrentMonitor(const ServoCurrentMonitor&) = delete;
+    ServoCurrentMonitor& operator=(const ServoCurrentMonitor&) = delete;
+
+    static void onSampleTimer(void* arg);
+    void sampleArmedZones();
+
+    static constexpr uint8_t MAX_CHANNELS = sizeof(SERVO_CURRENT_CHANNELS) / sizeof(SERVO_CURRENT_CHANNELS[0]);
+
+    struct ZoneWindow {
+        CurrentSignatureDetector detector;
+        volatile bool armed;
+        volatile uint8_t generation;    // Cambia en cada armMove para descartar muestras viejas
+        volatile MoveVerdict verdict;
+        uint16_t peakMilliamps;
+    };
+
+    ZoneWindow windows[MAX_CHANNELS];
+    CurrentSource* source;
+    esp_timer_handle_t timer;
+    bool timerRunning;
+    mutable portMUX_TYPE lock;
+
+    AdcShuntCurrentSource adcSource;
+    Ina219CurrentSource inaSource;
+};
+
+#endif // __SERVO_CURRENT_MONITOR_H__
@@ -41,6 +41,10 @@
 #include "SET_PIN.h"
 #include "SERVO_CONFIG.h"
 #include "ServoControllerInterface.h"
+#include "OUT_DIGITAL.h"
+#include "IrrigationPrograms.h"
+#include "Seqlock.h"
+#include "ZoneMask.h"
 
 // =============================================================================
 // Enumeraciones para Estados del Sistema
@@ -60,6 +64,7 @@ enum class IrrigationState {
     IRRIGATING,             // Regando zona actual (válvula abierta)
     CLOSING_VALVE,          // Cerrando válvula de la zona actual
     TRANSITIONING,          // Pausa entre zonas para estabilización
+    HANDOFF,                // Traspaso solapado: la zona siguiente abre mientras la actual cierra
     COMPLETED,              // Ciclo de riego completado
     ERROR                   // Error en el sistema (requiere intervención)
 };
@@ -79,6 +84,22 @@ enum class ServoState {
     ERROR                   // Error en el servo (no responde o mal funcionamiento)
 };
 
+/**
+ * @brief Modo de reparto del tiempo de riego de cada zona.
+ */
+enum class WateringMode {
+    CONTINUOUS,             // Cada zona riega su tiempo en un único bloque
+    SOAK_CYCLE              // Tiempo dividido en pulsos con pausas de remojo intercaladas
+};
+
+/**
+ * @brief Conjunto de zonas del controlador (índices 0-based).
+ * 
+ * Cabe una zona por salida de servo; si las salidas crecen (expansores),
+ * crece con NUM_SERVOS sin tocar el código que lo usa.
+ */
+typedef ZoneMask<NUM_SERVOS> ZoneSet;
+
 // =============================================================================
 // Estructura de Datos para Información de Zona
 // =============================================================================
@@ -87,7 +108,9 @@ enum class ServoState {
  * @brief Información de estado y configuración de una zona de riego.
  * 
  * Esta estructura contiene toda la información necesaria para monitorear
- * y controlar una zona individual del sistema de riego.
+ * y controlar una zona individual del sistema de riego. Lo que se consulta
+ * en cada paso para todas las zonas (habilitada, abierta, en error) vive
+ * aparte, en los ZoneSet del controlador.
  */
 struct ZoneInfo {
     uint8_t zoneNumber;           // Número de zona (1, 2, 3, etc.)
@@ -96,9 +119,53 @@ struct ZoneInfo {
     ServoState currentState;      // Estado actual del servomotor
     uint32_t lastActionTime;      // Timestamp de la última acción realizada
     uint32_t totalIrrigationTime; // Tiempo total regado en esta sesión
-    bool isEnabled;               // Zona habilitada para riego
     ServoZoneConfig config;            // Configuración específica de la zona
     uint8_t retryCount;           // Número de intentos de reposicionamiento
+    uint32_t transitionTimeMs;    // Pausa tras cerrar esta zona (TRANSITIONING)
+    
+    // Seguimiento de pulsos en modo ciclo y remojo
+    uint8_t pulsesPlanned;        // Pulsos planificados en el ciclo actual
+    uint8_t pulsesCompleted;      // Pulsos ya regados en el ciclo actual
+    uint32_t pulseDuration;       // Duración del pulso en curso (segundos)
+    uint32_t lastPulseEnd;        // millis() al terminar el último pulso
+};
+
+/**
+ * @brief Registro de telemetría de un pulso de riego completado.
+ */
+struct PulseRecord {
+    uint32_t sequence;            // Número de secuencia global (1, 2, 3, ...)
+    uint8_t zoneNumber;           // Zona regada (1-based)
+    uint8_t pulseIndex;           // Pulso dentro del ciclo (1-based)
+    uint8_t pulseCount;           // Pulsos planificados para la zona
+    uint32_t startedAt;           // millis() al iniciar la apertura
+    uint32_t durationSec;         // Segundos de riego efectivo del pulso
+    uint32_t soakedSec;           // Remojo real desde el pulso anterior (0 en el primero)
+};
+
+/**
+ * @brief Foto del controlador para lectores de otras tareas.
+ * 
+ * Se publica al final de cada update() (y tras los comandos) con un
+ * seqlock: quien la lee desde AsyncTCP obtiene siempre un estado coherente
+ * de un mismo instante, sin bloquear nunca al control de las válvulas.
+ */
+struct ControllerSnapshot {
+    uint32_t publishedAt;         // millis() de la publicación
+    IrrigationState state;
+    uint8_t activeZone;           // 1-based, 0 si no hay riego
+    uint32_t remainingTime;       // Segundos restantes al publicar
+    bool hasErrors;
+    WateringMode wateringMode;
+    uint32_t totalCycles;
+    uint32_t totalWateringTime;
+    uint32_t pulseSequence;
+    uint8_t zoneCount;
+    struct Zone {
+        ServoState state;
+        bool enabled;
+        uint32_t irrigationTime;  // Segundos configurados
+    } zones[NUM_SERVOS];
 };
 
 // =============================================================================
@@ -122,9 +189,10 @@ struct ZoneInfo {
  * - Escalable a cualquier número de zonas
  * 
  * PATRÓN DE DISEÑO:
- * Sigue el patrón \"Estado\" (State Pattern) donde el comportamiento
- * del objeto cambia según su estado interno, facilitando el mantenimiento
- * y la extensión del código.
+ * El estado visible del sistema sigue siendo IrrigationState, pero las
+ * secuencias de riego se escriben como programas lineales (protohilos, ver
+ * IrrigationPrograms.h) que un planificador cooperativo reanuda en cada
+ * update(). Varios programas pueden ejecutarse a la vez.
  */
 class ServoPWMController : public ServoControllerInterface {
 
@@ -135,7 +203,15 @@ private:
     
     ZoneInfo* zones;                    // Array dinámico de información de zonas
     uint8_t totalZones;                 // Número total de zonas configuradas
+    
+    // Estado de todas las zonas, un bit por zona (ver ZoneMask.h).
+    // enabledZones es la única fuente de "habilitada"; openZones y
+    // errorZones los mantiene setServoState() a partir de currentState.
+    ZoneSet enabledZones;               // Habilitadas para riego
+    ZoneSet openZones;                  // Válvula abierta o abriéndose
+    ZoneSet errorZones;                 // Servo en ERROR
     uint8_t currentZone;                // Zona que se está procesando actualmente
+    uint8_t handoffFromZone;            // Zona saliente durante un traspaso solapado
     IrrigationState systemState;        // Estado actual del sistema completo
     
     unsigned long stateStartTime;       // Tiempo de inicio del estado actual
@@ -143,6 +219,34 @@ private:
     
     bool autoCycle;                     // Repetir ciclo automáticamente
     bool emergencyStop;                 // Parada de emergencia activada
+    bool overlappedHandoff;             // Traspaso solapado entre zonas habilitado
+    
+    // Válvula principal (VALVULA_PRINCIPAL) coordinada con las válvulas de zona
+    OutDigital mainValve;               // Salida digital de la válvula principal
+    bool mainValveOpen;                 // Estado actual de la válvula principal
+    
+    // Programas de riego (protohilos) y su planificador
+    // Los programas no se transfieren al copiar o mover el controlador
+    SequentialCycleProgram cycleProgram;            // Ciclo secuencial de todas las zonas
+    SoakCycleProgram soakProgram;                   // Ciclo con pulsos y remojo intercalado
+    TimedZoneProgram zonePrograms[NUM_SERVOS];      // Cierre temporizado por zona
+    ProgramScheduler<ServoPWMController, MAX_CONCURRENT_PROGRAMS> scheduler;
+    
+    friend class SequentialCycleProgram;
+    friend class SoakCycleProgram;
+    friend class TimedZoneProgram;
+    
+    // Modo ciclo y remojo
+    WateringMode wateringMode;          // Modo aplicado al iniciar cada ciclo
+    uint8_t soakPulses;                 // Pulsos por zona en modo remojo
+    uint32_t soakIntervalSec;           // Pausa mínima de remojo entre pulsos
+    
+    // Telemetría de pulsos (buffer circular)
+    PulseRecord pulseLog[PULSE_TELEMETRY_BUFFER_SIZE];
+    uint32_t pulseSequence;             // Pulsos registrados desde el arranque
+    
+    // Estado publicado para otras tareas (ver ControllerSnapshot)
+    Seqlock<ControllerSnapshot> snapshot;
     
     // Estadísticas del sistema
     uint32_t totalCyclesCompleted;      // Ciclos completos de riego realizados
@@ -183,6 +287,36 @@ private:
      */
     bool moveServoToAngle(uint8_t zoneIndex, uint8_t targetAngle);
     
+    /**
+     * @brief Escribe un ángulo intermedio sin alterar el estado del servo.
+     * 
+     * Usado por la rampa de traspaso solapado, donde el estado lógico de cada
+     * válvula (OPENING/CLOSING) se mantiene durante toda la rampa.
+     * 
+     * @param zoneIndex Índice de la zona
+     * @param angle Ángulo a aplicar (0-180 grados)
+     */
+    void writeServoAngle(uint8_t zoneIndex, uint8_t angle);
+    
+    /**
+     * @brief Busca la siguiente zona habilitada a partir de un índice.
+     * 
+     * @param startIndex Primer índice a considerar (0-based)
+     * @return Índice de la zona encontrada, o totalZones si no hay ninguna
+     */
+    uint8_t findNextEnabledZone(uint8_t startIndex) const;
+    
+    /**
+     * @brief Abre o cierra la válvula principal.
+     * 
+     * La válvula principal solo se abre con una válvula de zona ya abierta y
+     * se cierra antes de cerrar la última, para que la bomba nunca trabaje
+     * contra un circuito cerrado.
+     * 
+     * @param open true para abrir, false para cerrar
+     */
+    void setMainValve(bool open);
+    
     /**
      * @brief Convierte un ángulo en grados a valor PWM correspondiente.
      * 
@@ -198,6 +332,9 @@ private:
     /**
      * @brief Verifica si un servomotor ha alcanzado su posición objetivo.
      * 
+     * Usa el veredicto de ServoCurrentMonitor; consultar tras esperar
+     * SERVO_MOVEMENT_TIME_MS desde el movimiento.
+     * 
      * @param zoneIndex Índice de la zona
      * @return true si el servo está en posición, false en caso contrario
      */
@@ -253,13 +390,60 @@ private:
      */
     void cleanup();
 
-    // Métodos de manejo de estados (deben estar declarados)
-    void handleInitializingState();
-    void handleOpeningValveState();
-    void handleIrrigatingState();
-    void handleClosingValveState();
-    void handleTransitioningState();
-    void handleCompletedState();
+    /**
+     * @brief Registra las métricas del controlador en MetricsRegistry (/metrics).
+     */
+    void registerMetrics();
+
+    /**
+     * @brief Cambia el estado visible del sistema y reinicia su cronómetro.
+     * 
+     * Los programas de riego publican su avance a través de este método, de
+     * modo que reportes, WebSocket y getState() siguen viendo IrrigationState.
+     * Cada cambio queda además registrado en StateMetrics.
+     * 
+     * @param state Nuevo estado del sistema
+     */
+    void enterState(IrrigationState state);
+    
+    /**
+     * @brief Cambia el estado de un servo registrando la transición en StateMetrics.
+     * 
+     * @param zoneIndex Índice de la zona (0-based)
+     * @param state Nuevo estado del servo
+     */
+    void setServoState(uint8_t zoneIndex, ServoState state);
+    
+    /**
+     * @brief Milisegundos transcurridos desde el último enterState().
+     */
+    uint32_t stateElapsedMs() const;
+    
+    /**
+     * @brief Cierra toda válvula de zona que no esté ya cerrada.
+     * 
+     * @return true si alguna válvula tuvo que moverse
+     */
+    bool closeAllZoneValves();
+    
+    /**
+     * @brief Termina los movimientos manuales (openZoneValve/closeZoneValve).
+     * 
+     * Fuera de un ciclo nadie más lleva esas zonas a su estado final: tras
+     * SERVO_MOVEMENT_TIME_MS pasan de OPENING a OPEN y de CLOSING a CLOSED
+     * (o a handleServoError si la firma de corriente indica fallo).
+     */
+    void settleManualMoves();
+    
+    /**
+     * @brief Registra un pulso completado en la telemetría.
+     * 
+     * Guarda el registro en el buffer circular y publica
+     * EventType::IRRIGATION_PULSE_COMPLETED en el EventBus.
+     */
+    void recordPulse(uint8_t zoneIndex, uint32_t startedAt, uint32_t durationSec, uint32_t soakedSec);
+    
+    // Manejo del estado de error (recuperación automática)
     void handleErrorState();
 
 public:
@@ -482,6 +666,82 @@ public:
      */
     bool setZoneIrrigationTime(uint8_t zoneNumber, uint32_t seconds);
     
+    /**
+     * @brief Aplica en caliente los ajustes persistidos de una zona.
+     * 
+     * Llamar desde el loop entre dos update(): ahí el programa de riego
+     * está parado en un PT_YIELD/PT_SLEEP y ningún campo está a medio usar.
+     * Nunca se reconfigura el PWM:
+     * - Tiempo de riego: la zona activa lo relee en cada paso.
+     * - Ángulo de apertura: si la válvula está abierta se reposiciona sin
+     *   cambiar de estado; si no, se usa en la próxima apertura.
+     * - Deshabilitar la zona que riega termina su riego con el cierre
+     *   normal (es el único caso que interrumpe a la zona activa).
+     * - Pausa de transición: en la próxima transición tras esta zona.
+     * - Una zona en ERROR no se habilita aunque se pida; se queda
+     *   deshabilitada hasta un ajuste posterior con el servo ya recuperado.
+     * 
+     * @param zoneNumber Número de zona (1-based)
+     * @return false si la zona o el tiempo de riego no son válidos (no se aplica nada)
+     */
+    bool applyZoneSettings(uint8_t zoneNumber, bool enabled, uint32_t irrigationTimeSec,
+                           uint8_t openAngle, uint32_t transitionTimeMs);
+    
+    /**
+     * @brief Habilita o deshabilita el traspaso solapado entre zonas.
+     * 
+     * Con el traspaso solapado, la válvula de la siguiente zona se abre en
+     * rampa mientras la actual se cierra, sin pasar por TRANSITIONING.
+     * El cambio se aplica en la próxima transición entre zonas.
+     * 
+     * @param enabled true para habilitar el traspaso solapado
+     */
+    void setOverlappedHandoff(bool enabled);
+    
+    /**
+     * @brief Indica si el traspaso solapado está habilitado.
+     */
+    bool isOverlappedHandoffEnabled() const;
+    
+    /**
+     * @brief Selecciona el modo de riego continuo o ciclo y remojo.
+     * 
+     * En modo SOAK_CYCLE el tiempo de cada zona se divide en `pulses` pulsos
+     * separados al menos `soakSeconds`, y los huecos de remojo se rellenan
+     * regando otras zonas. El modo se aplica al iniciar el próximo ciclo.
+     * 
+     * @param mode Modo de riego
+     * @param pulses Pulsos por zona (1-SOAK_MAX_PULSES)
+     * @param soakSeconds Pausa mínima de remojo entre pulsos de una zona
+     * @return true si los parámetros son válidos
+     */
+    bool setWateringMode(WateringMode mode, uint8_t pulses = SOAK_DEFAULT_PULSES,
+                         uint32_t soakSeconds = SOAK_MIN_INTERVAL_SECONDS);
+    
+    WateringMode getWateringMode() const;
+    
+    /**
+     * @brief Número de pulsos registrados desde el arranque.
+     * 
+     * Permite a los consumidores detectar pulsos nuevos comparando con el
+     * último número de secuencia que procesaron.
+     */
+    uint32_t getPulseSequence() const;
+    
+    /**
+     * @brief Obtiene el registro de un pulso por su número de secuencia.
+     * 
+     * @param sequence Número de secuencia (1-based)
+     * @param record Registro de salida
+     * @return false si el pulso aún no existe o ya fue sobrescrito
+     */
+    bool getPulseRecord(uint32_t sequence, PulseRecord& record) const;
+    
+    /**
+     * @brief Convierte un modo de riego a cadena para logs y JSON.
+     */
+    static const char* wateringModeToString(WateringMode mode);
+    
     // =========================================================================
     // Métodos de Consulta de Estado
     // =========================================================================
@@ -538,6 +798,22 @@ public:
      */
     bool hasErrors() const;
     
+    /**
+     * @brief Publica el estado actual para los lectores de otras tareas.
+     * 
+     * update() lo hace en cada pasada; llamarlo también desde la tarea de
+     * control tras cambiar el estado fuera de update() (comandos).
+     */
+    void publishSnapshot();
+    
+    /**
+     * @brief Copia la última foto publicada. Seguro desde cualquier tarea.
+     * 
+     * **CONCEPTO EDUCATIVO**: los demás getters leen los campos vivos y solo
+     * son seguros en la tarea del loop; desde AsyncTCP hay que usar este.
+     */
+    void getSnapshot(ControllerSnapshot& out) const;
+    
     /**
      * @brief Obtiene información detallada de una zona específica.
      * 
@@ -546,6 +822,29 @@ public:
      */
     const ZoneInfo* getZoneInfo(uint8_t zoneNumber) const;
     
+    /**
+     * @brief Número de zonas que maneja el controlador.
+     */
+    uint8_t getZoneCount() const { return totalZones; }
+    
+    /**
+     * @brief true si no hay nada en marcha: sin ciclo, sin programas y sin
+     *        válvulas abiertas ni moviéndose.
+     * 
+     * Es la condición para que PowerManager pueda entrar en reposo.
+     */
+    bool isQuiescent() const;
+    
+    /**
+     * @brief Deja de generar pulsos en las zonas cerradas, o los restablece.
+     * 
+     * Con `parked` los canales de las zonas cerradas quedan a nivel bajo: el
+     * servo no recibe pulsos y no se mueve, y el light sleep (que detiene
+     * LEDC) no puede dejar un pulso a medias. Las zonas que no están
+     * cerradas no se tocan.
+     */
+    void parkOutputs(bool parked);
+    
     /**
      * @brief Genera un reporte completo del estado del sistema.
      * 
@@ -0,0 +1,145 @@
+/**
+ * @file AdmissionControl.h
+ * @brief Admisión de peticiones HTTP y clientes WebSocket según el heap disponible.
+ *
+ * **CONCEPTO EDUCATIVO - ADMITIR POR MEMORIA, NO POR NÚMERO**:
+ * Un tope fijo de "5 clientes" es a la vez demasiado y demasiado poco: con
+ * el heap holgado sobran plazas, y con el heap justo (un sexto cliente más
+ * una subida de configuración a la vez) ya el quinto puede dejar al ESP32
+ * sin memoria para WiFi y acabar en un reinicio. Aquí cada conexión nueva
+ * se acepta solo si, después de pagar lo que cuesta, sigue quedando margen:
+ *
+ *     heap libre - reservas recientes - coste de la clase >= HEAP_RESERVE_BYTES
+ *     bloque libre más grande >= MIN_BLOCK_BYTES   (la fragmentación también mata)
+ *
+ * - El coste de una petición HTTP es fijo (objeto de petición, cabeceras,
+ *   buffer de respuesta); una petición con cuerpo cuesta más.
+ * - El coste de un cliente WebSocket se mide: (heap sin clientes - heap
+ *   ahora) / clientes, suavizado y acotado entre MIN y MAX.
+ * - Varias conexiones que llegan a la vez verían todas el mismo heap libre.
+ *   Por eso cada admisión deja una reserva de su coste durante
+ *   RESERVATION_MS, lo que tarda en reflejarse en el heap.
+ *
+ * Si no hay margen, la petición recibe 503 con Retry-After y el sistema
+ * sigue atendiendo a los que ya estaban, en lugar de caerse.
+ *
+ * Todas las llamadas llegan desde la tarea AsyncTCP (canHandle() de las
+ * peticiones y eventos WebSocket): no hace falta mutex.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __ADMISSION_CONTROL_H__
+#define __ADMISSION_CONTROL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+namespace AdmissionConfig {
+    constexpr uint32_t HEAP_RESERVE_BYTES = 20480;     // Nunca se reparte (WiFi, lwIP, loop)
+    constexpr uint32_t MIN_BLOCK_BYTES = 4096;         // Bloque contiguo para buffers de TCP
+    constexpr uint32_t HTTP_REQUEST_BYTES = 3072;      // Petición, cabeceras y respuesta
+    constexpr uint32_t UPLOAD_REQUEST_BYTES = 6144;    // Con cuerpo: copia de SystemConfig, SPIFFS
+    constexpr uint32_t WS_CLIENT_MIN_BYTES = 4096;     // Coste de un cliente antes de medirlo
+    constexpr uint32_t WS_CLIENT_MAX_BYTES = 16384;    // Tope de la medida (ruido de otras peticiones)
+    constexpr uint8_t MAX_WS_CLIENTS = 5;              // = WebSocketConfig::MAX_CONCURRENT_CLIENTS (tablas por cliente)
+    constexpr uint32_t RESERVATION_MS = 2000;          // Hasta que la admisión se note en el heap
+    constexpr uint8_t MAX_RESERVATIONS = 8;            // Sin hueco: se descarta la más antigua
+    constexpr uint32_t RETRY_AFTER_S = 5;              // Falta de memoria: pasa pronto
+    constexpr uint32_t CLIENT_RETRY_AFTER_S = 30;      // Sin plaza WebSocket: hasta que alguien salga
+}
+
+/**
+ * @brief Tipo de conexión que pide entrar.
+ */
+enum class AdmissionClass : uint8_t {
+    HTTP,           // GET y peticiones sin cuerpo
+    UPLOAD,         // PUT/POST con cuerpo
+    WEBSOCKET,      // Handshake de /ws
+    COUNT
+};
+
+/**
+ * @brief Resultado de la admisión.
+ */
+enum class AdmissionDecision : uint8_t {
+    ADMIT,
+    LOW_HEAP,           // No queda margen tras pagar el coste
+    FRAGMENTED,         // Hay memoria, pero no un bloque contiguo suficiente
+    TOO_MANY_CLIENTS    // Todas las plazas WebSocket ocupadas
+};
+
+/**
+ * @class AdmissionControl
+ * @brief Decide si una conexión nueva cabe en el heap (singleton).
+ */
+class AdmissionControl {
+public:
+    static AdmissionControl& getInstance() {
+        static AdmissionControl instance;
+        return instance;
+    }
+
+    /**
+     * @brief Registra las métricas (una vez).
+     */
+    void begin();
+
+    /**
+     * @brief Decide con el heap actual y, si admite, reserva el coste.
+     */
+    AdmissionDecision admit(AdmissionClass kind);
+
+    /**
+     * @brief Igual que admit() con el heap dado (permite probar la política).
+     */
+    AdmissionDecision admit(AdmissionClass kind, uint32_t freeHeap, uint32_t largestBlock, uint32_t now);
+
+    /**
+     * @brief Un cliente WebSocket terminó el handshake / se desconectó.
+     */
+    void webSocketConnected();
+    void webSocketDisconnected();
+
+    /**
+     * @brief Segundos para la cabecera Retry-After.
+     */
+    static uint32_t retryAfterSeconds(AdmissionDecision decision);
+
+    static const char* classToString(AdmissionClass kind);
+    static const char* decisionToString(AdmissionDecision decision);
+
+    uint32_t costOf(AdmissionClass kind) const;
+    uint8_t getWebSocketClients() const { return webSocketClients; }
+    uint32_t getRejectedCount(AdmissionClass kind) const;
+
+private:
+    AdmissionControl();
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    struct Reservation {
+        uint32_t bytes;         // 0 = hueco libre
+        uint32_t at;
+    };
+
+    uint32_t reservedBytes(uint32_t now);
+    void reserve(uint32_t bytes, uint32_t now);
+    void measureClientCost(uint32_t freeHeap);
+    void registerMetrics();
+
+    Reservation reservations[AdmissionConfig::MAX_RESERVATIONS];
+    uint8_t nextReservation;
+
+    uint8_t webSocketClients;
+    uint32_t idleHeap;                  // Heap libre visto sin clientes WebSocket (0 = aún no)
+    uint32_t clientCost;                // Estimación del coste de un cliente WebSocket
+
+    uint32_t rejected[static_cast<uint8_t>(AdmissionClass::COUNT)];
+    bool started;
+};
+
+#endif // __ADMISSION_CONTROL_H__
@@ -0,0 +1,215 @@
+#ifndef __MQTT_TELEMETRY_H__
+#define __MQTT_TELEMETRY_H__
+
+/**
+ * @file MqttTelemetry.h
+ * @brief Publicación de estado y telemetría por MQTT, con lotes y cola en flash.
+ *
+ * **CONCEPTO EDUCATIVO - TELEMETRÍA QUE NO SE PIERDE NI FRENA EL RIEGO**:
+ * Un broker MQTT (mosquitto, Home Assistant...) permite guardar y graficar
+ * lo que hace el sistema sin tener un navegador abierto. Tres ideas:
+ *
+ * 1. **Lotes**: se toma una muestra cada SAMPLE_INTERVAL_MS y se
+ *    envían SAMPLES_PER_BATCH juntas en un solo mensaje. Menos
+ *    mensajes = menos cabeceras, menos radio encendida.
+ *
+ * 2. **QoS1 + spool**: cada mensaje se publica con QoS1 (el broker confirma
+ *    con PUBACK). Si no hay conexión, el mensaje se guarda en SPIFFS y se
+ *    reenvía al reconectar, de uno en uno y esperando cada confirmación:
+ *
+ *        conectado y spool vacío ---> publicar
+ *        desconectado o spool con datos ---> añadir al spool
+ *        reconexión ---> vaciar spool (más antiguo primero) ---> publicar
+ *
+ *    Mientras el spool tiene datos, lo nuevo también va al spool: así el
+ *    broker recibe todo en orden cronológico.
+ *
+ * 3. **Sin bloquear el loop**: la red la maneja el cliente esp-mqtt de
+ *    ESP-IDF en su propia tarea (conexión, reconexión, reintentos QoS1). El
+ *    loop solo encola mensajes cuando ya hay conexión, y los comandos que
+ *    llegan por `riego/<id>/cmd/<comando>` entran en la misma CommandQueue
+ *    que los de WebSocket.
+ *
+ * Topics (con <id> = "riego-" + 3 últimos bytes de la MAC):
+ *
+ *     riego/<id>/status       "online"/"offline" (retenido, testamento)
+ *     riego/<id>/state        cambio de estado de riego (retenido)
+ *     riego/<id>/telemetry    lote de muestras
+ *     riego/<id>/cmd/<cmd>    comandos entrantes (payload: "zone=2&duration=60")
+ *     riego/<id>/cmd_result   resultado de cada comando
+ *
+ * Ver docs/MQTT.md para probarlo contra un mosquitto local.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include <mqtt_client.h>
+#include "CommandQueue.h"
+
+class ServoPWMController;
+
+// URI del broker; se define en build_flags para activar MQTT, por ejemplo:
+//   -DMQTT_BROKER_URI=\"mqtt://192.168.1.50:1883\"
+#ifndef MQTT_BROKER_URI
+#define MQTT_BROKER_URI ""
+#endif
+
+// =============================================================================
+// Configuración específica de MQTT
+// =============================================================================
+
+namespace MqttConfig {
+    constexpr const char* BROKER_URI = MQTT_BROKER_URI;    // Vacío = MQTT desactivado
+    constexpr const char* TOPIC_ROOT = "riego";
+    constexpr uint16_t KEEPALIVE_SECONDS = 30;
+    constexpr uint32_t RECONNECT_INTERVAL_MS = 10000;      // Entre intentos de conexión
+    constexpr uint32_t SAMPLE_INTERVAL_MS = 10000;         // Una muestra cada 10 s
+    constexpr uint8_t SAMPLES_PER_BATCH = 6;               // Un mensaje por minuto
+    constexpr size_t MAX_PAYLOAD = 512;                    // Tamaño máximo de un mensaje
+    constexpr size_t MAX_TOPIC = 64;
+
+    constexpr const char* SPOOL_PATH = "/mqtt_spool.bin";     // Se añade aquí
+    constexpr const char* SPOOL_REPLAY_PATH = "/mqtt_spool.old"; // Se reenvía desde aquí
+    constexpr size_t SPOOL_MAX_BYTES = 16384;              // Por archivo (hay dos)
+    constexpr uint32_t REPLAY_ACK_TIMEOUT_MS = 15000;      // Sin PUBACK: reenviar
+}
+
+/**
+ * @brief Una muestra de telemetría (una fila del lote).
+ */
+struct TelemetrySample {
+    uint32_t uptimeSeconds;
+    uint8_t irrigationState;    // IrrigationState como entero
+    uint8_t activeZone;
+    uint32_t remainingSeconds;
+    uint32_t freeHeap;
+    int8_t rssi;
+};
+
+/**
+ * @class MqttTelemetry
+ * @brief Cliente MQTT de telemetría y comandos (singleton).
+ */
+class MqttTelemetry {
+public:
+    static MqttTelemetry& getInstance() {
+        static MqttTelemetry instance;
+        return instance;
+    }
+
+    /**
+     * @brief Arranca el cliente MQTT en segundo plano.
+     *
+     * No espera a la conexión: si el broker no está, los mensajes van al
+     * spool hasta que aparezca.
+     *
+     * @param controller Controlador de riego del que se toman las muestras
+     * @param brokerUri URI "mqtt://host:puerto"; vacía desactiva MQTT
+     * @return true si el cliente quedó arrancado
+     */
+    bool begin(ServoPWMController* controller, const char* brokerUri = MqttConfig::BROKER_URI);
+
+    /**
+     * @brief Procesamiento periódico (llamar en loop principal).
+     *
+     * Toma muestras, publica cambios de estado y reenvía el spool. Nunca
+     * espera a la red.
+     */
+    void update();
+
+    /**
+     * @brief Detiene el cliente (el spool se conserva para el próximo arranque).
+     */
+    void end();
+
+    bool isStarted() const { return client != nullptr; }
+    bool isConnected() const { return connected; }
+    const char* getDeviceId() const { return deviceId; }
+
+    void getStatistics(uint32_t& published, uint32_t& spooled, uint32_t& replayed, uint32_t& dropped) const;
+
+private:
+    MqttTelemetry();
+    MqttTelemetry(const MqttTelemetry&) = delete;
+    MqttTelemetry& operator=(const MqttTelemetry&) = delete;
+
+    /**
+     * @brief Tipo de mensaje guardado en el spool (decide topic y retain).
+     */
+    enum class MessageKind : uint8_t {
+        TELEMETRY = 0,
+        STATE = 1
+    };
+
+    /**
+     * @brief Cabecera de cada registro del spool; le sigue el payload.
+     */
+    struct SpoolRecordHeader {
+        uint8_t kind;
+        uint8_t reserved;
+        uint16_t length;
+    };
+
+    // Tarea MQTT (esp-mqtt)
+    static void onMqttEvent(void* handlerArgs, esp_event_base_t base, int32_t eventId, void* eventData);
+    void handleIncomingCommand(const char* topic, int topicLength, const char* data, int dataLength);
+    void rememberAck(int msgId);
+
+    // Loop
+    static void onMqttCommandCompleted(const QueuedCommand& command, bool success, void* context);
+    void takeSample();
+    void publishBatch();
+    void publishStateIfChanged();
+    void publishOrSpool(MessageKind kind, const char* payload, size_t length);
+    bool publishNow(MessageKind kind, const char* payload, size_t length);
+    bool appendToSpool(MessageKind kind, const char* payload, size_t length);
+    void replaySpool();
+    bool wasAcked(int msgId) const;
+    bool spoolHasData() const;
+    void registerMetrics();
+    const char* topicFor(MessageKind kind) const;
+
+    esp_mqtt_client_handle_t client;
+    ServoPWMController* controller;
+
+    char deviceId[16];
+    char topicStatus[MqttConfig::MAX_TOPIC];
+    char topicState[MqttConfig::MAX_TOPIC];
+    char topicTelemetry[MqttConfig::MAX_TOPIC];
+    char topicCommands[MqttConfig::MAX_TOPIC];      // Prefijo "riego/<id>/cmd/"
+    char topicCommandResult[MqttConfig::MAX_TOPIC];
+
+    // Compartido con la tarea MQTT
+    volatile bool connected;
+    static constexpr uint8_t RECENT_ACKS = 8;
+    volatile int recentAcks[RECENT_ACKS];           // Últimos msg_id confirmados (PUBACK)
+    volatile uint8_t recentAckHead;
+
+    // Lote en curso
+    TelemetrySample batch[MqttConfig::SAMPLES_PER_BATCH];
+    uint8_t batchCount;
+    uint32_t lastSampleTime;
+
+    // Último estado publicado
+    uint8_t lastState;
+    uint8_t lastZone;
+    bool stateKnown;
+
+    // Reenvío del spool (parada y espera: un registro en vuelo)
+    bool spoolPending;
+    size_t replayOffset;
+    size_t replayNextOffset;
+    int replayMsgId;
+    uint32_t replaySentAt;
+
+    // Estadísticas
+    uint32_t publishedCount;
+    uint32_t spooledCount;
+    uint32_t replayedCount;
+    uint32_t droppedCount;
+};
+
+#endif // __MQTT_TELEMETRY_H__
@@ -0,0 +1,183 @@
+/**
+ * @file StatusPublisher.h
+ * @brief Política de envío del estado por WebSocket según lo que cambia y quién mira.
+ *
+ * **CONCEPTO EDUCATIVO - PUBLICAR CAMBIOS, NO RELOJES**:
+ * Enviar el estado cada segundo "por si acaso" gasta aire (la WiFi de
+ * 2,4 GHz es un medio compartido) y CPU aunque no pase nada. Casi todo el
+ * tiempo el sistema está en reposo, y durante un riego lo único que cambia
+ * es una cuenta atrás que el navegador puede calcular solo. Por eso se
+ * distinguen tres tipos de cambio:
+ *
+ * - TRANSICIÓN: cambia algo discreto (estado, zona activa, errores,
+ *   configuración de zonas, válvula que abre o cierra) o termina un comando.
+ *   Se envía en el acto.
+ * - CUENTA ATRÁS: solo baja remainingTime. El cliente extrapola desde el
+ *   instante en que recibió el mensaje, así que basta un recordatorio cada
+ *   COUNTDOWN_INTERVAL_MS; si el valor real se aparta de lo extrapolado más
+ *   de COUNTDOWN_DRIFT_S (pausa, tiempo cambiado) se corrige al momento.
+ * - REPOSO: nada cambia. Solo un refresco cada IDLE_INTERVAL_MS (memoria,
+ *   uptime); el heartbeat ya mantiene viva la conexión.
+ *
+ * Además, cada cliente avisa cuando su pestaña pasa a segundo plano
+ * ({"type":"visibility","hidden":true}). Si todas están ocultas, los
+ * cambios se agrupan en un envío cada HIDDEN_INTERVAL_MS (los errores
+ * siguen saliendo en el acto) y quien vuelve a primer plano recibe el
+ * estado completo.
+ *
+ * **ESTADO INICIAL Y REANUDACIÓN**: cada difusión lleva un número de
+ * secuencia ("seq"). El panel arranca con GET /api/v1/bootstrap, que ya
+ * incluye el estado con su seq, y al abrir el WebSocket lo devuelve en el
+ * hello ({"type":"hello",...,"statusSeq":N}). Si desde entonces no se ha
+ * difundido nada, no hace falta mandarle otra vez el estado completo. Por
+ * eso el estado inicial de un cliente nuevo espera al hello; quien no lo
+ * manda en HELLO_GRACE_MS (clientes antiguos) lo recibe igualmente.
+ *
+ * Las tablas de visibilidad y de espera del hello se escriben desde la
+ * tarea AsyncTCP y se leen en el loop: una lectura desfasada solo adelanta
+ * o retrasa un envío (o, como mucho, repite el estado inicial).
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __STATUS_PUBLISHER_H__
+#define __STATUS_PUBLISHER_H__
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "SET_PIN.h"           // NUM_SERVOS
+
+namespace StatusPublisherConfig {
+    constexpr uint8_t CLIENT_SLOTS = 5;                // = WebSocketConfig::MAX_CONCURRENT_CLIENTS
+    constexpr uint32_t POLL_INTERVAL_MS = 250;         // Comparación del estado (sin enviar)
+    constexpr uint32_t COUNTDOWN_INTERVAL_MS = 15000;  // Recordatorio de la cuenta atrás
+    constexpr uint32_t COUNTDOWN_DRIFT_S = 2;          // Desviación que fuerza un envío
+    constexpr uint32_t IDLE_INTERVAL_MS = 300000;      // Refresco en reposo (5 min)
+    constexpr uint32_t HIDDEN_INTERVAL_MS = 60000;     // Con todas las pestañas ocultas
+    constexpr uint32_t HELLO_GRACE_MS = 1500;          // Espera del hello antes del estado inicial
+}
+
+// =============================================================================
+// Estructura de datos para estado del sistema
+// =============================================================================
+
+/**
+ * @struct SystemStatus
+ * @brief Estructura optimizada para envío de estado del sistema via WebSocket.
+ * 
+ * **CONCEPTO DE OPTIMIZACIÓN**: Esta estructura está diseñada para minimizar
+ * el tamaño de los mensajes JSON sin sacrificar información importante.
+ * Cada campo tiene un propósito específico y está optimizado para serialización.
+ */
+struct SystemStatus {
+    // Estado del sistema de riego
+    String irrigationState;
+    uint8_t activeZone;
+    uint32_t remainingTime;
+    uint32_t totalCycles;
+    const char* wateringMode;     // Literal de wateringModeToString (nullptr sin controlador)
+    
+    // Estado de sensores
+    int humidityPercent;
+    int humidityThreshold;
+    
+    // Estado de zonas individuales
+    bool zonesEnabled[NUM_SERVOS];
+    uint32_t zoneTimes[NUM_SERVOS];
+    uint8_t zoneValveStates[NUM_SERVOS];  // ServoState de cada válvula (como entero)
+    
+    // Información del sistema
+    uint32_t systemUptime;
+    uint32_t freeMemory;
+    bool hasErrors;
+    
+    // Timestamp para sincronización
+    uint32_t timestamp;
+};
+
+/**
+ * @brief Motivo de un envío (etiqueta de la métrica).
+ */
+enum class PublishReason : uint8_t {
+    TRANSITION,
+    COUNTDOWN,
+    REFRESH,
+    FORCED,         // forceStatusUpdate(), comando ejecutado
+    COUNT,
+    NONE = COUNT
+};
+
+/**
+ * @class StatusPublisher
+ * @brief Decide cuándo difundir el estado; no envía nada por sí mismo.
+ */
+class StatusPublisher {
+public:
+    StatusPublisher();
+
+    /**
+     * @brief ¿Hay que difundir el estado ahora?
+     * @param connectedClients Clientes conectados (0: nunca se envía)
+     * @param forced Hay un envío pedido explícitamente
+     */
+    PublishReason evaluate(const SystemStatus& status, uint32_t now, uint32_t connectedClients, bool forced) const;
+
+    /**
+     * @brief Registra un envío: las siguientes decisiones comparan con este estado.
+     */
+    void markSent(const SystemStatus& status, uint32_t now, PublishReason reason);
+
+    /**
+     * @brief Cambia la visibilidad de un cliente.
+     * @return true si el cliente estaba oculto y pasa a visible
+     */
+    bool setClientHidden(uint32_t clientId, bool hidden);
+
+    /**
+     * @brief Cliente recién conectado: su estado inicial espera al hello.
+     * @return false si no hay hueco (enviar el estado ya)
+     */
+    bool awaitHello(uint32_t clientId, uint32_t now);
+
+    /**
+     * @brief Llegó el hello del cliente.
+     * @return true si aún esperaba su estado inicial
+     */
+    bool helloReceived(uint32_t clientId);
+
+    /**
+     * @brief Saca de la espera a un cliente que no mandó hello a tiempo.
+     * @return Su id, o 0 si no queda ninguno vencido
+     */
+    uint32_t takeHelloTimeout(uint32_t now);
+
+    /**
+     * @brief Olvida al cliente (desconexión).
+     */
+    void forgetClient(uint32_t clientId);
+
+    uint32_t getSentCount(PublishReason reason) const;
+
+    static const char* reasonToString(PublishReason reason);
+
+private:
+    bool hasVisibleClients(uint32_t connectedClients) const;
+    bool isTransition(const SystemStatus& status) const;
+    bool isCountdownOff(const SystemStatus& status, uint32_t now) const;
+
+    SystemStatus lastSent;              // Último estado difundido
+    bool hasSent;
+    uint32_t lastSentAt;
+    uint32_t hiddenClients[StatusPublisherConfig::CLIENT_SLOTS];   // 0 = hueco libre
+
+    struct PendingHello {
+        uint32_t clientId;              // 0 = hueco libre
+        uint32_t connectedAt;
+    };
+    PendingHello pendingHello[StatusPublisherConfig::CLIENT_SLOTS];
+    uint32_t sentCount[static_cast<uint8_t>(PublishReason::COUNT)];
+};
+
+#endif // __STATUS_PUBLISHER_H__
@@ -22,6 +22,8 @@ public:
     bool authenticateRequest(AsyncWebServerRequest* request);
 
 private:
+    bool isAuthorized(AsyncWebServerRequest* request);
+    void requestCredentials(AsyncWebServerRequest* request);
     void setupStaticFiles();
     void setupRESTEndpoints();
     void setupConfigurationEndpoints();
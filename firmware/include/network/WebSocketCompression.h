@@ -0,0 +1,135 @@
+/**
+ * @file WebSocketCompression.h
+ * @brief Compresión DEFLATE de los mensajes WebSocket (estilo permessage-deflate).
+ *
+ * **CONCEPTO EDUCATIVO - COMPRIMIR UNA VEZ, ENVIAR A TODOS**:
+ * RFC 7692 (permessage-deflate) comprime cada mensaje con DEFLATE. Aquí se
+ * usa solo el modo SIN "context takeover": cada mensaje se comprime desde
+ * cero, así que el resultado solo depende del texto y se calcula una vez;
+ * los mismos bytes sirven para todos los clientes que negociaron compresión.
+ *
+ * Con takeover (ventana conservada entre mensajes) se comprimiría más, pero
+ * cada cliente necesitaría su propio compresor (~5,4 KB) y el navegador un
+ * DecompressionStream vivo entre mensajes, que no separa un mensaje del
+ * siguiente. El servidor responde siempre "contextTakeover":false.
+ *
+ * La ventana es fija y pequeña (1 KB, windowBits = 10) para acotar la RAM.
+ *
+ * AsyncWebSocket no permite negociar extensiones en el handshake ni marcar
+ * el bit RSV1, así que la negociación va en un mensaje de la aplicación:
+ *
+ *     cliente → {"type":"hello","compression":"deflate","contextTakeover":false}
+ *     servidor → {"type":"hello","compression":"deflate","contextTakeover":false,"windowBits":10}
+ *
+ * y los mensajes comprimidos viajan como tramas binarias (DEFLATE crudo,
+ * "deflate-raw" para el DecompressionStream del navegador). Los mensajes
+ * cortos, o los que no ganan nada al comprimir, siguen yendo como texto.
+ *
+ * La tabla de clientes se modifica desde la tarea AsyncTCP (conexión,
+ * hello, desconexión) y se recorre desde el loop (difusiones): la protege
+ * un mutex.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __WEBSOCKET_COMPRESSION_H__
+#define __WEBSOCKET_COMPRESSION_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "MiniDeflate.h"
+
+namespace WebSocketCompressionConfig {
+    constexpr uint8_t CLIENT_SLOTS = 5;                 // = WebSocketConfig::MAX_CONCURRENT_CLIENTS
+    constexpr uint8_t WINDOW_BITS = 10;                 // log2(MiniDeflateConfig::WINDOW_SIZE)
+    constexpr size_t MIN_MESSAGE_BYTES = 96;            // Por debajo no compensa
+    constexpr size_t MAX_MESSAGE_BYTES = 2048;          // Por encima se envía como texto
+    constexpr size_t FRAME_BYTES = MAX_MESSAGE_BYTES * 9 / 8 + 16;   // Peor caso de Huffman fijo
+}
+
+static_assert((1u << WebSocketCompressionConfig::WINDOW_BITS) == MiniDeflateConfig::WINDOW_SIZE,
+              "windowBits anunciado distinto de la ventana de MiniDeflate");
+
+/**
+ * @brief Modo acordado con un cliente.
+ */
+enum class WsCompression : uint8_t {
+    NONE,               // Solo texto
+    PER_MESSAGE         // Trama compartida, cada mensaje independiente
+};
+
+/**
+ * @class WebSocketCompressor
+ * @brief Modo de cada cliente y compresión de las difusiones.
+ */
+class WebSocketCompressor {
+public:
+    /**
+     * @brief Envía un mensaje a un cliente (binary = trama comprimida).
+     */
+    typedef void (*SendFn)(uint32_t clientId, const uint8_t* data, size_t length, bool binary, void* context);
+
+    WebSocketCompressor();
+
+    /**
+     * @brief Registra un cliente recién conectado (sin compresión).
+     */
+    void addClient(uint32_t clientId);
+
+    /**
+     * @brief Procesa el hello de un cliente.
+     * @param deflate El cliente sabe descomprimir DEFLATE crudo
+     * @return Modo concedido
+     */
+    WsCompression negotiate(uint32_t clientId, bool deflate);
+
+    /**
+     * @brief Olvida al cliente (desconexión).
+     */
+    void forgetClient(uint32_t clientId);
+
+    /**
+     * @brief ¿Algún cliente negoció compresión? Si no, basta con textAll().
+     */
+    bool isActive() const { return compressedClients > 0; }
+
+    /**
+     * @brief Difunde un mensaje a todos los clientes registrados.
+     * @return false si la tabla se desbordó: el llamante debe usar textAll()
+     */
+    bool broadcast(const char* text, size_t length, SendFn send, void* context);
+
+    uint32_t getRawBytes() const { return rawBytes; }
+    uint32_t getCompressedBytes() const { return compressedBytes; }
+
+    static const char* modeToString(WsCompression mode);
+
+private:
+    struct Client {
+        uint32_t clientId;              // 0 = hueco libre
+        WsCompression mode;
+    };
+
+    Client* findClient(uint32_t clientId);
+    size_t compressShared(const uint8_t* data, size_t length);
+
+    Client clients[WebSocketCompressionConfig::CLIENT_SLOTS];
+    uint8_t compressedClients;
+    uint8_t unregisteredClients;        // Conectados que no cupieron en la tabla
+
+    MiniDeflate shared;                 // Comprime la trama de todos
+    uint8_t frame[WebSocketCompressionConfig::FRAME_BYTES];
+
+    uint32_t rawBytes;                  // Texto de los mensajes que se comprimieron
+    uint32_t compressedBytes;           // Lo que salió por la red en su lugar
+
+    StaticSemaphore_t lockBuffer;
+    SemaphoreHandle_t lock;
+};
+
+#endif // __WEBSOCKET_COMPRESSION_H__
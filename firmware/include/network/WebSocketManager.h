@@ -36,19 +36,27 @@
 #include <Arduino.h>
 #include <AsyncWebSocket.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "ServoPWMController.h"
 #include "SystemConfig.h"
+#include "CommandQueue.h"
+#include "WebSocketReassembly.h"
+#include "StatusPublisher.h"
+#include "WebSocketCompression.h"
 
 // =============================================================================
 // Configuración específica de WebSockets
 // =============================================================================
 
 namespace WebSocketConfig {
-    constexpr uint16_t MAX_CONCURRENT_CLIENTS = 5;         // Máximo 5 clientes simultáneos
+    constexpr const char* PATH = "/ws";                    // Endpoint (también lo usa la admisión)
+    constexpr uint16_t MAX_CONCURRENT_CLIENTS = 5;         // Huecos por cliente; la admisión decide por heap
     constexpr uint32_t HEARTBEAT_INTERVAL_MS = 30000;      // Ping cada 30 segundos
     constexpr uint32_t CLIENT_TIMEOUT_MS = 60000;          // Timeout cliente 60s
-    constexpr size_t MAX_MESSAGE_SIZE = 1024;              // Tamaño máximo mensaje JSON
-    constexpr uint32_t STATUS_UPDATE_INTERVAL_MS = 1000;   // Updates cada segundo
+    // Documento de un mensaje entrante (en el heap). Se analiza in situ: solo
+    // ocupan los nodos (16 bytes) y cada campo de un comando lleva al menos
+    // ~8 bytes de texto, así que el doble del mayor mensaje aceptado basta
+    constexpr size_t MESSAGE_DOC_CAPACITY = WebSocketReassemblyConfig::MAX_MESSAGE_BYTES * 2;
 }
 
 // =============================================================================
@@ -72,42 +80,6 @@ enum class WSMessageType {
     CLIENT_INFO         // Información del cliente conectado
 };
 
-// =============================================================================
-// Estructura de datos para estado del sistema
-// =============================================================================
-
-/**
- * @struct SystemStatus
- * @brief Estructura optimizada para envío de estado del sistema via WebSocket.
- * 
- * **CONCEPTO DE OPTIMIZACIÓN**: Esta estructura está diseñada para minimizar
- * el tamaño de los mensajes JSON sin sacrificar información importante.
- * Cada campo tiene un propósito específico y está optimizado para serialización.
- */
-struct SystemStatus {
-    // Estado del sistema de riego
-    String irrigationState;
-    uint8_t activeZone;
-    uint32_t remainingTime;
-    uint32_t totalCycles;
-    
-    // Estado de sensores
-    int humidityPercent;
-    int humidityThreshold;
-    
-    // Estado de zonas individuales
-    bool zonesEnabled[NUM_SERVOS];
-    uint32_t zoneTimes[NUM_SERVOS];
-    
-    // Información del sistema
-    uint32_t systemUptime;
-    uint32_t freeMemory;
-    bool hasErrors;
-    
-    // Timestamp para sincronización
-    uint32_t timestamp;
-};
-
 // =============================================================================
 // Clase Principal: WebSocketManager
 // =============================================================================
@@ -143,17 +115,25 @@ private:
     ServoPWMController* irrigationController; // Referencia al controlador de riego
     
     // Control de actualizaciones y timing
-    unsigned long lastStatusUpdate;         // Última actualización de estado enviada
+    unsigned long lastStatusUpdate;         // Última comparación del estado
     unsigned long lastHeartbeat;           // Último heartbeat enviado
     
-    // Cache de estado para optimización
-    SystemStatus lastKnownStatus;          // Último estado conocido
-    bool statusChanged;                    // Flag de cambio de estado
+    // Cuándo difundir el estado (transiciones, cuenta atrás, pestañas ocultas)
+    StatusPublisher statusPublisher;
+    bool statusChanged;                    // Envío forzado pendiente
+    std::atomic<uint32_t> statusSequence;  // "seq" del estado: sube en cada difusión
+    uint32_t lastPulseSequenceSent;        // Último pulso de riego difundido
     
     // Estadísticas de conexión
     uint32_t totalConnectionsCount;        // Total de conexiones históricas
     uint32_t messagesSentCount;           // Total de mensajes enviados
     uint32_t messagesReceivedCount;       // Total de mensajes recibidos
+    
+    // Mensajes fragmentados en curso (un hueco por cliente)
+    WebSocketReassembler reassembler;
+    
+    // Compresión DEFLATE negociada por cliente (mensaje "hello")
+    WebSocketCompressor compressor;
 
 public:
     // =========================================================================
@@ -193,10 +173,10 @@ public:
     void update();
     
     /**
-     * @brief Envía actualización de estado a todos los clientes conectados.
+     * @brief Envía el estado actual a todos los clientes conectados, sin esperar.
      * 
-     * **OPTIMIZACIÓN**: Solo envía si hay cambios reales en el estado,
-     * reduciendo tráfico de red innecesario.
+     * **OPTIMIZACIÓN**: update() solo lo difunde cuando StatusPublisher lo
+     * decide; este método es para quien necesita un envío inmediato.
      */
     void broadcastStatusUpdate();
     
@@ -250,6 +230,14 @@ public:
      * notificar inmediatamente a los clientes conectados.
      */
     void forceStatusUpdate();
+    
+    /**
+     * @brief Estado actual como mensaje status_update (con su "seq").
+     * 
+     * Lee la foto publicada del controlador: seguro desde AsyncTCP. Lo usa
+     * /api/v1/bootstrap para que el panel arranque sin esperar al WebSocket.
+     */
+    String getStatusJson();
 
 private:
     // =========================================================================
@@ -263,25 +251,70 @@ private:
                             AwsEventType type, void* arg, uint8_t* data, size_t len);
     
     /**
-     * @brief Procesa mensaje recibido de un cliente.
+     * @brief Procesa un mensaje completo de un cliente.
+     * @param message Texto JSON sin '\0' final; se modifica al analizarlo (in situ)
+     */
+    void handleClientMessage(AsyncWebSocketClient* client, char* message, size_t length);
+    
+    /**
+     * @brief Encola un comando {"command":..., "parameters":...} del cliente.
      */
-    void handleClientMessage(AsyncWebSocketClient* client, const String& message);
+    void queueClientCommand(AsyncWebSocketClient* client, JsonObjectConst entry);
     
     /**
-     * @brief Serializa el estado actual del sistema a JSON.
+     * @brief Envía {"type":"error","message":...} a un cliente.
+     */
+    void sendClientError(AsyncWebSocketClient* client, const char* message);
+    
+    /**
+     * @brief Ejecuta los comandos encolados (WebSocket y MQTT) en el loop.
+     * 
+     * **CONCEPTO EDUCATIVO**: Los comandos llegan desde tareas de red; aquí
+     * se ejecutan siempre desde la misma tarea que mueve los servos, así
+     * que nunca hay dos órdenes compitiendo por el controlador.
+     */
+    void processQueuedCommands();
+    
+    /**
+     * @brief Responde a un cliente WebSocket cuando su comando termina.
+     */
+    static void onWebSocketCommandCompleted(const QueuedCommand& command, bool success, void* context);
+    
+    /**
+     * @brief Serializa un estado del sistema a JSON.
      * 
      * **OPTIMIZACIÓN**: Usa ArduinoJson para serialización eficiente
      * con manejo automático de memoria.
      */
-    String serializeSystemStatus();
+    String serializeSystemStatus(const SystemStatus& status);
+    
+    /**
+     * @brief Difunde el estado y lo registra en StatusPublisher.
+     */
+    void publishStatus(const SystemStatus& status, PublishReason reason);
+    
+    /**
+     * @brief Procesa {"type":"visibility","hidden":bool} de un cliente.
+     */
+    void handleVisibility(AsyncWebSocketClient* client, bool hidden);
     
     /**
-     * @brief Compara estados para detectar cambios significativos.
+     * @brief Procesa {"type":"hello","compression":...} y responde con el modo concedido.
      * 
-     * **CONCEPTO DE EFICIENCIA**: Evita enviar actualizaciones innecesarias
-     * comparando el estado actual con el último estado enviado.
+     * @param statusSeq "seq" del último estado que tiene el cliente (0 = ninguno):
+     *                  si sigue siendo el actual no se le reenvía el estado inicial
      */
-    bool hasStatusChanged();
+    void handleHello(AsyncWebSocketClient* client, const char* compression, uint32_t statusSeq);
+    
+    /**
+     * @brief Difunde un mensaje: comprimido a quien lo negoció, texto al resto.
+     */
+    void broadcastMessage(const String& message);
+    
+    /**
+     * @brief Envío a un cliente para WebSocketCompressor::broadcast().
+     */
+    static void sendToClient(uint32_t clientId, const uint8_t* data, size_t length, bool binary, void* context);
     
     /**
      * @brief Envía mensaje de heartbeat para mantener conexiones activas.
@@ -291,6 +324,14 @@ private:
      */
     void sendHeartbeat();
     
+    /**
+     * @brief Difunde los pulsos de riego completados desde el último envío.
+     * 
+     * Compara el número de secuencia del controlador con el último enviado;
+     * si el buffer circular se dio la vuelta, los pulsos perdidos se omiten.
+     */
+    void broadcastPulseTelemetry();
+    
     /**
      * @brief Limpia conexiones inactivas o perdidas.
      */
@@ -0,0 +1,94 @@
+/**
+ * @file WebSocketReassembly.h
+ * @brief Reensamblado de mensajes WebSocket fragmentados, sin copias a String.
+ *
+ * **CONCEPTO EDUCATIVO - FRAGMENTOS, TRAMAS Y MENSAJES**:
+ * Un mensaje WebSocket puede llegar en varias tramas (fragmentación del
+ * protocolo: opcode de continuación) y cada trama, a su vez, en varios
+ * paquetes TCP. AsyncWebSocket llama a WS_EVT_DATA por cada trozo con:
+ *
+ * - info->num:   número de trama dentro del mensaje (0 = primera)
+ * - info->index: posición del trozo dentro de la trama
+ * - info->len:   longitud total de la trama
+ * - info->final: última trama del mensaje
+ *
+ * Si el mensaje llega entero en una llamada (lo habitual), se analiza
+ * directamente sobre el buffer de recepción de la biblioteca: ni una copia.
+ * Si llega en trozos, se acumula en el hueco del cliente (tamaño fijo
+ * MAX_MESSAGE_BYTES) y se analiza allí. En ambos casos el JSON se lee
+ * "in situ": ArduinoJson, al recibir un char* modificable, deja las cadenas
+ * apuntando al propio buffer en lugar de duplicarlas.
+ *
+ * Todos los eventos llegan desde la tarea AsyncTCP, así que los huecos no
+ * necesitan mutex.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __WEBSOCKET_REASSEMBLY_H__
+#define __WEBSOCKET_REASSEMBLY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <AsyncWebSocket.h>
+
+namespace WebSocketReassemblyConfig {
+    constexpr uint8_t SLOTS = 5;                        // = WebSocketConfig::MAX_CONCURRENT_CLIENTS
+    constexpr size_t MAX_MESSAGE_BYTES = 2048;          // Tope de un mensaje, reensamblado o no
+}
+
+/**
+ * @brief Resultado de entregar un trozo.
+ */
+enum class ReassemblyResult : uint8_t {
+    PENDING,        // Faltan trozos
+    COMPLETE,       // message/length apuntan al mensaje completo
+    TOO_LARGE,      // Supera MAX_MESSAGE_BYTES o no hay hueco libre; el resto se descarta
+    IGNORED         // Mensaje binario o trozo de un mensaje ya descartado
+};
+
+/**
+ * @class WebSocketReassembler
+ * @brief Un hueco de tamaño fijo por cliente (reservado al primer fragmento).
+ */
+class WebSocketReassembler {
+public:
+    WebSocketReassembler();
+
+    /**
+     * @brief Entrega un trozo recibido en WS_EVT_DATA.
+     * @param data Buffer de la biblioteca (se usa en sitio si el mensaje va entero)
+     * @param message Salida: inicio del mensaje completo (modificable, sin '\0')
+     * @param length Salida: longitud del mensaje completo
+     *
+     * Con COMPLETE, la vista es válida hasta la siguiente llamada a feed().
+     */
+    ReassemblyResult feed(uint32_t clientId, const AwsFrameInfo& info, uint8_t* data, size_t len,
+                          char*& message, size_t& length);
+
+    /**
+     * @brief Libera el hueco del cliente (desconexión).
+     */
+    void forget(uint32_t clientId);
+
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+private:
+    struct Slot {
+        uint32_t clientId;
+        bool inUse;
+        bool discarding;            // Mensaje demasiado grande: tirar hasta la última trama
+        size_t length;
+        char buffer[WebSocketReassemblyConfig::MAX_MESSAGE_BYTES];
+    };
+
+    Slot* findSlot(uint32_t clientId, bool allocate);
+
+    Slot slots[WebSocketReassemblyConfig::SLOTS];
+    uint32_t droppedCount;
+};
+
+#endif // __WEBSOCKET_REASSEMBLY_H__
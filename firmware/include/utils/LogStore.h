@@ -0,0 +1,254 @@
+/**
+ * @file LogStore.h
+ * @brief Almacenamiento del log en segmentos rotados, comprimidos e indexados.
+ *
+ * **CONCEPTO EDUCATIVO - SEGMENTOS + ÍNDICE DISPERSO**:
+ * Un único /system.log abierto en modo "a" crece hasta llenar la flash, y
+ * para buscar "los errores desde el martes" hay que leerlo entero. Aquí el
+ * log se organiza como en las bases de datos de series temporales:
+ *
+ *     /system.log        segmento activo, texto plano (se añade al final)
+ *     /logseg_<n>.z      segmentos cerrados: bloques DEFLATE independientes
+ *     /logs.idx          resumen de cada segmento cerrado
+ *
+ * Cuando el segmento activo supera su tamaño se cierra: se parte en bloques
+ * de ~1 KB cortados en fin de línea, cada bloque se comprime por separado
+ * y va precedido de una cabecera con su rango de horas y los niveles que
+ * contiene. Se conservan los últimos MAX_SEGMENTS segmentos.
+ *
+ * Una consulta (?since=&level=) baja por el índice en dos niveles:
+ *
+ *     /logs.idx  -> ¿algún bloque del segmento puede coincidir? si no, ni se abre
+ *     cabecera   -> ¿este bloque puede coincidir? si no, seek() al siguiente
+ *     bloque     -> se descomprime y se filtra línea a línea
+ *
+ * Así, buscar los errores de la última hora lee unas decenas de bytes de
+ * cabeceras por segmento y descomprime solo los bloques que interesan.
+ *
+ * Formato de línea en flash (también en el segmento activo):
+ *
+ *     <hora> <reloj> <nivel> <mensaje formateado>\n
+ *
+ * donde <hora> son segundos Unix (reloj 'e') o segundos desde el arranque
+ * si aún no hay hora (reloj 'u'), y <nivel> es el número de LogLevel. Los
+ * filtros por hora solo se aplican a líneas con hora Unix.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __LOG_STORE_H__
+#define __LOG_STORE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "MiniDeflate.h"
+
+namespace LogStoreConfig {
+    constexpr const char* ACTIVE_PATH = "/system.log";
+    constexpr const char* INDEX_PATH = "/logs.idx";
+    constexpr const char* SEGMENT_PREFIX = "/logseg_";         // + secuencia + ".z"
+    constexpr size_t DEFAULT_SEGMENT_BYTES = 16384;            // Tamaño del segmento activo
+    constexpr size_t MIN_SEGMENT_BYTES = 4096;
+    constexpr uint8_t MAX_SEGMENTS = 6;                        // Segmentos cerrados conservados
+    constexpr size_t BLOCK_RAW_BYTES = MiniDeflateConfig::WINDOW_SIZE;
+    constexpr size_t BLOCK_PACKED_MAX = MiniDeflateConfig::OUTPUT_SIZE;
+    constexpr uint32_t MIN_VALID_EPOCH = 1577836800;           // 2020-01-01: reloj en hora
+    constexpr uint8_t MAX_LEVEL = 4;                           // LogLevel::VERBOSE
+    constexpr const char* CONTENT_TYPE = "text/plain; charset=utf-8";
+}
+
+/**
+ * @brief Bits de flags en cabeceras y resúmenes.
+ */
+namespace LogSummaryFlags {
+    constexpr uint8_t HAS_UPTIME_LINES = 0x01;     // Hay líneas sin hora Unix
+}
+
+/**
+ * @brief Cabecera de cada bloque de un segmento cerrado (precede a los datos).
+ */
+struct LogBlockHeader {
+    uint32_t firstTime;         // Primera hora Unix del bloque (0 = ninguna)
+    uint32_t lastTime;          // Última hora Unix del bloque (0 = ninguna)
+    uint16_t rawLength;         // Bytes de texto descomprimido
+    uint16_t packedLength;      // Bytes DEFLATE que siguen a la cabecera
+    uint8_t levelMask;          // Bit N = hay líneas de nivel N
+    uint8_t flags;              // LogSummaryFlags
+    uint16_t reserved;
+};
+
+static_assert(sizeof(LogBlockHeader) == 16, "LogBlockHeader se guarda tal cual en flash");
+
+/**
+ * @brief Entrada de /logs.idx: resumen de un segmento cerrado.
+ */
+struct LogSegmentInfo {
+    uint32_t sequence;          // Número del archivo /logseg_<n>.z
+    uint32_t firstTime;
+    uint32_t lastTime;
+    uint16_t blockCount;
+    uint8_t levelMask;
+    uint8_t flags;
+};
+
+static_assert(sizeof(LogSegmentInfo) == 16, "LogSegmentInfo se guarda tal cual en flash");
+
+/**
+ * @brief Campos de una línea del log ya interpretados.
+ */
+struct LogLineInfo {
+    uint32_t time;
+    bool uptimeClock;
+    uint8_t level;
+};
+
+/**
+ * @brief Filtro de una consulta: hora mínima y nivel máximo (inclusive).
+ */
+struct LogQuery {
+    uint32_t since;             // 0 = sin límite de hora
+    uint8_t maxLevel;           // 0 = solo ERROR ... 4 = todo
+
+    bool matchesLine(const LogLineInfo& line) const;
+    bool matchesSummary(uint32_t lastTime, uint8_t levelMask) const;
+};
+
+/**
+ * @class LogStore
+ * @brief Escritura del log en segmentos con rotación y compresión (singleton).
+ *
+ * Solo lo usa Logger::flush(); no debe llamar a LOG_* (el mutex no es
+ * recursivo), los errores propios van directamente por Serial.
+ */
+class LogStore {
+public:
+    static LogStore& getInstance() {
+        static LogStore instance;
+        return instance;
+    }
+
+    /**
+     * @brief Carga el índice de segmentos (SPIFFS ya montado).
+     */
+    bool begin();
+
+    /**
+     * @brief Añade líneas ya formateadas al segmento activo y rota si se llena.
+     */
+    bool append(const char* data, size_t length);
+
+    /**
+     * @brief Cambia el tamaño del segmento activo (SystemConfig::logFileSizeKB).
+     */
+    void setSegmentBytes(size_t bytes);
+
+    /**
+     * @brief Impide rotaciones mientras una consulta lee los segmentos.
+     */
+    void pin();
+    void unpin();
+
+    /**
+     * @brief Copia el índice actual (para recorrerlo sin el mutex).
+     * @return Número de segmentos copiados
+     */
+    uint8_t copySegments(LogSegmentInfo* out, uint8_t maxSegments);
+
+    uint32_t getRotationCount() const { return rotationCount; }
+
+    /**
+     * @brief Interpreta el prefijo "<hora> <reloj> <nivel> " de una línea.
+     */
+    static bool parseLine(const char* line, size_t length, LogLineInfo& info);
+
+    static void segmentPath(uint32_t sequence, char* out, size_t outLength);
+
+private:
+    LogStore();
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    struct RotationScratch;
+
+    bool rotateLocked();
+    bool compressActiveLocked(RotationScratch& scratch, File& source, File& target, LogSegmentInfo& info);
+    bool saveIndexLocked();
+
+    LogSegmentInfo segments[LogStoreConfig::MAX_SEGMENTS];
+    uint8_t segmentCount;
+    uint32_t nextSequence;
+    size_t segmentBytes;
+    uint8_t pinCount;
+    bool started;
+    uint32_t rotationCount;
+
+    StaticSemaphore_t lockBuffer;
+    SemaphoreHandle_t lock;
+};
+
+/**
+ * @class LogQueryCursor
+ * @brief Consulta reanudable sobre los segmentos (una a la vez, instancia estática).
+ *
+ * Igual que HistoryExportCursor: el servidor pide la respuesta a trozos con
+ * fill() y el token protege contra liberaciones tardías. Las líneas salen
+ * tal como están en flash, de la más antigua a la más reciente.
+ */
+class LogQueryCursor {
+public:
+    /**
+     * @return nullptr si ya hay una consulta en curso
+     */
+    static LogQueryCursor* acquire(uint32_t& token, const LogQuery& query);
+
+    void release(uint32_t token);
+
+    /**
+     * @return Bytes escritos; 0 cuando la consulta ha terminado
+     */
+    size_t fill(uint8_t* out, size_t maxLength);
+
+    /**
+     * @brief Interpreta ?level= por nombre ("error", "warning", ...) o número.
+     */
+    static bool parseLevel(const char* text, uint8_t& level);
+
+private:
+    enum class Phase : uint8_t { SEGMENTS, ACTIVE, DONE };
+
+    LogQueryCursor() : inUse(false), token(0) {}
+
+    void reset(const LogQuery& query);
+    bool nextMatchingLine();
+    bool loadNextBlock();
+    bool loadActiveText();
+
+    bool inUse;
+    uint32_t token;
+
+    LogQuery query;
+    Phase phase;
+    LogSegmentInfo segments[LogStoreConfig::MAX_SEGMENTS];
+    uint8_t segmentCount;
+    uint8_t segmentIndex;
+    File file;
+    uint32_t activeRemaining;   // Bytes del segmento activo aún por leer
+
+    uint8_t packed[LogStoreConfig::BLOCK_PACKED_MAX];
+    char text[LogStoreConfig::BLOCK_RAW_BYTES];
+    size_t textLength;
+    size_t textPos;
+    size_t emitPos;
+    size_t emitEnd;
+
+    static LogQueryCursor instance;
+    static uint32_t nextToken;
+};
+
+#endif // __LOG_STORE_H__
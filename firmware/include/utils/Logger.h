@@ -101,11 +101,21 @@ public:
      */
     void setSerialLogging(bool enabled);
 
+    /**
+     * @brief ¿Está activo el logging a serial?
+     */
+    bool isSerialLogging() const;
+
     /**
      * @brief Habilita/deshabilita logging a archivo.
      */
     void setFileLogging(bool enabled);
 
+    /**
+     * @brief Tamaño del segmento activo del log en flash (SystemConfig::logFileSizeKB).
+     */
+    void setMaxFileSize(uint32_t kilobytes);
+
     /**
      * @brief Habilita/deshabilita logging a web.
      */
@@ -127,6 +137,11 @@ private:
      */
     String formatTimestamp();
 
+    /**
+     * @brief Prefijo de hora y nivel de las líneas guardadas en flash.
+     */
+    String formatStorePrefix(LogLevel level);
+
     /**
      * @brief Escribe el log al serial.
      */
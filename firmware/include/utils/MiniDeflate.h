@@ -0,0 +1,115 @@
+/**
+ * @file MiniDeflate.h
+ * @brief Compresor DEFLATE (RFC 1951) en streaming con memoria fija.
+ *
+ * **CONCEPTO EDUCATIVO - COMPRIMIR CON 5 KB DE RAM**:
+ * Un compresor zlib completo necesita cientos de KB. Este se queda en lo
+ * esencial del formato DEFLATE:
+ *
+ * - LZ77 con ventana de 1 KB: si los próximos bytes ya aparecieron hace
+ *   poco, se escribe "copia N bytes de hace D" en lugar de los bytes.
+ *   Las coincidencias se buscan con una tabla hash de 3 bytes (sin cadenas:
+ *   solo el candidato más reciente, búsqueda voraz).
+ * - Huffman fijo (BTYPE=01): los códigos vienen definidos por el estándar,
+ *   así que no hay que calcular ni transmitir tablas.
+ *
+ * Comprime peor que zlib nivel 6, pero la salida es DEFLATE estándar: se
+ * descomprime con zlib.decompressobj(-15) en Python o con cualquier
+ * inflate. Rinde bien con datos ya compactos y repetitivos (columnas de
+ * índices, varints parecidos).
+ *
+ * Uso en streaming:
+ *
+ *     deflater.begin();
+ *     while (hay datos) {
+ *         n = deflater.read(out, max);            // primero vaciar salida
+ *         if (n == 0) deflater.write(data, len);  // luego aceptar entrada
+ *     }
+ *     deflater.finish();                          // y vaciar con read()
+ *
+ * Con flush() en lugar de finish() el flujo sigue abierto: es el "vaciado
+ * síncrono" que separa mensajes sin perder la historia.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __MINI_DEFLATE_H__
+#define __MINI_DEFLATE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MiniDeflateConfig {
+    constexpr size_t WINDOW_SIZE = 1024;        // Historia para coincidencias (y tamaño de bloque)
+    constexpr uint8_t HASH_BITS = 9;            // 512 entradas
+    constexpr size_t OUTPUT_SIZE = 1280;        // Peor caso de un bloque: 1024 * 9 / 8 + cierre
+}
+
+class MiniDeflate {
+public:
+    MiniDeflate();
+
+    /**
+     * @brief Empieza un flujo nuevo.
+     */
+    void begin();
+
+    /**
+     * @brief Entrega datos al compresor.
+     * @return Bytes aceptados; 0 si antes hay que vaciar la salida con read()
+     */
+    size_t write(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Cierra el flujo (último bloque y relleno hasta byte).
+     * @return false si antes hay que vaciar la salida con read()
+     */
+    bool finish();
+
+    /**
+     * @brief Vaciado síncrono: todo lo escrito sale ya, sin cerrar el flujo.
+     *
+     * Cierra el bloque actual y añade un bloque almacenado vacío, así la
+     * salida termina alineada a byte en 00 00 FF FF (RFC 7692 quita esos
+     * cuatro bytes de cada mensaje). La historia se conserva: lo siguiente
+     * puede referirse a lo ya enviado.
+     * @return false si antes hay que vaciar la salida con read()
+     */
+    bool flush();
+
+    /**
+     * @brief Saca bytes comprimidos.
+     */
+    size_t read(uint8_t* out, size_t maxLength);
+
+    size_t pendingOutput() const { return outLength - outPos; }
+    bool finished() const { return closed && pendingOutput() == 0; }
+
+private:
+    void compressPending();
+    void putBits(uint32_t value, uint8_t count);
+    void putHuffman(uint16_t code, uint8_t length);
+    void putLiteral(uint8_t literal);
+    void putMatch(uint16_t length, uint16_t distance);
+    void flushBits();
+    uint16_t hashAt(size_t index) const;
+
+    // [historia: WINDOW_SIZE][bloque actual: WINDOW_SIZE]
+    uint8_t buffer[2 * MiniDeflateConfig::WINDOW_SIZE];
+    size_t bufferFill;          // Bytes válidos en buffer (historia + pendientes)
+    size_t historyLength;       // Bytes de historia al principio de buffer
+    uint32_t bufferBase;        // Posición absoluta en el flujo de buffer[0]
+
+    uint32_t head[1u << MiniDeflateConfig::HASH_BITS];     // Última posición absoluta + 1 (0 = vacía)
+
+    uint8_t out[MiniDeflateConfig::OUTPUT_SIZE];
+    size_t outLength;
+    size_t outPos;
+    uint32_t bitBuffer;
+    uint8_t bitCount;
+    bool closed;
+};
+
+#endif // __MINI_DEFLATE_H__
@@ -0,0 +1,58 @@
+/**
+ * @file MiniInflate.h
+ * @brief Descompresor DEFLATE mínimo para los bloques generados por MiniDeflate.
+ *
+ * **CONCEPTO EDUCATIVO - DESCOMPRIMIR SIN TABLAS**:
+ * MiniDeflate solo emite bloques con Huffman fijo, cuyos códigos están
+ * definidos por el estándar (RFC 1951 §3.2.6). Eso permite decodificar
+ * leyendo bit a bit y comparando rangos, sin construir tablas en RAM:
+ *
+ *     7 bits 0000000..0010111          -> símbolos 256..279
+ *     8 bits 00110000..10111111        -> literales 0..143
+ *     8 bits 11000000..11000111        -> símbolos 280..287
+ *     9 bits 110010000..111111111      -> literales 144..255
+ *
+ * También acepta bloques sin comprimir (BTYPE=00). Los bloques con Huffman
+ * dinámico (los que genera zlib) se rechazan: este módulo no pretende
+ * descomprimir datos ajenos, solo releer los propios.
+ *
+ * Trabaja de búfer a búfer: la salida completa debe caber en `out`, y las
+ * copias LZ77 se resuelven sobre esa misma salida.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __MINI_INFLATE_H__
+#define __MINI_INFLATE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+class MiniInflate {
+public:
+    /**
+     * @brief Descomprime un flujo DEFLATE crudo completo.
+     * @param outLength Bytes descomprimidos
+     * @return false si el flujo está corrupto, usa Huffman dinámico o no cabe en out
+     */
+    static bool inflate(const uint8_t* in, size_t inLength,
+                        uint8_t* out, size_t outCapacity, size_t& outLength);
+
+private:
+    MiniInflate(const uint8_t* in, size_t inLength);
+
+    bool bit(uint32_t& value);
+    bool bits(uint8_t count, uint32_t& value);
+    bool huffmanBits(uint8_t count, uint32_t& code);
+    bool literalLength(uint16_t& symbol);
+
+    const uint8_t* input;
+    size_t inputLength;
+    size_t inputPos;
+    uint32_t bitBuffer;
+    uint8_t bitCount;
+};
+
+#endif // __MINI_INFLATE_H__
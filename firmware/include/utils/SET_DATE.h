@@ -16,7 +16,7 @@ private:
     IRTC* rtc; // Puntero a un objeto RTC que cumple con la interfaz IRTC.
     
     // Funciones de ayuda internas.
-    uint8_t parseDigits(char* str, uint8_t count);
+    uint8_t parseDigits(const char* str, uint8_t count);
     bool isValidDateTime(const DateTime& dt);
 
 public:
@@ -28,6 +28,12 @@ public:
     // Intenta leer y procesar la entrada del puerto serie para configurar la fecha.
     // Devuelve true si la configuración fue exitosa en esta llamada.
     bool setDateFromSerial();
+
+    // Interpreta una cadena AAMMDDWHHMMSS (exactamente 13 dígitos) y la establece en el RTC.
+    bool setDateFromString(const char* digits, uint8_t length);
+
+    // Valida y establece una fecha ya descompuesta (p.ej. recibida por SerialProvisioning).
+    bool setDate(const DateTime& dt);
 };
 
 #endif
@@ -0,0 +1,95 @@
+/**
+ * @file Seqlock.h
+ * @brief Publicación de una estructura entre tareas sin mutex (un escritor, N lectores).
+ *
+ * **CONCEPTO EDUCATIVO - SEQLOCK**:
+ * El loop modifica el estado del riego y la tarea AsyncTCP (otro núcleo, o
+ * el mismo con más prioridad) lo lee para responder. Leer campo a campo lo
+ * que otra tarea está cambiando da mezclas imposibles: la zona nueva con el
+ * tiempo restante de la anterior. Un mutex lo evita, pero entonces el
+ * control de las válvulas puede quedarse esperando a una respuesta HTTP.
+ *
+ * Un seqlock invierte el coste: el escritor nunca espera y el lector, si
+ * tuvo mala suerte, repite la copia.
+ *
+ *     escritor:  seq++ (impar: escribiendo)  copia  seq++ (par: estable)
+ *     lector:    s1 = seq  copia  s2 = seq   → válida si s1 == s2 y es par
+ *
+ * T debe poder copiarse byte a byte (nada de String ni punteros propios).
+ * Si el lector interrumpe al escritor en el mismo núcleo, reintentar sin
+ * más no serviría (el escritor no avanza mientras el lector ocupa la CPU):
+ * tras unos reintentos el lector cede un tick con vTaskDelay.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Celda publicada con seqlock.
+ * @tparam T Estructura trivialmente copiable
+ */
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock necesita un tipo copiable byte a byte");
+
+public:
+    Seqlock() : sequence(0) {
+        memset(&value, 0, sizeof(T));
+    }
+
+    /**
+     * @brief Publica un valor nuevo. Solo desde la tarea escritora.
+     */
+    void write(const T& next) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value, &next, sizeof(T));
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copia el último valor publicado completo (nunca a medias).
+     */
+    void read(T& out) const {
+        for (uint8_t attempt = 0; ; attempt++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                memcpy(&out, &value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    return;
+                }
+            }
+            if (attempt >= SPIN_ATTEMPTS) {
+                vTaskDelay(1);          // Deja terminar al escritor
+            }
+        }
+    }
+
+    /**
+     * @brief Número de publicaciones (para detectar cambios sin copiar).
+     */
+    uint32_t getVersion() const {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr uint8_t SPIN_ATTEMPTS = 4;
+
+    T value;
+    std::atomic<uint32_t> sequence;
+};
+
+#endif // __SEQLOCK_H__
@@ -0,0 +1,200 @@
+/**
+ * @file Trace.h
+ * @brief Trazas de ejecución (inicio/fin) exportables en formato Chrome/Perfetto.
+ *
+ * **CONCEPTO EDUCATIVO - LÍNEA TEMPORAL FRENTE A HISTOGRAMAS**:
+ * Los histogramas de StateMetrics dicen cuánto dura cada cosa, pero no qué
+ * pasaba a la vez. Si un cierre de válvula tarda de vez en cuando el doble,
+ * hay que ver la línea temporal: ¿la interrumpió un broadcast del
+ * WebSocket desde la tarea AsyncTCP? ¿un flush del log?
+ *
+ * Cada punto de traza guarda un evento de 24 bytes en un buffer circular
+ * del núcleo que lo ejecuta:
+ *
+ *     µs (esp_timer_get_time) | nombre (literal) | tarea | fase B/E/i
+ *
+ * Registrar cuesta poco: leer el temporizador del sistema, reservar hueco
+ * con un incremento atómico y escribir cuatro campos. Sin mutex, sin
+ * formatear texto y sin reservar memoria. El JSON se genera solo
+ * al descargar la traza (GET /api/v1/trace) y se abre tal cual en
+ * chrome://tracing o ui.perfetto.dev: un proceso por núcleo y una fila por
+ * tarea.
+ *
+ * La marca de tiempo no se toma del contador de ciclos (CCOUNT). Ese
+ * contador es de 32 bits (a 240 MHz da la vuelta cada ~17,9 s), cada
+ * núcleo tiene el suyo sin sincronizar y su ritmo cambia con la frecuencia
+ * de la CPU, que PowerManager baja en reposo. esp_timer_get_time() es un único reloj de
+ * 64 bits en µs, común a los dos núcleos e independiente de la frecuencia.
+ *
+ * Limitaciones conocidas:
+ * - Los nombres deben ser literales (se guarda el puntero) y las tareas
+ *   trazadas no deben borrarse (su nombre se lee al exportar).
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+namespace TraceConfig {
+    constexpr uint16_t EVENTS_PER_CORE = 256;          // Potencia de 2 (máscara en lugar de módulo)
+    constexpr uint8_t CORES = 2;
+    constexpr uint8_t MAX_TASKS = 16;                  // Tareas distintas en una exportación
+    constexpr bool ENABLED_AT_BOOT = true;
+    constexpr const char* CONTENT_TYPE = "application/json";
+}
+
+static_assert((TraceConfig::EVENTS_PER_CORE & (TraceConfig::EVENTS_PER_CORE - 1)) == 0,
+              "EVENTS_PER_CORE debe ser potencia de 2");
+
+/**
+ * @brief Fase de un evento (letras del formato Chrome Trace Event).
+ */
+enum class TracePhase : uint8_t {
+    BEGIN = 'B',
+    END = 'E',
+    INSTANT = 'i'
+};
+
+struct TraceEvent {
+    int64_t micros;             // esp_timer_get_time()
+    const char* name;
+    TaskHandle_t task;
+    uint8_t phase;              // TracePhase
+    uint8_t reserved[3];
+};
+
+/**
+ * @class Trace
+ * @brief Buffers circulares por núcleo (estáticos, sin instancia).
+ */
+class Trace {
+public:
+    static inline void record(const char* name, TracePhase phase) {
+        if (!enabled) {
+            return;
+        }
+        int64_t micros = esp_timer_get_time();
+        Ring& ring = rings[xPortGetCoreID()];
+        uint32_t slot = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED) & (TraceConfig::EVENTS_PER_CORE - 1);
+        TraceEvent& event = ring.events[slot];
+        event.micros = micros;
+        event.name = name;
+        event.task = xTaskGetCurrentTaskHandle();
+        event.phase = static_cast<uint8_t>(phase);
+    }
+
+    static void setEnabled(bool on) { enabled = on; }
+    static bool isEnabled() { return enabled; }
+
+    /**
+     * @brief Vacía los buffers (con la traza pausada).
+     */
+    static void clear();
+
+    /**
+     * @brief Eventos registrados desde el arranque (incluidos los ya sobrescritos).
+     */
+    static uint32_t getRecordedCount();
+
+private:
+    friend class TraceExportCursor;
+
+    struct Ring {
+        uint32_t head;          // Eventos escritos en total; slot = head % EVENTS_PER_CORE
+        TraceEvent events[TraceConfig::EVENTS_PER_CORE];
+    };
+
+    static Ring rings[TraceConfig::CORES];
+    static volatile bool enabled;
+};
+
+/**
+ * @brief Emite BEGIN al construirse y END al salir del ámbito.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name) {
+        Trace::record(name, TracePhase::BEGIN);
+    }
+    ~TraceScope() {
+        Trace::record(name, TracePhase::END);
+    }
+
+private:
+    const char* name;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_BEGIN(name)   Trace::record(name, TracePhase::BEGIN)
+#define TRACE_END(name)     Trace::record(name, TracePhase::END)
+#define TRACE_INSTANT(name) Trace::record(name, TracePhase::INSTANT)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+/**
+ * @class TraceExportCursor
+ * @brief Exportación reanudable en JSON de Chrome (una a la vez, instancia estática).
+ *
+ * Igual que LogQueryCursor: el servidor pide la respuesta a trozos con
+ * fill() y el token protege contra liberaciones tardías. Mientras dura la
+ * exportación la traza se pausa, para que los buffers no cambien bajo el
+ * cursor; al liberar se restaura el estado anterior.
+ */
+class TraceExportCursor {
+public:
+    /**
+     * @return nullptr si ya hay una exportación en curso
+     */
+    static TraceExportCursor* acquire(uint32_t& token);
+
+    void release(uint32_t token);
+
+    /**
+     * @return Bytes escritos; 0 cuando la exportación ha terminado
+     */
+    size_t fill(uint8_t* out, size_t maxLength);
+
+private:
+    enum class Phase : uint8_t { HEADER, EVENTS, PROCESSES, THREADS, FOOTER, DONE };
+
+    TraceExportCursor() : inUse(false), token(0) {}
+
+    void reset();
+    bool produceLine();
+    uint8_t taskIndex(TaskHandle_t task);
+
+    bool inUse;
+    uint32_t token;
+    bool wasEnabled;
+
+    Phase phase;
+    uint8_t core;
+    uint32_t position[TraceConfig::CORES];     // Siguiente evento a exportar (contador absoluto)
+    uint32_t end[TraceConfig::CORES];
+    int64_t originMicros;                      // Evento más antiguo de la exportación ("ts" = 0)
+    bool firstEvent;
+    uint8_t metaIndex;
+
+    TaskHandle_t tasks[TraceConfig::MAX_TASKS];
+    uint8_t taskCount;
+
+    char line[160];
+    size_t lineLength;
+    size_t linePos;
+
+    static TraceExportCursor instance;
+    static uint32_t nextToken;
+};
+
+#endif // __TRACE_H__
@@ -0,0 +1,125 @@
+/**
+ * @file ZoneMask.h
+ * @brief Conjunto de zonas como mapa de bits (habilitadas, abiertas, en error...).
+ *
+ * **CONCEPTO EDUCATIVO - UN BIT POR ZONA**:
+ * Preguntar "¿cuál es la siguiente zona habilitada?" recorriendo
+ * zones[i].isEnabled cuesta una lectura por zona, y cada ZoneInfo ocupa
+ * decenas de bytes: con muchas zonas se recorre mucha memoria para leer
+ * un bool. Guardando ese bool aparte, un bit por zona, 32 zonas caben en
+ * una palabra y la pregunta se responde con una instrucción:
+ *
+ *     habilitadas = 0b0110'0100   desde = 3
+ *     palabra & (~0 << 3)  = 0b0110'0000
+ *     __builtin_ctz(...)   = 5      → zona 6
+ *
+ * Combinar conjuntos también es aritmética de palabras: "habilitadas y
+ * sin error" es un AND con el complemento, no un bucle con dos ifs.
+ *
+ * El tamaño se fija en compilación (N bits en (N + 31) / 32 palabras):
+ * más zonas solo añaden 4 bytes cada 32.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#ifndef __ZONE_MASK_H__
+#define __ZONE_MASK_H__
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Conjunto de índices de zona [0, N).
+ * @tparam N Número máximo de zonas
+ */
+template <uint16_t N>
+class ZoneMask {
+public:
+    ZoneMask() { clear(); }
+
+    void clear() { memset(words, 0, sizeof(words)); }
+
+    void set(uint16_t zone) {
+        if (zone < N) {
+            words[zone >> 5] |= bit(zone);
+        }
+    }
+
+    void reset(uint16_t zone) {
+        if (zone < N) {
+            words[zone >> 5] &= ~bit(zone);
+        }
+    }
+
+    void assign(uint16_t zone, bool value) {
+        if (value) {
+            set(zone);
+        } else {
+            reset(zone);
+        }
+    }
+
+    bool test(uint16_t zone) const {
+        return zone < N && (words[zone >> 5] & bit(zone)) != 0;
+    }
+
+    bool any() const {
+        for (uint16_t w = 0; w < WORDS; w++) {
+            if (words[w]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint16_t count() const {
+        uint16_t total = 0;
+        for (uint16_t w = 0; w < WORDS; w++) {
+            total += __builtin_popcount(words[w]);
+        }
+        return total;
+    }
+
+    /**
+     * @brief Primera zona del conjunto con índice >= `from`.
+     * @return Índice de la zona, o N si no queda ninguna
+     */
+    uint16_t next(uint16_t from) const {
+        if (from >= N) {
+            return N;
+        }
+        uint16_t w = from >> 5;
+        uint32_t word = words[w] & (~0u << (from & 31));
+        for (;;) {
+            if (word) {
+                return (w << 5) + __builtin_ctz(word);
+            }
+            if (++w >= WORDS) {
+                return N;
+            }
+            word = words[w];
+        }
+    }
+
+    /**
+     * @brief Zonas de este conjunto que no están en `other`.
+     */
+    ZoneMask without(const ZoneMask& other) const {
+        ZoneMask result;
+        for (uint16_t w = 0; w < WORDS; w++) {
+            result.words[w] = words[w] & ~other.words[w];
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint16_t WORDS = (N + 31) / 32;
+
+    static uint32_t bit(uint16_t zone) { return 1u << (zone & 31); }
+
+    uint32_t words[WORDS];          // Bits >= N siempre a 0
+};
+
+#endif // __ZONE_MASK_H__
@@ -0,0 +1,84 @@
+/**
+ * @file CommandQueue.cpp
+ * @brief Implementación de la cola de comandos remotos.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "CommandQueue.h"
+#include "PowerManager.h"
+#include <Arduino.h>
+#include <string.h>
+
+CommandQueue::CommandQueue()
+    : handle(nullptr)
+    , droppedCount(0)
+{
+    handle = xQueueCreateStatic(CommandQueueConfig::QUEUE_LENGTH, sizeof(QueuedCommand),
+                                storage, &queueBuffer);
+}
+
+bool CommandQueue::push(CommandSource source, uint32_t clientId,
+                        const char* command, size_t commandLength,
+                        const char* parameters, size_t parametersLength,
+                        CommandCompletion onComplete, void* context) {
+    if (handle == nullptr || command == nullptr || commandLength == 0) {
+        return false;
+    }
+
+    // Un comando recortado podría ejecutar algo distinto: mejor rechazarlo
+    if (commandLength >= CommandQueueConfig::MAX_COMMAND_LENGTH ||
+        parametersLength >= CommandQueueConfig::MAX_PARAMETERS_LENGTH) {
+        droppedCount++;
+        return false;
+    }
+
+    QueuedCommand item;
+    item.source = source;
+    item.clientId = clientId;
+    item.enqueuedAt = millis();
+    memcpy(item.command, command, commandLength);
+    item.command[commandLength] = '\0';
+    if (parameters != nullptr && parametersLength > 0) {
+        memcpy(item.parameters, parameters, parametersLength);
+    } else {
+        parametersLength = 0;
+    }
+    item.parameters[parametersLength] = '\0';
+    item.onComplete = onComplete;
+    item.context = context;
+
+    // Espera 0: el productor es una tarea de red y no debe quedarse parada
+    if (xQueueSend(handle, &item, 0) != pdTRUE) {
+        droppedCount++;
+        return false;
+    }
+
+    // El loop puede estar en reposo esperando su próximo plazo
+    PowerManager::getInstance().wake();
+    return true;
+}
+
+bool CommandQueue::pop(QueuedCommand& out) {
+    if (handle == nullptr) {
+        return false;
+    }
+    return xQueueReceive(handle, &out, 0) == pdTRUE;
+}
+
+uint8_t CommandQueue::pending() const {
+    if (handle == nullptr) {
+        return 0;
+    }
+    return static_cast<uint8_t>(uxQueueMessagesWaiting(handle));
+}
+
+const char* CommandQueue::sourceToString(CommandSource source) {
+    switch (source) {
+        case CommandSource::WEBSOCKET: return "websocket";
+        case CommandSource::MQTT:      return "mqtt";
+        default:                       return "unknown";
+    }
+}
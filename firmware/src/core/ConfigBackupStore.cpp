@@ -0,0 +1,387 @@
+/**
+ * @file ConfigBackupStore.cpp
+ * @brief Implementación del historial de versiones por deltas.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * Toda la lógica de deltas trabaja sobre imágenes de tamaño fijo
+ * (IMAGE_SIZE bytes), así que crear o aplicar un delta es recorrer dos
+ * arrays en paralelo, sin reservar memoria. Las lecturas del archivo se
+ * validan siempre con el hash de la imagen resultante: un delta corrupto
+ * no puede producir una configuración "casi buena".
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/core/ConfigBackupStore.h"
+#include "utils/Logger.h"
+#include <SPIFFS.h>
+#include <string.h>
+#include <time.h>
+
+using namespace BackupStoreConfig;
+
+namespace {
+    // Dos tramos separados por menos bytes que una cabecera de tramo
+    // (offset u16 + longitud u8) salen más baratos unidos
+    constexpr size_t RUN_HEADER_BYTES = 3;
+    constexpr size_t MAX_RUN_BYTES = 255;
+
+    uint32_t imageHash(const uint8_t* image) {
+        uint32_t hash = 2166136261u;        // FNV-1a
+        for (size_t i = 0; i < IMAGE_SIZE; i++) {
+            hash = (hash ^ image[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * @return Bytes del delta; 0 si no cabe en capacity (mejor guardar FULL)
+     */
+    size_t encodeDelta(const uint8_t* base, const uint8_t* image, uint8_t* out, size_t capacity) {
+        size_t length = 0;
+        size_t i = 0;
+        while (i < IMAGE_SIZE) {
+            if (base[i] == image[i]) {
+                i++;
+                continue;
+            }
+            size_t start = i;
+            size_t last = i;
+            for (size_t j = i + 1; j < IMAGE_SIZE && j - start < MAX_RUN_BYTES && j - last <= RUN_HEADER_BYTES; j++) {
+                if (base[j] != image[j]) {
+                    last = j;
+                }
+            }
+            size_t count = last - start + 1;
+            if (length + RUN_HEADER_BYTES + count > capacity) {
+                return 0;
+            }
+            out[length++] = static_cast<uint8_t>(start & 0xFF);
+            out[length++] = static_cast<uint8_t>(start >> 8);
+            out[length++] = static_cast<uint8_t>(count);
+            memcpy(out + length, image + start, count);
+            length += count;
+            i = last + 1;
+        }
+        return length;
+    }
+
+    bool applyPayload(const BackupRecordHeader& header, const uint8_t* payload, uint8_t* image) {
+        if (header.kind == static_cast<uint8_t>(BackupKind::FULL)) {
+            if (header.payloadLength != IMAGE_SIZE) {
+                return false;
+            }
+            memcpy(image, payload, IMAGE_SIZE);
+            return true;
+        }
+        if (header.kind != static_cast<uint8_t>(BackupKind::DELTA)) {
+            return false;
+        }
+        size_t pos = 0;
+        while (pos < header.payloadLength) {
+            if (pos + RUN_HEADER_BYTES > header.payloadLength) {
+                return false;
+            }
+            size_t offset = payload[pos] | (static_cast<size_t>(payload[pos + 1]) << 8);
+            size_t count = payload[pos + 2];
+            pos += RUN_HEADER_BYTES;
+            if (count == 0 || offset + count > IMAGE_SIZE || pos + count > header.payloadLength) {
+                return false;
+            }
+            memcpy(image + offset, payload + pos, count);
+            pos += count;
+        }
+        return true;
+    }
+
+    bool readRecord(File& file, BackupRecordHeader& header, uint8_t* payload) {
+        if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+        if (header.payloadLength > IMAGE_SIZE) {
+            return false;
+        }
+        return file.read(payload, header.payloadLength) == header.payloadLength;
+    }
+
+    bool writeRecord(File& file, const BackupRecordHeader& header, const uint8_t* payload) {
+        return file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+               file.write(payload, header.payloadLength) == header.payloadLength;
+    }
+
+    bool writeFileHeader(File& file) {
+        BackupFileHeader header = { FILE_MAGIC, ConfigCodec::schemaId() };
+        return file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    }
+
+    uint32_t currentTimestamp() {
+        time_t now = time(nullptr);
+        return now >= static_cast<time_t>(MIN_VALID_EPOCH) ? static_cast<uint32_t>(now) : 0;
+    }
+}
+
+ConfigBackupStore::ConfigBackupStore()
+    : recordCount(0), nextVersion(1), storedBytes(0), started(false) {
+    memset(lastImage, 0, sizeof(lastImage));
+}
+
+bool ConfigBackupStore::begin() {
+    recordCount = 0;
+    nextVersion = 1;
+    storedBytes = 0;
+    started = true;
+
+    File file = SPIFFS.open(STORE_PATH, "r");
+    if (!file) {
+        return true;    // Aún no hay historial
+    }
+
+    BackupFileHeader fileHeader;
+    if (file.read(reinterpret_cast<uint8_t*>(&fileHeader), sizeof(fileHeader)) != sizeof(fileHeader) ||
+        fileHeader.magic != FILE_MAGIC || fileHeader.schemaId != ConfigCodec::schemaId()) {
+        file.close();
+        LOG_WARNING("[BACKUP] Historial de otro esquema o ilegible, se descarta");
+        SPIFFS.remove(STORE_PATH);
+        return true;
+    }
+
+    uint8_t payload[IMAGE_SIZE];
+    uint8_t image[IMAGE_SIZE];
+    uint32_t fileSize = file.size();
+    uint32_t offset = sizeof(fileHeader);
+    bool damaged = false;
+
+    while (offset < fileSize) {
+        BackupRecordHeader header;
+        memcpy(image, lastImage, IMAGE_SIZE);
+        if (recordCount == MAX_RECORDS || !readRecord(file, header, payload) ||
+            (recordCount == 0 && header.kind != static_cast<uint8_t>(BackupKind::FULL)) ||
+            !applyPayload(header, payload, image) || imageHash(image) != header.contentHash) {
+            damaged = true;
+            break;
+        }
+        memcpy(lastImage, image, IMAGE_SIZE);
+        records[recordCount].header = header;
+        records[recordCount].offset = offset;
+        recordCount++;
+        nextVersion = header.version + 1;
+        offset += sizeof(header) + header.payloadLength;
+    }
+    file.close();
+    storedBytes = offset;
+
+    if (damaged) {
+        // Se reescribe con las versiones válidas: añadir tras bytes corruptos
+        // dejaría ilegibles las versiones nuevas
+        LOG_WARNING("[BACKUP] Historial dañado, se conservan " + String(recordCount) + " versiones");
+        if (recordCount == 0 ? !resetFile() : !compact(recordCount)) {
+            return false;
+        }
+    }
+
+    LOG_INFO("[BACKUP] " + String(recordCount) + " versiones de configuración, " +
+             String(storedBytes) + " bytes");
+    return true;
+}
+
+uint32_t ConfigBackupStore::store(const SystemConfig& config, bool& written) {
+    written = false;
+    if (!started) {
+        return 0;
+    }
+
+    uint8_t image[IMAGE_SIZE];
+    if (ConfigCodec::encodeBinary(config, image, sizeof(image), ConfigCodec::BinaryLayout::FIXED) != IMAGE_SIZE) {
+        return 0;
+    }
+    uint32_t hash = imageHash(image);
+
+    // Deduplicación: idéntica a la última versión -> no se toca la flash
+    if (recordCount > 0 && records[recordCount - 1].header.contentHash == hash &&
+        memcmp(image, lastImage, IMAGE_SIZE) == 0) {
+        return records[recordCount - 1].header.version;
+    }
+
+    if (recordCount == MAX_RECORDS && !compact(MAX_VERSIONS)) {
+        return 0;
+    }
+    if (recordCount == 0 && !resetFile()) {
+        return 0;
+    }
+
+    BackupRecordHeader header;
+    header.version = nextVersion;
+    header.timestamp = currentTimestamp();
+    header.contentHash = hash;
+    header.reserved = 0;
+
+    uint8_t delta[IMAGE_SIZE - 1];
+    size_t deltaLength = recordCount > 0 ? encodeDelta(lastImage, image, delta, sizeof(delta)) : 0;
+    const uint8_t* payload = image;
+    if (deltaLength > 0) {
+        header.kind = static_cast<uint8_t>(BackupKind::DELTA);
+        header.payloadLength = static_cast<uint16_t>(deltaLength);
+        payload = delta;
+    } else {
+        header.kind = static_cast<uint8_t>(BackupKind::FULL);
+        header.payloadLength = IMAGE_SIZE;
+    }
+
+    File file = SPIFFS.open(STORE_PATH, "a");
+    if (!file) {
+        LOG_ERROR("[BACKUP] No se pudo abrir " + String(STORE_PATH));
+        return 0;
+    }
+    bool ok = writeRecord(file, header, payload);
+    file.close();
+    if (!ok) {
+        LOG_ERROR("[BACKUP] Escritura incompleta, se reescribe el historial");
+        if (recordCount == 0) {
+            resetFile();
+        } else {
+            compact(recordCount);
+        }
+        return 0;
+    }
+
+    records[recordCount].header = header;
+    records[recordCount].offset = storedBytes;
+    recordCount++;
+    nextVersion++;
+    storedBytes += sizeof(header) + header.payloadLength;
+    memcpy(lastImage, image, IMAGE_SIZE);
+    written = true;
+    return header.version;
+}
+
+bool ConfigBackupStore::load(uint32_t version, SystemConfig& out) {
+    int target = findVersion(version);
+    if (target < 0) {
+        return false;
+    }
+
+    // Se empieza en la imagen completa más cercana por detrás
+    int start = target;
+    while (start > 0 && records[start].header.kind != static_cast<uint8_t>(BackupKind::FULL)) {
+        start--;
+    }
+
+    File file = SPIFFS.open(STORE_PATH, "r");
+    if (!file || !file.seek(records[start].offset)) {
+        return false;
+    }
+    uint8_t payload[IMAGE_SIZE];
+    uint8_t image[IMAGE_SIZE];
+    bool ok = true;
+    BackupRecordHeader header;
+    for (int i = start; i <= target && ok; i++) {
+        ok = readRecord(file, header, payload) &&
+             header.version == records[i].header.version &&
+             applyPayload(header, payload, image);
+    }
+    file.close();
+
+    if (!ok || imageHash(image) != records[target].header.contentHash) {
+        LOG_ERROR("[BACKUP] Versión " + String(records[target].header.version) + " ilegible");
+        return false;
+    }
+    return ConfigCodec::decodeBinary(image, IMAGE_SIZE, out, ConfigCodec::BinaryLayout::FIXED);
+}
+
+uint8_t ConfigBackupStore::listVersions(BackupVersionInfo* out, uint8_t maxVersions) const {
+    uint8_t count = recordCount < maxVersions ? recordCount : maxVersions;
+    // Si no caben todas, las más recientes
+    memcpy(out, records + (recordCount - count), count * sizeof(BackupVersionInfo));
+    return count;
+}
+
+uint32_t ConfigBackupStore::getLatestVersion() const {
+    return recordCount > 0 ? records[recordCount - 1].header.version : 0;
+}
+
+int ConfigBackupStore::findVersion(uint32_t version) const {
+    if (recordCount == 0) {
+        return -1;
+    }
+    if (version == 0) {
+        return recordCount - 1;
+    }
+    for (int i = recordCount - 1; i >= 0; i--) {
+        if (records[i].header.version == version) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ConfigBackupStore::resetFile() {
+    File file = SPIFFS.open(STORE_PATH, "w");
+    if (!file) {
+        LOG_ERROR("[BACKUP] No se pudo crear " + String(STORE_PATH));
+        return false;
+    }
+    bool ok = writeFileHeader(file);
+    file.close();
+    recordCount = 0;
+    storedBytes = ok ? sizeof(BackupFileHeader) : 0;
+    return ok;
+}
+
+bool ConfigBackupStore::compact(uint8_t keep) {
+    // Se conservan las `keep` más recientes; la primera pasa a FULL
+    uint8_t firstKept = recordCount > keep ? recordCount - keep : 0;
+
+    File source = SPIFFS.open(STORE_PATH, "r");
+    File target = SPIFFS.open(TEMP_PATH, "w");
+    if (!source || !target || !source.seek(records[0].offset) || !writeFileHeader(target)) {
+        LOG_ERROR("[BACKUP] No se pudo compactar el historial");
+        return false;
+    }
+
+    uint8_t payload[IMAGE_SIZE];
+    uint8_t image[IMAGE_SIZE];
+    BackupVersionInfo kept[MAX_RECORDS];
+    uint8_t keptCount = 0;
+    uint32_t offset = sizeof(BackupFileHeader);
+    bool ok = true;
+
+    for (uint8_t i = 0; i < recordCount && ok; i++) {
+        BackupRecordHeader header;
+        ok = readRecord(source, header, payload) && applyPayload(header, payload, image);
+        if (!ok || i < firstKept) {
+            continue;
+        }
+        if (i == firstKept) {
+            header.kind = static_cast<uint8_t>(BackupKind::FULL);
+            header.payloadLength = IMAGE_SIZE;
+            ok = writeRecord(target, header, image);
+        } else {
+            ok = writeRecord(target, header, payload);
+        }
+        kept[keptCount].header = header;
+        kept[keptCount].offset = offset;
+        keptCount++;
+        offset += sizeof(header) + header.payloadLength;
+    }
+    source.close();
+    target.close();
+
+    if (!ok) {
+        SPIFFS.remove(TEMP_PATH);
+        LOG_ERROR("[BACKUP] Error al compactar, se conserva el historial actual");
+        return false;
+    }
+
+    SPIFFS.remove(STORE_PATH);
+    if (!SPIFFS.rename(TEMP_PATH, STORE_PATH)) {
+        recordCount = 0;
+        storedBytes = 0;
+        return false;
+    }
+    memcpy(records, kept, keptCount * sizeof(BackupVersionInfo));
+    recordCount = keptCount;
+    storedBytes = offset;
+    return true;
+}
@@ -0,0 +1,412 @@
+/**
+ * @file ConfigCodec.cpp
+ * @brief Funciones de configuración generadas desde ConfigSchema.h.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * Cada función define sus macros X/S, expande el esquema y las borra. Las
+ * macros trabajan siempre sobre dos variables locales, `source` y
+ * `target`, para poder reutilizarlas tanto con SystemConfig como con cada
+ * ZoneConfig.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "ConfigCodec.h"
+#include "ProjectConfig.h"   // Defectos y límites usados por el esquema
+#include <string.h>
+
+namespace {
+    template <typename T>
+    bool inRange(T value, long long min, long long max) {
+        return static_cast<long long>(value) >= min && static_cast<long long>(value) <= max;
+    }
+
+    /**
+     * @brief Escritura secuencial con control de desbordamiento.
+     */
+    struct BinaryWriter {
+        uint8_t* out;
+        size_t capacity;
+        size_t pos;
+        bool overflow;
+        bool fixed;             // BinaryLayout::FIXED: cadenas rellenas hasta su capacidad
+
+        void bytes(const void* data, size_t length) {
+            if (pos + length > capacity) {
+                overflow = true;
+                return;
+            }
+            memcpy(out + pos, data, length);
+            pos += length;
+        }
+
+        template <typename T>
+        void scalar(const T& value) {
+            bytes(&value, sizeof(T));
+        }
+
+        void string(const char* value, size_t capacity) {
+            uint8_t length = static_cast<uint8_t>(strnlen(value, capacity));
+            scalar(length);
+            bytes(value, length);
+            if (fixed) {
+                static const uint8_t ZEROS[256] = { 0 };
+                bytes(ZEROS, capacity - length);
+            }
+        }
+    };
+
+    /**
+     * @brief Lectura secuencial; cualquier error se acumula en `error`.
+     */
+    struct BinaryReader {
+        const uint8_t* in;
+        size_t length;
+        size_t pos;
+        bool error;
+        bool fixed;
+
+        void bytes(void* data, size_t count) {
+            if (error || pos + count > length) {
+                error = true;
+                return;
+            }
+            memcpy(data, in + pos, count);
+            pos += count;
+        }
+
+        template <typename T>
+        void scalar(T& value) {
+            bytes(&value, sizeof(T));
+        }
+
+        void scalar(bool& value) {
+            uint8_t raw = 0;
+            bytes(&raw, 1);
+            value = raw != 0;
+        }
+
+        void string(char* value, size_t capacity) {
+            uint8_t count = 0;
+            scalar(count);
+            if (error || count > capacity || pos + count > length) {
+                error = true;
+                return;
+            }
+            memset(value, 0, capacity + 1);
+            memcpy(value, in + pos, count);
+            pos += count;
+            if (fixed) {
+                if (pos + (capacity - count) > length) {
+                    error = true;
+                    return;
+                }
+                pos += capacity - count;
+            }
+        }
+    };
+
+    /**
+     * @brief Copia acotada que rellena con ceros el resto del array.
+     *
+     * El relleno importa: así dos configuraciones iguales son iguales byte a
+     * byte, y el hash de sección no depende de basura tras el '\0'.
+     */
+    void copyString(char* target, const char* source, size_t capacity) {
+        size_t length = strnlen(source, capacity);
+        memcpy(target, source, length);
+        memset(target + length, 0, capacity + 1 - length);
+    }
+
+    constexpr uint32_t FNV_OFFSET = 2166136261u;
+    constexpr uint32_t FNV_PRIME = 16777619u;
+
+    uint32_t fnv(uint32_t hash, const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+}
+
+namespace ConfigCodec {
+
+uint32_t schemaId() {
+#define CONFIG_SIGNATURE_X(type, name, def, min, max)   #type " " #name ";"
+#define CONFIG_SIGNATURE_S(name, def, capacity)         "S" #capacity " " #name ";"
+    static const char SIGNATURE[] =
+        SYSTEM_CONFIG_FIELDS(CONFIG_SIGNATURE_X, CONFIG_SIGNATURE_S)
+        "zones:" ZONE_CONFIG_FIELDS(CONFIG_SIGNATURE_X);
+#undef CONFIG_SIGNATURE_X
+#undef CONFIG_SIGNATURE_S
+
+    static uint32_t id = 0;
+    if (id == 0) {
+        uint32_t hash = fnv(FNV_OFFSET, SIGNATURE, sizeof(SIGNATURE) - 1);   // FNV-1a
+        id = (hash ^ MAX_ZONES) * FNV_PRIME;
+    }
+    return id;
+}
+
+void applyDefaults(SystemConfig& config) {
+#define CONFIG_DEFAULT_X(type, name, def, min, max)     target.name = (def);
+#define CONFIG_DEFAULT_S(name, def, capacity)           copyString(target.name, (def), (capacity));
+    {
+        SystemConfig& target = config;
+        SYSTEM_CONFIG_FIELDS(CONFIG_DEFAULT_X, CONFIG_DEFAULT_S)
+    }
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        ZoneConfig& target = config.zones[i];
+        ZONE_CONFIG_FIELDS(CONFIG_DEFAULT_X)
+    }
+#undef CONFIG_DEFAULT_X
+#undef CONFIG_DEFAULT_S
+}
+
+bool validate(const SystemConfig& config, String& error) {
+#define CONFIG_VALIDATE_X(type, name, def, min, max) \
+    if (!inRange(target.name, (min), (max))) { \
+        error = prefix + #name; \
+        return false; \
+    }
+#define CONFIG_VALIDATE_S(name, def, capacity) \
+    if (memchr(target.name, '\0', sizeof(target.name)) == nullptr) { \
+        error = prefix + #name; \
+        return false; \
+    }
+    {
+        const SystemConfig& target = config;
+        const String prefix;
+        SYSTEM_CONFIG_FIELDS(CONFIG_VALIDATE_X, CONFIG_VALIDATE_S)
+    }
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& target = config.zones[i];
+        const String prefix = "zones[" + String(i) + "].";
+        ZONE_CONFIG_FIELDS(CONFIG_VALIDATE_X)
+    }
+#undef CONFIG_VALIDATE_X
+#undef CONFIG_VALIDATE_S
+    return true;
+}
+
+void toJson(const SystemConfig& config, JsonObject out) {
+#define CONFIG_TO_JSON_X(type, name, def, min, max)     target[#name] = source.name;
+#define CONFIG_TO_JSON_S(name, def, capacity)           target[#name] = static_cast<const char*>(source.name);
+    {
+        const SystemConfig& source = config;
+        JsonObject target = out;
+        SYSTEM_CONFIG_FIELDS(CONFIG_TO_JSON_X, CONFIG_TO_JSON_S)
+    }
+    JsonArray zones = out.createNestedArray("zones");
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& source = config.zones[i];
+        JsonObject target = zones.createNestedObject();
+        ZONE_CONFIG_FIELDS(CONFIG_TO_JSON_X)
+    }
+#undef CONFIG_TO_JSON_X
+#undef CONFIG_TO_JSON_S
+}
+
+bool fromJson(JsonObjectConst in, SystemConfig& config, String& error) {
+#define CONFIG_FROM_JSON_X(type, name, def, min, max) \
+    { \
+        JsonVariantConst value = source[#name]; \
+        if (!value.isNull()) { \
+            if (!value.is<type>()) { \
+                error = prefix + #name; \
+                return false; \
+            } \
+            target.name = value.as<type>(); \
+        } \
+    }
+#define CONFIG_FROM_JSON_S(name, def, capacity) \
+    { \
+        JsonVariantConst value = source[#name]; \
+        if (!value.isNull()) { \
+            const char* text = value.as<const char*>(); \
+            if (text == nullptr || strlen(text) > (capacity)) { \
+                error = prefix + #name; \
+                return false; \
+            } \
+            copyString(target.name, text, (capacity)); \
+        } \
+    }
+    // Se decodifica sobre una copia: un error a mitad no deja la
+    // configuración a medio aplicar
+    SystemConfig decoded = config;
+    {
+        JsonObjectConst source = in;
+        SystemConfig& target = decoded;
+        const String prefix;
+        SYSTEM_CONFIG_FIELDS(CONFIG_FROM_JSON_X, CONFIG_FROM_JSON_S)
+    }
+
+    JsonVariantConst zonesValue = in["zones"];
+    if (!zonesValue.isNull()) {
+        JsonArrayConst zones = zonesValue.as<JsonArrayConst>();
+        if (zones.isNull() || zones.size() > MAX_ZONES) {
+            error = "zones";
+            return false;
+        }
+        uint8_t i = 0;
+        for (JsonVariantConst zoneValue : zones) {
+            JsonObjectConst source = zoneValue.as<JsonObjectConst>();
+            const String prefix = "zones[" + String(i) + "].";
+            if (source.isNull()) {
+                error = "zones[" + String(i) + "]";
+                return false;
+            }
+            ZoneConfig& target = decoded.zones[i];
+            ZONE_CONFIG_FIELDS(CONFIG_FROM_JSON_X)
+            i++;
+        }
+    }
+#undef CONFIG_FROM_JSON_X
+#undef CONFIG_FROM_JSON_S
+
+    config = decoded;
+    return true;
+}
+
+size_t encodeBinary(const SystemConfig& config, uint8_t* out, size_t capacity, BinaryLayout layout) {
+#define CONFIG_ENCODE_X(type, name, def, min, max)      writer.scalar(source.name);
+#define CONFIG_ENCODE_S(name, def, capacity)            writer.string(source.name, capacity);
+    BinaryWriter writer = { out, capacity, 0, false, layout == BinaryLayout::FIXED };
+    writer.scalar(BINARY_MAGIC);
+    writer.scalar(schemaId());
+    {
+        const SystemConfig& source = config;
+        SYSTEM_CONFIG_FIELDS(CONFIG_ENCODE_X, CONFIG_ENCODE_S)
+    }
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& source = config.zones[i];
+        ZONE_CONFIG_FIELDS(CONFIG_ENCODE_X)
+    }
+#undef CONFIG_ENCODE_X
+#undef CONFIG_ENCODE_S
+    return writer.overflow ? 0 : writer.pos;
+}
+
+bool decodeBinary(const uint8_t* in, size_t length, SystemConfig& config, BinaryLayout layout) {
+#define CONFIG_DECODE_X(type, name, def, min, max)      reader.scalar(target.name);
+#define CONFIG_DECODE_S(name, def, capacity)            reader.string(target.name, capacity);
+    BinaryReader reader = { in, length, 0, false, layout == BinaryLayout::FIXED };
+    uint32_t magic = 0;
+    uint32_t id = 0;
+    reader.scalar(magic);
+    reader.scalar(id);
+    if (reader.error || magic != BINARY_MAGIC || id != schemaId()) {
+        return false;
+    }
+
+    SystemConfig decoded = config;
+    {
+        SystemConfig& target = decoded;
+        SYSTEM_CONFIG_FIELDS(CONFIG_DECODE_X, CONFIG_DECODE_S)
+    }
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        ZoneConfig& target = decoded.zones[i];
+        ZONE_CONFIG_FIELDS(CONFIG_DECODE_X)
+    }
+#undef CONFIG_DECODE_X
+#undef CONFIG_DECODE_S
+
+    if (reader.error || reader.pos != length) {
+        return false;
+    }
+    config = decoded;
+    return true;
+}
+
+ConfigDiff diff(const SystemConfig& before, const SystemConfig& after) {
+#define CONFIG_DIFF_X(type, name, def, min, max) \
+    if (before.name != after.name) { \
+        changes.fields |= 1UL << static_cast<uint8_t>(ConfigField::name); \
+    }
+#define CONFIG_DIFF_S(name, def, capacity) \
+    if (strncmp(before.name, after.name, sizeof(before.name)) != 0) { \
+        changes.fields |= 1UL << static_cast<uint8_t>(ConfigField::name); \
+    }
+#define CONFIG_DIFF_ZONE_X(type, name, def, min, max)   changed = changed || a.name != b.name;
+    ConfigDiff changes = { 0, 0 };
+    SYSTEM_CONFIG_FIELDS(CONFIG_DIFF_X, CONFIG_DIFF_S)
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& a = before.zones[i];
+        const ZoneConfig& b = after.zones[i];
+        bool changed = false;
+        ZONE_CONFIG_FIELDS(CONFIG_DIFF_ZONE_X)
+        if (changed) {
+            changes.zones |= static_cast<uint8_t>(1u << i);
+        }
+    }
+#undef CONFIG_DIFF_X
+#undef CONFIG_DIFF_S
+#undef CONFIG_DIFF_ZONE_X
+    return changes;
+}
+
+void writeDiffJson(const ConfigDiff& changes, JsonArray out) {
+    for (uint8_t f = 0; f < static_cast<uint8_t>(ConfigField::COUNT); f++) {
+        if (changes.fields & (1UL << f)) {
+            out.add(fieldName(static_cast<ConfigField>(f)));
+        }
+    }
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        if (changes.zones & (1u << i)) {
+            out.add("zones[" + String(i) + "]");
+        }
+    }
+}
+
+ConfigFingerprint fingerprint(const SystemConfig& config, uint32_t generation) {
+    // Campo a campo y no el struct entero: los huecos de alineación no
+    // están inicializados y harían el hash no determinista
+#define CONFIG_HASH_X(type, name, def, min, max)        hash = fnv(hash, &source.name, sizeof(source.name));
+#define CONFIG_HASH_S(name, def, capacity)              hash = fnv(hash, source.name, strnlen(source.name, capacity));
+#define CONFIG_HASH_SECTION(id, FIELDS) \
+    { \
+        uint32_t hash = FNV_OFFSET; \
+        FIELDS(CONFIG_HASH_X, CONFIG_HASH_S) \
+        result.sections[static_cast<uint8_t>(ConfigSection::id)] = hash; \
+    }
+    ConfigFingerprint result;
+    result.generation = generation;
+    const SystemConfig& source = config;
+    CONFIG_SECTIONS(CONFIG_HASH_SECTION)
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& source = config.zones[i];
+        uint32_t hash = FNV_OFFSET;
+        ZONE_CONFIG_FIELDS(CONFIG_HASH_X)
+        result.sections[static_cast<uint8_t>(ConfigSection::ZONE_FIRST) + i] = hash;
+    }
+#undef CONFIG_HASH_X
+#undef CONFIG_HASH_S
+#undef CONFIG_HASH_SECTION
+    return result;
+}
+
+const char* sectionName(ConfigSection section) {
+#define CONFIG_SECTION_NAME(id, FIELDS)                 case ConfigSection::id: return #id;
+    switch (section) {
+        CONFIG_SECTIONS(CONFIG_SECTION_NAME)
+        default: break;
+    }
+#undef CONFIG_SECTION_NAME
+    return section < ConfigSection::COUNT ? "ZONE" : "unknown";
+}
+
+const char* fieldName(ConfigField field) {
+#define CONFIG_NAME_X(type, name, def, min, max)        case ConfigField::name: return #name;
+#define CONFIG_NAME_S(name, def, capacity)              case ConfigField::name: return #name;
+    switch (field) {
+        SYSTEM_CONFIG_FIELDS(CONFIG_NAME_X, CONFIG_NAME_S)
+        default: return "unknown";
+    }
+#undef CONFIG_NAME_X
+#undef CONFIG_NAME_S
+}
+
+} // namespace ConfigCodec
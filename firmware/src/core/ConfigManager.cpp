@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "../../include/core/ConfigManager.h"
+#include "core/ConfigCodec.h"
+#include "core/ConfigBackupStore.h"
 #include "core/SystemConfig.h"
 #include "utils/Logger.h"
 #include <SPIFFS.h>
@@ -9,7 +11,36 @@
 
 ConfigManager* ConfigManager::instance = nullptr;
 
-// ... existing implementation ...
+namespace {
+    constexpr size_t CONFIG_JSON_CAPACITY = 2048;
+
+    /**
+     * @brief Un solo cambio de configuración a la vez (mutex recursivo).
+     */
+    class WriteGuard {
+    public:
+        explicit WriteGuard(SemaphoreHandle_t lock) : lock(lock) { xSemaphoreTakeRecursive(lock, portMAX_DELAY); }
+        ~WriteGuard() { xSemaphoreGiveRecursive(lock); }
+    private:
+        SemaphoreHandle_t lock;
+    };
+}
+
+ConfigManager::ConfigManager() {
+    writeLock = xSemaphoreCreateRecursiveMutexStatic(&writeLockBuffer);
+    ConfigCodec::applyDefaults(config);
+    fingerprint = ConfigCodec::fingerprint(config, generation);
+}
+
+ConfigManager::~ConfigManager() {
+}
+
+ConfigManager& ConfigManager::getInstance() {
+    if (instance == nullptr) {
+        instance = new ConfigManager();
+    }
+    return *instance;
+}
 
 bool ConfigManager::initialize() {
     if (!SPIFFS.begin(true)) {
@@ -34,6 +65,11 @@ bool ConfigManager::initialize() {
         }
         LOG_INFO("[CONFIG] Configuration loaded");
     }
+
+    // La configuración con la que arranca queda como versión (deduplicada)
+    if (ConfigBackupStore::getInstance().begin()) {
+        createBackup();
+    }
     return true;
 }
 
@@ -46,4 +82,255 @@ void ConfigManager::setFirstBoot(bool firstBoot) {
     saveConfiguration(); // Persist the state
 }
 
-// ... rest of existing implementation ...
+// =============================================================================
+// Persistencia (JSON generado desde ConfigSchema.h)
+// =============================================================================
+
+bool ConfigManager::loadConfiguration() {
+    File file = SPIFFS.open(configPath, "r");
+    if (!file) {
+        return false;
+    }
+
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
+    DeserializationError jsonError = deserializeJson(doc, file);
+    file.close();
+    if (jsonError) {
+        LOG_ERROR("[CONFIG] Invalid JSON: " + String(jsonError.c_str()));
+        return false;
+    }
+
+    // Los campos que falten (archivo de una versión anterior) toman su defecto
+    SystemConfig loaded;
+    ConfigCodec::applyDefaults(loaded);
+    String error;
+    if (!ConfigCodec::fromJson(doc.as<JsonObjectConst>(), loaded, error) ||
+        !ConfigCodec::validate(loaded, error)) {
+        LOG_ERROR("[CONFIG] Invalid field: " + error);
+        return false;
+    }
+
+    commit(loaded);
+    return true;
+}
+
+bool ConfigManager::saveConfiguration() {
+    return writeConfigFile(config);
+}
+
+bool ConfigManager::writeConfigFile(const SystemConfig& toSave) {
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
+    ConfigCodec::toJson(toSave, doc.to<JsonObject>());
+
+    File file = SPIFFS.open(configPath, "w");
+    if (!file) {
+        LOG_ERROR("[CONFIG] Cannot open " + String(configPath));
+        return false;
+    }
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok;
+}
+
+bool ConfigManager::validateConfiguration() const {
+    String error;
+    if (!ConfigCodec::validate(config, error)) {
+        LOG_WARNING("[CONFIG] Out of range: " + error);
+        return false;
+    }
+    return true;
+}
+
+void ConfigManager::setDefaultConfiguration() {
+    SystemConfig defaults;
+    ConfigCodec::applyDefaults(defaults);
+    commit(defaults);
+}
+
+void ConfigManager::commit(const SystemConfig& newConfig) {
+    WriteGuard guard(writeLock);
+    config = newConfig;
+    generation++;
+    fingerprint = ConfigCodec::fingerprint(config, generation);
+    published.write(config);
+}
+
+// =============================================================================
+// API pública
+// =============================================================================
+
+const SystemConfig& ConfigManager::getConfig() const {
+    return config;
+}
+
+void ConfigManager::copyConfig(SystemConfig& out) const {
+    published.read(out);
+}
+
+uint32_t ConfigManager::getGeneration() const {
+    return published.getVersion();
+}
+
+const ConfigFingerprint& ConfigManager::getFingerprint() const {
+    return fingerprint;
+}
+
+bool ConfigManager::snapshotIfChanged(uint32_t& seenGeneration, SystemConfig& out) const {
+    // Una publicación por commit(): la versión del seqlock es la generación
+    uint32_t current = published.getVersion();
+    if (seenGeneration == current) {
+        return false;
+    }
+
+    // La copia es coherente, pero puede ser de una generación posterior a
+    // `current`; solo vale si la versión no se movió mientras se copiaba
+    for (;;) {
+        published.read(out);
+        uint32_t after = published.getVersion();
+        if (after == current) {
+            break;
+        }
+        current = after;
+    }
+    seenGeneration = current;
+    return true;
+}
+
+bool ConfigManager::updateConfig(const SystemConfig& newConfig) {
+    WriteGuard guard(writeLock);
+    String error;
+    if (!ConfigCodec::validate(newConfig, error)) {
+        LOG_WARNING("[CONFIG] Rejected update, out of range: " + error);
+        return false;
+    }
+
+    // Sin cambios no se reescribe la flash
+    ConfigDiff changes = ConfigCodec::diff(config, newConfig);
+    if (!changes.any()) {
+        return true;
+    }
+
+    // Primero la flash: si falla, nadie ha visto la configuración nueva
+    if (!writeConfigFile(newConfig)) {
+        return false;
+    }
+    commit(newConfig);
+    createBackup();
+
+    DynamicJsonDocument doc(256);
+    ConfigCodec::writeDiffJson(changes, doc.to<JsonArray>());
+    String changed;
+    serializeJson(doc, changed);
+    LOG_INFO("[CONFIG] Updated: " + changed);
+    return true;
+}
+
+bool ConfigManager::updateZoneConfig(uint8_t zoneIndex, const ZoneConfig& zoneConfig) {
+    if (zoneIndex >= MAX_ZONES) {
+        return false;
+    }
+    WriteGuard guard(writeLock);
+    SystemConfig updated = config;
+    updated.zones[zoneIndex] = zoneConfig;
+    return updateConfig(updated);
+}
+
+bool ConfigManager::resetToDefaults() {
+    WriteGuard guard(writeLock);
+    SystemConfig defaults;
+    ConfigCodec::applyDefaults(defaults);
+    if (!writeConfigFile(defaults)) {
+        return false;
+    }
+    commit(defaults);
+    createBackup();
+    return true;
+}
+
+String ConfigManager::exportConfig() const {
+    // Se llama desde AsyncTCP: la copia publicada, no el original
+    SystemConfig current;
+    published.read(current);
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
+    ConfigCodec::toJson(current, doc.to<JsonObject>());
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+bool ConfigManager::importConfig(const String& jsonConfig) {
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
+    DeserializationError jsonError = deserializeJson(doc, jsonConfig);
+    if (jsonError) {
+        LOG_WARNING("[CONFIG] Import rejected, invalid JSON: " + String(jsonError.c_str()));
+        return false;
+    }
+
+    // Importación parcial: solo cambian los campos presentes (sobre la
+    // configuración actual, sin que otro cambio se cuele entre medias)
+    WriteGuard guard(writeLock);
+    SystemConfig updated = config;
+    String error;
+    if (!ConfigCodec::fromJson(doc.as<JsonObjectConst>(), updated, error)) {
+        LOG_WARNING("[CONFIG] Import rejected, bad field: " + error);
+        return false;
+    }
+    return updateConfig(updated);
+}
+
+bool ConfigManager::checkConfigIntegrity() const {
+    File file = SPIFFS.open(configPath, "r");
+    if (!file) {
+        return false;
+    }
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
+    DeserializationError jsonError = deserializeJson(doc, file);
+    file.close();
+    if (jsonError) {
+        return false;
+    }
+
+    SystemConfig stored;
+    ConfigCodec::applyDefaults(stored);
+    String error;
+    return ConfigCodec::fromJson(doc.as<JsonObjectConst>(), stored, error) &&
+           ConfigCodec::validate(stored, error);
+}
+
+String ConfigManager::getConfigHash() const {
+    // Hash de la codificación binaria: no depende del orden ni formato del JSON
+    SystemConfig current;
+    published.read(current);
+    uint8_t buffer[ConfigCodec::MAX_BINARY_SIZE];
+    size_t length = ConfigCodec::encodeBinary(current, buffer, sizeof(buffer));
+
+    MD5Builder md5;
+    md5.begin();
+    md5.add(buffer, length);
+    md5.calculate();
+    return md5.toString();
+}
+
+bool ConfigManager::createBackup(uint32_t* version) {
+    bool written = false;
+    uint32_t stored = ConfigBackupStore::getInstance().store(config, written);
+    if (stored == 0) {
+        LOG_ERROR("[CONFIG] Backup failed");
+        return false;
+    }
+    if (version != nullptr) {
+        *version = stored;
+    }
+    return true;
+}
+
+bool ConfigManager::restoreBackup(uint32_t version) {
+    SystemConfig restored;
+    String error;
+    if (!ConfigBackupStore::getInstance().load(version, restored) ||
+        !ConfigCodec::validate(restored, error)) {
+        LOG_WARNING("[CONFIG] Backup version " + String(version) + " not available");
+        return false;
+    }
+    return updateConfig(restored);
+}
@@ -0,0 +1,626 @@
+/**
+ * @file ConfigStreamParser.cpp
+ * @brief Máquina de estados del JSON y asignación de campos generada desde el esquema.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * El léxico (cadenas, escapes, literales) y la estructura (pila de
+ * contenedores) son los de cualquier JSON. Lo específico está en
+ * currentSlot(): con la profundidad y la clave basta para saber si un valor
+ * es un campo del sistema, una zona o algo que ignorar. Las funciones
+ * assign*Field() se generan con las mismas X-macros que ConfigCodec.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "ConfigStreamParser.h"
+#include "ProjectConfig.h"   // Defectos y límites usados por el esquema
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits>
+
+using namespace ConfigStreamConfig;
+
+#define CONFIG_STREAM_CHECK_X(type, name, def, min, max)
+#define CONFIG_STREAM_CHECK_S(name, def, capacity) \
+    static_assert((capacity) <= MAX_TOKEN_CHARS, "MAX_TOKEN_CHARS menor que la cadena " #name);
+SYSTEM_CONFIG_FIELDS(CONFIG_STREAM_CHECK_X, CONFIG_STREAM_CHECK_S)
+#undef CONFIG_STREAM_CHECK_X
+#undef CONFIG_STREAM_CHECK_S
+
+namespace {
+    bool isDigitChar(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    /**
+     * @brief Gramática de número JSON: -?(0|[1-9]d*)(.d+)?([eE][+-]?d+)?
+     * @param integer Salida: sin parte decimal ni exponente
+     */
+    bool isJsonNumber(const char* text, size_t length, bool& integer) {
+        size_t i = 0;
+        if (i < length && text[i] == '-') {
+            i++;
+        }
+        if (i >= length || !isDigitChar(text[i])) {
+            return false;
+        }
+        if (text[i] == '0') {
+            i++;
+        } else {
+            while (i < length && isDigitChar(text[i])) {
+                i++;
+            }
+        }
+        integer = i == length;
+        if (i < length && text[i] == '.') {
+            i++;
+            if (i >= length || !isDigitChar(text[i])) {
+                return false;
+            }
+            while (i < length && isDigitChar(text[i])) {
+                i++;
+            }
+        }
+        if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+            i++;
+            if (i < length && (text[i] == '+' || text[i] == '-')) {
+                i++;
+            }
+            if (i >= length || !isDigitChar(text[i])) {
+                return false;
+            }
+            while (i < length && isDigitChar(text[i])) {
+                i++;
+            }
+        }
+        return i == length;
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool isLiteralChar(char c) {
+        return isDigitChar(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               c == '-' || c == '+' || c == '.';
+    }
+}
+
+ConfigStreamParser ConfigStreamParser::instance;
+uint32_t ConfigStreamParser::nextToken = 0;
+
+ConfigStreamParser::ConfigStreamParser() : inUse(false), token(0) {
+}
+
+ConfigStreamParser* ConfigStreamParser::acquire(uint32_t& tokenOut, const SystemConfig& base,
+                                                size_t expectedBytes) {
+    if (instance.inUse) {
+        return nullptr;
+    }
+
+    instance.reset(base, expectedBytes);
+    instance.inUse = true;
+    if (++nextToken == 0) {
+        nextToken = 1;
+    }
+    instance.token = nextToken;
+    tokenOut = nextToken;
+    return &instance;
+}
+
+void ConfigStreamParser::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        inUse = false;
+    }
+}
+
+void ConfigStreamParser::reset(const SystemConfig& base, size_t expectedBytes) {
+    staging = base;
+    error = "";
+    received = 0;
+    result = ConfigParseResult::PENDING;
+    lex = Lex::VALUE;
+    stringIsKey = false;
+    unicodeDigits = 0;
+    unicodeValue = 0;
+    pendingHighSurrogate = 0;
+    tokenLength = 0;
+    tokenOverflow = false;
+    depth = 0;
+    skipDepth = 0;
+    key[0] = '\0';
+    keyOverflow = false;
+    inZones = false;
+    zoneCount = 0;
+
+    // Content-Length ya anunciado: se rechaza sin leer el cuerpo
+    if (expectedBytes > MAX_BODY_BYTES) {
+        result = ConfigParseResult::TOO_LARGE;
+        error = "JSON";
+    }
+}
+
+ConfigParseResult ConfigStreamParser::feed(const uint8_t* data, size_t length) {
+    if (result != ConfigParseResult::PENDING) {
+        return result;
+    }
+    received += length;
+    if (received > MAX_BODY_BYTES) {
+        result = ConfigParseResult::TOO_LARGE;
+        error = "JSON";
+        return result;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (!handleByte(static_cast<char>(data[i]))) {
+            return result;
+        }
+    }
+    return result;
+}
+
+ConfigParseResult ConfigStreamParser::finish() {
+    if (result != ConfigParseResult::PENDING) {
+        return result;
+    }
+    if (lex != Lex::END) {
+        fail("JSON");                   // Documento truncado
+        return result;
+    }
+    result = ConfigParseResult::COMPLETE;
+    return result;
+}
+
+bool ConfigStreamParser::fail(const String& field) {
+    error = field;
+    result = ConfigParseResult::INVALID;
+    return false;
+}
+
+// =============================================================================
+// Léxico
+// =============================================================================
+
+bool ConfigStreamParser::handleByte(char c) {
+    switch (lex) {
+        case Lex::STRING:
+            if (c == '"') {
+                return endString();
+            }
+            if (c == '\\') {
+                lex = Lex::ESCAPE;
+                return true;
+            }
+            if (static_cast<uint8_t>(c) < 0x20) {
+                return fail("JSON");    // Control sin escapar
+            }
+            if (pendingHighSurrogate != 0) {
+                appendUtf8(0xFFFD);     // Sustituto alto sin pareja
+                pendingHighSurrogate = 0;
+            }
+            appendToken(c);
+            return true;
+
+        case Lex::ESCAPE: {
+            char decoded;
+            switch (c) {
+                case '"':  decoded = '"'; break;
+                case '\\': decoded = '\\'; break;
+                case '/':  decoded = '/'; break;
+                case 'b':  decoded = '\b'; break;
+                case 'f':  decoded = '\f'; break;
+                case 'n':  decoded = '\n'; break;
+                case 'r':  decoded = '\r'; break;
+                case 't':  decoded = '\t'; break;
+                case 'u':
+                    lex = Lex::UNICODE;
+                    unicodeDigits = 0;
+                    unicodeValue = 0;
+                    return true;
+                default:
+                    return fail("JSON");
+            }
+            if (pendingHighSurrogate != 0) {
+                appendUtf8(0xFFFD);
+                pendingHighSurrogate = 0;
+            }
+            appendToken(decoded);
+            lex = Lex::STRING;
+            return true;
+        }
+
+        case Lex::UNICODE: {
+            int digit = hexValue(c);
+            if (digit < 0) {
+                return fail("JSON");
+            }
+            unicodeValue = (unicodeValue << 4) | static_cast<uint32_t>(digit);
+            if (++unicodeDigits < 4) {
+                return true;
+            }
+            lex = Lex::STRING;
+            if (unicodeValue >= 0xD800 && unicodeValue <= 0xDBFF) {
+                if (pendingHighSurrogate != 0) {
+                    appendUtf8(0xFFFD);
+                }
+                pendingHighSurrogate = static_cast<uint16_t>(unicodeValue);
+            } else if (unicodeValue >= 0xDC00 && unicodeValue <= 0xDFFF) {
+                if (pendingHighSurrogate != 0) {
+                    appendUtf8(0x10000 + ((static_cast<uint32_t>(pendingHighSurrogate) - 0xD800) << 10) +
+                               (unicodeValue - 0xDC00));
+                    pendingHighSurrogate = 0;
+                } else {
+                    appendUtf8(0xFFFD);
+                }
+            } else {
+                if (pendingHighSurrogate != 0) {
+                    appendUtf8(0xFFFD);
+                    pendingHighSurrogate = 0;
+                }
+                appendUtf8(unicodeValue);
+            }
+            return true;
+        }
+
+        case Lex::LITERAL:
+            if (isLiteralChar(c)) {
+                appendToken(c);
+                return true;
+            }
+            // El carácter que cierra el literal es estructural: se procesa después
+            return endLiteral() && handleStructural(c);
+
+        default:
+            return handleStructural(c);
+    }
+}
+
+bool ConfigStreamParser::handleStructural(char c) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        return true;
+    }
+
+    switch (lex) {
+        case Lex::VALUE:
+        case Lex::VALUE_OR_CLOSE:
+            if (c == '{') {
+                return beginContainer(true);
+            }
+            if (c == '[') {
+                return beginContainer(false);
+            }
+            if (c == ']' && lex == Lex::VALUE_OR_CLOSE) {
+                return endContainer(false);
+            }
+            if (c == '"') {
+                stringIsKey = false;
+                tokenLength = 0;
+                tokenOverflow = false;
+                lex = Lex::STRING;
+                return true;
+            }
+            if (isLiteralChar(c)) {
+                tokenLength = 0;
+                tokenOverflow = false;
+                appendToken(c);
+                lex = Lex::LITERAL;
+                return true;
+            }
+            return fail("JSON");
+
+        case Lex::KEY:
+        case Lex::KEY_OR_CLOSE:
+            if (c == '"') {
+                stringIsKey = true;
+                tokenLength = 0;
+                tokenOverflow = false;
+                lex = Lex::STRING;
+                return true;
+            }
+            if (c == '}' && lex == Lex::KEY_OR_CLOSE) {
+                return endContainer(true);
+            }
+            return fail("JSON");
+
+        case Lex::COLON:
+            if (c == ':') {
+                lex = Lex::VALUE;
+                return true;
+            }
+            return fail("JSON");
+
+        case Lex::COMMA_OR_CLOSE: {
+            bool object = stackIsObject[depth - 1];
+            if (c == ',') {
+                lex = object ? Lex::KEY : Lex::VALUE;
+                return true;
+            }
+            if ((c == '}' && object) || (c == ']' && !object)) {
+                return endContainer(object);
+            }
+            return fail("JSON");
+        }
+
+        default:
+            return fail("JSON");        // Bytes tras el objeto raíz
+    }
+}
+
+void ConfigStreamParser::appendToken(char c) {
+    if (tokenLength < MAX_TOKEN_CHARS) {
+        tokenText[tokenLength++] = c;
+    } else {
+        tokenOverflow = true;
+    }
+}
+
+void ConfigStreamParser::appendUtf8(uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        appendToken(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        appendToken(static_cast<char>(0xC0 | (codepoint >> 6)));
+        appendToken(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        appendToken(static_cast<char>(0xE0 | (codepoint >> 12)));
+        appendToken(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        appendToken(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+        appendToken(static_cast<char>(0xF0 | (codepoint >> 18)));
+        appendToken(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        appendToken(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        appendToken(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+bool ConfigStreamParser::endString() {
+    if (pendingHighSurrogate != 0) {
+        appendUtf8(0xFFFD);
+        pendingHighSurrogate = 0;
+    }
+    tokenText[tokenLength] = '\0';
+
+    if (stringIsKey) {
+        // Una clave que no cabe no puede ser del esquema: su valor se ignora
+        keyOverflow = tokenOverflow || tokenLength > MAX_KEY_CHARS;
+        if (keyOverflow) {
+            key[0] = '\0';
+        } else {
+            memcpy(key, tokenText, tokenLength + 1);
+        }
+        lex = Lex::COLON;
+        return true;
+    }
+
+    lex = Lex::COMMA_OR_CLOSE;
+    return handleScalar(Scalar::STRING);
+}
+
+bool ConfigStreamParser::endLiteral() {
+    tokenText[tokenLength] = '\0';
+    lex = Lex::COMMA_OR_CLOSE;
+
+    if (tokenOverflow) {
+        // Solo un número absurdamente largo llega aquí: válido si se ignora
+        return currentSlot() == Slot::IGNORED ? true : fail("JSON");
+    }
+    if (strcmp(tokenText, "true") == 0) {
+        return handleScalar(Scalar::BOOL_TRUE);
+    }
+    if (strcmp(tokenText, "false") == 0) {
+        return handleScalar(Scalar::BOOL_FALSE);
+    }
+    if (strcmp(tokenText, "null") == 0) {
+        return handleScalar(Scalar::NULL_VALUE);
+    }
+    bool integer = false;
+    if (!isJsonNumber(tokenText, tokenLength, integer)) {
+        return fail("JSON");
+    }
+    return handleScalar(Scalar::NUMBER);
+}
+
+// =============================================================================
+// Estructura
+// =============================================================================
+
+ConfigStreamParser::Slot ConfigStreamParser::currentSlot() const {
+    if (skipDepth != 0 && depth >= skipDepth) {
+        return Slot::IGNORED;
+    }
+    switch (depth) {
+        case 0:  return Slot::ROOT;
+        case 1:  return Slot::ROOT_FIELD;
+        case 2:  return inZones ? Slot::ZONE_ELEMENT : Slot::IGNORED;
+        case 3:  return Slot::ZONE_FIELD;
+        default: return Slot::IGNORED;
+    }
+}
+
+bool ConfigStreamParser::beginContainer(bool object) {
+    if (depth >= MAX_DEPTH) {
+        return fail("JSON");
+    }
+
+    switch (currentSlot()) {
+        case Slot::ROOT:
+            if (!object) {
+                return fail("JSON");
+            }
+            break;
+
+        case Slot::ROOT_FIELD:
+            if (!keyOverflow && strcmp(key, "zones") == 0) {
+                if (object) {
+                    return fail("zones");
+                }
+                inZones = true;
+                zoneCount = 0;
+            } else if (isKnownField(false)) {
+                return fail(key);
+            } else {
+                skipDepth = depth + 1;
+            }
+            break;
+
+        case Slot::ZONE_ELEMENT:
+            if (!object) {
+                return fail("zones[" + String(zoneCount) + "]");
+            }
+            if (zoneCount >= MAX_ZONES) {
+                return fail("zones");
+            }
+            zoneCount++;
+            break;
+
+        case Slot::ZONE_FIELD:
+            if (isKnownField(true)) {
+                return fail("zones[" + String(zoneCount - 1) + "]." + key);
+            }
+            skipDepth = depth + 1;
+            break;
+
+        case Slot::IGNORED:
+            break;
+    }
+
+    stackIsObject[depth++] = object;
+    lex = object ? Lex::KEY_OR_CLOSE : Lex::VALUE_OR_CLOSE;
+    return true;
+}
+
+bool ConfigStreamParser::endContainer(bool object) {
+    depth--;
+    if (skipDepth != 0 && depth < skipDepth) {
+        skipDepth = 0;
+    }
+    if (depth == 1 && !object && inZones) {
+        inZones = false;
+    }
+    lex = depth == 0 ? Lex::END : Lex::COMMA_OR_CLOSE;
+    return true;
+}
+
+// =============================================================================
+// Campos (generados desde ConfigSchema.h)
+// =============================================================================
+
+bool ConfigStreamParser::handleScalar(Scalar kind) {
+    switch (currentSlot()) {
+        case Slot::ROOT:
+            return fail("JSON");
+        case Slot::ROOT_FIELD:
+            if (!keyOverflow && strcmp(key, "zones") == 0) {
+                return kind == Scalar::NULL_VALUE ? true : fail("zones");
+            }
+            return assignRootField(kind);
+        case Slot::ZONE_ELEMENT:
+            return fail("zones[" + String(zoneCount) + "]");
+        case Slot::ZONE_FIELD:
+            return assignZoneField(kind);
+        case Slot::IGNORED:
+            return true;
+    }
+    return true;
+}
+
+template <typename T>
+bool ConfigStreamParser::assignScalar(T& target, Scalar kind, long long min, long long max) {
+    if (kind == Scalar::NULL_VALUE) {
+        return true;                    // null equivale a ausente
+    }
+    bool integer = false;
+    if (kind != Scalar::NUMBER || !isJsonNumber(tokenText, tokenLength, integer) || !integer) {
+        return false;
+    }
+    errno = 0;
+    long long value = strtoll(tokenText, nullptr, 10);
+    if (errno == ERANGE ||
+        value < static_cast<long long>(std::numeric_limits<T>::min()) ||
+        value > static_cast<long long>(std::numeric_limits<T>::max()) ||
+        value < min || value > max) {
+        return false;
+    }
+    target = static_cast<T>(value);
+    return true;
+}
+
+template <>
+bool ConfigStreamParser::assignScalar<bool>(bool& target, Scalar kind, long long, long long) {
+    if (kind == Scalar::NULL_VALUE) {
+        return true;
+    }
+    if (kind != Scalar::BOOL_TRUE && kind != Scalar::BOOL_FALSE) {
+        return false;
+    }
+    target = kind == Scalar::BOOL_TRUE;
+    return true;
+}
+
+bool ConfigStreamParser::assignString(char* target, Scalar kind, size_t capacity) {
+    if (kind == Scalar::NULL_VALUE) {
+        return true;
+    }
+    if (kind != Scalar::STRING || tokenOverflow || tokenLength > capacity ||
+        memchr(tokenText, '\0', tokenLength) != nullptr) {
+        return false;
+    }
+    memcpy(target, tokenText, tokenLength);
+    memset(target + tokenLength, 0, capacity + 1 - tokenLength);
+    return true;
+}
+
+bool ConfigStreamParser::assignRootField(Scalar kind) {
+    if (keyOverflow) {
+        return true;
+    }
+#define CONFIG_STREAM_X(type, name, def, min, max) \
+    if (strcmp(key, #name) == 0) { \
+        return assignScalar<type>(target.name, kind, (min), (max)) || fail(#name); \
+    }
+#define CONFIG_STREAM_S(name, def, capacity) \
+    if (strcmp(key, #name) == 0) { \
+        return assignString(target.name, kind, (capacity)) || fail(#name); \
+    }
+    SystemConfig& target = staging;
+    SYSTEM_CONFIG_FIELDS(CONFIG_STREAM_X, CONFIG_STREAM_S)
+#undef CONFIG_STREAM_X
+#undef CONFIG_STREAM_S
+    return true;                        // Clave desconocida
+}
+
+bool ConfigStreamParser::assignZoneField(Scalar kind) {
+    if (keyOverflow) {
+        return true;
+    }
+#define CONFIG_STREAM_X(type, name, def, min, max) \
+    if (strcmp(key, #name) == 0) { \
+        return assignScalar<type>(target.name, kind, (min), (max)) || \
+               fail("zones[" + String(zoneCount - 1) + "]." #name); \
+    }
+    ZoneConfig& target = staging.zones[zoneCount - 1];
+    ZONE_CONFIG_FIELDS(CONFIG_STREAM_X)
+#undef CONFIG_STREAM_X
+    return true;
+}
+
+bool ConfigStreamParser::isKnownField(bool zone) const {
+    if (keyOverflow) {
+        return false;
+    }
+#define CONFIG_STREAM_X(type, name, def, min, max)  if (strcmp(key, #name) == 0) return true;
+#define CONFIG_STREAM_S(name, def, capacity)        if (strcmp(key, #name) == 0) return true;
+    if (zone) {
+        ZONE_CONFIG_FIELDS(CONFIG_STREAM_X)
+    } else {
+        SYSTEM_CONFIG_FIELDS(CONFIG_STREAM_X, CONFIG_STREAM_S)
+    }
+#undef CONFIG_STREAM_X
+#undef CONFIG_STREAM_S
+    return false;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file EventHistory.cpp
+ * @brief Implementación del historial persistente de eventos.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "EventHistory.h"
+#include <time.h>
+#include "Logger.h"
+
+// =============================================================================
+// HistoryReader
+// =============================================================================
+
+void HistoryReader::rewind() {
+    close();
+    fileIndex = 0;
+}
+
+void HistoryReader::close() {
+    if (file) {
+        file.close();
+    }
+    bufferCount = 0;
+    bufferPos = 0;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Se leen 16 registros de golpe: SPIFFS tiene un coste fijo por llamada y
+ * leer de 12 en 12 bytes sería varias veces más lento.
+ */
+bool HistoryReader::refill() {
+    while (fileIndex < 2) {
+        if (!file) {
+            const char* path = fileIndex == 0 ? HistoryConfig::HISTORY_OLD_PATH : HistoryConfig::HISTORY_PATH;
+            if (SPIFFS.exists(path)) {
+                file = SPIFFS.open(path, "r");
+            }
+            if (!file) {
+                fileIndex++;
+                continue;
+            }
+        }
+
+        size_t bytes = file.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer));
+        bufferCount = static_cast<uint8_t>(bytes / sizeof(HistoryRecord));
+        bufferPos = 0;
+        if (bufferCount > 0) {
+            return true;
+        }
+
+        // Fin del archivo (un registro a medias al final se ignora)
+        file.close();
+        fileIndex++;
+    }
+    return false;
+}
+
+bool HistoryReader::next(HistoryRecord& record) {
+    if (bufferPos >= bufferCount && !refill()) {
+        return false;
+    }
+    record = buffer[bufferPos++];
+    return true;
+}
+
+// =============================================================================
+// EventHistory
+// =============================================================================
+
+EventHistory::EventHistory()
+    : pendingCount(0)
+    , pinCount(0)
+    , started(false)
+    , lastFlush(0)
+    , droppedCount(0)
+{
+    lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+}
+
+bool EventHistory::begin() {
+    started = true;
+    lastFlush = millis();
+    record(HistoryEvent::BOOT);
+    LOG_INFO("[HISTORY] Historial de eventos: " + String(getStoredBytes() / sizeof(HistoryRecord)) + " registros");
+    return true;
+}
+
+void EventHistory::record(HistoryEvent event, uint8_t zone, uint32_t value) {
+    HistoryRecord entry;
+    time_t now = time(nullptr);
+    if (now >= static_cast<time_t>(HistoryConfig::MIN_VALID_EPOCH)) {
+        entry.timestamp = static_cast<uint32_t>(now);
+        entry.flags = 0;
+    } else {
+        entry.timestamp = millis() / 1000;
+        entry.flags = HistoryFlags::UPTIME_CLOCK;
+    }
+    entry.zone = zone;
+    entry.event = static_cast<uint8_t>(event);
+    entry.reserved = 0;
+    entry.value = value;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (pendingCount == HistoryConfig::RAM_BUFFER_RECORDS) {
+        if (started && pinCount == 0) {
+            writePendingLocked();
+        }
+    }
+    if (pendingCount < HistoryConfig::RAM_BUFFER_RECORDS) {
+        pending[pendingCount++] = entry;
+    } else {
+        droppedCount++;     // Exportación larga en curso y búfer lleno
+    }
+    xSemaphoreGive(lock);
+}
+
+void EventHistory::update() {
+    if (!started || pendingCount == 0) {
+        return;
+    }
+    if (millis() - lastFlush >= HistoryConfig::FLUSH_INTERVAL_MS) {
+        flush();
+    }
+}
+
+void EventHistory::flush() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (started && pinCount == 0) {
+        writePendingLocked();
+    }
+    xSemaphoreGive(lock);
+}
+
+void EventHistory::pin() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (started && pinCount == 0) {
+        writePendingLocked();
+    }
+    pinCount++;
+    xSemaphoreGive(lock);
+}
+
+void EventHistory::unpin() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (pinCount > 0) {
+        pinCount--;
+    }
+    xSemaphoreGive(lock);
+}
+
+namespace {
+    size_t recordCount(File& file) {
+        return file ? file.size() / sizeof(HistoryRecord) : 0;
+    }
+
+    // Últimos `count` registros completos del archivo
+    uint8_t readTail(File& file, HistoryRecord* out, uint8_t count) {
+        if (count == 0) {
+            return 0;
+        }
+        file.seek((recordCount(file) - count) * sizeof(HistoryRecord));
+        size_t bytes = file.read(reinterpret_cast<uint8_t*>(out), count * sizeof(HistoryRecord));
+        return static_cast<uint8_t>(bytes / sizeof(HistoryRecord));
+    }
+}
+
+uint8_t EventHistory::readRecent(HistoryRecord* out, uint8_t max) {
+    pin();
+
+    File current;
+    if (SPIFFS.exists(HistoryConfig::HISTORY_PATH)) {
+        current = SPIFFS.open(HistoryConfig::HISTORY_PATH, "r");
+    }
+    size_t fromCurrent = recordCount(current) < max ? recordCount(current) : max;
+
+    // Recién rotado, el archivo en curso tiene pocos: el resto sale del final del antiguo
+    uint8_t count = 0;
+    if (fromCurrent < max && SPIFFS.exists(HistoryConfig::HISTORY_OLD_PATH)) {
+        File old = SPIFFS.open(HistoryConfig::HISTORY_OLD_PATH, "r");
+        size_t fromOld = max - fromCurrent;
+        if (recordCount(old) < fromOld) {
+            fromOld = recordCount(old);
+        }
+        count = readTail(old, out, static_cast<uint8_t>(fromOld));
+        if (old) {
+            old.close();
+        }
+    }
+
+    if (current) {
+        count += readTail(current, out + count, static_cast<uint8_t>(fromCurrent));
+        current.close();
+    }
+
+    unpin();
+    return count;
+}
+
+uint32_t EventHistory::getStoredBytes() const {
+    uint32_t total = 0;
+    const char* paths[] = { HistoryConfig::HISTORY_OLD_PATH, HistoryConfig::HISTORY_PATH };
+    for (const char* path : paths) {
+        if (SPIFFS.exists(path)) {
+            File file = SPIFFS.open(path, "r");
+            if (file) {
+                total += file.size();
+                file.close();
+            }
+        }
+    }
+    return total;
+}
+
+void EventHistory::writePendingLocked() {
+    lastFlush = millis();
+    if (pendingCount == 0) {
+        return;
+    }
+
+    size_t bytes = pendingCount * sizeof(HistoryRecord);
+    File file = SPIFFS.open(HistoryConfig::HISTORY_PATH, "a");
+    if (file && file.size() + bytes > HistoryConfig::MAX_FILE_BYTES) {
+        // Rotación: el archivo lleno pasa a ser el antiguo
+        file.close();
+        SPIFFS.remove(HistoryConfig::HISTORY_OLD_PATH);
+        SPIFFS.rename(HistoryConfig::HISTORY_PATH, HistoryConfig::HISTORY_OLD_PATH);
+        file = SPIFFS.open(HistoryConfig::HISTORY_PATH, "a");
+    }
+
+    if (!file) {
+        LOG_ERROR("[HISTORY] No se pudo abrir " + String(HistoryConfig::HISTORY_PATH));
+        droppedCount += pendingCount;
+        pendingCount = 0;
+        return;
+    }
+
+    if (file.write(reinterpret_cast<const uint8_t*>(pending), bytes) != bytes) {
+        LOG_ERROR("[HISTORY] Escritura incompleta del historial");
+        droppedCount += pendingCount;
+    }
+    file.close();
+    pendingCount = 0;
+}
+
+const char* EventHistory::eventToString(HistoryEvent event) {
+    switch (event) {
+        case HistoryEvent::BOOT:            return "boot";
+        case HistoryEvent::CYCLE_STARTED:   return "cycle_started";
+        case HistoryEvent::CYCLE_COMPLETED: return "cycle_completed";
+        case HistoryEvent::CYCLE_STOPPED:   return "cycle_stopped";
+        case HistoryEvent::ZONE_WATERED:    return "zone_watered";
+        case HistoryEvent::PULSE_COMPLETED: return "pulse_completed";
+        case HistoryEvent::MANUAL_OPEN:     return "manual_open";
+        case HistoryEvent::MANUAL_CLOSE:    return "manual_close";
+        case HistoryEvent::SERVO_FAULT:     return "servo_fault";
+        case HistoryEvent::ZONE_DISABLED:   return "zone_disabled";
+        case HistoryEvent::EMERGENCY_STOP:  return "emergency_stop";
+        default:                            return "unknown";
+    }
+}
@@ -0,0 +1,365 @@
+/**
+ * @file HistoryExport.cpp
+ * @brief Implementación de la exportación columnar del historial.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "HistoryExport.h"
+#include <string.h>
+
+namespace {
+    typedef HistoryExportCursor::ColumnKind ColumnKind;
+
+    struct ColumnSpec {
+        const char* name;
+        uint8_t kind;
+    };
+
+    // Orden de las columnas en el documento (nombres COL_* en history_to_csv.py)
+    const ColumnSpec COLUMNS[] = {
+        { "t",     static_cast<uint8_t>(ColumnKind::DELTA) },
+        { "zone",  static_cast<uint8_t>(ColumnKind::DICT) },
+        { "event", static_cast<uint8_t>(ColumnKind::LABELED) },
+        { "flags", static_cast<uint8_t>(ColumnKind::DICT) },
+        { "value", static_cast<uint8_t>(ColumnKind::VARINT) },
+    };
+    constexpr uint8_t COLUMN_COUNT = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+}
+
+HistoryExportCursor HistoryExportCursor::instance;
+uint32_t HistoryExportCursor::nextToken = 0;
+
+// =============================================================================
+// Diccionarios
+// =============================================================================
+
+void HistoryExportCursor::Dictionary::clear() {
+    memset(present, 0, sizeof(present));
+    size = 0;
+    bits = 0;
+}
+
+void HistoryExportCursor::Dictionary::add(uint8_t value) {
+    present[value >> 3] |= static_cast<uint8_t>(1u << (value & 7));
+}
+
+void HistoryExportCursor::Dictionary::build() {
+    size = 0;
+    for (uint16_t v = 0; v < 256; v++) {
+        if (contains(static_cast<uint8_t>(v))) {
+            index[v] = static_cast<uint8_t>(size++);
+        }
+    }
+    bits = 0;
+    while ((1u << bits) < size) {
+        bits++;
+    }
+}
+
+// =============================================================================
+// Ciclo de vida
+// =============================================================================
+
+HistoryExportCursor* HistoryExportCursor::acquire(uint32_t& tokenOut, bool compress, uint32_t since) {
+    if (instance.inUse) {
+        return nullptr;
+    }
+
+    EventHistory::getInstance().pin();
+    instance.reset(compress, since);
+    instance.inUse = true;
+    if (++nextToken == 0) {
+        nextToken = 1;
+    }
+    instance.token = nextToken;
+    tokenOut = nextToken;
+    return &instance;
+}
+
+void HistoryExportCursor::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        reader.close();
+        EventHistory::getInstance().unpin();
+        inUse = false;
+    }
+}
+
+void HistoryExportCursor::reset(bool compressBody, uint32_t sinceEpoch) {
+    compress = compressBody;
+    since = sinceEpoch;
+    phase = Phase::SCAN;
+    preamblePos = 0;
+    recordCount = 0;
+    emitted = 0;
+    column = 0;
+    dictValue = 0;
+    previousTimestamp = 0;
+    bitAccumulator = 0;
+    bitCount = 0;
+    rawLength = 0;
+    rawPos = 0;
+    zones.clear();
+    events.clear();
+    flags.clear();
+    reader.rewind();
+    if (compress) {
+        deflater.begin();
+    }
+}
+
+bool HistoryExportCursor::accept(const HistoryRecord& record) const {
+    if (since == 0) {
+        return true;
+    }
+    return (record.flags & HistoryFlags::UPTIME_CLOCK) == 0 && record.timestamp >= since;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Primera pasada: contar filas y descubrir qué valores aparecen en cada
+ * columna de diccionario. Es lo único que hay que saber antes de empezar a
+ * escribir; el resto se calcula columna a columna en pasadas posteriores.
+ */
+void HistoryExportCursor::scan() {
+    HistoryRecord record;
+    reader.rewind();
+    while (reader.next(record)) {
+        if (!accept(record)) {
+            continue;
+        }
+        recordCount++;
+        zones.add(record.zone);
+        events.add(record.event);
+        flags.add(record.flags);
+    }
+    reader.close();
+
+    zones.build();
+    events.build();
+    flags.build();
+}
+
+// =============================================================================
+// Generación
+// =============================================================================
+
+void HistoryExportCursor::putVarint(uint32_t v) {
+    while (v >= 0x80) {
+        putByte(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    putByte(static_cast<uint8_t>(v));
+}
+
+void HistoryExportCursor::putBitsPacked(uint32_t value, uint8_t count) {
+    bitAccumulator |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        putByte(static_cast<uint8_t>(bitAccumulator));
+        bitAccumulator >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void HistoryExportCursor::flushPackedBits() {
+    if (bitCount > 0) {
+        putByte(static_cast<uint8_t>(bitAccumulator));
+    }
+    bitAccumulator = 0;
+    bitCount = 0;
+}
+
+HistoryExportCursor::Dictionary* HistoryExportCursor::columnDictionary() {
+    switch (column) {
+        case 1:  return &zones;
+        case 2:  return &events;
+        case 3:  return &flags;
+        default: return nullptr;
+    }
+}
+
+uint32_t HistoryExportCursor::columnValue(const HistoryRecord& record) const {
+    switch (column) {
+        case 0:  return record.timestamp;
+        case 1:  return record.zone;
+        case 2:  return record.event;
+        case 3:  return record.flags;
+        default: return record.value;
+    }
+}
+
+void HistoryExportCursor::produceColumnHeader() {
+    const ColumnSpec& spec = COLUMNS[column];
+    uint8_t nameLength = static_cast<uint8_t>(strlen(spec.name));
+
+    putByte(spec.kind);
+    putByte(nameLength);
+    for (uint8_t i = 0; i < nameLength; i++) {
+        putByte(static_cast<uint8_t>(spec.name[i]));
+    }
+
+    Dictionary* dict = columnDictionary();
+    if (dict != nullptr) {
+        putVarint(dict->size);
+        dictValue = 0;
+        phase = Phase::COLUMN_DICT;
+    } else {
+        reader.rewind();
+        emitted = 0;
+        previousTimestamp = 0;
+        phase = Phase::COLUMN_DATA;
+    }
+}
+
+void HistoryExportCursor::produceColumnDictionary() {
+    Dictionary* dict = columnDictionary();
+    bool labeled = COLUMNS[column].kind == static_cast<uint8_t>(ColumnKind::LABELED);
+
+    while (dictValue < 256 && rawLength + 2 + HistoryExportConfig::MAX_LABEL <= sizeof(raw)) {
+        uint8_t value = static_cast<uint8_t>(dictValue++);
+        if (!dict->contains(value)) {
+            continue;
+        }
+        putByte(value);
+        if (labeled) {
+            const char* label = EventHistory::eventToString(static_cast<HistoryEvent>(value));
+            size_t length = strlen(label);
+            if (length > HistoryExportConfig::MAX_LABEL) {
+                length = HistoryExportConfig::MAX_LABEL;
+            }
+            putByte(static_cast<uint8_t>(length));
+            for (size_t i = 0; i < length; i++) {
+                putByte(static_cast<uint8_t>(label[i]));
+            }
+        }
+    }
+
+    if (dictValue >= 256) {
+        reader.rewind();
+        emitted = 0;
+        phase = Phase::COLUMN_DATA;
+    }
+}
+
+void HistoryExportCursor::produceColumnData() {
+    const uint8_t kind = COLUMNS[column].kind;
+    Dictionary* dict = columnDictionary();
+
+    // Hueco para el valor más largo: varint de 5 bytes
+    while (emitted < recordCount && rawLength + 5 <= sizeof(raw)) {
+        HistoryRecord record;
+        bool found = false;
+        while (reader.next(record)) {
+            if (accept(record)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            // El historial no debería cambiar con el cursor fijado; si aun así
+            // faltan filas, se rellenan con ceros para no romper el formato
+            memset(&record, 0, sizeof(record));
+        }
+
+        uint32_t value = columnValue(record);
+        if (kind == static_cast<uint8_t>(ColumnKind::DELTA)) {
+            int32_t delta = static_cast<int32_t>(value - previousTimestamp);
+            previousTimestamp = value;
+            putVarint((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+        } else if (dict != nullptr) {
+            uint8_t index = dict->contains(static_cast<uint8_t>(value)) ? dict->index[value] : 0;
+            putBitsPacked(index, dict->bits);
+        } else {
+            putVarint(value);
+        }
+        emitted++;
+    }
+
+    if (emitted >= recordCount) {
+        flushPackedBits();
+        reader.close();
+        column++;
+        phase = column < COLUMN_COUNT ? Phase::COLUMN_HEADER : Phase::DONE;
+    }
+}
+
+void HistoryExportCursor::produce() {
+    rawLength = 0;
+    rawPos = 0;
+
+    switch (phase) {
+        case Phase::SCAN:
+            // Lee todo el historial una vez (~100 ms para 128 KB en SPIFFS)
+            scan();
+            putVarint(recordCount);
+            putByte(COLUMN_COUNT);
+            column = 0;
+            phase = Phase::COLUMN_HEADER;
+            break;
+
+        case Phase::COLUMN_HEADER:
+            produceColumnHeader();
+            break;
+
+        case Phase::COLUMN_DICT:
+            produceColumnDictionary();
+            break;
+
+        case Phase::COLUMN_DATA:
+            produceColumnData();
+            break;
+
+        case Phase::DONE:
+            break;
+    }
+}
+
+size_t HistoryExportCursor::fill(uint8_t* out, size_t maxLength) {
+    size_t written = 0;
+
+    // Preámbulo sin comprimir: el lector sabe así si debe inflar el resto
+    const uint8_t preamble[8] = {
+        'R', 'H', 'C', '1', HistoryExportConfig::FORMAT_VERSION,
+        static_cast<uint8_t>(compress ? HistoryExportConfig::FLAG_DEFLATE : 0), 0, 0
+    };
+    while (preamblePos < sizeof(preamble) && written < maxLength) {
+        out[written++] = preamble[preamblePos++];
+    }
+
+    while (written < maxLength) {
+        if (compress) {
+            size_t n = deflater.read(out + written, maxLength - written);
+            if (n > 0) {
+                written += n;
+                continue;
+            }
+            // Con la salida vacía el compresor siempre acepta entrada
+            if (rawPos < rawLength) {
+                rawPos += deflater.write(raw + rawPos, rawLength - rawPos);
+                continue;
+            }
+        } else if (rawPos < rawLength) {
+            size_t available = rawLength - rawPos;
+            size_t chunk = available < maxLength - written ? available : maxLength - written;
+            memcpy(out + written, raw + rawPos, chunk);
+            rawPos += chunk;
+            written += chunk;
+            continue;
+        }
+
+        if (phase == Phase::DONE) {
+            if (compress && !deflater.finished()) {
+                deflater.finish();
+                continue;
+            }
+            break;
+        }
+
+        produce();
+    }
+
+    return written;
+}
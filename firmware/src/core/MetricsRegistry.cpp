@@ -0,0 +1,291 @@
+/**
+ * @file MetricsRegistry.cpp
+ * @brief Implementación del registro de métricas y del exportador Prometheus.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "MetricsRegistry.h"
+#include <string.h>
+
+// =============================================================================
+// MetricLine
+// =============================================================================
+
+void MetricLine::append(char c) {
+    if (len + 1 >= MetricsConfig::MAX_LINE_LENGTH) {
+        overflow = true;
+        return;
+    }
+    buffer[len++] = c;
+    buffer[len] = '\0';
+}
+
+void MetricLine::append(const char* text) {
+    while (*text != '\0' && !overflow) {
+        append(*text++);
+    }
+}
+
+void MetricLine::appendUnsigned(uint64_t v) {
+    // Dígitos en orden inverso en un búfer local y luego al derecho
+    char digits[21];
+    uint8_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + (v % 10));
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0) {
+        append(digits[--n]);
+    }
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Prometheus espera segundos. En vez de usar coma flotante (printf con %f es
+ * caro y arrastra código), los milisegundos se escriben como parte entera,
+ * punto y tres decimales: 1500 ms -> "1.500".
+ */
+void MetricLine::appendMilliseconds(uint64_t milliseconds) {
+    appendUnsigned(milliseconds / 1000);
+    append('.');
+    uint32_t fraction = static_cast<uint32_t>(milliseconds % 1000);
+    append(static_cast<char>('0' + fraction / 100));
+    append(static_cast<char>('0' + (fraction / 10) % 10));
+    append(static_cast<char>('0' + fraction % 10));
+}
+
+void MetricLine::closeLabels() {
+    if (labelsOpen) {
+        append('}');
+        labelsOpen = false;
+    }
+}
+
+void MetricLine::begin(const char* name, const char* suffix) {
+    clear();
+    append(name);
+    if (suffix != nullptr) {
+        append(suffix);
+    }
+}
+
+void MetricLine::label(const char* key, const char* value) {
+    append(labelsOpen ? ',' : '{');
+    labelsOpen = true;
+    append(key);
+    append("=\"");
+    append(value);
+    append('"');
+}
+
+void MetricLine::label(const char* key, uint32_t value) {
+    append(labelsOpen ? ',' : '{');
+    labelsOpen = true;
+    append(key);
+    append("=\"");
+    appendUnsigned(value);
+    append('"');
+}
+
+void MetricLine::labelMsAsSeconds(const char* key, uint32_t milliseconds) {
+    append(labelsOpen ? ',' : '{');
+    labelsOpen = true;
+    append(key);
+    append("=\"");
+    appendMilliseconds(milliseconds);
+    append('"');
+}
+
+void MetricLine::value(uint64_t v) {
+    closeLabels();
+    append(' ');
+    appendUnsigned(v);
+    append('\n');
+}
+
+void MetricLine::valueMsAsSeconds(uint64_t milliseconds) {
+    closeLabels();
+    append(' ');
+    appendMilliseconds(milliseconds);
+    append('\n');
+}
+
+void MetricLine::comment(const char* kind, const char* name, const char* text) {
+    clear();
+    append("# ");
+    append(kind);
+    append(' ');
+    append(name);
+    append(' ');
+    append(text);
+    append('\n');
+}
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+bool MetricsRegistry::add(const char* name, const char* help, MetricType type,
+                          MetricSampler sampler, void* context) {
+    if (name == nullptr || sampler == nullptr) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(families[i].name, name) == 0) {
+            families[i].help = help;
+            families[i].type = type;
+            families[i].sampler = sampler;
+            families[i].context = context;
+            return true;
+        }
+    }
+
+    if (count >= MetricsConfig::MAX_METRIC_FAMILIES) {
+        return false;
+    }
+
+    families[count].name = name;
+    families[count].help = help;
+    families[count].type = type;
+    families[count].sampler = sampler;
+    families[count].context = context;
+    count++;
+    return true;
+}
+
+void MetricsRegistry::removeContext(void* context) {
+    if (context == nullptr) {
+        return;
+    }
+
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (families[i].context != context) {
+            families[kept++] = families[i];
+        }
+    }
+    count = kept;
+}
+
+const char* MetricsRegistry::typeToString(MetricType type) {
+    switch (type) {
+        case MetricType::COUNTER:   return "counter";
+        case MetricType::GAUGE:     return "gauge";
+        case MetricType::HISTOGRAM: return "histogram";
+        default:                    return "untyped";
+    }
+}
+
+// =============================================================================
+// PrometheusCursor
+// =============================================================================
+
+PrometheusCursor PrometheusCursor::pool[MetricsConfig::MAX_CONCURRENT_SCRAPES];
+uint32_t PrometheusCursor::nextToken = 0;
+
+PrometheusCursor* PrometheusCursor::acquire(uint32_t& tokenOut) {
+    for (uint8_t i = 0; i < MetricsConfig::MAX_CONCURRENT_SCRAPES; i++) {
+        PrometheusCursor& cursor = pool[i];
+        if (!cursor.inUse) {
+            cursor.reset();
+            cursor.inUse = true;
+            if (++nextToken == 0) {
+                nextToken = 1;
+            }
+            cursor.token = nextToken;
+            tokenOut = nextToken;
+            return &cursor;
+        }
+    }
+    return nullptr;
+}
+
+void PrometheusCursor::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        inUse = false;
+    }
+}
+
+void PrometheusCursor::reset() {
+    finished = false;
+    familyIndex = 0;
+    sampleIndex = 0;
+    phase = Phase::HELP;
+    linePos = 0;
+    line.clear();
+}
+
+/**
+ * @brief Compone la siguiente línea de la exposición.
+ * @return false cuando no quedan líneas
+ */
+bool PrometheusCursor::nextLine() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    linePos = 0;
+
+    while (!finished) {
+        const MetricFamily* family = registry.family(familyIndex);
+        if (family == nullptr) {
+            finished = true;
+            break;
+        }
+
+        switch (phase) {
+            case Phase::HELP:
+                line.comment("HELP", family->name, family->help);
+                phase = Phase::TYPE;
+                return true;
+
+            case Phase::TYPE:
+                line.comment("TYPE", family->name, MetricsRegistry::typeToString(family->type));
+                phase = Phase::SAMPLES;
+                sampleIndex = 0;
+                return true;
+
+            case Phase::SAMPLES: {
+                line.clear();
+                MetricSample result = family->sampler(*family, sampleIndex, line);
+                if (result == MetricSample::DONE) {
+                    familyIndex++;
+                    phase = Phase::HELP;
+                    continue;
+                }
+                sampleIndex++;
+                // Las líneas truncadas (length() == 0) se descartan
+                if (result == MetricSample::EMITTED && line.length() > 0) {
+                    return true;
+                }
+                break;
+            }
+        }
+    }
+
+    line.clear();
+    return false;
+}
+
+size_t PrometheusCursor::fill(uint8_t* out, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        size_t available = line.length() - (linePos < line.length() ? linePos : line.length());
+        if (available > 0) {
+            size_t chunk = available < maxLen - written ? available : maxLen - written;
+            memcpy(out + written, line.c_str() + linePos, chunk);
+            linePos += chunk;
+            written += chunk;
+            continue;
+        }
+
+        if (!nextLine()) {
+            break;
+        }
+    }
+
+    return written;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Bloqueos de gestión de energía, esperas del loop y fuentes de despertar.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * esp_pm decide la frecuencia (y si se duerme) según los bloqueos que haya
+ * tomados. En modo ocupado se mantienen dos: CPU al máximo y "sin light
+ * sleep". En reposo se sueltan los dos; cuando todas las tareas están
+ * bloqueadas, la tarea idle de FreeRTOS calcula cuánto falta para el
+ * próximo tick con trabajo y duerme hasta entonces. Por eso el loop espera
+ * con ulTaskNotifyTake() y no con un bucle: una tarea que gira impide
+ * cualquier reposo.
+ *
+ * MIN_CPU_MHZ = 80 mantiene el bus APB a 80 MHz: los canales LEDC de los
+ * servos y la UART no cambian de reloj al bajar la frecuencia. Durante el
+ * light sleep LEDC se detiene, así que SystemManager deja de generar pulsos
+ * en las zonas cerradas antes de entrar en reposo (un servo sin pulso no se
+ * mueve) y los restablece al salir.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "PowerManager.h"
+#include "ProjectConfig.h"
+#include "MetricsRegistry.h"
+#include "Logger.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <esp_sleep.h>
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
+
+using namespace PowerConfig;
+
+namespace {
+    constexpr gpio_num_t SENSOR_PIN = static_cast<gpio_num_t>(HardwarePins::DigitalIO::SENSOR_HUMEDAD);
+}
+
+TaskHandle_t PowerManager::loopTask = nullptr;
+volatile bool PowerManager::sensorWoke = false;
+
+PowerManager::PowerManager()
+    : started(false), lowPower(false), hasIdleSince(false), idleSince(0), hasDeadline(false), nextDeadline(0),
+      sleepCount(0), sleptMs(0), cpuLock(nullptr), noSleepLock(nullptr) {
+}
+
+void PowerManager::begin() {
+    if (started) {
+        return;
+    }
+    started = true;
+    loopTask = xTaskGetCurrentTaskHandle();
+
+    if (!ENABLE_IDLE_SLEEP) {
+        LOG_INFO("[POWER] Reposo de bajo consumo deshabilitado");
+        return;
+    }
+
+    // Modo ocupado desde el principio: los bloqueos se toman antes de configurar
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "riego_cpu", &cpuLock) != ESP_OK) {
+        cpuLock = nullptr;
+    }
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "riego_awake", &noSleepLock) != ESP_OK) {
+        noSleepLock = nullptr;
+    }
+    if (cpuLock) {
+        esp_pm_lock_acquire(cpuLock);
+    }
+    if (noSleepLock) {
+        esp_pm_lock_acquire(noSleepLock);
+    }
+
+    esp_pm_config_esp32_t pm;
+    pm.max_freq_mhz = MAX_CPU_MHZ;
+    pm.min_freq_mhz = MIN_CPU_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+#else
+    pm.light_sleep_enable = false;
+#endif
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err == ESP_OK) {
+        LOG_INFO("[POWER] Gestión de energía: " + String(MIN_CPU_MHZ) + "-" + String(MAX_CPU_MHZ) + " MHz, light sleep " +
+                 String(pm.light_sleep_enable ? "automático" : "no disponible (sin tickless idle)"));
+    } else {
+        LOG_WARNING("[POWER] esp_pm no disponible (" + String(esp_err_to_name(err)) +
+                    "): en reposo solo esperas del loop y modem sleep");
+    }
+
+    // Sensor de humedad: interrupción por nivel, desarmada hasta la primera espera
+    pinMode(SENSOR_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(SENSOR_PIN), onSensorLevel, ONHIGH);
+    gpio_intr_disable(SENSOR_PIN);
+    esp_sleep_enable_gpio_wakeup();
+
+    // Puerto serie: los primeros bytes despiertan y se pierden; el host de
+    // SerialProvisioning reintenta la trama con el mismo número de secuencia
+    uart_set_wakeup_threshold(UART_NUM_0, UART_WAKE_THRESHOLD);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+
+    registerMetrics();
+}
+
+bool PowerManager::setIdle(bool idle, uint32_t now) {
+    if (!started || !ENABLE_IDLE_SLEEP) {
+        return false;
+    }
+
+    if (!idle) {
+        hasIdleSince = false;
+        if (lowPower) {
+            leaveLowPower();
+            return true;
+        }
+        return false;
+    }
+
+    if (!hasIdleSince) {
+        hasIdleSince = true;
+        idleSince = now;
+    }
+    if (!lowPower && now - idleSince >= IDLE_SETTLE_MS) {
+        enterLowPower();
+        return true;
+    }
+    return false;
+}
+
+void PowerManager::wakeBy(uint32_t deadline) {
+    if (!hasDeadline || static_cast<int32_t>(deadline - nextDeadline) < 0) {
+        nextDeadline = deadline;
+        hasDeadline = true;
+    }
+}
+
+void PowerManager::wake() {
+    TaskHandle_t task = loopTask;
+    if (task != nullptr) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void PowerManager::idle() {
+    if (!lowPower) {
+        hasDeadline = false;
+        yield();
+        return;
+    }
+
+    // Plazo más cercano de la vuelta, con tope: lo que no se anuncia
+    // (heartbeat, MQTT, volcado del historial) se atiende como mucho MAX_SLEEP_MS tarde
+    uint32_t waitMs = MAX_SLEEP_MS;
+    if (hasDeadline) {
+        int32_t until = static_cast<int32_t>(nextDeadline - millis());
+        if (until < 0) {
+            until = 0;
+        }
+        if (static_cast<uint32_t>(until) < waitMs) {
+            waitMs = until;
+        }
+    }
+    hasDeadline = false;
+
+    if (waitMs < MIN_SLEEP_MS) {
+        yield();
+        return;
+    }
+
+    armSensorWake();
+    sleepCount++;
+    sleptMs += waitMs;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    disarmSensorWake();
+}
+
+bool PowerManager::takeSensorWake() {
+    if (!sensorWoke) {
+        return false;
+    }
+    sensorWoke = false;
+    return true;
+}
+
+void PowerManager::enterLowPower() {
+    lowPower = true;
+    if (noSleepLock) {
+        esp_pm_lock_release(noSleepLock);
+    }
+    if (cpuLock) {
+        esp_pm_lock_release(cpuLock);
+    }
+
+    // WIFI_PS_MIN_MODEM: la radio se apaga entre balizas y escucha en cada DTIM
+    WiFi.setSleep(true);
+    LOG_INFO("[POWER] Reposo: sin riego pendiente, esperas hasta el próximo plazo");
+}
+
+void PowerManager::leaveLowPower() {
+    lowPower = false;
+    if (cpuLock) {
+        esp_pm_lock_acquire(cpuLock);
+    }
+    if (noSleepLock) {
+        esp_pm_lock_acquire(noSleepLock);
+    }
+
+    WiFi.setSleep(false);
+    LOG_INFO("[POWER] Fin del reposo tras " + String(sleepCount) + " esperas");
+}
+
+void PowerManager::armSensorWake() {
+    // Nivel contrario al actual: dispara (y despierta) en cuanto cambie. Si
+    // cambia entre la lectura y el enable, la interrupción salta al momento
+    gpio_wakeup_enable(SENSOR_PIN, gpio_get_level(SENSOR_PIN) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    gpio_intr_enable(SENSOR_PIN);
+}
+
+void PowerManager::disarmSensorWake() {
+    gpio_intr_disable(SENSOR_PIN);
+    gpio_wakeup_disable(SENSOR_PIN);
+}
+
+void IRAM_ATTR PowerManager::onSensorLevel() {
+    // Una interrupción por nivel seguiría saltando mientras dure el nivel:
+    // se desarma aquí (acceso directo al registro, nada en flash) y el loop
+    // la vuelve a armar con el nivel contrario antes de la próxima espera
+    gpio_ll_intr_disable(&GPIO, SENSOR_PIN);
+    sensorWoke = true;
+
+    BaseType_t woken = pdFALSE;
+    if (loopTask != nullptr) {
+        vTaskNotifyGiveFromISR(loopTask, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// =============================================================================
+// Métricas
+// =============================================================================
+
+void PowerManager::registerMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+
+    registry.add("riego_power_low_power", "1 si el sistema está en reposo de bajo consumo", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const PowerManager* power = static_cast<const PowerManager*>(family.context);
+            return singleSample(family, index, line, power->lowPower ? 1 : 0);
+        }, this);
+    registry.add("riego_power_sleeps_total", "Esperas del loop en reposo", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const PowerManager* power = static_cast<const PowerManager*>(family.context);
+            return singleSample(family, index, line, power->sleepCount);
+        }, this);
+    registry.add("riego_power_sleep_ms_total", "Milisegundos de espera pedidos en reposo", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const PowerManager* power = static_cast<const PowerManager*>(family.context);
+            return singleSample(family, index, line, power->sleptMs);
+        }, this);
+}
@@ -0,0 +1,565 @@
+/**
+ * @file SerialProvisioning.cpp
+ * @brief Tramas COBS + CRC en Serial: sesión, comandos y volcados no bloqueantes.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * La recepción es una pequeña máquina de estados byte a byte. Al arrancar
+ * está en modo texto (compatibilidad con la línea AAMMDDWHHMMSS); el primer
+ * 0x00 la pasa a modo trama, donde cada 0x00 cierra la trama acumulada.
+ * Los enteros viajan en little-endian, el orden nativo del ESP32.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/core/SerialProvisioning.h"
+#include "../../include/core/ConfigManager.h"
+#include "../../include/core/MetricsRegistry.h"
+#include "ProjectConfig.h"
+#include "utils/LogStore.h"
+#include "utils/Logger.h"
+#include "utils/SET_DATE.h"
+#include <string.h>
+#include <stdlib.h>
+
+using namespace SerialProvisioningConfig;
+
+namespace {
+    // Trozo mínimo de un volcado: por debajo se espera a que se vacíe el buffer de transmisión
+    constexpr size_t MIN_STREAM_CHUNK = 32;
+
+    uint16_t readU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t readU32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void writeU16(uint8_t* p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void writeU32(uint8_t* p, uint32_t v) {
+        for (uint8_t i = 0; i < 4; i++) {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+}
+
+SerialProvisioning::SerialProvisioning()
+    : rtc(nullptr), started(false), rtcUpdated(false),
+      frameMode(false), overflow(false), rxLength(0), legacyLength(0),
+      sessionActive(false), loggerWasSerial(true), lastFrameTime(0), currentBaud(DEFAULT_BAUD),
+      importBuffer(nullptr), importLength(0), importReceived(0),
+      stream(StreamKind::NONE), streamCommand(0), streamSeq(0), streamToken(0),
+      metricsCursor(nullptr), logCursor(nullptr) {}
+
+void SerialProvisioning::begin(IRTC* rtcInstance) {
+    rtc = rtcInstance;
+    started = true;
+}
+
+bool SerialProvisioning::consumeRtcUpdate() {
+    bool updated = rtcUpdated;
+    rtcUpdated = false;
+    return updated;
+}
+
+void SerialProvisioning::update() {
+    if (!started) {
+        return;
+    }
+
+    size_t budget = RX_BYTES_PER_UPDATE;
+    while (budget > 0 && Serial.available() > 0) {
+        int byte = Serial.read();
+        if (byte < 0) {
+            break;
+        }
+        handleByte(static_cast<uint8_t>(byte));
+        budget--;
+    }
+
+    if (stream != StreamKind::NONE) {
+        pumpStream();
+    }
+
+    // Un host que no siguió el cambio de velocidad (o que se fue) no deja el puerto bloqueado
+    if (sessionActive && stream == StreamKind::NONE && millis() - lastFrameTime > SESSION_TIMEOUT_MS) {
+        endSession();
+    }
+}
+
+// =============================================================================
+// Recepción
+// =============================================================================
+
+void SerialProvisioning::handleByte(uint8_t byte) {
+    if (byte == 0) {
+        // Un 0x00 suelto (ruido, una traza) no basta para dejar el modo texto:
+        // solo una trama que decodifica con CRC válido pasa a modo trama
+        if (!overflow && rxLength > 0) {
+            handleFrame(rxBuffer, rxLength);
+        }
+        overflow = false;
+        rxLength = 0;
+        legacyLength = 0;
+        return;
+    }
+
+    if (!frameMode) {
+        // Mismo criterio que SetDate::setDateFromSerial: solo cuentan los dígitos
+        if (byte == '\n' || byte == '\r') {
+            if (legacyLength > 0) {
+                handleLegacyLine();
+            }
+        } else if (isDigit(byte) && legacyLength < LEGACY_DIGITS) {
+            legacyDigits[legacyLength++] = static_cast<char>(byte);
+        }
+    }
+
+    // Todo byte puede ser parte de una trama: se acumula hasta el siguiente 0x00
+    if (overflow) {
+        return;
+    }
+    if (rxLength >= sizeof(rxBuffer)) {
+        overflow = true;
+        return;
+    }
+    rxBuffer[rxLength++] = byte;
+}
+
+void SerialProvisioning::handleLegacyLine() {
+    uint8_t length = legacyLength;
+    legacyLength = 0;
+    if (rtc == nullptr) {
+        return;
+    }
+    SetDate setDate(rtc);
+    if (setDate.setDateFromString(legacyDigits, length)) {
+        rtcUpdated = true;
+        LOG_INFO("[PROVISION] RTC configurado con línea AAMMDDWHHMMSS");
+    }
+}
+
+void SerialProvisioning::handleFrame(const uint8_t* encoded, size_t length) {
+    uint8_t frame[MAX_FRAME];
+    size_t frameLength = cobsDecode(encoded, length, frame, sizeof(frame));
+
+    // cmd + seq + crc como mínimo
+    if (frameLength < 2 + sizeof(uint16_t)) {
+        return;
+    }
+    size_t bodyLength = frameLength - sizeof(uint16_t);
+    if (crc16(frame, bodyLength) != readU16(frame + bodyLength)) {
+        return;     // El host reintenta al no recibir respuesta
+    }
+
+    lastFrameTime = millis();
+    frameMode = true;
+    if (!sessionActive) {
+        startSession();
+    }
+    dispatch(frame[0], frame[1], frame + 2, bodyLength - 2);
+}
+
+void SerialProvisioning::dispatch(uint8_t command, uint8_t seq, const uint8_t* data, size_t length) {
+    ProvisioningCommand cmd = static_cast<ProvisioningCommand>(command);
+
+    if (stream != StreamKind::NONE && cmd != ProvisioningCommand::PING && cmd != ProvisioningCommand::BYE) {
+        reply(command, seq, ProvisioningStatus::BUSY);
+        return;
+    }
+
+    switch (cmd) {
+        case ProvisioningCommand::HELLO:
+            handleHello(seq, data, length);
+            break;
+        case ProvisioningCommand::PING:
+            reply(command, seq, ProvisioningStatus::OK);
+            break;
+        case ProvisioningCommand::BYE:
+            reply(command, seq, ProvisioningStatus::OK);
+            endSession();
+            break;
+        case ProvisioningCommand::SET_TIME:
+            handleSetTime(seq, data, length);
+            break;
+        case ProvisioningCommand::GET_TIME:
+            handleGetTime(seq);
+            break;
+        case ProvisioningCommand::CONFIG_BEGIN:
+            handleConfigBegin(seq, data, length);
+            break;
+        case ProvisioningCommand::CONFIG_DATA:
+            handleConfigData(seq, data, length);
+            break;
+        case ProvisioningCommand::CONFIG_COMMIT:
+            handleConfigCommit(seq);
+            break;
+        case ProvisioningCommand::METRICS:
+            metricsCursor = PrometheusCursor::acquire(streamToken);
+            if (metricsCursor == nullptr) {
+                reply(command, seq, ProvisioningStatus::BUSY);
+                return;
+            }
+            stream = StreamKind::METRICS;
+            streamCommand = command;
+            streamSeq = seq;
+            break;
+        case ProvisioningCommand::LOGS:
+            handleLogs(seq, data, length);
+            break;
+        default:
+            reply(command, seq, ProvisioningStatus::UNKNOWN_COMMAND);
+            break;
+    }
+}
+
+// =============================================================================
+// Comandos
+// =============================================================================
+
+void SerialProvisioning::handleHello(uint8_t seq, const uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::HELLO);
+    if (length != sizeof(uint32_t)) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+
+    // La mayor velocidad soportada que no supere la pedida
+    uint32_t requested = readU32(data);
+    uint32_t baud = DEFAULT_BAUD;
+    for (uint32_t supported : SUPPORTED_BAUDS) {
+        if (supported <= requested && supported > baud) {
+            baud = supported;
+        }
+    }
+
+    uint8_t payload[1 + sizeof(uint32_t) + sizeof(uint16_t) + 16];
+    size_t versionLength = strnlen(ProjectInfo::VERSION, 16);
+    payload[0] = PROTOCOL_VERSION;
+    writeU32(payload + 1, baud);
+    writeU16(payload + 5, static_cast<uint16_t>(MAX_DATA));
+    memcpy(payload + 7, ProjectInfo::VERSION, versionLength);
+    reply(command, seq, ProvisioningStatus::OK, payload, 7 + versionLength);
+
+    // La respuesta sale a la velocidad antigua; el host cambia al recibirla
+    if (baud != currentBaud) {
+        Serial.flush();
+        Serial.updateBaudRate(baud);
+        currentBaud = baud;
+    }
+}
+
+void SerialProvisioning::handleSetTime(uint8_t seq, const uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::SET_TIME);
+    if (length != 7) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+    if (rtc == nullptr) {
+        reply(command, seq, ProvisioningStatus::UNAVAILABLE);
+        return;
+    }
+
+    DateTime dt;
+    dt.year = data[0];
+    dt.month = data[1];
+    dt.day = data[2];
+    dt.dayOfWeek = data[3];
+    dt.hour = data[4];
+    dt.minute = data[5];
+    dt.second = data[6];
+
+    SetDate setDate(rtc);
+    if (!setDate.setDate(dt)) {
+        reply(command, seq, ProvisioningStatus::REJECTED);
+        return;
+    }
+    rtcUpdated = true;
+    LOG_INFO("[PROVISION] RTC configurado por trama serie");
+    reply(command, seq, ProvisioningStatus::OK);
+}
+
+void SerialProvisioning::handleGetTime(uint8_t seq) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::GET_TIME);
+    DateTime dt;
+    if (rtc == nullptr || !rtc->getDateTime(&dt)) {
+        reply(command, seq, ProvisioningStatus::UNAVAILABLE);
+        return;
+    }
+    uint8_t payload[7] = { dt.year, dt.month, dt.day, dt.dayOfWeek, dt.hour, dt.minute, dt.second };
+    reply(command, seq, ProvisioningStatus::OK, payload, sizeof(payload));
+}
+
+void SerialProvisioning::handleConfigBegin(uint8_t seq, const uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::CONFIG_BEGIN);
+    if (length != sizeof(uint16_t)) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+    uint16_t total = readU16(data);
+    if (total == 0 || total > MAX_IMPORT_BYTES) {
+        reply(command, seq, ProvisioningStatus::TOO_LARGE);
+        return;
+    }
+
+    freeImport();
+    importBuffer = static_cast<char*>(malloc(total + 1));
+    if (importBuffer == nullptr) {
+        reply(command, seq, ProvisioningStatus::UNAVAILABLE);
+        return;
+    }
+    importLength = total;
+    importReceived = 0;
+    reply(command, seq, ProvisioningStatus::OK);
+}
+
+void SerialProvisioning::handleConfigData(uint8_t seq, const uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::CONFIG_DATA);
+    if (importBuffer == nullptr) {
+        reply(command, seq, ProvisioningStatus::UNAVAILABLE);
+        return;
+    }
+    if (length < sizeof(uint16_t)) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+
+    uint16_t offset = readU16(data);
+    size_t chunk = length - sizeof(uint16_t);
+    if (offset + chunk > importLength) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+
+    // Reenvío de un trozo ya recibido (se perdió nuestra respuesta): confirmar sin copiar
+    if (offset + chunk <= importReceived) {
+        reply(command, seq, ProvisioningStatus::OK);
+        return;
+    }
+    if (offset != importReceived) {
+        uint8_t expected[sizeof(uint16_t)];
+        writeU16(expected, importReceived);
+        reply(command, seq, ProvisioningStatus::BAD_OFFSET, expected, sizeof(expected));
+        return;
+    }
+
+    memcpy(importBuffer + offset, data + sizeof(uint16_t), chunk);
+    importReceived += chunk;
+    reply(command, seq, ProvisioningStatus::OK);
+}
+
+void SerialProvisioning::handleConfigCommit(uint8_t seq) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::CONFIG_COMMIT);
+    if (importBuffer == nullptr) {
+        reply(command, seq, ProvisioningStatus::UNAVAILABLE);
+        return;
+    }
+    if (importReceived != importLength) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+
+    importBuffer[importLength] = '\0';
+    String json(importBuffer);
+    freeImport();
+
+    ConfigManager& configManager = ConfigManager::getInstance();
+    if (!configManager.importConfig(json)) {
+        reply(command, seq, ProvisioningStatus::REJECTED);
+        return;
+    }
+    LOG_INFO("[PROVISION] Configuración importada por serie (" + String(json.length()) + " bytes)");
+
+    uint8_t generation[sizeof(uint32_t)];
+    writeU32(generation, configManager.getGeneration());
+    reply(command, seq, ProvisioningStatus::OK, generation, sizeof(generation));
+}
+
+void SerialProvisioning::handleLogs(uint8_t seq, const uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(ProvisioningCommand::LOGS);
+    if (length != sizeof(uint32_t) + 1) {
+        reply(command, seq, ProvisioningStatus::BAD_LENGTH);
+        return;
+    }
+
+    LogQuery query = { readU32(data), data[4] };
+    if (query.maxLevel > LogStoreConfig::MAX_LEVEL) {
+        query.maxLevel = LogStoreConfig::MAX_LEVEL;
+    }
+    logCursor = LogQueryCursor::acquire(streamToken, query);
+    if (logCursor == nullptr) {
+        reply(command, seq, ProvisioningStatus::BUSY);
+        return;
+    }
+    stream = StreamKind::LOGS;
+    streamCommand = command;
+    streamSeq = seq;
+}
+
+// =============================================================================
+// Emisión
+// =============================================================================
+
+void SerialProvisioning::reply(uint8_t command, uint8_t seq, ProvisioningStatus status,
+                               const uint8_t* data, size_t length) {
+    uint8_t frame[MAX_FRAME];
+    frame[0] = command | 0x80;
+    frame[1] = seq;
+    frame[2] = static_cast<uint8_t>(status);
+    if (length > 0) {
+        memcpy(frame + 3, data, length);
+    }
+    size_t bodyLength = 3 + length;
+    writeU16(frame + bodyLength, crc16(frame, bodyLength));
+
+    uint8_t wire[MAX_WIRE];
+    wire[0] = 0;
+    size_t encoded = cobsEncode(frame, bodyLength + sizeof(uint16_t), wire + 1);
+    wire[encoded + 1] = 0;
+    Serial.write(wire, encoded + 2);
+}
+
+void SerialProvisioning::pumpStream() {
+    // Trama sin datos ya codificada: cabecera + crc + byte COBS + dos delimitadores
+    const size_t fixed = FRAME_OVERHEAD + 1 + 2;
+
+    for (uint8_t i = 0; i < STREAM_FRAMES_PER_UPDATE && stream != StreamKind::NONE; i++) {
+        int space = Serial.availableForWrite();
+        if (space < static_cast<int>(fixed + MIN_STREAM_CHUNK)) {
+            return;     // Se sigue en la próxima iteración del loop
+        }
+        size_t chunk = static_cast<size_t>(space) - fixed;
+        if (chunk > MAX_DATA) {
+            chunk = MAX_DATA;
+        }
+
+        uint8_t data[MAX_DATA];
+        size_t written = stream == StreamKind::METRICS
+            ? metricsCursor->fill(data, chunk)
+            : logCursor->fill(data, chunk);
+        if (written == 0) {
+            reply(streamCommand, streamSeq, ProvisioningStatus::OK);
+            endStream();
+            return;
+        }
+        reply(streamCommand, streamSeq, ProvisioningStatus::MORE, data, written);
+    }
+}
+
+void SerialProvisioning::endStream() {
+    if (stream == StreamKind::METRICS) {
+        metricsCursor->release(streamToken);
+    } else if (stream == StreamKind::LOGS) {
+        logCursor->release(streamToken);
+    }
+    stream = StreamKind::NONE;
+    metricsCursor = nullptr;
+    logCursor = nullptr;
+    lastFrameTime = millis();
+}
+
+// =============================================================================
+// Sesión
+// =============================================================================
+
+void SerialProvisioning::startSession() {
+    LOG_INFO("[PROVISION] Sesión serie iniciada, log por serie en pausa");
+    Logger& logger = Logger::getInstance();
+    loggerWasSerial = logger.isSerialLogging();
+    logger.setSerialLogging(false);
+    sessionActive = true;
+}
+
+void SerialProvisioning::endSession() {
+    endStream();
+    freeImport();
+    if (currentBaud != DEFAULT_BAUD) {
+        Serial.flush();
+        Serial.updateBaudRate(DEFAULT_BAUD);
+        currentBaud = DEFAULT_BAUD;
+    }
+    sessionActive = false;
+    frameMode = false;
+    rxLength = 0;
+    Logger::getInstance().setSerialLogging(loggerWasSerial);
+    LOG_INFO("[PROVISION] Sesión serie terminada");
+}
+
+void SerialProvisioning::freeImport() {
+    free(importBuffer);
+    importBuffer = nullptr;
+    importLength = 0;
+    importReceived = 0;
+}
+
+// =============================================================================
+// COBS y CRC
+// =============================================================================
+
+size_t SerialProvisioning::cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t codeIndex = 0;
+    size_t write = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+            continue;
+        }
+        out[write++] = in[i];
+        if (++code == 0xFF) {
+            // Bloque de 254 bytes sin ceros: se cierra sin cero implícito
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        }
+    }
+    out[codeIndex] = code;
+    return write;
+}
+
+size_t SerialProvisioning::cobsDecode(const uint8_t* in, size_t length, uint8_t* out, size_t maxOut) {
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < length) {
+        uint8_t code = in[read++];
+        if (code == 0) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (read >= length || write >= maxOut || in[read] == 0) {
+                return 0;
+            }
+            out[write++] = in[read++];
+        }
+        // Cada bloque corto representa un cero, salvo el último
+        if (code != 0xFF && read < length) {
+            if (write >= maxOut) {
+                return 0;
+            }
+            out[write++] = 0;
+        }
+    }
+    return write;
+}
+
+uint16_t SerialProvisioning::crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
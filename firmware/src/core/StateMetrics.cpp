@@ -0,0 +1,436 @@
+/**
+ * @file StateMetrics.cpp
+ * @brief Implementación del registro de métricas de estados.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "StateMetrics.h"
+#include "MetricsRegistry.h"
+
+namespace {
+    // Mismo orden que IrrigationState (ServoPWMController.h)
+    const char* const IRRIGATION_STATE_NAMES[StateMetricsConfig::IRRIGATION_STATES] = {
+        "IDLE", "INITIALIZING", "OPENING_VALVE", "IRRIGATING", "CLOSING_VALVE",
+        "TRANSITIONING", "HANDOFF", "COMPLETED", "ERROR"
+    };
+
+    // Mismo orden que ServoState (ServoPWMController.h)
+    const char* const SERVO_STATE_NAMES[StateMetricsConfig::SERVO_STATES] = {
+        "UNINITIALIZED", "CLOSED", "OPENING", "OPEN", "CLOSING", "ERROR"
+    };
+
+    // Mismo orden que SystemManager::SystemState
+    const char* const SYSTEM_STATE_NAMES[StateMetricsConfig::SYSTEM_STATES] = {
+        "INITIALIZING", "CONFIGURATION_MODE", "NORMAL_OPERATION", "ERROR_RECOVERY", "EMERGENCY_STOP"
+    };
+
+    /**
+     * @brief Escribe el bloque de métricas de un estado.
+     *
+     * Los cubos se recortan tras el último no vacío para reducir el tamaño.
+     */
+    void writeStateJson(Print& out, const char* name, uint32_t entries, const DwellHistogram& hist) {
+        out.print('"'); out.print(name); out.print("\":{\"entries\":"); out.print(entries);
+        out.print(",\"dwellCount\":"); out.print(hist.getCount());
+        out.print(",\"dwellSumMs\":"); out.print((unsigned long long)hist.getSumMs());
+        out.print(",\"dwellMaxMs\":"); out.print(hist.getMaxMs());
+        out.print(",\"buckets\":[");
+
+        int8_t last = -1;
+        for (uint8_t i = 0; i < StateMetricsConfig::DWELL_BUCKETS; i++) {
+            if (hist.bucket(i) > 0) last = i;
+        }
+        for (int8_t i = 0; i <= last; i++) {
+            if (i > 0) out.print(',');
+            out.print(hist.bucket(i));
+        }
+        out.print("]}");
+    }
+
+    /**
+     * @brief Escribe un bloque de una máquina de estados.
+     *
+     * step 0 es la cabecera (estado actual y apertura de "states"); los
+     * siguientes, un estado cada uno. El último cierra "states".
+     *
+     * @return true si era el último bloque de la máquina
+     */
+    template<uint8_t N>
+    bool writeTrackerStep(Print& out, const StateTracker<N>& tracker,
+                          const char* (*nameOf)(uint8_t), uint8_t step, uint32_t now) {
+        if (step == 0) {
+            out.print("\"current\":\"");
+            out.print(tracker.isStarted() ? nameOf(tracker.currentState()) : "");
+            out.print("\",\"currentDwellMs\":"); out.print(tracker.currentDwellMs(now));
+            out.print(",\"states\":{");
+            return false;
+        }
+
+        uint8_t s = step - 1;
+        if (s > 0) out.print(',');
+        writeStateJson(out, nameOf(s), tracker.entryCount(s), tracker.histogram(s));
+        if (s + 1 < N) {
+            return false;
+        }
+        out.print('}');
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+    // Exportación Prometheus
+    // -------------------------------------------------------------------------
+
+    // Series de estado: ciclo de riego, cada servo y sistema, en ese orden
+    constexpr uint16_t SERIES_COUNT = StateMetricsConfig::IRRIGATION_STATES +
+                                      NUM_SERVOS * StateMetricsConfig::SERVO_STATES +
+                                      StateMetricsConfig::SYSTEM_STATES;
+
+    // Cubos exportados: uno de cada dos (límites 4 ms, 16 ms, ... ≈ 70 min)
+    // para reducir a la mitad el tamaño del scrape. El último cubo interno
+    // es abierto y solo cuenta en +Inf.
+    constexpr uint8_t PROM_BUCKET_STRIDE = 2;
+    constexpr uint8_t PROM_BUCKETS = (StateMetricsConfig::DWELL_BUCKETS - 1) / PROM_BUCKET_STRIDE;
+    constexpr uint8_t PROM_LINES_PER_SERIES = PROM_BUCKETS + 3;    // + +Inf, _sum, _count
+
+    struct SeriesRef {
+        const char* machine;
+        uint8_t zone;                   // 1-based; 0 si la máquina no es por zona
+        const char* state;
+        uint32_t entries;
+        const DwellHistogram* histogram;
+    };
+
+    void resolveSeries(const StateMetrics& metrics, uint16_t series, SeriesRef& ref) {
+        if (series < StateMetricsConfig::IRRIGATION_STATES) {
+            uint8_t state = series;
+            ref.machine = "irrigation";
+            ref.zone = 0;
+            ref.state = IRRIGATION_STATE_NAMES[state];
+            ref.entries = metrics.irrigation().entryCount(state);
+            ref.histogram = &metrics.irrigation().histogram(state);
+            return;
+        }
+        series -= StateMetricsConfig::IRRIGATION_STATES;
+
+        if (series < NUM_SERVOS * StateMetricsConfig::SERVO_STATES) {
+            uint8_t zone = series / StateMetricsConfig::SERVO_STATES;
+            uint8_t state = series % StateMetricsConfig::SERVO_STATES;
+            ref.machine = "servo";
+            ref.zone = zone + 1;
+            ref.state = SERVO_STATE_NAMES[state];
+            ref.entries = metrics.servo(zone).entryCount(state);
+            ref.histogram = &metrics.servo(zone).histogram(state);
+            return;
+        }
+        series -= NUM_SERVOS * StateMetricsConfig::SERVO_STATES;
+
+        ref.machine = "system";
+        ref.zone = 0;
+        ref.state = SYSTEM_STATE_NAMES[series];
+        ref.entries = metrics.system().entryCount(series);
+        ref.histogram = &metrics.system().histogram(series);
+    }
+
+    void seriesLabels(MetricLine& line, const SeriesRef& ref) {
+        line.label("machine", ref.machine);
+        if (ref.zone > 0) {
+            line.label("zone", static_cast<uint32_t>(ref.zone));
+        }
+        line.label("state", ref.state);
+    }
+
+    MetricSample sampleStateEntries(const MetricFamily& family, uint16_t index, MetricLine& line) {
+        if (index >= SERIES_COUNT) return MetricSample::DONE;
+
+        SeriesRef ref;
+        resolveSeries(*static_cast<const StateMetrics*>(family.context), index, ref);
+        if (ref.entries == 0) return MetricSample::SKIPPED;
+
+        line.begin(family.name);
+        seriesLabels(line, ref);
+        line.value(ref.entries);
+        return MetricSample::EMITTED;
+    }
+
+    MetricSample sampleStateDwell(const MetricFamily& family, uint16_t index, MetricLine& line) {
+        uint16_t series = index / PROM_LINES_PER_SERIES;
+        uint8_t lineIndex = index % PROM_LINES_PER_SERIES;
+        if (series >= SERIES_COUNT) return MetricSample::DONE;
+
+        SeriesRef ref;
+        resolveSeries(*static_cast<const StateMetrics*>(family.context), series, ref);
+        const DwellHistogram& hist = *ref.histogram;
+        if (hist.getCount() == 0) return MetricSample::SKIPPED;
+
+        if (lineIndex < PROM_BUCKETS) {
+            // Cubo acumulado hasta el límite superior del cubo interno `last`
+            uint8_t last = lineIndex * PROM_BUCKET_STRIDE + (PROM_BUCKET_STRIDE - 1);
+            uint32_t cumulative = 0;
+            for (uint8_t b = 0; b <= last; b++) {
+                cumulative += hist.bucket(b);
+            }
+            line.begin(family.name, "_bucket");
+            seriesLabels(line, ref);
+            line.labelMsAsSeconds("le", DwellHistogram::bucketUpperBoundMs(last));
+            line.value(cumulative);
+        } else if (lineIndex == PROM_BUCKETS) {
+            line.begin(family.name, "_bucket");
+            seriesLabels(line, ref);
+            line.label("le", "+Inf");
+            line.value(hist.getCount());
+        } else if (lineIndex == PROM_BUCKETS + 1) {
+            line.begin(family.name, "_sum");
+            seriesLabels(line, ref);
+            line.valueMsAsSeconds(hist.getSumMs());
+        } else {
+            line.begin(family.name, "_count");
+            seriesLabels(line, ref);
+            line.value(hist.getCount());
+        }
+        return MetricSample::EMITTED;
+    }
+
+    MetricSample sampleServoRetries(const MetricFamily& family, uint16_t index, MetricLine& line) {
+        if (index >= NUM_SERVOS) return MetricSample::DONE;
+
+        line.begin(family.name);
+        line.label("zone", static_cast<uint32_t>(index + 1));
+        line.value(static_cast<const StateMetrics*>(family.context)->servoRetries(index));
+        return MetricSample::EMITTED;
+    }
+
+    MetricSample sampleSystemTransitions(const MetricFamily& family, uint16_t index, MetricLine& line) {
+        const uint8_t states = StateMetricsConfig::SYSTEM_STATES;
+        if (index >= states * states) return MetricSample::DONE;
+
+        uint8_t from = index / states;
+        uint8_t to = index % states;
+        uint32_t count = static_cast<const StateMetrics*>(family.context)->systemTransitions(from, to);
+        if (count == 0) return MetricSample::SKIPPED;
+
+        line.begin(family.name);
+        line.label("from", SYSTEM_STATE_NAMES[from]);
+        line.label("to", SYSTEM_STATE_NAMES[to]);
+        line.value(count);
+        return MetricSample::EMITTED;
+    }
+}
+
+StateMetrics::StateMetrics() {
+    for (uint8_t z = 0; z < NUM_SERVOS; z++) {
+        retries[z] = 0;
+    }
+    for (uint8_t i = 0; i < StateMetricsConfig::SYSTEM_STATES; i++) {
+        for (uint8_t j = 0; j < StateMetricsConfig::SYSTEM_STATES; j++) {
+            transitions[i][j] = 0;
+        }
+    }
+
+    // Las series vacías no se exportan: solo aparecen estados visitados
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    registry.add("riego_state_entries_total", "Entradas en cada estado de las máquinas de estados",
+                 MetricType::COUNTER, &sampleStateEntries, this);
+    registry.add("riego_state_dwell_seconds", "Tiempo de permanencia en cada estado",
+                 MetricType::HISTOGRAM, &sampleStateDwell, this);
+    registry.add("riego_servo_retries_total", "Reintentos por fallo de servo",
+                 MetricType::COUNTER, &sampleServoRetries, this);
+    registry.add("riego_system_transitions_total", "Transiciones entre estados del sistema",
+                 MetricType::COUNTER, &sampleSystemTransitions, this);
+}
+
+// =============================================================================
+// Notificaciones
+// =============================================================================
+
+void StateMetrics::recordIrrigationState(uint8_t state) {
+    irrigationTracker.transition(state, millis());
+}
+
+void StateMetrics::recordServoState(uint8_t zoneIndex, uint8_t state) {
+    if (zoneIndex >= NUM_SERVOS) return;
+    servoTrackers[zoneIndex].transition(state, millis());
+}
+
+void StateMetrics::recordServoRetry(uint8_t zoneIndex) {
+    if (zoneIndex >= NUM_SERVOS) return;
+    retries[zoneIndex]++;
+}
+
+void StateMetrics::recordSystemState(uint8_t state) {
+    if (state >= StateMetricsConfig::SYSTEM_STATES) return;
+
+    bool wasStarted = systemTracker.isStarted();
+    uint8_t from = systemTracker.currentState();
+    if (systemTracker.transition(state, millis()) && wasStarted) {
+        transitions[from][state]++;
+    }
+}
+
+// =============================================================================
+// Nombres de estados
+// =============================================================================
+
+const char* StateMetrics::irrigationStateName(uint8_t state) {
+    return state < StateMetricsConfig::IRRIGATION_STATES ? IRRIGATION_STATE_NAMES[state] : "UNKNOWN";
+}
+
+const char* StateMetrics::servoStateName(uint8_t state) {
+    return state < StateMetricsConfig::SERVO_STATES ? SERVO_STATE_NAMES[state] : "UNKNOWN";
+}
+
+const char* StateMetrics::systemStateName(uint8_t state) {
+    return state < StateMetricsConfig::SYSTEM_STATES ? SYSTEM_STATE_NAMES[state] : "UNKNOWN";
+}
+
+// =============================================================================
+// Exportación JSON
+// =============================================================================
+
+StateMetricsCursor StateMetricsCursor::instance;
+uint32_t StateMetricsCursor::nextToken = 0;
+
+size_t StateMetricsCursor::Chunk::write(uint8_t c) {
+    if (length >= sizeof(buffer)) {
+        return 0;
+    }
+    buffer[length++] = static_cast<char>(c);
+    return 1;
+}
+
+StateMetricsCursor* StateMetricsCursor::acquire(uint32_t& tokenOut) {
+    if (instance.inUse) {
+        return nullptr;
+    }
+
+    instance.reset();
+    instance.inUse = true;
+    if (++nextToken == 0) {
+        nextToken = 1;
+    }
+    instance.token = nextToken;
+    tokenOut = nextToken;
+    return &instance;
+}
+
+void StateMetricsCursor::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        inUse = false;
+    }
+}
+
+void StateMetricsCursor::reset() {
+    phase = Phase::HEADER;
+    zone = 0;
+    step = 0;
+    now = millis();
+    chunk.clear();
+    chunkPos = 0;
+}
+
+/**
+ * @brief Compone el siguiente bloque del documento.
+ * @return false cuando no quedan bloques
+ */
+bool StateMetricsCursor::nextChunk() {
+    const StateMetrics& metrics = StateMetrics::getInstance();
+    chunk.clear();
+    chunkPos = 0;
+
+    switch (phase) {
+        case Phase::HEADER:
+            chunk.print("{\"uptimeMs\":"); chunk.print(now);
+
+            // Límites superiores de los cubos, comunes a todos los histogramas
+            chunk.print(",\"bucketUpperBoundsMs\":[");
+            for (uint8_t i = 0; i < StateMetricsConfig::DWELL_BUCKETS; i++) {
+                if (i > 0) chunk.print(',');
+                chunk.print(DwellHistogram::bucketUpperBoundMs(i));
+            }
+            chunk.print("],\"irrigation\":{");
+            phase = Phase::IRRIGATION;
+            return true;
+
+        case Phase::IRRIGATION:
+            // Ciclo de riego
+            if (writeTrackerStep(chunk, metrics.irrigation(), &StateMetrics::irrigationStateName, step++, now)) {
+                chunk.print("},\"zones\":[");
+                phase = Phase::ZONES;
+                step = 0;
+            }
+            return true;
+
+        case Phase::ZONES:
+            // Servos por zona
+            if (step == 0) {
+                if (zone > 0) chunk.print(',');
+                chunk.print("{\"zone\":"); chunk.print(zone + 1);
+                chunk.print(",\"retries\":"); chunk.print(metrics.servoRetries(zone));
+                chunk.print(',');
+            }
+            if (writeTrackerStep(chunk, metrics.servo(zone), &StateMetrics::servoStateName, step++, now)) {
+                chunk.print('}');
+                zone++;
+                step = 0;
+                if (zone >= metrics.zoneCount()) {
+                    chunk.print("],\"system\":{");
+                    phase = Phase::SYSTEM;
+                }
+            }
+            return true;
+
+        case Phase::SYSTEM:
+            // Estado global del sistema
+            if (writeTrackerStep(chunk, metrics.system(), &StateMetrics::systemStateName, step++, now)) {
+                chunk.print(",\"transitions\":{");
+                phase = Phase::TRANSITIONS;
+                step = 0;
+            }
+            return true;
+
+        case Phase::TRANSITIONS: {
+            // Matriz de transiciones, una fila por bloque
+            uint8_t from = step++;
+            if (from > 0) chunk.print(',');
+            chunk.print('"'); chunk.print(SYSTEM_STATE_NAMES[from]); chunk.print("\":{");
+            for (uint8_t to = 0; to < StateMetricsConfig::SYSTEM_STATES; to++) {
+                if (to > 0) chunk.print(',');
+                chunk.print('"'); chunk.print(SYSTEM_STATE_NAMES[to]); chunk.print("\":");
+                chunk.print(metrics.systemTransitions(from, to));
+            }
+            chunk.print('}');
+            if (step >= StateMetricsConfig::SYSTEM_STATES) {
+                chunk.print("}}}");
+                phase = Phase::DONE;
+            }
+            return true;
+        }
+
+        case Phase::DONE:
+            break;
+    }
+    return false;
+}
+
+size_t StateMetricsCursor::fill(uint8_t* out, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        size_t available = chunk.length - chunkPos;
+        if (available > 0) {
+            size_t part = available < maxLen - written ? available : maxLen - written;
+            memcpy(out + written, chunk.buffer + chunkPos, part);
+            chunkPos += part;
+            written += part;
+            continue;
+        }
+
+        if (!nextChunk()) {
+            break;
+        }
+    }
+
+    return written;
+}
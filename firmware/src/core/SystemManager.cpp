@@ -9,19 +9,31 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <ESP.h>
+#include <sys/time.h>
+#include <time.h>
 #include "SystemManager.h"
 #include "ConfigManager.h"
 #include "Logger.h"
 #include "Utils.h"
 #include "GET_DATE.h"
-#include "SET_DATE.h"
 #include "IN_DIGITAL.h"
 #include "SET_PIN.h"
 #include "WebSocketManager.h"
+#include "MqttTelemetry.h"
+#include "EventHistory.h"
 #include "SystemConfig.h"
 #include "RTC_DS1302.h"
 #include "Led.h"
 #include "ServoPWMController.h"
+#include "StateMetrics.h"
+#include "MetricsRegistry.h"
+#include "Trace.h"
+#include "TaskDiagnostics.h"
+#include "SerialProvisioning.h"
+#include "PowerManager.h"
+
+static_assert(StateMetricsConfig::SYSTEM_STATES == 5,
+              "Actualizar StateMetricsConfig::SYSTEM_STATES al cambiar SystemState");
 
 SystemManager::SystemManager(RTC_DS1302* rtc, Led* statusLed, ServoPWMController* servoController)
     : rtc(rtc)
@@ -38,9 +50,12 @@ SystemManager::SystemManager(RTC_DS1302* rtc, Led* statusLed, ServoPWMController
 {
     initialFreeMemory = ESP.getFreeHeap();
     minimumFreeMemory = initialFreeMemory;
+    StateMetrics::getInstance().recordSystemState(static_cast<uint8_t>(currentState));
 }
 
 SystemManager::~SystemManager() {
+    MetricsRegistry::getInstance().removeContext(this);
+    
     // Asegurar parada segura del sistema
     if (servoController) {
         servoController->closeServo();
@@ -50,6 +65,40 @@ SystemManager::~SystemManager() {
 bool SystemManager::initialize() {
     LOG_INFO("Iniciando inicialización del sistema...");
     
+    // Métricas de plataforma para /metrics (disponibles aunque falle la inicialización)
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    registry.add("riego_uptime_seconds", "Segundos desde el arranque", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            return singleSample(family, index, line, millis() / 1000);
+        }, this);
+    registry.add("riego_heap_free_bytes", "Memoria heap libre", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            return singleSample(family, index, line, ESP.getFreeHeap());
+        }, this);
+    registry.add("riego_heap_min_free_bytes", "Mínimo de heap libre observado", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const SystemManager* manager = static_cast<const SystemManager*>(family.context);
+            return singleSample(family, index, line, manager->minimumFreeMemory);
+        }, this);
+    registry.add("riego_consecutive_errors", "Fallos consecutivos de la validación de salud", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const SystemManager* manager = static_cast<const SystemManager*>(family.context);
+            return singleSample(family, index, line, manager->consecutiveErrors);
+        }, this);
+    
+    // **FASE 0: RTC y hora del sistema**
+    // Antes que ConfigManager: la copia de configuración del arranque, el
+    // historial y el log llevan la marca de time()
+    if (rtc) {
+        if (!rtc->init()) {
+            LOG_ERROR("Error al inicializar RTC - Continuando en modo limitado");
+            // No cambiar a ERROR_RECOVERY, permitir funcionamiento básico
+        }
+        syncSystemClock();
+    } else {
+        LOG_ERROR("RTC no inyectado - Funcionalidad de tiempo deshabilitada");
+    }
+    
     // **FASE 1: Inicializar ConfigManager**
     ConfigManager& config = ConfigManager::getInstance();
     if (!config.initialize()) {
@@ -57,6 +106,21 @@ bool SystemManager::initialize() {
         return false;
     }
     
+    // Historial de eventos en SPIFFS (montado por ConfigManager)
+    EventHistory::getInstance().begin();
+    
+    // Log en flash: segmentos rotados del tamaño configurado
+    SystemConfig loaded;
+    config.copyConfig(loaded);
+    Logger::getInstance().setMaxFileSize(loaded.logFileSizeKB);
+    Logger::getInstance().setFileLogging(loaded.logToFile);
+    
+    // CPU por tarea y márgenes de pila
+    TaskDiagnostics::getInstance().begin();
+    
+    // Aprovisionamiento por tramas serie (y la línea AAMMDDWHHMMSS de siempre)
+    SerialProvisioning::getInstance().begin(rtc);
+    
     // **FASE 2: Validación de configuración**
     if (!SystemConfigValidator::validateAllConfiguration()) {
         LOG_ERROR("Configuración inválida - Abortando inicialización");
@@ -64,15 +128,6 @@ bool SystemManager::initialize() {
     }
     
     // **FASE 3: Inicialización de módulos de hardware (inyectados)**
-    if (rtc) {
-        if (!rtc->init()) {
-            LOG_ERROR("Error al inicializar RTC - Continuando en modo limitado");
-            // No cambiar a ERROR_RECOVERY, permitir funcionamiento básico
-        }
-    } else {
-        LOG_ERROR("RTC no inyectado - Funcionalidad de tiempo deshabilitada");
-    }
-
     if (statusLed) {
         statusLed->init(LOW);
     } else {
@@ -96,13 +151,11 @@ bool SystemManager::initialize() {
         if (rtc->getDateTime(&currentDateTime)) {
             if (!currentDateTime.isValid() || currentDateTime.year == 0) {
                 LOG_WARNING("[SystemManager] RTC tiene fecha/hora inválida - Se requiere configuración");
-                currentState = SystemState::ERROR_RECOVERY;
-                lastStateChange = millis();
+                setState(SystemState::ERROR_RECOVERY);
             }
         } else {
             LOG_ERROR("[SystemManager] No se pudo leer fecha/hora del RTC");
-            currentState = SystemState::ERROR_RECOVERY;
-            lastStateChange = millis();
+            setState(SystemState::ERROR_RECOVERY);
         }
         
         // Si todavía está detenido después de intentar iniciar, requerir configuración
@@ -110,44 +163,56 @@ bool SystemManager::initialize() {
             LOG_WARNING("[SystemManager] RTC todavía detenido - Se requiere configuración manual");
             LOG_INFO("[SystemManager] Ingrese la fecha y hora en formato: AAMMDDWHHMMSS");
             LOG_INFO("[SystemManager] Ejemplo: 2508306133200 para 30 de agosto de 2025, sábado, 13:32:00");
-            currentState = SystemState::ERROR_RECOVERY;
-            lastStateChange = millis();
+            setState(SystemState::ERROR_RECOVERY);
         }
     } else {
         LOG_ERROR("No se puede verificar el RTC porque no fue inyectado");
-        currentState = SystemState::ERROR_RECOVERY;
-        lastStateChange = millis();
+        setState(SystemState::ERROR_RECOVERY);
     }
     
     // **FASE 5: Inicialización del controlador de servos (inyectado)**
     if (servoController) {
         if (!servoController->init()) {
             LOG_ERROR("[SystemManager] Error al inicializar controlador de servos");
-            currentState = SystemState::ERROR_RECOVERY;
+            setState(SystemState::ERROR_RECOVERY);
             consecutiveErrors++;
             return false;
         }
+        // Ajustes de zona guardados (tiempos, ángulos, habilitación)
+        zoneConfigBinder.update(*servoController);
     } else {
         LOG_ERROR("Controlador de servos no inyectado - Funcionalidad de riego deshabilitada");
-        currentState = SystemState::EMERGENCY_STOP;
+        setState(SystemState::EMERGENCY_STOP);
         return false;
     }
     
     // **FASE 6: Configuración de estado inicial**
     if (currentState != SystemState::ERROR_RECOVERY) {
-        currentState = SystemState::NORMAL_OPERATION;
+        setState(SystemState::NORMAL_OPERATION);
     }
     lastStateChange = millis();
     lastMemoryCheck = millis();
     lastStatusReport = millis();
     
+    // Reposo de bajo consumo cuando no hay riego (empieza en modo ocupado)
+    PowerManager::getInstance().begin();
+    
     LOG_INFO("[SystemManager] Inicialización completada exitosamente");
     return true;
 }
 
 void SystemManager::update() {
+    TRACE_SCOPE("system.update");
     unsigned long currentTime = millis();
     
+    // El puerto serie se atiende en todos los estados (también en configuración)
+    SerialProvisioning::getInstance().update();
+    
+    // El sensor de humedad cambió durante el reposo: se difunde en esta vuelta
+    if (PowerManager::getInstance().takeSensorWake() && wsManager) {
+        wsManager->forceStatusUpdate();
+    }
+    
     // **ACTUALIZACIÓN PRINCIPAL SEGÚN ESTADO**
     switch (currentState) {
         case SystemState::INITIALIZING:
@@ -185,6 +250,8 @@ void SystemManager::update() {
     
     // **ACTUALIZACIÓN DE MÓDULOS PRINCIPALES**
     if (servoController) {
+        // Punto seguro: el programa de riego está entre dos pasos
+        zoneConfigBinder.update(*servoController);
         servoController->update();
     }
     
@@ -192,6 +259,19 @@ void SystemManager::update() {
         wsManager->update();
     }
     
+    // Telemetría MQTT (no hace nada si no se arrancó)
+    TRACE_BEGIN("mqtt.update");
+    MqttTelemetry::getInstance().update();
+    TRACE_END("mqtt.update");
+    
+    // Volcado periódico del historial de eventos a flash
+    TRACE_BEGIN("history.update");
+    EventHistory::getInstance().update();
+    TRACE_END("history.update");
+    
+    // Muestreo de tareas FreeRTOS (cada SAMPLE_INTERVAL_MS)
+    TaskDiagnostics::getInstance().update();
+    
     // Actualizar indicadores visuales
     updateStatusIndicators();
     
@@ -199,12 +279,31 @@ void SystemManager::update() {
     if (!validateSystemHealth()) {
         consecutiveErrors++;
         if (consecutiveErrors > SystemSafety::MAX_CONSECUTIVE_ERRORS) {
-            currentState = SystemState::EMERGENCY_STOP;
-            lastStateChange = currentTime;
+            setState(SystemState::EMERGENCY_STOP);
         }
     } else {
         consecutiveErrors = 0;
     }
+    
+    // **AHORRO DE ENERGÍA**: sin trabajo, el loop espera hasta el próximo plazo
+    updatePowerMode(currentTime);
+}
+
+void SystemManager::updatePowerMode(unsigned long currentTime) {
+    PowerManager& power = PowerManager::getInstance();
+    
+    // Reposo solo en operación normal, sin riego ni válvulas abiertas y sin
+    // sesión de aprovisionamiento por serie (la UART pierde bytes al despertar)
+    bool idle = currentState == SystemState::NORMAL_OPERATION &&
+                servoController != nullptr && servoController->isQuiescent() &&
+                !SerialProvisioning::getInstance().isSessionActive();
+    if (power.setIdle(idle, currentTime) && servoController) {
+        servoController->parkOutputs(power.isLowPower());
+    }
+    
+    // Plazos propios (el del LED lo anuncia updateStatusIndicators)
+    power.wakeBy(lastMemoryCheck + 30000);
+    power.wakeBy(lastStatusReport + 60000);
 }
 
 void SystemManager::handleConfigurationMode() {
@@ -216,23 +315,29 @@ void SystemManager::handleConfigurationMode() {
         LOG_INFO("\n🔧 🔧 🔧 MODO CONFIGURACIÓN ACTIVADO 🔧 🔧 🔧");
         LOG_WARNING("El sistema requiere configuración del RTC para operar");
         LOG_INFO("Opciones de configuración disponibles:");
-        LOG_INFO("  1. Por puerto serial: Ingrese fecha/hora en formato AAMMDDWHHMMSS");
+        LOG_INFO("  1. Por puerto serial: Ingrese fecha/hora en formato AAMMDDWHHMMSS (o scripts/provision.py --time)");
         LOG_INFO("  2. Por interfaz web: Acceda a http://" + WiFi.localIP().toString() + "/config");
         LOG_INFO("Ejemplo serial: 2508306141200 (30/08/2025, sábado, 14:12:00)");
         lastConfigMessage = currentTime;
     }
     
-    // Intentar configuración automática desde serial
-    if (rtc && rtc->isHalted()) {
-        SetDate setDate(rtc);
-        if (setDate.setDateFromSerial()) {
-            LOG_INFO("[SystemManager] RTC configurado desde serial - Saliendo de modo configuración");
-            currentState = SystemState::NORMAL_OPERATION;
-            lastStateChange = millis();
-        }
+    // La hora llega por serie a través de SerialProvisioning (línea o trama)
+    if (SerialProvisioning::getInstance().consumeRtcUpdate()) {
+        LOG_INFO("[SystemManager] RTC configurado desde serial - Saliendo de modo configuración");
+        setState(SystemState::NORMAL_OPERATION);
     }
 }
 
+/**
+ * @brief Único punto de cambio de estado: actualiza la marca de tiempo y
+ *        registra la transición en StateMetrics.
+ */
+void SystemManager::setState(SystemState newState) {
+    currentState = newState;
+    lastStateChange = millis();
+    StateMetrics::getInstance().recordSystemState(static_cast<uint8_t>(newState));
+}
+
 void SystemManager::handleInitializingState() {
     // Este estado ahora es transitorio y se maneja directamente en initialize()
     // Si la inicialización es exitosa, el estado pasa a NORMAL_OPERATION o ERROR_RECOVERY
@@ -255,8 +360,7 @@ void SystemManager::handleNormalOperationState() {
             // Si hay muchos errores consecutivos, entrar en modo recuperación
             if (rtcErrorCount > 5) {
                 LOG_INFO("[SystemManager] Demasiados errores RTC - Entrando en modo recuperación");
-                currentState = SystemState::ERROR_RECOVERY;
-                lastStateChange = currentTime;
+                setState(SystemState::ERROR_RECOVERY);
                 rtcErrorCount = 0;
             }
         } else {
@@ -267,7 +371,8 @@ void SystemManager::handleNormalOperationState() {
     
     // Mostrar fecha/hora cada segundo solo si RTC está funcionando
     if (currentTime - lastDatePrint >= 1000) {
-        if (rtc && !rtc->isHalted()) {
+        // Durante una sesión de aprovisionamiento el puerto solo lleva tramas
+        if (rtc && !rtc->isHalted() && !SerialProvisioning::getInstance().isSessionActive()) {
             GetDate fecha_hora(rtc);
             fecha_hora.printDate();
         }
@@ -276,16 +381,12 @@ void SystemManager::handleNormalOperationState() {
 }
 
 void SystemManager::handleErrorRecoveryState() {
-    // Verificar si hay datos disponibles en el puerto serial para configurar el RTC
-    if (rtc && rtc->isHalted()) {
-        // Intentar configuración automática del RTC
-        SetDate setDate(rtc);
-        if (setDate.setDateFromSerial()) {
-            LOG_INFO("[SystemManager] RTC configurado - Recuperación exitosa");
-            currentState = SystemState::NORMAL_OPERATION;
-            lastStateChange = millis();
-            consecutiveErrors = 0;
-        }
+    // ¿Se ha puesto en hora el RTC por el puerto serie?
+    if (SerialProvisioning::getInstance().consumeRtcUpdate()) {
+        LOG_INFO("[SystemManager] RTC configurado - Recuperación exitosa");
+        syncSystemClock();
+        setState(SystemState::NORMAL_OPERATION);
+        consecutiveErrors = 0;
     }
     
     // Intentar recuperación automática cada 10 segundos si no hay entrada serial
@@ -400,8 +501,7 @@ bool SystemManager::validateSystemHealth() {
     if (rtc && rtc->isHalted() && currentState == SystemState::NORMAL_OPERATION) {
         // En lugar de marcar como no saludable, entrar en modo configuración
         LOG_WARNING("[SystemManager] RTC detenido - Entrando en modo configuración");
-        currentState = SystemState::CONFIGURATION_MODE;
-        lastStateChange = millis();
+        setState(SystemState::CONFIGURATION_MODE);
         return true; // No incrementar errores por RTC
     }
     
@@ -442,6 +542,7 @@ void SystemManager::updateStatusIndicators() {
         statusLed->toggle();
         lastLedUpdate = currentTime;
     }
+    PowerManager::getInstance().wakeBy(lastLedUpdate + blinkInterval);
 }
 
 // **MÉTODOS PÚBLICOS DE CONTROL**
@@ -468,8 +569,7 @@ void SystemManager::stopIrrigationCycle() {
 
 void SystemManager::emergencyStop() {
     LOG_ERROR("[SystemManager] PARADA DE EMERGENCIA ACTIVADA");
-    currentState = SystemState::EMERGENCY_STOP;
-    lastStateChange = millis();
+    setState(SystemState::EMERGENCY_STOP);
     
     if (servoController) {
         servoController->closeServo();
@@ -478,8 +578,7 @@ void SystemManager::emergencyStop() {
 
 void SystemManager::resetSystem() {
     LOG_INFO("[SystemManager] Reinicio del sistema solicitado");
-    currentState = SystemState::INITIALIZING;
-    lastStateChange = millis();
+    setState(SystemState::INITIALIZING);
     consecutiveErrors = 0;
 }
 
@@ -522,6 +621,28 @@ void SystemManager::printSystemInfo() const {
     SystemConfigValidator::printConfigurationSummary();
 }
 
+void SystemManager::syncSystemClock() {
+    // time() solo lo pone el NTP: sin WiFi, las marcas del historial, del log
+    // y de las copias de configuración quedarían a 0. El DS1302 sí tiene hora
+    DateTime current;
+    if (!rtc || !rtc->getDateTime(&current) || !current.isValid() || current.year == 0) {
+        LOG_WARNING("[SystemManager] RTC sin hora válida - Hora del sistema sin ajustar");
+        return;
+    }
+    
+    struct tm timeInfo = {};
+    timeInfo.tm_year = current.year + 100;  // tm_year cuenta desde 1900
+    timeInfo.tm_mon = current.month - 1;    // tm_mon es 0-11
+    timeInfo.tm_mday = current.day;
+    timeInfo.tm_hour = current.hour;
+    timeInfo.tm_min = current.minute;
+    timeInfo.tm_sec = current.second;
+    
+    struct timeval now = { mktime(&timeInfo), 0 };
+    settimeofday(&now, nullptr);
+    LOG_INFO("[SystemManager] Hora del sistema tomada del RTC: " + current.toString());
+}
+
 // Configuración del RTC desde web
 bool SystemManager::setRTCDateTime(uint8_t year, uint8_t month, uint8_t day, uint8_t dayOfWeek, uint8_t hour, uint8_t minute, uint8_t second) {
     if (!rtc) {
@@ -541,12 +662,12 @@ bool SystemManager::setRTCDateTime(uint8_t year, uint8_t month, uint8_t day, uin
     
     if (rtc->setDateTime(newDateTime)) {
         LOG_INFO("[SystemManager] RTC configurado exitosamente desde web");
+        syncSystemClock();
         
         // Si estábamos en modo configuración, salir a operación normal
         if (currentState == SystemState::CONFIGURATION_MODE) {
             LOG_INFO("[SystemManager] Saliendo de modo configuración - Sistema operacional");
-            currentState = SystemState::NORMAL_OPERATION;
-            lastStateChange = millis();
+            setState(SystemState::NORMAL_OPERATION);
             consecutiveErrors = 0;
         }
         
@@ -0,0 +1,262 @@
+/**
+ * @file TaskDiagnostics.cpp
+ * @brief Muestreo de tareas FreeRTOS y cálculo de CPU en ventana deslizante.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * Las tareas se identifican por su handle entre muestras. Cada tarea
+ * seguida guarda en un anillo su contador de tiempo acumulado en las
+ * últimas WINDOW_SAMPLES + 1 muestras, y el anillo global guarda el tiempo
+ * total en esos mismos instantes. La CPU en la ventana es una resta de los
+ * extremos del anillo: no hace falta sumar nada muestra a muestra. Los
+ * contadores son de 32 bits en microsegundos (vuelta cada ~71 min); la resta
+ * modular da el delta correcto dentro de una ventana de 30 s.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/core/TaskDiagnostics.h"
+#include "../../include/core/MetricsRegistry.h"
+#include "utils/Logger.h"
+#include <string.h>
+
+using namespace TaskDiagnosticsConfig;
+
+namespace {
+    // Buffer de uxTaskGetSystemState(): estático para no ocupar ~1 KB de la pila del loop
+    TaskStatus_t statusBuffer[MAX_TASKS];
+}
+
+TaskDiagnostics::TaskDiagnostics()
+    : sampleCount(0), lastSampleTime(0), started(false), publishedCount(0) {
+    memset(tracked, 0, sizeof(tracked));
+    memset(totalRuntime, 0, sizeof(totalRuntime));
+    for (uint8_t c = 0; c < CORES; c++) {
+        coreLoad[c] = CPU_UNKNOWN;
+    }
+    lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+}
+
+bool TaskDiagnostics::hasRuntimeStats() {
+#if defined(configGENERATE_RUN_TIME_STATS) && configGENERATE_RUN_TIME_STATS == 1
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TaskDiagnostics::begin() {
+    if (started) {
+        return;
+    }
+    started = true;
+    registerMetrics();
+    sample();
+    lastSampleTime = millis();
+    if (!hasRuntimeStats()) {
+        LOG_INFO("[TASKS] Sin estadísticas de tiempo de ejecución: solo márgenes de pila");
+    }
+}
+
+void TaskDiagnostics::update() {
+    if (!started || millis() - lastSampleTime < SAMPLE_INTERVAL_MS) {
+        return;
+    }
+    lastSampleTime = millis();
+    sample();
+}
+
+int TaskDiagnostics::findOrAssignSlot(TaskHandle_t handle) {
+    int freeSlot = -1;
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        if (tracked[i].handle == handle) {
+            return i;
+        }
+        if (freeSlot < 0 && tracked[i].handle == nullptr) {
+            freeSlot = i;
+        }
+    }
+    if (freeSlot >= 0) {
+        memset(&tracked[freeSlot], 0, sizeof(TrackedTask));
+        tracked[freeSlot].handle = handle;
+    }
+    return freeSlot;
+}
+
+void TaskDiagnostics::sample() {
+#if defined(configUSE_TRACE_FACILITY) && configUSE_TRACE_FACILITY == 1
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(statusBuffer, MAX_TASKS, &total);
+    if (count == 0) {
+        // Devuelve 0 si hay más tareas que huecos en el buffer
+        LOG_WARNING("[TASKS] Más de " + String(MAX_TASKS) + " tareas, muestra descartada");
+        return;
+    }
+
+    uint8_t h = sampleCount % HISTORY;
+    totalRuntime[h] = total;
+    sampleCount++;
+
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        tracked[i].seen = false;
+    }
+
+    TaskSnapshot snapshot[MAX_TASKS];
+    uint8_t snapshotCount = 0;
+    uint16_t load[CORES];
+    for (uint8_t c = 0; c < CORES; c++) {
+        load[c] = CPU_UNKNOWN;
+    }
+
+    for (UBaseType_t t = 0; t < count; t++) {
+        const TaskStatus_t& status = statusBuffer[t];
+        int slot = findOrAssignSlot(status.xHandle);
+        if (slot < 0) {
+            continue;
+        }
+        TrackedTask& task = tracked[slot];
+        task.seen = true;
+        task.runtime[h] = status.ulRunTimeCounter;
+        if (task.samples < HISTORY) {
+            task.samples++;
+        }
+
+        TaskSnapshot& out = snapshot[snapshotCount++];
+        strncpy(out.name, status.pcTaskName, NAME_LENGTH - 1);
+        out.name[NAME_LENGTH - 1] = '\0';
+        out.priority = static_cast<uint8_t>(status.uxCurrentPriority);
+#if defined(configTASKLIST_INCLUDE_COREID) && configTASKLIST_INCLUDE_COREID == 1
+        out.core = status.xCoreID < CORES ? static_cast<uint8_t>(status.xCoreID) : CORE_ANY;
+#else
+        out.core = CORE_ANY;
+#endif
+        // En el ESP32 la pila se mide en bytes (StackType_t es uint8_t)
+        out.stackFreeBytes = status.usStackHighWaterMark * sizeof(StackType_t);
+
+        // Ventana: tantas muestras como lleve la tarea, hasta WINDOW_SAMPLES
+        uint8_t span = task.samples - 1;
+        out.cpuPermille = CPU_UNKNOWN;
+        if (hasRuntimeStats() && span > 0) {
+            uint8_t oldest = (sampleCount - 1 - span) % HISTORY;
+            uint32_t taskDelta = task.runtime[h] - task.runtime[oldest];
+            uint32_t totalDelta = total - totalRuntime[oldest];
+            if (totalDelta > 0) {
+                uint64_t permille = static_cast<uint64_t>(taskDelta) * 1000 / totalDelta;
+                out.cpuPermille = static_cast<uint16_t>(permille > 1000 ? 1000 : permille);
+            }
+        }
+
+        for (uint8_t c = 0; c < CORES; c++) {
+            if (status.xHandle == xTaskGetIdleTaskHandleForCPU(c)) {
+                out.core = c;
+                if (out.cpuPermille != CPU_UNKNOWN) {
+                    load[c] = 1000 - out.cpuPermille;
+                }
+            }
+        }
+
+        if (out.stackFreeBytes < STACK_WARNING_BYTES && !task.warned) {
+            task.warned = true;
+            LOG_WARNING("[TASKS] Pila casi agotada en '" + String(out.name) + "': " +
+                        String(out.stackFreeBytes) + " bytes libres");
+        }
+    }
+
+    // Las tareas que ya no existen liberan su hueco
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        if (!tracked[i].seen) {
+            tracked[i].handle = nullptr;
+        }
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memcpy(published, snapshot, snapshotCount * sizeof(TaskSnapshot));
+    publishedCount = snapshotCount;
+    memcpy(coreLoad, load, sizeof(coreLoad));
+    xSemaphoreGive(lock);
+#endif
+}
+
+uint8_t TaskDiagnostics::copyTasks(TaskSnapshot* out, uint8_t maxTasks) const {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t count = publishedCount < maxTasks ? publishedCount : maxTasks;
+    memcpy(out, published, count * sizeof(TaskSnapshot));
+    xSemaphoreGive(lock);
+    return count;
+}
+
+bool TaskDiagnostics::getTask(uint8_t index, TaskSnapshot& out) const {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool found = index < publishedCount;
+    if (found) {
+        out = published[index];
+    }
+    xSemaphoreGive(lock);
+    return found;
+}
+
+uint16_t TaskDiagnostics::getCoreLoadPermille(uint8_t core) const {
+    if (core >= CORES) {
+        return CPU_UNKNOWN;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint16_t load = coreLoad[core];
+    xSemaphoreGive(lock);
+    return load;
+}
+
+// =============================================================================
+// Métricas
+// =============================================================================
+
+void TaskDiagnostics::registerMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+
+    // Fracción de un núcleo (0.000-1.000): mismo formato de 3 decimales que los segundos
+    registry.add("riego_task_cpu_ratio", "Fracción de un núcleo usada por cada tarea (ventana de 30 s)",
+        MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const TaskDiagnostics* diagnostics = static_cast<const TaskDiagnostics*>(family.context);
+            TaskSnapshot task;
+            if (!diagnostics->getTask(index, task)) {
+                return MetricSample::DONE;
+            }
+            if (task.cpuPermille == CPU_UNKNOWN) {
+                return MetricSample::SKIPPED;
+            }
+            line.begin(family.name);
+            line.label("task", task.name);
+            line.valueMsAsSeconds(task.cpuPermille);
+            return MetricSample::EMITTED;
+        }, this);
+    registry.add("riego_task_stack_free_bytes", "Mínimo de pila libre de cada tarea desde su creación",
+        MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const TaskDiagnostics* diagnostics = static_cast<const TaskDiagnostics*>(family.context);
+            TaskSnapshot task;
+            if (!diagnostics->getTask(index, task)) {
+                return MetricSample::DONE;
+            }
+            line.begin(family.name);
+            line.label("task", task.name);
+            line.value(task.stackFreeBytes);
+            return MetricSample::EMITTED;
+        }, this);
+    registry.add("riego_core_load_ratio", "Carga de cada núcleo (1 - fracción de su tarea IDLE)",
+        MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const TaskDiagnostics* diagnostics = static_cast<const TaskDiagnostics*>(family.context);
+            if (index >= CORES) {
+                return MetricSample::DONE;
+            }
+            uint16_t load = diagnostics->getCoreLoadPermille(index);
+            if (load == CPU_UNKNOWN) {
+                return MetricSample::SKIPPED;
+            }
+            line.begin(family.name);
+            line.label("core", static_cast<uint32_t>(index));
+            line.valueMsAsSeconds(load);
+            return MetricSample::EMITTED;
+        }, this);
+}
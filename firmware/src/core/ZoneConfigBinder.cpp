@@ -0,0 +1,54 @@
+/**
+ * @file ZoneConfigBinder.cpp
+ * @brief Aplicación incremental de la configuración de zonas.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "ZoneConfigBinder.h"
+#include "ConfigManager.h"
+#include "ServoPWMController.h"
+#include "Logger.h"
+#include <string.h>
+
+ZoneConfigBinder::ZoneConfigBinder() : seenGeneration(0), hasApplied(false) {
+    memset(&applied, 0, sizeof(applied));
+}
+
+uint16_t ZoneConfigBinder::update(ServoPWMController& controller) {
+    if (!ConfigManager::getInstance().snapshotIfChanged(seenGeneration, snapshot)) {
+        return 0;
+    }
+
+    ConfigFingerprint current = ConfigCodec::fingerprint(snapshot, seenGeneration);
+    uint16_t changed = hasApplied ? current.changedSections(applied) : 0xFFFF;
+
+    uint16_t appliedZones = 0;
+    uint8_t zoneCount = controller.getZoneCount() < MAX_ZONES ? controller.getZoneCount() : MAX_ZONES;
+    for (uint8_t i = 0; i < zoneCount; i++) {
+        uint8_t section = static_cast<uint8_t>(ConfigSection::ZONE_FIRST) + i;
+        if (!(changed & (1u << section))) {
+            continue;
+        }
+
+        const ZoneConfig& zone = snapshot.zones[i];
+        if (controller.applyZoneSettings(i + 1, zone.enabled, zone.irrigationTimeSec,
+                                         zone.servoOpenAngle, zone.transitionTimeMs)) {
+            appliedZones |= static_cast<uint16_t>(1u << i);
+        } else {
+            // Se queda la huella antigua: se reintenta con la próxima generación
+            current.sections[section] = applied.sections[section];
+        }
+    }
+
+    applied = current;
+    hasApplied = true;
+
+    if (appliedZones) {
+        LOG_INFO("[CONFIG] Zonas aplicadas en caliente (generación " + String(seenGeneration) +
+                 "): máscara 0x" + String(appliedZones, HEX));
+    }
+    return appliedZones;
+}
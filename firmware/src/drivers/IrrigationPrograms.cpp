@@ -0,0 +1,476 @@
+/**
+ * @file IrrigationPrograms.cpp
+ * @brief Implementación de los programas de riego basados en protohilos.
+ *
+ * RECORDATORIO: dentro de run() las variables locales no sobreviven a un
+ * PT_SLEEP_MS/PT_YIELD. Todo lo que deba recordarse entre pasos es miembro
+ * del programa, y los bloques con variables locales van entre llaves para
+ * no cruzar ninguna etiqueta de reanudación.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include "../../include/drivers/IrrigationPrograms.h"
+#include "../../include/drivers/ServoPWMController.h"
+#include "../../include/drivers/ServoCurrentMonitor.h"
+#include "../../include/core/EventHistory.h"
+
+// =============================================================================
+// SequentialCycleProgram
+// =============================================================================
+
+PtStatus SequentialCycleProgram::run(ServoPWMController& ctl) {
+    PT_BEGIN(pt);
+
+    do {
+        // --- Inicialización: todas las válvulas cerradas antes de empezar
+        ctl.enterState(IrrigationState::INITIALIZING);
+        ctl.setMainValve(false);
+
+        valvesMoved = ctl.closeAllZoneValves();
+        if (valvesMoved) {
+            PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+        }
+
+        zone = ctl.findNextEnabledZone(0);
+        valveAlreadyOpen = false;
+
+        while (zone < ctl.totalZones) {
+            ctl.currentZone = zone;
+
+            // --- Apertura (se omite si la zona llegó abierta por un traspaso)
+            if (!valveAlreadyOpen) {
+                Serial.println("[INFO] Iniciando riego de zona " + String(zone + 1) +
+                              " (" + String(ctl.zones[zone].config.name) + ")");
+                ctl.enterState(IrrigationState::OPENING_VALVE);
+
+                // Reintentar mientras el movimiento falle o la firma de
+                // corriente indique que la válvula no llegó a abrirse
+                for (;;) {
+                    if (ctl.moveServoToAngle(zone, ctl.zones[zone].config.openAngle)) {
+                        PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+                        if (ctl.isServoInPosition(zone)) {
+                            break;
+                        }
+                    }
+                    if (!ctl.handleServoError(zone, "Fallo en apertura de válvula")) {
+                        PT_EXIT(pt);
+                    }
+                    if (!ctl.enabledZones.test(zone)) {
+                        break;
+                    }
+                    PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+                }
+
+                // Zona deshabilitada por fallos repetidos: pasar a la siguiente
+                if (!ctl.enabledZones.test(zone)) {
+                    zone = ctl.findNextEnabledZone(zone + 1);
+                    continue;
+                }
+
+                ctl.setServoState(zone, ServoState::OPEN);
+                ctl.zones[zone].lastActionTime = millis();
+                ctl.zones[zone].retryCount = 0;
+
+                Serial.println("[INFO] Válvula de zona " + String(zone + 1) + " abierta. Iniciando riego...");
+
+                // Con la válvula de zona ya abierta, habilitar el suministro principal
+                ctl.setMainValve(true);
+            }
+            valveAlreadyOpen = false;
+
+            // --- Riego: el tiempo objetivo se relee en cada paso para
+            // respetar cambios de configuración en caliente (deshabilitar
+            // la zona lo termina)
+            ctl.enterState(IrrigationState::IRRIGATING);
+            while (ctl.enabledZones.test(zone) &&
+                   ctl.stateElapsedMs() / 1000 < ctl.zones[zone].config.irrigationTime) {
+                ctl.zones[zone].totalIrrigationTime = ctl.stateElapsedMs() / 1000;
+                PT_YIELD(pt);
+            }
+
+            ctl.zones[zone].totalIrrigationTime = ctl.stateElapsedMs() / 1000;
+            ctl.totalWateringTime += ctl.zones[zone].totalIrrigationTime;
+            Serial.println("[INFO] Riego de zona " + String(zone + 1) + " completado. Tiempo: " +
+                          String(ctl.zones[zone].totalIrrigationTime) + "s");
+            EventHistory::getInstance().record(HistoryEvent::ZONE_WATERED, zone + 1,
+                                               ctl.zones[zone].totalIrrigationTime);
+
+            nextZone = ctl.findNextEnabledZone(zone + 1);
+
+            // --- Traspaso solapado: la siguiente zona abre mientras esta cierra.
+            // La saliente sigue OPEN hasta que empieza a cerrar (mitad de la rampa)
+            if (ctl.overlappedHandoff && nextZone < ctl.totalZones) {
+                ctl.handoffFromZone = zone;
+                ctl.currentZone = nextZone;
+                ctl.setServoState(nextZone, ServoState::OPENING);
+                ctl.zones[nextZone].lastActionTime = millis();
+                ServoCurrentMonitor::getInstance().armMove(nextZone);
+                ctl.enterState(IrrigationState::HANDOFF);
+                lastRampWrite = 0;
+                stalledZone = ctl.totalZones;
+
+                Serial.println("[INFO] Traspaso solapado de zona " + String(zone + 1) +
+                              " a zona " + String(nextZone + 1) + "...");
+
+                while (!stepHandoffRamp(ctl)) {
+                    stalledZone = findHandoffStall(ctl);
+                    if (stalledZone < ctl.totalZones) {
+                        break;
+                    }
+                    PT_YIELD(pt);
+                }
+
+                if (stalledZone >= ctl.totalZones) {
+                    zone = nextZone;
+                    valveAlreadyOpen = true;
+                    continue;
+                }
+
+                // Sobrecorriente en el solapamiento: se abandona la rampa. La
+                // entrante vuelve a cerrada (se abrirá sola, con sus reintentos)
+                // y la saliente se cierra por el camino normal
+                if (!ctl.handleServoError(stalledZone, "Sobrecorriente durante el traspaso")) {
+                    PT_EXIT(pt);
+                }
+                if (stalledZone != nextZone) {
+                    ctl.moveServoToAngle(nextZone, SERVO_CLOSED_ANGLE);
+                }
+                ctl.currentZone = zone;
+            }
+
+            // --- Cierre: la válvula principal se cierra antes que la de zona
+            ctl.setMainValve(false);
+            ctl.enterState(IrrigationState::CLOSING_VALVE);
+            ctl.moveServoToAngle(zone, SERVO_CLOSED_ANGLE);
+            PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+
+            // handleServoError vuelve a llevar el servo a cerrado
+            if (!ctl.isServoInPosition(zone) &&
+                !ctl.handleServoError(zone, "Fallo en cierre de válvula")) {
+                PT_EXIT(pt);
+            }
+
+            ctl.setServoState(zone, ServoState::CLOSED);
+            ctl.zones[zone].lastActionTime = millis();
+            Serial.println("[INFO] Válvula de zona " + String(zone + 1) + " cerrada correctamente.");
+
+            // --- Pausa de estabilización antes de la siguiente zona
+            if (nextZone < ctl.totalZones) {
+                ctl.currentZone = nextZone;
+                ctl.enterState(IrrigationState::TRANSITIONING);
+                Serial.println("[INFO] Transicionando a zona " + String(nextZone + 1) + "...");
+
+                PT_SLEEP_MS(pt, ctl.zones[zone].transitionTimeMs);
+                Serial.println("[INFO] Transición completada. Iniciando riego de zona " + String(nextZone + 1));
+            }
+
+            zone = nextZone;
+        }
+
+        // --- Ciclo completado
+        ctl.totalCyclesCompleted++;
+        ctl.enterState(IrrigationState::COMPLETED);
+        EventHistory::getInstance().record(HistoryEvent::CYCLE_COMPLETED, 0, ctl.totalCyclesCompleted);
+        Serial.println("[ÉXITO] Ciclo de riego completado. Ciclos totales: " + String(ctl.totalCyclesCompleted));
+
+        if (ctl.autoCycle) {
+            PT_SLEEP_MS(pt, CYCLE_RESTART_DELAY_SECONDS * 1000UL);
+            if (ctl.autoCycle) {
+                Serial.println("[INFO] Reiniciando ciclo automático...");
+            }
+        }
+    } while (ctl.autoCycle);
+
+    ctl.enterState(IrrigationState::IDLE);
+    Serial.println("[INFO] Sistema en estado idle. Listo para nuevo ciclo.");
+
+    PT_END(pt);
+}
+
+/**
+ * @brief Rampa del traspaso solapado.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * Ambas válvulas se mueven a la vez durante HANDOFF_RAMP_TIME_MS:
+ * - La válvula entrante se abre linealmente durante toda la rampa
+ * - La válvula saliente permanece abierta (OPEN) hasta la mitad y luego se
+ *   cierra (CLOSING desde ese momento)
+ *
+ * Así la apertura combinada nunca baja de una válvula completa: la bomba
+ * nunca trabaja contra un circuito cerrado y desaparecen el tiempo muerto
+ * y el pico de presión de cada transición. La válvula principal permanece
+ * abierta durante todo el traspaso.
+ */
+bool SequentialCycleProgram::stepHandoffRamp(ServoPWMController& ctl) {
+    unsigned long now = millis();
+    uint32_t elapsed = ctl.stateElapsedMs();
+    uint8_t from = ctl.handoffFromZone;
+    uint8_t to = ctl.currentZone;
+
+    if (elapsed >= HANDOFF_RAMP_TIME_MS) {
+        // Fin de la rampa: posiciones finales y estados definitivos
+        ctl.writeServoAngle(from, SERVO_CLOSED_ANGLE);
+        ctl.writeServoAngle(to, ctl.zones[to].config.openAngle);
+
+        ctl.setServoState(from, ServoState::CLOSED);
+        ctl.zones[from].lastActionTime = now;
+        ctl.setServoState(to, ServoState::OPEN);
+        ctl.zones[to].lastActionTime = now;
+
+        Serial.println("[INFO] Traspaso completado. Zona " + String(from + 1) +
+                      " cerrada, regando zona " + String(to + 1));
+        return true;
+    }
+
+    // Limitar la frecuencia de escritura al periférico LEDC
+    if (lastRampWrite != 0 && now - lastRampWrite < HANDOFF_RAMP_STEP_MS) {
+        return false;
+    }
+    lastRampWrite = now;
+
+    // Zona entrante: apertura lineal durante toda la rampa
+    uint8_t incomingOpen = ctl.zones[to].config.openAngle;
+    uint8_t incomingAngle = SERVO_CLOSED_ANGLE +
+        (uint32_t)(incomingOpen - SERVO_CLOSED_ANGLE) * elapsed / HANDOFF_RAMP_TIME_MS;
+
+    // Zona saliente: abierta hasta la mitad de la rampa, luego cierre lineal
+    uint8_t outgoingOpen = ctl.zones[from].config.openAngle;
+    const uint32_t halfRamp = HANDOFF_RAMP_TIME_MS / 2;
+    uint8_t outgoingAngle = outgoingOpen;
+    if (elapsed >= halfRamp) {
+        // Empieza a cerrar: desde aquí es CLOSING y se vigila su corriente
+        if (ctl.zones[from].currentState == ServoState::OPEN) {
+            ctl.setServoState(from, ServoState::CLOSING);
+            ctl.zones[from].lastActionTime = now;
+            ServoCurrentMonitor::getInstance().armMove(from);
+        }
+        outgoingAngle = outgoingOpen -
+            (uint32_t)(outgoingOpen - SERVO_CLOSED_ANGLE) * (elapsed - halfRamp) / halfRamp;
+    }
+
+    ctl.writeServoAngle(to, incomingAngle);
+    ctl.writeServoAngle(from, outgoingAngle);
+    return false;
+}
+
+uint8_t SequentialCycleProgram::findHandoffStall(ServoPWMController& ctl) const {
+    if (!ENABLE_POSITION_FEEDBACK) {
+        return ctl.totalZones;
+    }
+
+    // Solo cuentan las ventanas abiertas en este traspaso: la saliente no
+    // tiene una hasta que empieza a cerrar
+    ServoCurrentMonitor& monitor = ServoCurrentMonitor::getInstance();
+    uint8_t to = ctl.currentZone;
+    uint8_t from = ctl.handoffFromZone;
+    if (monitor.getVerdict(to) == MoveVerdict::STALL) {
+        return to;
+    }
+    if (ctl.zones[from].currentState == ServoState::CLOSING &&
+        monitor.getVerdict(from) == MoveVerdict::STALL) {
+        return from;
+    }
+    return ctl.totalZones;
+}
+
+// =============================================================================
+// SoakCycleProgram
+// =============================================================================
+
+PtStatus SoakCycleProgram::run(ServoPWMController& ctl) {
+    PT_BEGIN(pt);
+
+    do {
+        // --- Inicialización: válvulas cerradas y reparto de pulsos
+        ctl.enterState(IrrigationState::INITIALIZING);
+        ctl.setMainValve(false);
+
+        valvesMoved = ctl.closeAllZoneValves();
+        if (valvesMoved) {
+            PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+        }
+
+        planPulses(ctl);
+
+        for (;;) {
+            zone = selectZone(ctl);
+
+            // --- Ninguna zona lista: esperar al final del remojo más próximo
+            if (zone >= ctl.totalZones) {
+                if (soakWaitMs == 0) {
+                    break; // Todas las zonas completaron sus pulsos
+                }
+
+                ctl.enterState(IrrigationState::TRANSITIONING);
+                Serial.println("[INFO] Remojo en curso. Próxima zona lista en " +
+                              String(soakWaitMs / 1000) + "s");
+                PT_SLEEP_MS(pt, soakWaitMs);
+                continue;
+            }
+
+            // --- Apertura del pulso
+            ctl.currentZone = zone;
+            pulseStart = millis();
+            soakedSec = ctl.zones[zone].pulsesCompleted > 0
+                ? (pulseStart - ctl.zones[zone].lastPulseEnd) / 1000 : 0;
+
+            Serial.println("[INFO] Pulso " + String(ctl.zones[zone].pulsesCompleted + 1) + "/" +
+                          String(ctl.zones[zone].pulsesPlanned) + " de zona " + String(zone + 1) +
+                          " (" + String(ctl.zones[zone].config.name) + ")");
+            ctl.enterState(IrrigationState::OPENING_VALVE);
+
+            if (!ctl.moveServoToAngle(zone, ctl.zones[zone].config.openAngle)) {
+                // Tras agotar los reintentos la zona queda deshabilitada y
+                // selectZone() deja de elegirla
+                if (!ctl.handleServoError(zone, "Fallo en apertura de válvula")) {
+                    PT_EXIT(pt);
+                }
+                PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+                continue;
+            }
+
+            PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+            if (!ctl.isServoInPosition(zone)) {
+                if (!ctl.handleServoError(zone, "Fallo en apertura de válvula")) {
+                    PT_EXIT(pt);
+                }
+                PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+                continue;
+            }
+
+            ctl.setServoState(zone, ServoState::OPEN);
+            ctl.zones[zone].lastActionTime = millis();
+            ctl.zones[zone].retryCount = 0;
+            ctl.setMainValve(true);
+
+            // --- Riego del pulso (el último absorbe el resto de la división)
+            {
+                const ZoneInfo& info = ctl.zones[zone];
+                uint32_t base = info.config.irrigationTime / info.pulsesPlanned;
+                ctl.zones[zone].pulseDuration = (info.pulsesCompleted + 1 == info.pulsesPlanned)
+                    ? info.config.irrigationTime - base * (info.pulsesPlanned - 1)
+                    : base;
+            }
+            wateredBefore = ctl.zones[zone].totalIrrigationTime;
+
+            ctl.enterState(IrrigationState::IRRIGATING);
+            while (ctl.enabledZones.test(zone) && ctl.stateElapsedMs() / 1000 < ctl.zones[zone].pulseDuration) {
+                ctl.zones[zone].totalIrrigationTime = wateredBefore + ctl.stateElapsedMs() / 1000;
+                PT_YIELD(pt);
+            }
+            ctl.zones[zone].totalIrrigationTime = wateredBefore + ctl.stateElapsedMs() / 1000;
+            ctl.totalWateringTime += ctl.zones[zone].totalIrrigationTime - wateredBefore;
+
+            // --- Cierre: la válvula principal se cierra antes que la de zona
+            ctl.setMainValve(false);
+            ctl.enterState(IrrigationState::CLOSING_VALVE);
+            ctl.moveServoToAngle(zone, SERVO_CLOSED_ANGLE);
+            PT_SLEEP_MS(pt, SERVO_MOVEMENT_TIME_MS);
+
+            // handleServoError vuelve a llevar el servo a cerrado
+            if (!ctl.isServoInPosition(zone) &&
+                !ctl.handleServoError(zone, "Fallo en cierre de válvula")) {
+                PT_EXIT(pt);
+            }
+
+            ctl.setServoState(zone, ServoState::CLOSED);
+            ctl.zones[zone].lastActionTime = millis();
+            ctl.zones[zone].pulsesCompleted++;
+            ctl.zones[zone].lastPulseEnd = millis();
+
+            ctl.recordPulse(zone, pulseStart,
+                            ctl.zones[zone].totalIrrigationTime - wateredBefore, soakedSec);
+        }
+
+        // --- Ciclo completado
+        ctl.totalCyclesCompleted++;
+        ctl.enterState(IrrigationState::COMPLETED);
+        EventHistory::getInstance().record(HistoryEvent::CYCLE_COMPLETED, 0, ctl.totalCyclesCompleted);
+        Serial.println("[ÉXITO] Ciclo de riego con remojo completado. Ciclos totales: " +
+                      String(ctl.totalCyclesCompleted));
+
+        if (ctl.autoCycle) {
+            PT_SLEEP_MS(pt, CYCLE_RESTART_DELAY_SECONDS * 1000UL);
+            if (ctl.autoCycle) {
+                Serial.println("[INFO] Reiniciando ciclo automático...");
+            }
+        }
+    } while (ctl.autoCycle);
+
+    ctl.enterState(IrrigationState::IDLE);
+    Serial.println("[INFO] Sistema en estado idle. Listo para nuevo ciclo.");
+
+    PT_END(pt);
+}
+
+void SoakCycleProgram::planPulses(ServoPWMController& ctl) {
+    for (uint8_t i = 0; i < ctl.totalZones; i++) {
+        ZoneInfo& info = ctl.zones[i];
+
+        // Menos pulsos si el tiempo de la zona no alcanza el pulso mínimo
+        uint32_t maxPulses = info.config.irrigationTime / SOAK_MIN_PULSE_SECONDS;
+        uint8_t pulses = ctl.soakPulses;
+        if (maxPulses < pulses) {
+            pulses = maxPulses > 0 ? (uint8_t)maxPulses : 1;
+        }
+
+        info.pulsesPlanned = ctl.enabledZones.test(i) ? pulses : 0;
+        info.pulsesCompleted = 0;
+        info.pulseDuration = 0;
+        info.lastPulseEnd = 0;
+        info.totalIrrigationTime = 0;
+    }
+}
+
+uint8_t SoakCycleProgram::selectZone(ServoPWMController& ctl) {
+    const uint32_t soakMs = ctl.soakIntervalSec * 1000UL;
+    unsigned long now = millis();
+
+    uint8_t best = ctl.totalZones;
+    soakWaitMs = 0;
+
+    // Solo se visitan las zonas habilitadas
+    for (uint8_t i = ctl.findNextEnabledZone(0); i < ctl.totalZones; i = ctl.findNextEnabledZone(i + 1)) {
+        const ZoneInfo& info = ctl.zones[i];
+        if (info.pulsesCompleted >= info.pulsesPlanned) {
+            continue;
+        }
+
+        // Zona pendiente pero aún en remojo: recordar cuánto le falta
+        uint32_t soaked = now - info.lastPulseEnd;
+        if (info.pulsesCompleted > 0 && soaked < soakMs) {
+            uint32_t remaining = soakMs - soaked;
+            if (soakWaitMs == 0 || remaining < soakWaitMs) {
+                soakWaitMs = remaining;
+            }
+            continue;
+        }
+
+        // Entre las zonas listas, la que menos pulsos lleva (turno rotativo)
+        if (best == ctl.totalZones || info.pulsesCompleted < ctl.zones[best].pulsesCompleted) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// =============================================================================
+// TimedZoneProgram
+// =============================================================================
+
+PtStatus TimedZoneProgram::run(ServoPWMController& ctl) {
+    PT_BEGIN(pt);
+
+    PT_SLEEP_MS(pt, durationSec * 1000UL);
+
+    Serial.println("[INFO] Cierre automático de zona " + String(zoneIndex + 1) +
+                  " tras " + String(durationSec) + " segundos.");
+    ctl.closeZoneValve(zoneIndex + 1);
+
+    PT_END(pt);
+}
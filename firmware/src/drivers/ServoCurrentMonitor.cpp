@@ -0,0 +1,387 @@
+/**
+ * @file ServoCurrentMonitor.cpp
+ * @brief Implementación del sensado de corriente y del detector de firmas.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "ServoCurrentMonitor.h"
+#include <Wire.h>
+
+namespace {
+    constexpr uint8_t CHANNEL_COUNT = sizeof(SERVO_CURRENT_CHANNELS) / sizeof(SERVO_CURRENT_CHANNELS[0]);
+    constexpr uint16_t WINDOW_SAMPLES = SERVO_CURRENT_WINDOW_MS / SERVO_CURRENT_SAMPLE_INTERVAL_MS;
+    constexpr uint16_t STALL_SAMPLES = SERVO_CURRENT_STALL_MIN_MS / SERVO_CURRENT_SAMPLE_INTERVAL_MS;
+
+    // Registro de tensión de shunt del INA219 (LSB = 10 µV)
+    constexpr uint8_t INA219_REG_SHUNT_VOLTAGE = 0x01;
+    constexpr int32_t INA219_SHUNT_LSB_MICROVOLTS = 10;
+
+    static_assert(WINDOW_SAMPLES > 0, "SERVO_CURRENT_WINDOW_MS debe ser mayor que el periodo de muestreo");
+    static_assert(SERVO_CURRENT_WINDOW_MS < SERVO_MOVEMENT_TIME_MS,
+                  "La ventana de corriente debe cerrarse antes de comprobar la posición");
+    static_assert(SERVO_CURRENT_AVG_SAMPLES > 0, "La media móvil necesita al menos una muestra");
+
+    uint16_t clampMilliamps(uint32_t milliamps) {
+        return milliamps > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(milliamps);
+    }
+}
+
+// =============================================================================
+// AdcShuntCurrentSource
+// =============================================================================
+
+bool AdcShuntCurrentSource::begin() {
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        pinMode(SERVO_CURRENT_CHANNELS[i], INPUT);
+    }
+    return true;
+}
+
+bool AdcShuntCurrentSource::readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) {
+    if (zoneIndex >= CHANNEL_COUNT) return false;
+
+    // analogReadMilliVolts aplica la calibración de fábrica del ADC
+    uint32_t millivolts = analogReadMilliVolts(SERVO_CURRENT_CHANNELS[zoneIndex]);
+
+    // I = V / (R * G); con mV y mΩ: mA = mV * 1000 / (mΩ * G)
+    milliamps = clampMilliamps(millivolts * 1000UL / (SERVO_SHUNT_MILLIOHMS * SERVO_SHUNT_GAIN));
+    return true;
+}
+
+// =============================================================================
+// Ina219CurrentSource
+// =============================================================================
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * El INA219 conserva el último registro seleccionado. Dejando el puntero en
+ * el registro de shunt aquí, cada lectura posterior es una sola transacción
+ * de 2 bytes, sin volver a escribir la dirección del registro.
+ */
+bool Ina219CurrentSource::begin() {
+    Wire.begin();
+
+    uint8_t found = 0;
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        Wire.beginTransmission(SERVO_CURRENT_CHANNELS[i]);
+        Wire.write(INA219_REG_SHUNT_VOLTAGE);
+        if (Wire.endTransmission() == 0) {
+            found++;
+        } else {
+            Serial.println("[WARNING] INA219 no responde en 0x" + String(SERVO_CURRENT_CHANNELS[i], HEX) +
+                          " (zona " + String(i + 1) + ")");
+        }
+    }
+
+    return found > 0;
+}
+
+bool Ina219CurrentSource::readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) {
+    if (zoneIndex >= CHANNEL_COUNT) return false;
+
+    uint8_t address = SERVO_CURRENT_CHANNELS[zoneIndex];
+    if (Wire.requestFrom(address, static_cast<uint8_t>(2)) != 2) {
+        return false;
+    }
+
+    int16_t raw = static_cast<int16_t>((Wire.read() << 8) | Wire.read());
+    int32_t microvolts = static_cast<int32_t>(raw) * INA219_SHUNT_LSB_MICROVOLTS;
+    if (microvolts < 0) microvolts = -microvolts;  // Shunt montado al revés
+
+    // µV / mΩ = mA
+    milliamps = clampMilliamps(static_cast<uint32_t>(microvolts) / SERVO_SHUNT_MILLIOHMS);
+    return true;
+}
+
+// =============================================================================
+// TraceCurrentSource
+// =============================================================================
+
+TraceCurrentSource::TraceCurrentSource() {
+    for (uint8_t i = 0; i < MAX_TRACES; i++) {
+        traces[i] = nullptr;
+        lengths[i] = 0;
+        positions[i] = 0;
+    }
+}
+
+void TraceCurrentSource::setTrace(uint8_t zoneIndex, const uint16_t* samples, uint16_t length) {
+    if (zoneIndex >= MAX_TRACES) return;
+    traces[zoneIndex] = samples;
+    lengths[zoneIndex] = length;
+    positions[zoneIndex] = 0;
+}
+
+void TraceCurrentSource::onMoveStarted(uint8_t zoneIndex) {
+    if (zoneIndex < MAX_TRACES) {
+        positions[zoneIndex] = 0;
+    }
+}
+
+bool TraceCurrentSource::readMilliamps(uint8_t zoneIndex, uint16_t& milliamps) {
+    if (zoneIndex >= MAX_TRACES || traces[zoneIndex] == nullptr || lengths[zoneIndex] == 0) {
+        return false;
+    }
+
+    uint16_t position = positions[zoneIndex];
+    milliamps = traces[zoneIndex][position < lengths[zoneIndex] ? position : lengths[zoneIndex] - 1];
+    if (position < lengths[zoneIndex]) {
+        positions[zoneIndex] = position + 1;
+    }
+    return true;
+}
+
+// =============================================================================
+// CurrentSignatureDetector
+// =============================================================================
+
+CurrentSignatureDetector::CurrentSignatureDetector() {
+    start(WINDOW_SAMPLES);
+    result = MoveVerdict::IDLE;
+}
+
+void CurrentSignatureDetector::start(uint16_t samples) {
+    ringSum = 0;
+    ringHead = 0;
+    ringFilled = 0;
+    samplesSeen = 0;
+    windowSamples = samples > 0 ? samples : 1;
+    stallSamples = 0;
+    peakAvg = 0;
+    lastAvg = 0;
+    result = MoveVerdict::PENDING;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * La media móvil se mantiene con una suma acumulada: se resta la muestra que
+ * sale del anillo y se suma la que entra, así cada muestra cuesta O(1) sea
+ * cual sea el tamaño de la ventana. El bloqueo se decide en cuanto la media
+ * supera SERVO_CURRENT_STALL_MA durante SERVO_CURRENT_STALL_MIN_MS, sin
+ * esperar al final de la ventana.
+ */
+bool CurrentSignatureDetector::addSample(uint16_t milliamps) {
+    if (result != MoveVerdict::PENDING) {
+        return true;
+    }
+
+    if (ringFilled == SERVO_CURRENT_AVG_SAMPLES) {
+        ringSum -= ring[ringHead];
+    } else {
+        ringFilled++;
+    }
+    ring[ringHead] = milliamps;
+    ringSum += milliamps;
+    ringHead = (ringHead + 1) % SERVO_CURRENT_AVG_SAMPLES;
+
+    lastAvg = static_cast<uint16_t>(ringSum / ringFilled);
+    if (lastAvg > peakAvg) {
+        peakAvg = lastAvg;
+    }
+
+    stallSamples = lastAvg >= SERVO_CURRENT_STALL_MA ? stallSamples + 1 : 0;
+    samplesSeen++;
+
+    if (stallSamples >= STALL_SAMPLES) {
+        result = MoveVerdict::STALL;
+        return true;
+    }
+
+    if (samplesSeen >= windowSamples) {
+        result = finish();
+        return true;
+    }
+
+    return false;
+}
+
+MoveVerdict CurrentSignatureDetector::finish() {
+    if (peakAvg < SERVO_CURRENT_NO_LOAD_MAX_MA) {
+        return MoveVerdict::NO_LOAD;
+    }
+    if (lastAvg > SERVO_CURRENT_HOLD_MAX_MA) {
+        return MoveVerdict::JAMMED;
+    }
+    return MoveVerdict::OK;
+}
+
+MoveVerdict CurrentSignatureDetector::classify(const uint16_t* samples, uint16_t length) {
+    CurrentSignatureDetector detector;
+    detector.start(length);
+    for (uint16_t i = 0; i < length; i++) {
+        if (detector.addSample(samples[i])) break;
+    }
+    return detector.verdict();
+}
+
+// =============================================================================
+// ServoCurrentMonitor
+// =============================================================================
+
+ServoCurrentMonitor::ServoCurrentMonitor()
+    : source(nullptr)
+    , timer(nullptr)
+    , timerRunning(false)
+    , lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    for (uint8_t i = 0; i < MAX_CHANNELS; i++) {
+        windows[i].armed = false;
+        windows[i].generation = 0;
+        windows[i].verdict = MoveVerdict::IDLE;
+        windows[i].peakMilliamps = 0;
+    }
+}
+
+bool ServoCurrentMonitor::begin() {
+    if (timer != nullptr) {
+        return isEnabled();
+    }
+
+    if (source == nullptr) {
+        switch (SERVO_CURRENT_SENSE) {
+            case CurrentSenseType::ADC_SHUNT: source = &adcSource; break;
+            case CurrentSenseType::INA219:    source = &inaSource; break;
+            case CurrentSenseType::NONE:      return false;
+        }
+    }
+
+    if (!source->begin()) {
+        Serial.println("[ERROR] No se pudo inicializar el sensado de corriente de servos.");
+        source = nullptr;
+        return false;
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = &ServoCurrentMonitor::onSampleTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "servo_current";
+
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        Serial.println("[ERROR] No se pudo crear el temporizador de muestreo de corriente.");
+        timer = nullptr;
+        return false;
+    }
+
+    Serial.println("[INFO] Sensado de corriente de servos activo (" + String(CHANNEL_COUNT) + " canales).");
+    return true;
+}
+
+void ServoCurrentMonitor::setSource(CurrentSource* newSource) {
+    portENTER_CRITICAL(&lock);
+    source = newSource;
+    portEXIT_CRITICAL(&lock);
+}
+
+void ServoCurrentMonitor::armMove(uint8_t zoneIndex) {
+    if (!isEnabled() || zoneIndex >= MAX_CHANNELS) {
+        return;
+    }
+
+    source->onMoveStarted(zoneIndex);
+
+    portENTER_CRITICAL(&lock);
+    ZoneWindow& window = windows[zoneIndex];
+    window.detector.start(WINDOW_SAMPLES);
+    window.generation++;
+    window.verdict = MoveVerdict::PENDING;
+    window.armed = true;
+    bool startTimer = !timerRunning;
+    timerRunning = true;
+    portEXIT_CRITICAL(&lock);
+
+    if (startTimer) {
+        esp_timer_start_once(timer, SERVO_CURRENT_SAMPLE_INTERVAL_MS * 1000ULL);
+    }
+}
+
+MoveVerdict ServoCurrentMonitor::getVerdict(uint8_t zoneIndex) const {
+    if (zoneIndex >= MAX_CHANNELS) {
+        return MoveVerdict::IDLE;
+    }
+    return windows[zoneIndex].verdict;
+}
+
+uint16_t ServoCurrentMonitor::getPeakMilliamps(uint8_t zoneIndex) const {
+    if (zoneIndex >= MAX_CHANNELS) {
+        return 0;
+    }
+    portENTER_CRITICAL(&lock);
+    uint16_t peak = windows[zoneIndex].peakMilliamps;
+    portEXIT_CRITICAL(&lock);
+    return peak;
+}
+
+void ServoCurrentMonitor::onSampleTimer(void* arg) {
+    static_cast<ServoCurrentMonitor*>(arg)->sampleArmedZones();
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * El temporizador es de un solo disparo y se rearma mientras quede alguna
+ * ventana abierta. Cuando todas se cierran deja de ejecutarse: sin
+ * movimientos en curso el muestreo no consume CPU.
+ *
+ * La lectura del sensor (ADC o I2C) se hace fuera de la sección crítica; el
+ * número de generación descarta la muestra si la zona se rearmó mientras
+ * tanto.
+ */
+void ServoCurrentMonitor::sampleArmedZones() {
+    for (uint8_t i = 0; i < MAX_CHANNELS; i++) {
+        ZoneWindow& window = windows[i];
+
+        portENTER_CRITICAL(&lock);
+        bool armed = window.armed;
+        uint8_t generation = window.generation;
+        portEXIT_CRITICAL(&lock);
+
+        if (!armed) continue;
+
+        uint16_t milliamps = 0;
+        bool readOk = source != nullptr && source->readMilliamps(i, milliamps);
+
+        portENTER_CRITICAL(&lock);
+        if (window.armed && window.generation == generation) {
+            if (!readOk) {
+                // Sin lectura no hay veredicto: la zona queda sin datos
+                window.verdict = MoveVerdict::IDLE;
+                window.armed = false;
+            } else if (window.detector.addSample(milliamps)) {
+                window.verdict = window.detector.verdict();
+                window.peakMilliamps = window.detector.peakMilliamps();
+                window.armed = false;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+
+    portENTER_CRITICAL(&lock);
+    bool anyArmed = false;
+    for (uint8_t i = 0; i < MAX_CHANNELS; i++) {
+        if (windows[i].armed) {
+            anyArmed = true;
+            break;
+        }
+    }
+    timerRunning = anyArmed;
+    portEXIT_CRITICAL(&lock);
+
+    if (anyArmed) {
+        esp_timer_start_once(timer, SERVO_CURRENT_SAMPLE_INTERVAL_MS * 1000ULL);
+    }
+}
+
+const char* ServoCurrentMonitor::verdictToString(MoveVerdict verdict) {
+    switch (verdict) {
+        case MoveVerdict::IDLE:    return "sin datos";
+        case MoveVerdict::PENDING: return "analizando";
+        case MoveVerdict::OK:      return "correcto";
+        case MoveVerdict::NO_LOAD: return "sin carga (servo desconectado)";
+        case MoveVerdict::STALL:   return "bloqueado (corriente de bloqueo sostenida)";
+        case MoveVerdict::JAMMED:  return "atascado (no vuelve a reposo)";
+        default:                   return "desconocido";
+    }
+}
@@ -14,9 +14,10 @@
  * - Operación no bloqueante compatible con otras tareas del sistema
  * 
  * ARQUITECTURA DEL CÓDIGO:
- * La implementación sigue el patrón "Estado" donde cada estado del sistema
- * tiene comportamientos específicos y transiciones bien definidas. Esto hace
- * el código más mantenible y fácil de extender.
+ * El controlador ofrece las operaciones de bajo nivel (mover servos, válvula
+ * principal, errores) y publica el estado visible del sistema. Las secuencias
+ * de riego son programas lineales (IrrigationPrograms.cpp) que el planificador
+ * reanuda en cada update(), lo que permite varios programas concurrentes.
  * 
  * @author Sistema de Riego Inteligente
  * @version 2.0
@@ -65,6 +66,18 @@ MockSerial Serial;
 // Include project headers after environment setup
 #include "../../include/drivers/ServoPWMController.h"
 #include "../../include/core/ProjectConfig.h"  // Configuración centralizada - reemplaza SystemConfig.h
+#include "../../include/core/EventBus.h"
+#include "../../include/core/StateMetrics.h"
+#include "../../include/core/EventHistory.h"
+#include "../../include/core/MetricsRegistry.h"
+#include "../../include/utils/Trace.h"
+#include "../../include/drivers/ServoCurrentMonitor.h"
+
+// Las tablas de StateMetrics deben cubrir todos los valores de los enums
+static_assert(static_cast<uint8_t>(IrrigationState::ERROR) + 1 == StateMetricsConfig::IRRIGATION_STATES,
+              "StateMetricsConfig::IRRIGATION_STATES no coincide con IrrigationState");
+static_assert(static_cast<uint8_t>(ServoState::ERROR) + 1 == StateMetricsConfig::SERVO_STATES,
+              "StateMetricsConfig::SERVO_STATES no coincide con ServoState");
 
 
 // =============================================================================
@@ -87,15 +100,25 @@ ServoPWMController::ServoPWMController(uint8_t numZones)
     : zones(nullptr)
     , totalZones(0)
     , currentZone(0)
+    , handoffFromZone(0)
     , systemState(IrrigationState::IDLE)
     , stateStartTime(0)
     , lastStatusReport(0)
     , autoCycle(false)
     , emergencyStop(false)
+    , overlappedHandoff(ENABLE_OVERLAPPED_HANDOFF)
+    , mainValve(HardwarePins::DigitalIO::VALVULA_PRINCIPAL)
+    , mainValveOpen(false)
+    , wateringMode(WateringMode::CONTINUOUS)
+    , soakPulses(SOAK_DEFAULT_PULSES)
+    , soakIntervalSec(SOAK_MIN_INTERVAL_SECONDS)
+    , pulseSequence(0)
     , totalCyclesCompleted(0)
     , totalWateringTime(0)
     , systemStartTime(0)
 {
+    memset(pulseLog, 0, sizeof(pulseLog));
+    
     // Validación del número de zonas solicitado
     if (numZones == 0 || numZones > NUM_SERVOS) {
         Serial.println("[ERROR] Número de zonas inválido. Usando configuración por defecto.");
@@ -104,6 +127,7 @@ ServoPWMController::ServoPWMController(uint8_t numZones)
     
     // Inicializar el controlador con el número de zonas válido
     initializeZones(numZones);
+    publishSnapshot();
 }
 
 /**
@@ -118,15 +142,25 @@ ServoPWMController::ServoPWMController(const ServoPWMController& other)
     : zones(nullptr)
     , totalZones(0)
     , currentZone(other.currentZone)
+    , handoffFromZone(other.handoffFromZone)
     , systemState(other.systemState)
     , stateStartTime(other.stateStartTime)
     , lastStatusReport(other.lastStatusReport)
     , autoCycle(other.autoCycle)
     , emergencyStop(other.emergencyStop)
+    , overlappedHandoff(other.overlappedHandoff)
+    , mainValve(other.mainValve)
+    , mainValveOpen(other.mainValveOpen)
+    , wateringMode(other.wateringMode)
+    , soakPulses(other.soakPulses)
+    , soakIntervalSec(other.soakIntervalSec)
+    , pulseSequence(other.pulseSequence)
     , totalCyclesCompleted(other.totalCyclesCompleted)
     , totalWateringTime(other.totalWateringTime)
     , systemStartTime(other.systemStartTime)
 {
+    memcpy(pulseLog, other.pulseLog, sizeof(pulseLog));
+    
     // Copiar zonas
     if (other.zones != nullptr && other.totalZones > 0) {
         initializeZones(other.totalZones);
@@ -135,6 +169,9 @@ ServoPWMController::ServoPWMController(const ServoPWMController& other)
         for (uint8_t i = 0; i < totalZones; i++) {
             zones[i] = other.zones[i];
         }
+        enabledZones = other.enabledZones;
+        openZones = other.openZones;
+        errorZones = other.errorZones;
     }
 }
 
@@ -156,11 +193,20 @@ ServoPWMController& ServoPWMController::operator=(const ServoPWMController& othe
         
         // Copiar datos básicos
         currentZone = other.currentZone;
+        handoffFromZone = other.handoffFromZone;
         systemState = other.systemState;
         stateStartTime = other.stateStartTime;
         lastStatusReport = other.lastStatusReport;
         autoCycle = other.autoCycle;
         emergencyStop = other.emergencyStop;
+        overlappedHandoff = other.overlappedHandoff;
+        mainValve = other.mainValve;
+        mainValveOpen = other.mainValveOpen;
+        wateringMode = other.wateringMode;
+        soakPulses = other.soakPulses;
+        soakIntervalSec = other.soakIntervalSec;
+        pulseSequence = other.pulseSequence;
+        memcpy(pulseLog, other.pulseLog, sizeof(pulseLog));
         totalCyclesCompleted = other.totalCyclesCompleted;
         totalWateringTime = other.totalWateringTime;
         systemStartTime = other.systemStartTime;
@@ -173,6 +219,9 @@ ServoPWMController& ServoPWMController::operator=(const ServoPWMController& othe
             for (uint8_t i = 0; i < totalZones; i++) {
                 zones[i] = other.zones[i];
             }
+            enabledZones = other.enabledZones;
+            openZones = other.openZones;
+            errorZones = other.errorZones;
         }
     }
     
@@ -190,25 +239,45 @@ ServoPWMController& ServoPWMController::operator=(const ServoPWMController& othe
 ServoPWMController::ServoPWMController(ServoPWMController&& other) noexcept
     : zones(other.zones)
     , totalZones(other.totalZones)
+    , enabledZones(other.enabledZones)
+    , openZones(other.openZones)
+    , errorZones(other.errorZones)
     , currentZone(other.currentZone)
+    , handoffFromZone(other.handoffFromZone)
     , systemState(other.systemState)
     , stateStartTime(other.stateStartTime)
     , lastStatusReport(other.lastStatusReport)
     , autoCycle(other.autoCycle)
     , emergencyStop(other.emergencyStop)
+    , overlappedHandoff(other.overlappedHandoff)
+    , mainValve(other.mainValve)
+    , mainValveOpen(other.mainValveOpen)
+    , wateringMode(other.wateringMode)
+    , soakPulses(other.soakPulses)
+    , soakIntervalSec(other.soakIntervalSec)
+    , pulseSequence(other.pulseSequence)
     , totalCyclesCompleted(other.totalCyclesCompleted)
     , totalWateringTime(other.totalWateringTime)
     , systemStartTime(other.systemStartTime)
 {
+    memcpy(pulseLog, other.pulseLog, sizeof(pulseLog));
+    
     // Resetear el controlador original
     other.zones = nullptr;
     other.totalZones = 0;
+    other.enabledZones.clear();
+    other.openZones.clear();
+    other.errorZones.clear();
     other.currentZone = 0;
+    other.handoffFromZone = 0;
     other.systemState = IrrigationState::IDLE;
     other.stateStartTime = 0;
     other.lastStatusReport = 0;
     other.autoCycle = false;
     other.emergencyStop = false;
+    other.mainValveOpen = false;
+    other.pulseSequence = 0;
+    other.scheduler.stopAll();
     other.totalCyclesCompleted = 0;
     other.totalWateringTime = 0;
     other.systemStartTime = 0;
@@ -233,12 +302,24 @@ ServoPWMController& ServoPWMController::operator=(ServoPWMController&& other) no
         // Transferir recursos
         zones = other.zones;
         totalZones = other.totalZones;
+        enabledZones = other.enabledZones;
+        openZones = other.openZones;
+        errorZones = other.errorZones;
         currentZone = other.currentZone;
+        handoffFromZone = other.handoffFromZone;
         systemState = other.systemState;
         stateStartTime = other.stateStartTime;
         lastStatusReport = other.lastStatusReport;
         autoCycle = other.autoCycle;
         emergencyStop = other.emergencyStop;
+        overlappedHandoff = other.overlappedHandoff;
+        mainValve = other.mainValve;
+        mainValveOpen = other.mainValveOpen;
+        wateringMode = other.wateringMode;
+        soakPulses = other.soakPulses;
+        soakIntervalSec = other.soakIntervalSec;
+        pulseSequence = other.pulseSequence;
+        memcpy(pulseLog, other.pulseLog, sizeof(pulseLog));
         totalCyclesCompleted = other.totalCyclesCompleted;
         totalWateringTime = other.totalWateringTime;
         systemStartTime = other.systemStartTime;
@@ -246,12 +327,19 @@ ServoPWMController& ServoPWMController::operator=(ServoPWMController&& other) no
         // Resetear el controlador original
         other.zones = nullptr;
         other.totalZones = 0;
+        other.enabledZones.clear();
+        other.openZones.clear();
+        other.errorZones.clear();
         other.currentZone = 0;
+        other.handoffFromZone = 0;
         other.systemState = IrrigationState::IDLE;
         other.stateStartTime = 0;
         other.lastStatusReport = 0;
         other.autoCycle = false;
         other.emergencyStop = false;
+        other.mainValveOpen = false;
+        other.pulseSequence = 0;
+        other.scheduler.stopAll();
         other.totalCyclesCompleted = 0;
         other.totalWateringTime = 0;
         other.systemStartTime = 0;
@@ -272,6 +360,9 @@ ServoPWMController::~ServoPWMController() {
     // Parada de emergencia para asegurar que todas las válvulas se cierren
     emergencyStopAll();
     
+    // Los muestreadores registrados apuntan a este objeto
+    MetricsRegistry::getInstance().removeContext(this);
+    
     // Liberar memoria asignada dinámicamente
     if (zones != nullptr) {
         delete[] zones;
@@ -315,6 +406,10 @@ void ServoPWMController::initializeZones(uint8_t numZones) {
     
     totalZones = numZones;
     
+    enabledZones.clear();
+    openZones.clear();
+    errorZones.clear();
+    
     // Inicializar información básica de cada zona
     for (uint8_t i = 0; i < totalZones; i++) {
         zones[i].zoneNumber = i + 1;  // Numeración 1-based para el usuario
@@ -323,8 +418,13 @@ void ServoPWMController::initializeZones(uint8_t numZones) {
         zones[i].currentState = ServoState::UNINITIALIZED;
         zones[i].lastActionTime = 0;
         zones[i].totalIrrigationTime = 0;
-        zones[i].isEnabled = true;
+        enabledZones.set(i);
         zones[i].retryCount = 0;
+        zones[i].transitionTimeMs = TRANSITION_TIME_SECONDS * 1000UL;
+        zones[i].pulsesPlanned = 0;
+        zones[i].pulsesCompleted = 0;
+        zones[i].pulseDuration = 0;
+        zones[i].lastPulseEnd = 0;
         
         // Copiar configuración específica si está disponible
         if (i < (sizeof(ZONE_CONFIGURATIONS) / sizeof(ZONE_CONFIGURATIONS[0]))) {
@@ -350,6 +450,12 @@ void ServoPWMController::cleanup() {
         emergencyStopAll();
     }
     
+    // Detener programas en curso (referencian las zonas que se liberan)
+    scheduler.stopAll();
+    
+    // Las métricas registradas apuntan a este objeto
+    MetricsRegistry::getInstance().removeContext(this);
+    
     // Liberar memoria de zonas
     if (zones != nullptr) {
         delete[] zones;
@@ -358,12 +464,18 @@ void ServoPWMController::cleanup() {
     
     // Resetear variables
     totalZones = 0;
+    enabledZones.clear();
+    openZones.clear();
+    errorZones.clear();
     currentZone = 0;
+    handoffFromZone = 0;
     systemState = IrrigationState::IDLE;
     stateStartTime = 0;
     lastStatusReport = 0;
     autoCycle = false;
     emergencyStop = false;
+    mainValveOpen = false;
+    pulseSequence = 0;
     totalCyclesCompleted = 0;
     totalWateringTime = 0;
     systemStartTime = 0;
@@ -405,19 +517,31 @@ bool ServoPWMController::init() {
         return false;
     }
     
+    // Sensado de corriente (opcional): debe estar listo antes del primer movimiento
+    if (ENABLE_POSITION_FEEDBACK && !ServoCurrentMonitor::getInstance().begin()) {
+        Serial.println("[WARNING] Sensado de corriente no disponible. Sin verificación de posición.");
+    }
+    
     // Configurar cada servomotor individualmente
     for (uint8_t i = 0; i < totalZones; i++) {
+        zones[i].retryCount = 0;
         if (!setupServo(i)) {
             Serial.println("[ERROR] Fallo configurando servo de zona " + String(i + 1));
             return false;
         }
     }
     
+    // Configurar la válvula principal en estado cerrado
+    mainValve.init();
+    mainValveOpen = false;
+    
     // Establecer estado inicial del sistema
-    systemState = IrrigationState::IDLE;
+    enterState(IrrigationState::IDLE);
     systemStartTime = millis();
     emergencyStop = false;
     
+    registerMetrics();
+    
     Serial.println("[ÉXITO] Sistema de servomotores inicializado correctamente.");
     Serial.println("[INFO] Zonas configuradas: " + String(totalZones));
     
@@ -453,34 +577,30 @@ bool ServoPWMController::startIrrigationCycle(bool enableAutoCycle) {
         return false;
     }
     
-    // Contar zonas habilitadas
-    uint8_t enabledZones = 0;
-    for (uint8_t i = 0; i < totalZones; i++) {
-        if (zones[i].isEnabled) {
-            enabledZones++;
-        }
-    }
-    
-    if (enabledZones == 0) {
+    if (!enabledZones.any()) {
         Serial.println("[ADVERTENCIA] No hay zonas habilitadas para riego.");
         return false;
     }
     
     // Configurar parámetros del ciclo
     autoCycle = enableAutoCycle;
-    currentZone = 0;
-    
-    // Encontrar la primera zona habilitada
-    while (currentZone < totalZones && !zones[currentZone].isEnabled) {
-        currentZone++;
+    currentZone = findNextEnabledZone(0);
+    
+    // Arrancar el programa del modo elegido; publica INITIALIZING en su primer paso
+    IrrigationProgram* program = (wateringMode == WateringMode::SOAK_CYCLE)
+        ? static_cast<IrrigationProgram*>(&soakProgram)
+        : static_cast<IrrigationProgram*>(&cycleProgram);
+    if (!scheduler.start(program)) {
+        Serial.println("[ERROR] No hay ranuras libres en el planificador de programas.");
+        return false;
     }
+    enterState(IrrigationState::INITIALIZING);
+    EventHistory::getInstance().record(HistoryEvent::CYCLE_STARTED, 0, enableAutoCycle ? 1 : 0);
     
-    // Iniciar el ciclo cambiando al estado de inicialización
-    systemState = IrrigationState::INITIALIZING;
-    stateStartTime = millis();
-    
-    Serial.println("[INFO] Iniciando ciclo de riego. Zonas habilitadas: " + String(enabledZones));
+    Serial.println("[INFO] Iniciando ciclo de riego. Zonas habilitadas: " + String(enabledZones.count()));
     Serial.println("[INFO] Auto-ciclo: " + String(enableAutoCycle ? "Habilitado" : "Deshabilitado"));
+    Serial.println("[INFO] Traspaso solapado: " + String(overlappedHandoff ? "Habilitado" : "Deshabilitado"));
+    Serial.println("[INFO] Modo de riego: " + String(wateringModeToString(wateringMode)));
     
     return true;
 }
@@ -489,18 +609,21 @@ bool ServoPWMController::startIrrigationCycle(bool enableAutoCycle) {
  * @brief Función principal de procesamiento del sistema.
  * 
  * EXPLICACIÓN EDUCATIVA:
- * Esta función implementa una máquina de estados no bloqueante. Cada llamada:
- * 1. Evalúa el estado actual del sistema
- * 2. Ejecuta las acciones correspondientes al estado
- * 3. Determina si debe transicionar a un nuevo estado
+ * Esta función es el "reloj" de los programas de riego. Cada llamada:
+ * 1. Genera el reporte periódico de estado
+ * 2. Reanuda cada programa activo (ciclo, cierres temporizados, ...)
+ * 3. Cada programa avanza hasta su siguiente espera y devuelve el control
  * 
  * El patrón no bloqueante es crucial en sistemas embebidos porque permite
  * que el microcontrolador maneje otras tareas importantes mientras controla
  * el riego (como monitoreo de sensores, comunicación WiFi, etc.).
  */
 void ServoPWMController::update() {
+    TRACE_SCOPE("servo.update");
+    
     // Verificar parada de emergencia
     if (emergencyStop) {
+        publishSnapshot();
         return; // No procesar nada si hay parada de emergencia
     }
     
@@ -512,40 +635,19 @@ void ServoPWMController::update() {
         lastStatusReport = millis();
     }
     
-    // Procesar estado actual del sistema
-    switch (systemState) {
-        case IrrigationState::IDLE:
-            // Estado inactivo - no hay acciones que realizar
-            break;
-            
-        case IrrigationState::INITIALIZING:
-            handleInitializingState();
-            break;
-            
-        case IrrigationState::OPENING_VALVE:
-            handleOpeningValveState();
-            break;
-            
-        case IrrigationState::IRRIGATING:
-            handleIrrigatingState();
-            break;
-            
-        case IrrigationState::CLOSING_VALVE:
-            handleClosingValveState();
-            break;
-            
-        case IrrigationState::TRANSITIONING:
-            handleTransitioningState();
-            break;
-            
-        case IrrigationState::COMPLETED:
-            handleCompletedState();
-            break;
-            
-        case IrrigationState::ERROR:
-            handleErrorState();
-            break;
+    // En error solo se intenta la recuperación automática
+    if (systemState == IrrigationState::ERROR) {
+        handleErrorState();
+        publishSnapshot();
+        return;
     }
+    
+    // Reanudar cada programa activo hasta su siguiente punto de espera
+    scheduler.runOnce(*this);
+    settleManualMoves();
+    
+    // Estado de esta pasada, coherente, para las tareas de red
+    publishSnapshot();
 }
 
 /**
@@ -560,29 +662,23 @@ void ServoPWMController::update() {
 void ServoPWMController::stopIrrigationCycle() {
     Serial.println("[INFO] Deteniendo ciclo de riego de forma segura...");
     
-    // Si estamos regando activamente, cerrar la válvula actual
-    if (systemState == IrrigationState::IRRIGATING || 
-        systemState == IrrigationState::OPENING_VALVE) {
-        
-        // Cambiar a estado de cierre para finalizar ordenadamente
-        systemState = IrrigationState::CLOSING_VALVE;
-        stateStartTime = millis();
-        
+    // Detener el ciclo y los cierres temporizados: se cierra todo ahora
+    scheduler.stopAll();
+    autoCycle = false;
+    
+    // La válvula principal se cierra antes que cualquier válvula de zona
+    setMainValve(false);
+    
+    if (systemState != IrrigationState::IDLE && systemState != IrrigationState::COMPLETED) {
         Serial.println("[INFO] Cerrando válvula de zona " + String(currentZone + 1) + " antes de detener.");
-    } else {
-        // Si no estamos regando activamente, ir directamente a idle
-        systemState = IrrigationState::IDLE;
-        autoCycle = false;
+        EventHistory::getInstance().record(HistoryEvent::CYCLE_STOPPED, currentZone + 1);
     }
+    enterState(IrrigationState::IDLE);
     
-    // Asegurar que todas las válvulas estén cerradas
-    for (uint8_t i = 0; i < totalZones; i++) {
-        if (zones[i].currentState == ServoState::OPEN || 
-            zones[i].currentState == ServoState::OPENING) {
-            moveServoToAngle(i, SERVO_CLOSED_ANGLE);
-            zones[i].currentState = ServoState::CLOSING;
-        }
-    }
+    // Asegurar que todas las válvulas estén cerradas: también las que
+    // quedaron a medio camino (CLOSING de un traspaso interrumpido), porque
+    // ya no queda ningún programa que termine de cerrarlas
+    closeAllZoneValves();
 }
 
 /**
@@ -598,16 +694,23 @@ void ServoPWMController::emergencyStopAll() {
     // Solo mostrar mensajes si no estaba ya en parada de emergencia
     if (!emergencyStop) {
         Serial.println("[EMERGENCIA] Activando parada de emergencia del sistema!");
+        EventHistory::getInstance().record(HistoryEvent::EMERGENCY_STOP);
     }
     
     emergencyStop = true;
-    systemState = IrrigationState::ERROR;
+    enterState(IrrigationState::ERROR);
     autoCycle = false;
     
+    // Ningún programa debe seguir moviendo válvulas
+    scheduler.stopAll();
+    
+    // Cortar primero el suministro desde la válvula principal
+    setMainValve(false);
+    
     // Cerrar inmediatamente todas las válvulas
     for (uint8_t i = 0; i < totalZones; i++) {
         moveServoToAngle(i, SERVO_CLOSED_ANGLE);
-        zones[i].currentState = ServoState::CLOSED;
+        setServoState(i, ServoState::CLOSED);
         zones[i].lastActionTime = millis();
     }
     
@@ -630,11 +733,11 @@ void ServoPWMController::resetEmergencyStop() {
     Serial.println("[INFO] Desactivando parada de emergencia...");
     
     emergencyStop = false;
-    systemState = IrrigationState::IDLE;
+    enterState(IrrigationState::IDLE);
     
     // Reinicializar estados de zonas
     for (uint8_t i = 0; i < totalZones; i++) {
-        zones[i].currentState = ServoState::CLOSED;
+        setServoState(i, ServoState::CLOSED);
         zones[i].retryCount = 0;
     }
     
@@ -646,198 +749,162 @@ void ServoPWMController::resetEmergencyStop() {
 // =============================================================================
 
 /**
- * @brief Maneja el estado de inicialización del ciclo de riego.
+ * @brief Cambia el estado visible del sistema.
  * 
  * EXPLICACIÓN EDUCATIVA:
- * El estado de inicialización prepara el sistema para el ciclo de riego:
- * 1. Verifica que todas las válvulas estén cerradas
- * 2. Reinicia contadores y estadísticas
- * 3. Prepara la transición al primer riego
+ * Las secuencias de riego viven ahora en los programas (IrrigationPrograms.cpp);
+ * este método es el único punto donde publican en qué fase están, y reinicia
+ * el cronómetro que usan getRemainingIrrigationTime() y los reportes.
  */
-void ServoPWMController::handleInitializingState() {
-    // Asegurar que todas las válvulas estén cerradas antes de empezar
-    bool allClosed = true;
-    for (uint8_t i = 0; i < totalZones; i++) {
-        if (zones[i].currentState != ServoState::CLOSED) {
-            moveServoToAngle(i, SERVO_CLOSED_ANGLE);
-            zones[i].currentState = ServoState::CLOSED;
-            allClosed = false;
-        }
-    }
-    
-    // Si todas las válvulas están cerradas, continuar al primer riego
-    if (allClosed) {
-        Serial.println("[INFO] Iniciando riego de zona " + String(currentZone + 1) + 
-                      " (" + String(zones[currentZone].config.name) + ")");
-        
-        systemState = IrrigationState::OPENING_VALVE;
-        stateStartTime = millis();
-    }
+void ServoPWMController::enterState(IrrigationState state) {
+    systemState = state;
+    stateStartTime = millis();
+    StateMetrics::getInstance().recordIrrigationState(static_cast<uint8_t>(state));
 }
 
 /**
- * @brief Maneja el estado de apertura de válvula.
+ * @brief Registra las familias de métricas del controlador.
  * 
  * EXPLICACIÓN EDUCATIVA:
- * La apertura controlada de válvulas previene golpes de ariete hidráulicos
- * que pueden dañar tuberías y conexiones. El movimiento gradual es clave.
+ * Cada muestreador es una lambda sin capturas (convertible a puntero a
+ * función); el controlador llega como contexto. Al estar definidas dentro
+ * de un método, las lambdas pueden leer los miembros privados.
  */
-void ServoPWMController::handleOpeningValveState() {
-    uint8_t targetAngle = zones[currentZone].config.openAngle;
-    
-    // Mover servo a posición de apertura
-    if (moveServoToAngle(currentZone, targetAngle)) {
-        zones[currentZone].currentState = ServoState::OPEN;
-        zones[currentZone].lastActionTime = millis();
-        
-        Serial.println("[INFO] Válvula de zona " + String(currentZone + 1) + " abierta. Iniciando riego...");
-        
-        // Transicionar a estado de riego
-        systemState = IrrigationState::IRRIGATING;
-        stateStartTime = millis();
-    } else {
-        // Manejar error de apertura
-        if (millis() - stateStartTime > SERVO_MOVEMENT_TIME_MS * 2) {
-            handleServoError(currentZone, "Fallo en apertura de válvula");
-        }
-    }
+void ServoPWMController::registerMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    
+    registry.add("riego_cycles_completed_total", "Ciclos de riego completados", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            return singleSample(family, index, line, ctl->totalCyclesCompleted);
+        }, this);
+    
+    registry.add("riego_watering_seconds_total", "Segundos de riego acumulados", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            return singleSample(family, index, line, ctl->totalWateringTime);
+        }, this);
+    
+    registry.add("riego_zone_watering_seconds", "Segundos regados por zona en el ciclo actual", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            if (index >= ctl->totalZones || ctl->zones == nullptr) return MetricSample::DONE;
+            line.begin(family.name);
+            line.label("zone", static_cast<uint32_t>(index + 1));
+            line.value(ctl->zones[index].totalIrrigationTime);
+            return MetricSample::EMITTED;
+        }, this);
+    
+    registry.add("riego_irrigation_state", "Estado actual del ciclo de riego (1 = activo)", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            if (index >= StateMetricsConfig::IRRIGATION_STATES) return MetricSample::DONE;
+            line.begin(family.name);
+            line.label("state", StateMetrics::irrigationStateName(index));
+            line.value(static_cast<uint8_t>(ctl->systemState) == index ? 1 : 0);
+            return MetricSample::EMITTED;
+        }, this);
+    
+    registry.add("riego_main_valve_open", "Válvula principal abierta", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            return singleSample(family, index, line, ctl->mainValveOpen ? 1 : 0);
+        }, this);
+    
+    registry.add("riego_emergency_stop", "Parada de emergencia activa", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            return singleSample(family, index, line, ctl->emergencyStop ? 1 : 0);
+        }, this);
+    
+    registry.add("riego_active_programs", "Programas de riego en ejecución", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const ServoPWMController* ctl = static_cast<const ServoPWMController*>(family.context);
+            return singleSample(family, index, line, ctl->scheduler.activeCount());
+        }, this);
 }
 
 /**
- * @brief Maneja el estado de riego activo.
- * 
- * EXPLICACIÓN EDUCATIVA:
- * Durante el riego, el sistema monitorea continuamente:
- * 1. Tiempo transcurrido vs tiempo configurado
- * 2. Estado del servo (verificar que sigue abierto)
- * 3. Condiciones de error que requieran parada
+ * @brief Cambia el estado de un servo y lo registra en las métricas.
  */
-void ServoPWMController::handleIrrigatingState() {
-    uint32_t elapsedTime = (millis() - stateStartTime) / 1000; // Convertir a segundos
-    uint32_t targetTime = zones[currentZone].config.irrigationTime;
-    
-    // Actualizar estadísticas de riego
-    zones[currentZone].totalIrrigationTime = elapsedTime;
-    
-    // Verificar si el tiempo de riego se ha completado
-    if (elapsedTime >= targetTime) {
-        Serial.println("[INFO] Riego de zona " + String(currentZone + 1) + " completado. Tiempo: " + 
-                      String(elapsedTime) + "s");
-        
-        // Transicionar a estado de cierre
-        systemState = IrrigationState::CLOSING_VALVE;
-        stateStartTime = millis();
-        
-        // Actualizar estadísticas globales
-        totalWateringTime += elapsedTime;
-    }
-    
-    // Verificar que el servo sigue en posición correcta
-    if (zones[currentZone].currentState != ServoState::OPEN) {
-        Serial.println("[ADVERTENCIA] Servo de zona " + String(currentZone + 1) + " no está en posición abierta");
-        // Intentar reposicionar el servo
-        moveServoToAngle(currentZone, zones[currentZone].config.openAngle);
-    }
+void ServoPWMController::setServoState(uint8_t zoneIndex, ServoState state) {
+    zones[zoneIndex].currentState = state;
+    openZones.assign(zoneIndex, state == ServoState::OPENING || state == ServoState::OPEN);
+    errorZones.assign(zoneIndex, state == ServoState::ERROR);
+    StateMetrics::getInstance().recordServoState(zoneIndex, static_cast<uint8_t>(state));
 }
 
-/**
- * @brief Maneja el estado de cierre de válvula.
- * 
- * EXPLICACIÓN EDUCATIVA:
- * El cierre controlado es tan importante como la apertura porque:
- * 1. Previene golpes de ariete al detener el flujo gradualmente
- * 2. Asegura sellado completo de la válvula
- * 3. Prepara el sistema para la siguiente zona
- */
-void ServoPWMController::handleClosingValveState() {
-    // Mover servo a posición cerrada
-    if (moveServoToAngle(currentZone, SERVO_CLOSED_ANGLE)) {
-        zones[currentZone].currentState = ServoState::CLOSED;
-        zones[currentZone].lastActionTime = millis();
-        
-        Serial.println("[INFO] Válvula de zona " + String(currentZone + 1) + " cerrada correctamente.");
-        
-        // Buscar la siguiente zona habilitada
-        uint8_t nextZone = currentZone + 1;
-        while (nextZone < totalZones && !zones[nextZone].isEnabled) {
-            nextZone++;
+uint32_t ServoPWMController::stateElapsedMs() const {
+    return millis() - stateStartTime;
+}
+
+void ServoPWMController::settleManualMoves() {
+    // Durante un ciclo el programa es el dueño de las zonas y decide él
+    if (systemState != IrrigationState::IDLE && systemState != IrrigationState::COMPLETED) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < totalZones; i++) {
+        ServoState state = zones[i].currentState;
+        if (state != ServoState::OPENING && state != ServoState::CLOSING) {
+            continue;
         }
-        
-        if (nextZone < totalZones) {
-            // Hay más zonas por procesar - transición
-            currentZone = nextZone;
-            systemState = IrrigationState::TRANSITIONING;
-            stateStartTime = millis();
-            
-            Serial.println("[INFO] Transicionando a zona " + String(currentZone + 1) + "...");
-        } else {
-            // Todas las zonas completadas
-            systemState = IrrigationState::COMPLETED;
-            stateStartTime = millis();
-            totalCyclesCompleted++;
-            
-            Serial.println("[ÉXITO] Ciclo de riego completado. Ciclos totales: " + String(totalCyclesCompleted));
+        if (millis() - zones[i].lastActionTime < SERVO_MOVEMENT_TIME_MS) {
+            continue;
         }
-    } else {
-        // Manejar error de cierre
-        if (millis() - stateStartTime > SERVO_MOVEMENT_TIME_MS * 2) {
-            handleServoError(currentZone, "Fallo en cierre de válvula");
+        
+        // handleServoError vuelve a llevar el servo a cerrado (o lo deja en ERROR)
+        if (!isServoInPosition(i)) {
+            handleServoError(i, state == ServoState::OPENING ? "Fallo en apertura manual" : "Fallo en cierre manual");
+            continue;
         }
+        setServoState(i, state == ServoState::OPENING ? ServoState::OPEN : ServoState::CLOSED);
+        zones[i].lastActionTime = millis();
+        zones[i].retryCount = 0;
     }
 }
 
-/**
- * @brief Maneja el estado de transición entre zonas.
- * 
- * EXPLICACIÓN EDUCATIVA:
- * La pausa entre zonas es importante para:
- * 1. Permitir que la presión del sistema se estabilice
- * 2. Evitar picos de corriente al activar móltiples servos seguidos
- * 3. Dar tiempo para que el agua residual drene completamente
- */
-void ServoPWMController::handleTransitioningState() {
-    uint32_t elapsedTime = (millis() - stateStartTime) / 1000;
-    
-    if (elapsedTime >= TRANSITION_TIME_SECONDS) {
-        Serial.println("[INFO] Transición completada. Iniciando riego de zona " + String(currentZone + 1));
-        
-        systemState = IrrigationState::OPENING_VALVE;
-        stateStartTime = millis();
+bool ServoPWMController::closeAllZoneValves() {
+    bool moved = false;
+    for (uint8_t i = 0; i < totalZones; i++) {
+        if (zones[i].currentState != ServoState::CLOSED) {
+            moveServoToAngle(i, SERVO_CLOSED_ANGLE);
+            setServoState(i, ServoState::CLOSED);
+            moved = true;
+        }
     }
+    return moved;
 }
 
 /**
- * @brief Maneja el estado de ciclo completado.
+ * @brief Registra un pulso completado en la telemetría.
  * 
  * EXPLICACIÓN EDUCATIVA:
- * El estado completado determina si:
- * 1. El ciclo debe repetirse automáticamente (auto-ciclo)
- * 2. El sistema debe retornar a estado idle
- * 3. Se deben generar reportes finales
+ * El buffer circular guarda los últimos PULSE_TELEMETRY_BUFFER_SIZE pulsos sin
+ * asignar memoria. El número de secuencia permite a cada consumidor (p.ej. el
+ * WebSocket) saber qué pulsos ya envió aunque el buffer se haya dado la vuelta.
  */
-void ServoPWMController::handleCompletedState() {
-    if (autoCycle) {
-        // Esperar un tiempo antes de reiniciar el ciclo
-        uint32_t elapsedTime = (millis() - stateStartTime) / 1000;
-        const uint32_t CYCLE_RESTART_DELAY = 300; // 5 minutos entre ciclos
-        
-        if (elapsedTime >= CYCLE_RESTART_DELAY) {
-            Serial.println("[INFO] Reiniciando ciclo automático...");
-            currentZone = 0;
-            
-            // Encontrar la primera zona habilitada
-            while (currentZone < totalZones && !zones[currentZone].isEnabled) {
-                currentZone++;
-            }
-            
-            systemState = IrrigationState::INITIALIZING;
-            stateStartTime = millis();
-        }
-    } else {
-        // Ciclo ónico completado - retornar a idle
-        systemState = IrrigationState::IDLE;
-        Serial.println("[INFO] Sistema en estado idle. Listo para nuevo ciclo.");
-    }
+void ServoPWMController::recordPulse(uint8_t zoneIndex, uint32_t startedAt, uint32_t durationSec, uint32_t soakedSec) {
+    PulseRecord& record = pulseLog[pulseSequence % PULSE_TELEMETRY_BUFFER_SIZE];
+    pulseSequence++;
+    
+    record.sequence = pulseSequence;
+    record.zoneNumber = zoneIndex + 1;
+    record.pulseIndex = zones[zoneIndex].pulsesCompleted;
+    record.pulseCount = zones[zoneIndex].pulsesPlanned;
+    record.startedAt = startedAt;
+    record.durationSec = durationSec;
+    record.soakedSec = soakedSec;
+    
+    Serial.println("[INFO] Pulso " + String(record.pulseIndex) + "/" + String(record.pulseCount) +
+                  " de zona " + String(record.zoneNumber) + " completado: " + String(durationSec) +
+                  "s de riego, " + String(soakedSec) + "s de remojo previo");
+    EventHistory::getInstance().record(HistoryEvent::PULSE_COMPLETED, record.zoneNumber, durationSec);
+    
+    EventData data = {};
+    data.intValue = record.zoneNumber;
+    data.customData = &record;
+    EventBus::getInstance().publish(EventType::IRRIGATION_PULSE_COMPLETED, &data);
 }
 
 /**
@@ -860,13 +927,13 @@ void ServoPWMController::handleErrorState() {
         // Cerrar todas las válvulas como medida de seguridad
         for (uint8_t i = 0; i < totalZones; i++) {
             moveServoToAngle(i, SERVO_CLOSED_ANGLE);
-            zones[i].currentState = ServoState::CLOSED;
+            setServoState(i, ServoState::CLOSED);
         }
         
         // Reinicializar sistema
         if (init()) {
             Serial.println("[ÉXITO] Recuperación automática exitosa.");
-            systemState = IrrigationState::IDLE;
+            enterState(IrrigationState::IDLE);
         } else {
             Serial.println("[ERROR] Recuperación automática fallida. Intervención manual requerida.");
             emergencyStopAll();
@@ -930,9 +997,8 @@ bool ServoPWMController::setupServo(uint8_t zoneIndex) {
     
     // Mover servo a posición cerrada
     if (moveServoToAngle(zoneIndex, SERVO_CLOSED_ANGLE)) {
-        zones[zoneIndex].currentState = ServoState::CLOSED;
+        setServoState(zoneIndex, ServoState::CLOSED);
         zones[zoneIndex].lastActionTime = millis();
-        zones[zoneIndex].retryCount = 0;
         
         Serial.println("[INFO] Servo zona " + String(zoneIndex + 1) + " configurado correctamente.");
         return true;
@@ -964,17 +1030,23 @@ bool ServoPWMController::moveServoToAngle(uint8_t zoneIndex, uint8_t targetAngle
         targetAngle = 180;
     }
     
+    // Marca instantánea: el servo termina de moverse por su cuenta
+    TRACE_INSTANT(targetAngle == SERVO_CLOSED_ANGLE ? "servo.close" : "servo.open");
+    
     // Calcular valor PWM para el ángulo objetivo
     uint32_t targetPulse = angleToHaltValue(targetAngle);
     
     // Aplicar valor PWM al servo
     ledcWrite(zones[zoneIndex].pwmChannel, targetPulse);
     
+    // Abrir la ventana de análisis de corriente de este movimiento
+    ServoCurrentMonitor::getInstance().armMove(zoneIndex);
+    
     // Actualizar estado del servo
     if (targetAngle == SERVO_CLOSED_ANGLE) {
-        zones[zoneIndex].currentState = ServoState::CLOSING;
+        setServoState(zoneIndex, ServoState::CLOSING);
     } else {
-        zones[zoneIndex].currentState = ServoState::OPENING;
+        setServoState(zoneIndex, ServoState::OPENING);
     }
     
     zones[zoneIndex].lastActionTime = millis();
@@ -987,6 +1059,57 @@ bool ServoPWMController::moveServoToAngle(uint8_t zoneIndex, uint8_t targetAngle
     return true;
 }
 
+/**
+ * @brief Escribe un ángulo intermedio sin alterar el estado lógico del servo.
+ */
+void ServoPWMController::writeServoAngle(uint8_t zoneIndex, uint8_t angle) {
+    if (zoneIndex >= totalZones) {
+        return;
+    }
+    
+    if (angle > 180) {
+        angle = 180;
+    }
+    
+    ledcWrite(zones[zoneIndex].pwmChannel, angleToHaltValue(angle));
+}
+
+/**
+ * @brief Busca la siguiente zona habilitada a partir de un índice.
+ * 
+ * Un count-trailing-zeros sobre enabledZones en lugar de recorrer las zonas.
+ */
+uint8_t ServoPWMController::findNextEnabledZone(uint8_t startIndex) const {
+    uint16_t zone = enabledZones.next(startIndex);
+    return zone < totalZones ? zone : totalZones;
+}
+
+/**
+ * @brief Abre o cierra la válvula principal de suministro.
+ * 
+ * EXPLICACIÓN EDUCATIVA:
+ * La válvula principal se coordina con las válvulas de zona: se abre después
+ * de que una zona esté abierta y se cierra antes de cerrar la última, de modo
+ * que el circuito aguas abajo siempre tiene una salida para el agua.
+ */
+void ServoPWMController::setMainValve(bool open) {
+    if (mainValveOpen == open) {
+        return;
+    }
+    
+    TRACE_INSTANT(open ? "main_valve.open" : "main_valve.close");
+    if (open) {
+        mainValve.high();
+    } else {
+        mainValve.low();
+    }
+    mainValveOpen = open;
+    
+    if (ENABLE_VERBOSE_LOGGING) {
+        Serial.println("[DEBUG] Válvula principal " + String(open ? "abierta" : "cerrada"));
+    }
+}
+
 /**
  * @brief Convierte un ángulo en grados a valor PWM correspondiente.
  * 
@@ -1017,6 +1140,39 @@ uint32_t ServoPWMController::angleToHaltValue(uint8_t angle) {
     return pwmValue;
 }
 
+/**
+ * @brief Verifica, por la firma de corriente, si el último movimiento llegó a destino.
+ * 
+ * EXPLICACIÓN EDUCATIVA:
+ * El análisis ya lo hizo ServoCurrentMonitor en segundo plano; aquí solo se
+ * consulta el veredicto. Sin sensado, o sin datos del movimiento, se asume
+ * que el servo está en posición (el comportamiento anterior).
+ */
+bool ServoPWMController::isServoInPosition(uint8_t zoneIndex) {
+    if (zoneIndex >= totalZones) {
+        return false;
+    }
+    
+    if (!ENABLE_POSITION_FEEDBACK) {
+        return true;
+    }
+    
+    ServoCurrentMonitor& monitor = ServoCurrentMonitor::getInstance();
+    MoveVerdict verdict = monitor.getVerdict(zoneIndex);
+    
+    switch (verdict) {
+        case MoveVerdict::NO_LOAD:
+        case MoveVerdict::STALL:
+        case MoveVerdict::JAMMED:
+            Serial.println("[WARNING] Zona " + String(zoneIndex + 1) + ": servo " +
+                          String(ServoCurrentMonitor::verdictToString(verdict)) +
+                          " (pico " + String(monitor.getPeakMilliamps(zoneIndex)) + " mA)");
+            return false;
+        default:
+            return true;
+    }
+}
+
 /**
  * @brief Valida la configuración del sistema antes de iniciar operaciones.
  */
@@ -1061,10 +1217,12 @@ bool ServoPWMController::handleServoError(uint8_t zoneIndex, const char* errorTy
     }
     
     zones[zoneIndex].retryCount++;
+    StateMetrics::getInstance().recordServoRetry(zoneIndex);
     
     Serial.println("[ERROR] Zona " + String(zoneIndex + 1) + ": " + String(errorType) + 
                   " (Intento " + String(zones[zoneIndex].retryCount) + "/" + 
                   String(MAX_SERVO_RETRY_ATTEMPTS) + ")");
+    EventHistory::getInstance().record(HistoryEvent::SERVO_FAULT, zoneIndex + 1, zones[zoneIndex].retryCount);
     
     // Si no hemos excedido el límite de intentos, reintentar
     if (zones[zoneIndex].retryCount <= MAX_SERVO_RETRY_ATTEMPTS) {
@@ -1073,22 +1231,15 @@ bool ServoPWMController::handleServoError(uint8_t zoneIndex, const char* errorTy
         return true;
     } else {
         // Demasiados fallos - marcar zona como error y continuar
-        zones[zoneIndex].currentState = ServoState::ERROR;
-        zones[zoneIndex].isEnabled = false; // Deshabilitar zona problemática
+        setServoState(zoneIndex, ServoState::ERROR);
+        enabledZones.reset(zoneIndex);      // Deshabilitar zona problemática
         
         Serial.println("[ERROR CRÍTICO] Zona " + String(zoneIndex + 1) + 
                       " deshabilitada por fallos repetidos.");
+        EventHistory::getInstance().record(HistoryEvent::ZONE_DISABLED, zoneIndex + 1);
         
         // Si todas las zonas están en error, activar parada de emergencia
-        bool allInError = true;
-        for (uint8_t i = 0; i < totalZones; i++) {
-            if (zones[i].currentState != ServoState::ERROR && zones[i].isEnabled) {
-                allInError = false;
-                break;
-            }
-        }
-        
-        if (allInError) {
+        if (!enabledZones.without(errorZones).any()) {
             emergencyStopAll();
             return false;
         }
@@ -1116,7 +1267,7 @@ void ServoPWMController::generateStatusReport() const {
     for (uint8_t i = 0; i < totalZones; i++) {
         Serial.println("Zona " + String(i + 1) + " (" + String(zones[i].config.name) + "): " +
                       String(servoStateToString(zones[i].currentState)) + 
-                      " | Habilitada: " + String(zones[i].isEnabled ? "Sí" : "No") +
+                      " | Habilitada: " + String(enabledZones.test(i) ? "Sí" : "No") +
                       " | Tiempo riego: " + String(zones[i].totalIrrigationTime) + "s");
     }
     Serial.println("=======================================\n");
@@ -1154,7 +1305,9 @@ uint32_t ServoPWMController::getRemainingIrrigationTime() const {
     }
     
     uint32_t elapsed = (millis() - stateStartTime) / 1000;
-    uint32_t total = zones[currentZone].config.irrigationTime;
+    uint32_t total = scheduler.isRunning(&soakProgram)
+        ? zones[currentZone].pulseDuration        // Ciclo y remojo: pulso en curso
+        : zones[currentZone].config.irrigationTime;
     
     return (elapsed < total) ? (total - elapsed) : 0;
 }
@@ -1173,13 +1326,39 @@ bool ServoPWMController::hasErrors() const {
     }
     
     // Verificar si alguna zona está en error
-    for (uint8_t i = 0; i < totalZones; i++) {
-        if (zones[i].currentState == ServoState::ERROR) {
-            return true;
-        }
-    }
-    
-    return false;
+    return errorZones.any();
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Se arma la foto completa en la pila y se publica de una vez: el seqlock
+ * copia ~100 bytes, así que publicar en cada pasada del loop cuesta menos
+ * que cualquier lectura de red. Los lectores ven la pasada anterior entera
+ * o la nueva entera, nunca una mezcla.
+ */
+void ServoPWMController::publishSnapshot() {
+    ControllerSnapshot next;
+    memset(&next, 0, sizeof(next));
+    next.publishedAt = millis();
+    next.state = systemState;
+    next.activeZone = getCurrentActiveZone();
+    next.remainingTime = getRemainingIrrigationTime();
+    next.hasErrors = hasErrors();
+    next.wateringMode = wateringMode;
+    next.totalCycles = totalCyclesCompleted;
+    next.totalWateringTime = totalWateringTime;
+    next.pulseSequence = pulseSequence;
+    next.zoneCount = totalZones < NUM_SERVOS ? totalZones : NUM_SERVOS;
+    for (uint8_t i = 0; i < next.zoneCount; i++) {
+        next.zones[i].state = zones[i].currentState;
+        next.zones[i].enabled = enabledZones.test(i);
+        next.zones[i].irrigationTime = zones[i].config.irrigationTime;
+    }
+    snapshot.write(next);
+}
+
+void ServoPWMController::getSnapshot(ControllerSnapshot& out) const {
+    snapshot.read(out);
 }
 
 const ZoneInfo* ServoPWMController::getZoneInfo(uint8_t zoneNumber) const {
@@ -1189,6 +1368,30 @@ const ZoneInfo* ServoPWMController::getZoneInfo(uint8_t zoneNumber) const {
     return &zones[zoneNumber - 1];
 }
 
+bool ServoPWMController::isQuiescent() const {
+    if ((systemState != IrrigationState::IDLE && systemState != IrrigationState::COMPLETED) ||
+        scheduler.activeCount() != 0 || openZones.any()) {
+        return false;
+    }
+    
+    // Una zona CLOSING (cierre manual aún sin asentar) sigue recibiendo pulsos
+    for (uint8_t i = 0; i < totalZones; i++) {
+        if (zones[i].currentState == ServoState::CLOSING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ServoPWMController::parkOutputs(bool parked) {
+    uint32_t closedPulse = parked ? 0 : angleToHaltValue(SERVO_CLOSED_ANGLE);
+    for (uint8_t i = 0; i < totalZones; i++) {
+        if (zones[i].currentState == ServoState::CLOSED) {
+            ledcWrite(zones[i].pwmChannel, closedPulse);
+        }
+    }
+}
+
 void ServoPWMController::printSystemStatus() const {
     const_cast<ServoPWMController*>(this)->generateStatusReport();
 }
@@ -1214,14 +1417,22 @@ bool ServoPWMController::openZoneValve(uint8_t zoneNumber, uint32_t duration) {
     
     // Mover servo a posición abierta
     if (moveServoToAngle(zoneIndex, zones[zoneIndex].config.openAngle)) {
-        zones[zoneIndex].currentState = ServoState::OPENING;
+        setServoState(zoneIndex, ServoState::OPENING);
         zones[zoneIndex].lastActionTime = millis();
         
+        // Con la válvula de zona en marcha, habilitar el suministro principal
+        setMainValve(true);
+        EventHistory::getInstance().record(HistoryEvent::MANUAL_OPEN, zoneNumber, duration);
+        
         // Si se especifica duración, programar cierre automático
-        // (Esta funcionalidad se podría implementar con un temporizador)
         if (duration > 0) {
-            Serial.println("[INFO] Válvula se cerrará automáticamente en " + String(duration) + " segundos.");
-            // TODO: Implementar temporizador para cierre automático
+            zonePrograms[zoneIndex].configure(zoneIndex, duration);
+            if (scheduler.start(&zonePrograms[zoneIndex])) {
+                Serial.println("[INFO] Válvula se cerrará automáticamente en " + String(duration) + " segundos.");
+            } else {
+                Serial.println("[ADVERTENCIA] Sin ranuras libres: la zona " + String(zoneNumber) +
+                              " no se cerrará automáticamente.");
+            }
         }
         
         return true;
@@ -1240,9 +1451,20 @@ bool ServoPWMController::closeZoneValve(uint8_t zoneNumber) {
     
     Serial.println("[INFO] Cerrando manualmente válvula de zona " + String(zoneNumber));
     
+    // Cancelar un cierre temporizado pendiente para esta zona
+    scheduler.stop(&zonePrograms[zoneIndex]);
+    
+    // Si es la única válvula abierta, cerrar antes la válvula principal
+    ZoneSet otherOpen = openZones;
+    otherOpen.reset(zoneIndex);
+    if (!otherOpen.any()) {
+        setMainValve(false);
+    }
+    
     if (moveServoToAngle(zoneIndex, SERVO_CLOSED_ANGLE)) {
-        zones[zoneIndex].currentState = ServoState::CLOSING;
+        setServoState(zoneIndex, ServoState::CLOSING);
         zones[zoneIndex].lastActionTime = millis();
+        EventHistory::getInstance().record(HistoryEvent::MANUAL_CLOSE, zoneNumber);
         return true;
     }
     
@@ -1256,7 +1478,7 @@ bool ServoPWMController::setZoneEnabled(uint8_t zoneNumber, bool enabled) {
     }
     
     uint8_t zoneIndex = zoneNumber - 1;
-    zones[zoneIndex].isEnabled = enabled;
+    enabledZones.assign(zoneIndex, enabled);
     
     Serial.println("[INFO] Zona " + String(zoneNumber) + " " + 
                   String(enabled ? "habilitada" : "deshabilitada"));
@@ -1286,6 +1508,117 @@ bool ServoPWMController::setZoneIrrigationTime(uint8_t zoneNumber, uint32_t seco
     return true;
 }
 
+bool ServoPWMController::applyZoneSettings(uint8_t zoneNumber, bool enabled, uint32_t irrigationTimeSec,
+                                           uint8_t openAngle, uint32_t transitionTimeMs) {
+    if (zoneNumber == 0 || zoneNumber > totalZones) {
+        Serial.println("[ERROR] Número de zona inválido: " + String(zoneNumber));
+        return false;
+    }
+    
+    if (irrigationTimeSec < MIN_IRRIGATION_TIME_SECONDS || irrigationTimeSec > MAX_IRRIGATION_TIME_SECONDS ||
+        openAngle > 180) {
+        Serial.println("[ERROR] Ajustes fuera de rango para zona " + String(zoneNumber));
+        return false;
+    }
+    
+    uint8_t zoneIndex = zoneNumber - 1;
+    ZoneInfo& zone = zones[zoneIndex];
+    
+    zone.config.irrigationTime = irrigationTimeSec;
+    zone.transitionTimeMs = transitionTimeMs;
+    
+    // Una zona que handleServoError deshabilitó sigue deshabilitada aunque
+    // la configuración la pida habilitada: volver a aplicar los ajustes no
+    // arregla el servo. Salir de ERROR (cierre de todas las válvulas al
+    // parar, o reinicio del controlador) no la rehabilita por sí solo:
+    // ZoneConfigBinder solo vuelve a llamar aquí cuando cambia la sección
+    // de esa zona, así que hace falta editar su configuración (o
+    // setZoneEnabled) con el servo ya fuera de ERROR
+    if (enabled && errorZones.test(zoneIndex)) {
+        enabled = false;
+        Serial.println("[WARNING] Zona " + String(zoneNumber) + " en error: se mantiene deshabilitada");
+    }
+    enabledZones.assign(zoneIndex, enabled);
+    
+    // Con la válvula abierta y quieta, el ángulo nuevo se nota ya. Durante
+    // un movimiento o un traspaso, el propio programa lo recoge al releerlo.
+    if (zone.config.openAngle != openAngle) {
+        zone.config.openAngle = openAngle;
+        if (zone.currentState == ServoState::OPEN) {
+            writeServoAngle(zoneIndex, openAngle);
+        }
+    }
+    
+    Serial.println("[INFO] Zona " + String(zoneNumber) + " reconfigurada: " +
+                  String(enabled ? "habilitada" : "deshabilitada") + ", " +
+                  String(irrigationTimeSec) + " s, " + String(openAngle) + "°, transición " +
+                  String(transitionTimeMs) + " ms");
+    
+    return true;
+}
+
+void ServoPWMController::setOverlappedHandoff(bool enabled) {
+    overlappedHandoff = enabled;
+    Serial.println("[INFO] Traspaso solapado entre zonas " + String(enabled ? "habilitado" : "deshabilitado"));
+}
+
+bool ServoPWMController::isOverlappedHandoffEnabled() const {
+    return overlappedHandoff;
+}
+
+bool ServoPWMController::setWateringMode(WateringMode mode, uint8_t pulses, uint32_t soakSeconds) {
+    if (mode == WateringMode::SOAK_CYCLE) {
+        if (pulses == 0 || pulses > SOAK_MAX_PULSES) {
+            Serial.println("[ERROR] Número de pulsos fuera de rango (1-" + String(SOAK_MAX_PULSES) + ")");
+            return false;
+        }
+        if (soakSeconds < SOAK_INTERVAL_LIMIT_MIN_SECONDS || soakSeconds > SOAK_INTERVAL_LIMIT_MAX_SECONDS) {
+            Serial.println("[ERROR] Intervalo de remojo fuera de rango (" +
+                          String(SOAK_INTERVAL_LIMIT_MIN_SECONDS) + "-" +
+                          String(SOAK_INTERVAL_LIMIT_MAX_SECONDS) + " segundos)");
+            return false;
+        }
+        soakPulses = pulses;
+        soakIntervalSec = soakSeconds;
+    }
+    
+    wateringMode = mode;
+    
+    Serial.println("[INFO] Modo de riego: " + String(wateringModeToString(mode)) +
+                  (mode == WateringMode::SOAK_CYCLE
+                      ? " (" + String(soakPulses) + " pulsos, remojo " + String(soakIntervalSec) + "s)"
+                      : String("")) +
+                  ". Se aplicará en el próximo ciclo.");
+    return true;
+}
+
+WateringMode ServoPWMController::getWateringMode() const {
+    return wateringMode;
+}
+
+uint32_t ServoPWMController::getPulseSequence() const {
+    return pulseSequence;
+}
+
+bool ServoPWMController::getPulseRecord(uint32_t sequence, PulseRecord& record) const {
+    // Aún no registrado, o ya sobrescrito por pulsos más recientes
+    if (sequence == 0 || sequence > pulseSequence ||
+        pulseSequence - sequence >= PULSE_TELEMETRY_BUFFER_SIZE) {
+        return false;
+    }
+    
+    record = pulseLog[(sequence - 1) % PULSE_TELEMETRY_BUFFER_SIZE];
+    return true;
+}
+
+const char* ServoPWMController::wateringModeToString(WateringMode mode) {
+    switch (mode) {
+        case WateringMode::CONTINUOUS: return "continuo";
+        case WateringMode::SOAK_CYCLE: return "remojo";
+        default: return "desconocido";
+    }
+}
+
 // =============================================================================
 // Métodos de Utilidad
 // =============================================================================
@@ -1298,6 +1631,7 @@ const char* ServoPWMController::stateToString(IrrigationState state) {
         case IrrigationState::IRRIGATING: return "REGANDO";
         case IrrigationState::CLOSING_VALVE: return "CERRANDO_VALVULA";
         case IrrigationState::TRANSITIONING: return "TRANSICIONANDO";
+        case IrrigationState::HANDOFF: return "TRASPASO";
         case IrrigationState::COMPLETED: return "COMPLETADO";
         case IrrigationState::ERROR: return "ERROR";
         default: return "DESCONOCIDO";
@@ -1340,6 +1674,8 @@ ServoControlState ServoPWMController::getState() const {
             return ServoControlState::MOVING_TO_CLOSE;
         case IrrigationState::TRANSITIONING: 
             return ServoControlState::CLOSED;
+        case IrrigationState::HANDOFF: 
+            return ServoControlState::OPEN;
         case IrrigationState::COMPLETED: 
             return ServoControlState::CLOSED;
         case IrrigationState::ERROR: 
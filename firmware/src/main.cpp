@@ -29,6 +29,9 @@
  * @date 2025
  */
 
+// Las pruebas de `pio test` compilan firmware/src con su propio setup()/loop()
+#ifndef PIO_UNIT_TESTING
+
 // =============================================================================
 // Includes Esenciales
 // =============================================================================
@@ -40,6 +43,8 @@
 
 // Módulos del proyecto
 #include "core/SystemManager.h"
+#include "core/SerialProvisioning.h"
+#include "core/PowerManager.h"
 #include "network/WebControl.h"
 #include "utils/SET_PIN.h"      // Configuración de pines
 #include "drivers/ServoPWMController.h"  // Controlador de servo multi-zona con PWM nativo ESP32
@@ -93,6 +98,8 @@ SystemManager* sistemaRiego = nullptr;
  */
 void setup() {
     // **FASE 1: COMUNICACIÓN Y LOGGING**
+    // Buffer de transmisión para que los volcados de SerialProvisioning no bloqueen el loop
+    Serial.setTxBufferSize(SerialProvisioningConfig::TX_BUFFER_BYTES);
     Serial.begin(SystemDebug::SERIAL_BAUD_RATE);
     delay(2000); // Estabilización del puerto serie
     
@@ -263,8 +270,9 @@ void loop() {
     
     // **COOPERACIÓN CON EL SISTEMA ESP32**
     // Importante: Permitir que el ESP32 maneje tareas internas
-    // como WiFi, TCP/IP, y garbage collection
-    yield();
+    // como WiFi, TCP/IP, y garbage collection. Sin riego pendiente, además,
+    // el loop espera aquí hasta el próximo plazo (ver PowerManager.h)
+    PowerManager::getInstance().idle();
     
     // **DEBUGGING DE RENDIMIENTO OPCIONAL**
     #if 0
@@ -295,3 +303,5 @@ void loop() {
  */
 
 // [Espacio reservado para futuras expansiones]
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,193 @@
+/**
+ * @file AdmissionControl.cpp
+ * @brief Política de admisión: margen de heap, reservas recientes y coste medido.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * El coste de un cliente WebSocket no es una constante del código: depende
+ * de la versión de la biblioteca, de los buffers de lwIP y de lo que el
+ * cliente tenga en cola. Se estima comparando el heap libre con el que
+ * había la última vez que no quedaba ningún cliente, repartido entre los
+ * clientes actuales y suavizado (1/4 de cada medida nueva). Otras
+ * peticiones en curso inflan la medida; por eso se acota en
+ * WS_CLIENT_MAX_BYTES: en la duda, el error es rechazar de más, nunca
+ * quedarse sin memoria.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/network/AdmissionControl.h"
+#include "../../include/core/MetricsRegistry.h"
+#include "utils/Logger.h"
+#include <string.h>
+
+using namespace AdmissionConfig;
+
+AdmissionControl::AdmissionControl()
+    : nextReservation(0), webSocketClients(0), idleHeap(0), clientCost(WS_CLIENT_MIN_BYTES), started(false) {
+    memset(reservations, 0, sizeof(reservations));
+    memset(rejected, 0, sizeof(rejected));
+}
+
+void AdmissionControl::begin() {
+    if (started) {
+        return;
+    }
+    started = true;
+    registerMetrics();
+}
+
+AdmissionDecision AdmissionControl::admit(AdmissionClass kind) {
+    return admit(kind, ESP.getFreeHeap(), ESP.getMaxAllocHeap(), millis());
+}
+
+AdmissionDecision AdmissionControl::admit(AdmissionClass kind, uint32_t freeHeap, uint32_t largestBlock,
+                                          uint32_t now) {
+    measureClientCost(freeHeap);
+
+    AdmissionDecision decision = AdmissionDecision::ADMIT;
+    uint32_t cost = costOf(kind);
+    uint32_t reserved = reservedBytes(now);
+    uint32_t available = freeHeap > reserved ? freeHeap - reserved : 0;
+
+    if (kind == AdmissionClass::WEBSOCKET && webSocketClients >= MAX_WS_CLIENTS) {
+        decision = AdmissionDecision::TOO_MANY_CLIENTS;
+    } else if (available < HEAP_RESERVE_BYTES + cost) {
+        decision = AdmissionDecision::LOW_HEAP;
+    } else if (largestBlock < MIN_BLOCK_BYTES) {
+        decision = AdmissionDecision::FRAGMENTED;
+    }
+
+    if (decision != AdmissionDecision::ADMIT) {
+        rejected[static_cast<uint8_t>(kind)]++;
+        LOG_WARNING("[ADMISSION] " + String(classToString(kind)) + " rechazada (" +
+                    String(decisionToString(decision)) + "): heap " + String(freeHeap) + " B, reservado " +
+                    String(reserved) + " B, bloque " + String(largestBlock) + " B");
+        return decision;
+    }
+
+    reserve(cost, now);
+    return decision;
+}
+
+uint32_t AdmissionControl::costOf(AdmissionClass kind) const {
+    switch (kind) {
+        case AdmissionClass::UPLOAD:    return UPLOAD_REQUEST_BYTES;
+        case AdmissionClass::WEBSOCKET: return clientCost;
+        default:                        return HTTP_REQUEST_BYTES;
+    }
+}
+
+uint32_t AdmissionControl::reservedBytes(uint32_t now) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < MAX_RESERVATIONS; i++) {
+        if (reservations[i].bytes == 0) {
+            continue;
+        }
+        if (now - reservations[i].at >= RESERVATION_MS) {
+            reservations[i].bytes = 0;          // Ya se refleja en el heap (o ya terminó)
+            continue;
+        }
+        total += reservations[i].bytes;
+    }
+    return total;
+}
+
+void AdmissionControl::reserve(uint32_t bytes, uint32_t now) {
+    // Anillo: si todas están vivas se pisa la más antigua, que es la que
+    // antes habrá llegado al heap
+    reservations[nextReservation].bytes = bytes;
+    reservations[nextReservation].at = now;
+    nextReservation = (nextReservation + 1) % MAX_RESERVATIONS;
+}
+
+void AdmissionControl::measureClientCost(uint32_t freeHeap) {
+    if (webSocketClients == 0) {
+        idleHeap = freeHeap;
+        return;
+    }
+    if (idleHeap == 0) {
+        return;                                 // Aún no hay referencia sin clientes
+    }
+
+    uint32_t used = idleHeap > freeHeap ? idleHeap - freeHeap : 0;
+    uint32_t measured = used / webSocketClients;
+    if (measured < WS_CLIENT_MIN_BYTES) {
+        measured = WS_CLIENT_MIN_BYTES;
+    } else if (measured > WS_CLIENT_MAX_BYTES) {
+        measured = WS_CLIENT_MAX_BYTES;
+    }
+    clientCost = (clientCost * 3 + measured) / 4;
+}
+
+void AdmissionControl::webSocketConnected() {
+    if (webSocketClients < 0xFF) {
+        webSocketClients++;
+    }
+}
+
+void AdmissionControl::webSocketDisconnected() {
+    if (webSocketClients > 0) {
+        webSocketClients--;
+    }
+}
+
+uint32_t AdmissionControl::getRejectedCount(AdmissionClass kind) const {
+    return kind < AdmissionClass::COUNT ? rejected[static_cast<uint8_t>(kind)] : 0;
+}
+
+uint32_t AdmissionControl::retryAfterSeconds(AdmissionDecision decision) {
+    return decision == AdmissionDecision::TOO_MANY_CLIENTS ? CLIENT_RETRY_AFTER_S : RETRY_AFTER_S;
+}
+
+const char* AdmissionControl::classToString(AdmissionClass kind) {
+    switch (kind) {
+        case AdmissionClass::HTTP:      return "http";
+        case AdmissionClass::UPLOAD:    return "upload";
+        case AdmissionClass::WEBSOCKET: return "websocket";
+        default:                        return "unknown";
+    }
+}
+
+const char* AdmissionControl::decisionToString(AdmissionDecision decision) {
+    switch (decision) {
+        case AdmissionDecision::ADMIT:            return "admit";
+        case AdmissionDecision::LOW_HEAP:         return "low_heap";
+        case AdmissionDecision::FRAGMENTED:       return "fragmented";
+        case AdmissionDecision::TOO_MANY_CLIENTS: return "too_many_clients";
+        default:                                  return "unknown";
+    }
+}
+
+// =============================================================================
+// Métricas
+// =============================================================================
+
+void AdmissionControl::registerMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+
+    registry.add("riego_admission_rejected_total", "Conexiones rechazadas por falta de memoria o de plaza",
+        MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const AdmissionControl* admission = static_cast<const AdmissionControl*>(family.context);
+            if (index >= static_cast<uint8_t>(AdmissionClass::COUNT)) {
+                return MetricSample::DONE;
+            }
+            AdmissionClass kind = static_cast<AdmissionClass>(index);
+            line.begin(family.name);
+            line.label("class", classToString(kind));
+            line.value(admission->getRejectedCount(kind));
+            return MetricSample::EMITTED;
+        }, this);
+    registry.add("riego_admission_websocket_client_bytes", "Coste estimado de un cliente WebSocket",
+        MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const AdmissionControl* admission = static_cast<const AdmissionControl*>(family.context);
+            return singleSample(family, index, line, admission->costOf(AdmissionClass::WEBSOCKET));
+        }, this);
+    registry.add("riego_heap_largest_block_bytes", "Bloque libre más grande del heap", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            return singleSample(family, index, line, ESP.getMaxAllocHeap());
+        });
+}
@@ -0,0 +1,539 @@
+/**
+ * @file MqttTelemetry.cpp
+ * @brief Implementación del publicador MQTT con lotes y spool en SPIFFS.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "MqttTelemetry.h"
+#include <WiFi.h>
+#include <SPIFFS.h>
+#include <string.h>
+#include <stdio.h>
+#include "ServoPWMController.h"
+#include "MetricsRegistry.h"
+#include "Logger.h"
+
+MqttTelemetry::MqttTelemetry()
+    : client(nullptr)
+    , controller(nullptr)
+    , connected(false)
+    , recentAckHead(0)
+    , batchCount(0)
+    , lastSampleTime(0)
+    , lastState(0)
+    , lastZone(0)
+    , stateKnown(false)
+    , spoolPending(false)
+    , replayOffset(0)
+    , replayNextOffset(0)
+    , replayMsgId(0)
+    , replaySentAt(0)
+    , publishedCount(0)
+    , spooledCount(0)
+    , replayedCount(0)
+    , droppedCount(0)
+{
+    deviceId[0] = '\0';
+    topicStatus[0] = '\0';
+    topicState[0] = '\0';
+    topicTelemetry[0] = '\0';
+    topicCommands[0] = '\0';
+    topicCommandResult[0] = '\0';
+    for (uint8_t i = 0; i < RECENT_ACKS; i++) {
+        recentAcks[i] = 0;
+    }
+}
+
+// =============================================================================
+// Arranque y parada
+// =============================================================================
+
+bool MqttTelemetry::begin(ServoPWMController* irrigationController, const char* brokerUri) {
+    if (client) {
+        return true;
+    }
+
+    if (brokerUri == nullptr || brokerUri[0] == '\0') {
+        LOG_INFO("[MQTT] Sin broker configurado (MQTT_BROKER_URI) - MQTT desactivado");
+        return false;
+    }
+
+    controller = irrigationController;
+
+    // Identificador estable: los 3 últimos bytes de la MAC
+    uint64_t mac = ESP.getEfuseMac();
+    snprintf(deviceId, sizeof(deviceId), "riego-%02x%02x%02x",
+             (unsigned)((mac >> 24) & 0xFF), (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+
+    const char* root = MqttConfig::TOPIC_ROOT;
+    snprintf(topicStatus, sizeof(topicStatus), "%s/%s/status", root, deviceId);
+    snprintf(topicState, sizeof(topicState), "%s/%s/state", root, deviceId);
+    snprintf(topicTelemetry, sizeof(topicTelemetry), "%s/%s/telemetry", root, deviceId);
+    snprintf(topicCommands, sizeof(topicCommands), "%s/%s/cmd/", root, deviceId);
+    snprintf(topicCommandResult, sizeof(topicCommandResult), "%s/%s/cmd_result", root, deviceId);
+
+    /**
+     * EXPLICACIÓN EDUCATIVA:
+     * El "testamento" (LWT) lo publica el broker por nosotros si la conexión
+     * se corta sin despedirse: así cualquier suscriptor sabe que el equipo
+     * está "offline" aunque se haya quedado sin corriente.
+     */
+    esp_mqtt_client_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.uri = brokerUri;
+    config.client_id = deviceId;
+    config.keepalive = MqttConfig::KEEPALIVE_SECONDS;
+    config.reconnect_timeout_ms = MqttConfig::RECONNECT_INTERVAL_MS;
+    config.lwt_topic = topicStatus;
+    config.lwt_msg = "offline";
+    config.lwt_qos = 1;
+    config.lwt_retain = 1;
+
+    client = esp_mqtt_client_init(&config);
+    if (!client) {
+        LOG_ERROR("[MQTT] No se pudo crear el cliente MQTT");
+        return false;
+    }
+
+    esp_mqtt_client_register_event(client, static_cast<esp_mqtt_event_id_t>(ESP_EVENT_ANY_ID),
+                                   &MqttTelemetry::onMqttEvent, this);
+
+    if (esp_mqtt_client_start(client) != ESP_OK) {
+        LOG_ERROR("[MQTT] No se pudo arrancar el cliente MQTT");
+        esp_mqtt_client_destroy(client);
+        client = nullptr;
+        return false;
+    }
+
+    // Lo que quedó en el spool de un arranque anterior se reenvía al conectar
+    spoolPending = spoolHasData();
+    lastSampleTime = millis();
+    registerMetrics();
+
+    LOG_INFO("[MQTT] Cliente " + String(deviceId) + " arrancado contra " + String(brokerUri));
+    if (spoolPending) {
+        LOG_INFO("[MQTT] Hay mensajes en el spool pendientes de reenvío");
+    }
+    return true;
+}
+
+void MqttTelemetry::end() {
+    if (!client) {
+        return;
+    }
+
+    MetricsRegistry::getInstance().removeContext(this);
+    esp_mqtt_client_stop(client);
+    esp_mqtt_client_destroy(client);
+    client = nullptr;
+    connected = false;
+    replayMsgId = 0;
+}
+
+void MqttTelemetry::registerMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    registry.add("riego_mqtt_connected", "Conexión con el broker MQTT (1 = conectado)", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const MqttTelemetry* mqtt = static_cast<const MqttTelemetry*>(family.context);
+            return singleSample(family, index, line, mqtt->connected ? 1 : 0);
+        }, this);
+    registry.add("riego_mqtt_messages_total", "Mensajes MQTT por destino", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const MqttTelemetry* mqtt = static_cast<const MqttTelemetry*>(family.context);
+            static const char* const outcomes[] = { "published", "spooled", "replayed", "dropped" };
+            if (index >= 4) {
+                return MetricSample::DONE;
+            }
+            const uint32_t values[] = { mqtt->publishedCount, mqtt->spooledCount,
+                                        mqtt->replayedCount, mqtt->droppedCount };
+            line.begin(family.name);
+            line.label("outcome", outcomes[index]);
+            line.value(values[index]);
+            return MetricSample::EMITTED;
+        }, this);
+}
+
+void MqttTelemetry::getStatistics(uint32_t& published, uint32_t& spooled, uint32_t& replayed, uint32_t& dropped) const {
+    published = publishedCount;
+    spooled = spooledCount;
+    replayed = replayedCount;
+    dropped = droppedCount;
+}
+
+// =============================================================================
+// Tarea MQTT: eventos de esp-mqtt
+// =============================================================================
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Este manejador corre en la tarea de esp-mqtt, no en el loop. Por eso solo
+ * toca banderas volátiles y la CommandQueue (segura entre tareas); nunca el
+ * controlador de riego ni SPIFFS.
+ */
+void MqttTelemetry::onMqttEvent(void* handlerArgs, esp_event_base_t base, int32_t eventId, void* eventData) {
+    (void)base;
+    MqttTelemetry* self = static_cast<MqttTelemetry*>(handlerArgs);
+    esp_mqtt_event_handle_t event = static_cast<esp_mqtt_event_handle_t>(eventData);
+
+    switch (static_cast<esp_mqtt_event_id_t>(eventId)) {
+        case MQTT_EVENT_CONNECTED: {
+            char filter[MqttConfig::MAX_TOPIC + 2];
+            snprintf(filter, sizeof(filter), "%s+", self->topicCommands);
+            esp_mqtt_client_subscribe(self->client, filter, 1);
+            esp_mqtt_client_publish(self->client, self->topicStatus, "online", 0, 1, 1);
+            self->connected = true;
+            break;
+        }
+
+        case MQTT_EVENT_DISCONNECTED:
+            self->connected = false;
+            break;
+
+        case MQTT_EVENT_PUBLISHED:
+            self->rememberAck(event->msg_id);
+            break;
+
+        case MQTT_EVENT_DATA:
+            // Los comandos son cortos: un mensaje fragmentado no es un comando válido
+            if (event->current_data_offset != 0 || event->data_len != event->total_data_len) {
+                break;
+            }
+            self->handleIncomingCommand(event->topic, event->topic_len, event->data, event->data_len);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void MqttTelemetry::handleIncomingCommand(const char* topic, int topicLength, const char* data, int dataLength) {
+    int prefixLength = static_cast<int>(strlen(topicCommands));
+    if (topicLength <= prefixLength || strncmp(topic, topicCommands, prefixLength) != 0) {
+        return;
+    }
+
+    const char* command = topic + prefixLength;
+    int commandLength = topicLength - prefixLength;
+
+    bool queued = CommandQueue::getInstance().push(CommandSource::MQTT, 0,
+                                                   command, commandLength,
+                                                   data, dataLength > 0 ? dataLength : 0,
+                                                   &MqttTelemetry::onMqttCommandCompleted, this);
+    if (!queued) {
+        char payload[96];
+        int length = snprintf(payload, sizeof(payload), "{\"command\":\"%.*s\",\"success\":false,\"error\":\"busy\"}",
+                              commandLength < 32 ? commandLength : 32, command);
+        if (length > 0 && length < (int)sizeof(payload)) {
+            esp_mqtt_client_publish(client, topicCommandResult, payload, length, 1, 0);
+        }
+    }
+}
+
+void MqttTelemetry::rememberAck(int msgId) {
+    recentAcks[recentAckHead % RECENT_ACKS] = msgId;
+    recentAckHead = static_cast<uint8_t>(recentAckHead + 1);
+}
+
+bool MqttTelemetry::wasAcked(int msgId) const {
+    for (uint8_t i = 0; i < RECENT_ACKS; i++) {
+        if (recentAcks[i] == msgId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// Loop: muestreo, lotes y estado
+// =============================================================================
+
+void MqttTelemetry::update() {
+    if (!client) {
+        return;
+    }
+
+    uint32_t now = millis();
+    if (now - lastSampleTime >= MqttConfig::SAMPLE_INTERVAL_MS) {
+        lastSampleTime = now;
+        takeSample();
+        if (batchCount >= MqttConfig::SAMPLES_PER_BATCH) {
+            publishBatch();
+        }
+    }
+
+    publishStateIfChanged();
+
+    if (spoolPending && connected) {
+        replaySpool();
+    }
+}
+
+void MqttTelemetry::takeSample() {
+    TelemetrySample& sample = batch[batchCount++];
+    sample.uptimeSeconds = millis() / 1000;
+    sample.irrigationState = controller ? static_cast<uint8_t>(controller->getCurrentState()) : 0;
+    sample.activeZone = controller ? controller->getCurrentActiveZone() : 0;
+    sample.remainingSeconds = controller ? controller->getRemainingIrrigationTime() : 0;
+    sample.freeHeap = ESP.getFreeHeap();
+    sample.rssi = WiFi.isConnected() ? static_cast<int8_t>(WiFi.RSSI()) : 0;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * El lote va en forma de tabla: los nombres de los campos una sola vez y
+ * luego una fila por muestra. Seis muestras ocupan ~400 bytes en lugar de
+ * los ~900 que ocuparían seis objetos JSON con sus claves repetidas.
+ *
+ *     {"device":"riego-a1b2c3","interval":10,
+ *      "fields":["t","state","zone","remaining","heap","rssi"],
+ *      "samples":[[3600,"REGANDO",2,120,181232,-61], ...]}
+ */
+void MqttTelemetry::publishBatch() {
+    char payload[MqttConfig::MAX_PAYLOAD];
+    size_t length = 0;
+    bool overflow = false;
+
+    int written = snprintf(payload, sizeof(payload),
+                           "{\"device\":\"%s\",\"interval\":%lu,"
+                           "\"fields\":[\"t\",\"state\",\"zone\",\"remaining\",\"heap\",\"rssi\"],\"samples\":[",
+                           deviceId, (unsigned long)(MqttConfig::SAMPLE_INTERVAL_MS / 1000));
+    if (written < 0 || (size_t)written >= sizeof(payload)) {
+        overflow = true;
+    } else {
+        length = written;
+    }
+
+    for (uint8_t i = 0; i < batchCount && !overflow; i++) {
+        const TelemetrySample& s = batch[i];
+        written = snprintf(payload + length, sizeof(payload) - length,
+                           "%s[%lu,\"%s\",%u,%lu,%lu,%d]", i > 0 ? "," : "",
+                           (unsigned long)s.uptimeSeconds,
+                           ServoPWMController::stateToString(static_cast<IrrigationState>(s.irrigationState)),
+                           (unsigned)s.activeZone, (unsigned long)s.remainingSeconds,
+                           (unsigned long)s.freeHeap, (int)s.rssi);
+        if (written < 0 || (size_t)written >= sizeof(payload) - length) {
+            overflow = true;
+        } else {
+            length += written;
+        }
+    }
+
+    if (!overflow) {
+        written = snprintf(payload + length, sizeof(payload) - length, "]}");
+        overflow = written < 0 || (size_t)written >= sizeof(payload) - length;
+        if (!overflow) {
+            length += written;
+        }
+    }
+
+    batchCount = 0;
+
+    if (overflow) {
+        LOG_ERROR("[MQTT] Lote de telemetría mayor que MAX_PAYLOAD - descartado");
+        droppedCount++;
+        return;
+    }
+
+    publishOrSpool(MessageKind::TELEMETRY, payload, length);
+}
+
+void MqttTelemetry::publishStateIfChanged() {
+    uint8_t state = controller ? static_cast<uint8_t>(controller->getCurrentState()) : 0;
+    uint8_t zone = controller ? controller->getCurrentActiveZone() : 0;
+
+    if (stateKnown && state == lastState && zone == lastZone) {
+        return;
+    }
+
+    stateKnown = true;
+    lastState = state;
+    lastZone = zone;
+
+    char payload[128];
+    int length = snprintf(payload, sizeof(payload), "{\"state\":\"%s\",\"zone\":%u,\"remaining\":%lu,\"t\":%lu}",
+                          ServoPWMController::stateToString(static_cast<IrrigationState>(state)),
+                          (unsigned)zone,
+                          (unsigned long)(controller ? controller->getRemainingIrrigationTime() : 0),
+                          (unsigned long)(millis() / 1000));
+    if (length > 0 && length < (int)sizeof(payload)) {
+        publishOrSpool(MessageKind::STATE, payload, length);
+    }
+}
+
+void MqttTelemetry::onMqttCommandCompleted(const QueuedCommand& command, bool success, void* context) {
+    MqttTelemetry* self = static_cast<MqttTelemetry*>(context);
+    // El resultado solo interesa en vivo: sin conexión no se guarda en el spool
+    if (!self || !self->client || !self->connected) {
+        return;
+    }
+
+    char payload[128];
+    int length = snprintf(payload, sizeof(payload), "{\"command\":\"%s\",\"success\":%s,\"latencyMs\":%lu}",
+                          command.command, success ? "true" : "false",
+                          (unsigned long)(millis() - command.enqueuedAt));
+    if (length > 0 && length < (int)sizeof(payload)) {
+        esp_mqtt_client_enqueue(self->client, self->topicCommandResult, payload, length, 1, 0, true);
+    }
+}
+
+// =============================================================================
+// Publicación y spool
+// =============================================================================
+
+const char* MqttTelemetry::topicFor(MessageKind kind) const {
+    return kind == MessageKind::STATE ? topicState : topicTelemetry;
+}
+
+void MqttTelemetry::publishOrSpool(MessageKind kind, const char* payload, size_t length) {
+    // Con datos en el spool, lo nuevo espera detrás para conservar el orden
+    if (connected && !spoolPending && publishNow(kind, payload, length)) {
+        return;
+    }
+
+    if (appendToSpool(kind, payload, length)) {
+        spooledCount++;
+        spoolPending = true;
+    } else {
+        droppedCount++;
+    }
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * esp_mqtt_client_enqueue() no escribe en el socket: deja el mensaje en la
+ * bandeja de salida del cliente y vuelve enseguida. La tarea MQTT lo envía
+ * y lo reintenta hasta recibir el PUBACK. Solo se llama con conexión, cuando
+ * la tarea MQTT no está ocupada intentando conectar.
+ */
+bool MqttTelemetry::publishNow(MessageKind kind, const char* payload, size_t length) {
+    int msgId = esp_mqtt_client_enqueue(client, topicFor(kind), payload, length, 1,
+                                        kind == MessageKind::STATE ? 1 : 0, true);
+    if (msgId < 0) {
+        return false;
+    }
+    publishedCount++;
+    return true;
+}
+
+bool MqttTelemetry::spoolHasData() const {
+    return SPIFFS.exists(MqttConfig::SPOOL_PATH) || SPIFFS.exists(MqttConfig::SPOOL_REPLAY_PATH);
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * El spool son dos archivos. Se añade al primero; cuando se llena pasa a
+ * ser el segundo (el que se reenvía) y se empieza uno nuevo. Si el segundo
+ * ya existía, se pierden los mensajes más antiguos: el espacio en flash es
+ * limitado y lo reciente vale más.
+ */
+bool MqttTelemetry::appendToSpool(MessageKind kind, const char* payload, size_t length) {
+    File file = SPIFFS.open(MqttConfig::SPOOL_PATH, "a");
+    if (!file) {
+        LOG_ERROR("[MQTT] No se pudo abrir el spool");
+        return false;
+    }
+
+    if (file.size() + sizeof(SpoolRecordHeader) + length > MqttConfig::SPOOL_MAX_BYTES) {
+        file.close();
+        if (SPIFFS.exists(MqttConfig::SPOOL_REPLAY_PATH)) {
+            LOG_WARNING("[MQTT] Spool lleno - se descartan los mensajes más antiguos");
+            SPIFFS.remove(MqttConfig::SPOOL_REPLAY_PATH);
+            replayOffset = 0;
+            replayMsgId = 0;
+        }
+        SPIFFS.rename(MqttConfig::SPOOL_PATH, MqttConfig::SPOOL_REPLAY_PATH);
+
+        file = SPIFFS.open(MqttConfig::SPOOL_PATH, "a");
+        if (!file) {
+            return false;
+        }
+    }
+
+    SpoolRecordHeader header;
+    header.kind = static_cast<uint8_t>(kind);
+    header.reserved = 0;
+    header.length = static_cast<uint16_t>(length);
+
+    bool ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+              file.write(reinterpret_cast<const uint8_t*>(payload), length) == length;
+    file.close();
+    return ok;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * El reenvío es de "parada y espera": un registro en vuelo cada vez, y el
+ * desplazamiento de lectura solo avanza cuando llega su PUBACK. Si el
+ * equipo se reinicia a mitad, el archivo se reenvía desde el principio; con
+ * QoS1 eso es aceptable (entrega "al menos una vez": puede haber duplicados,
+ * nunca huecos).
+ */
+void MqttTelemetry::replaySpool() {
+    uint32_t now = millis();
+
+    if (replayMsgId != 0) {
+        if (wasAcked(replayMsgId)) {
+            replayOffset = replayNextOffset;
+            replayMsgId = 0;
+            replayedCount++;
+        } else if (now - replaySentAt < MqttConfig::REPLAY_ACK_TIMEOUT_MS) {
+            return;
+        } else {
+            replayMsgId = 0;    // Sin confirmación: reenviar el mismo registro
+        }
+    }
+
+    if (!SPIFFS.exists(MqttConfig::SPOOL_REPLAY_PATH)) {
+        if (!SPIFFS.exists(MqttConfig::SPOOL_PATH)) {
+            spoolPending = false;
+            LOG_INFO("[MQTT] Spool reenviado por completo");
+            return;
+        }
+        // Congelar el archivo actual: lo que llegue ahora irá a uno nuevo
+        SPIFFS.rename(MqttConfig::SPOOL_PATH, MqttConfig::SPOOL_REPLAY_PATH);
+        replayOffset = 0;
+    }
+
+    File file = SPIFFS.open(MqttConfig::SPOOL_REPLAY_PATH, "r");
+    if (!file) {
+        return;
+    }
+
+    if (replayOffset >= file.size()) {
+        file.close();
+        SPIFFS.remove(MqttConfig::SPOOL_REPLAY_PATH);
+        replayOffset = 0;
+        return;
+    }
+
+    SpoolRecordHeader header;
+    char payload[MqttConfig::MAX_PAYLOAD];
+    bool valid = file.seek(replayOffset) &&
+                 file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                 header.kind <= static_cast<uint8_t>(MessageKind::STATE) &&
+                 header.length <= sizeof(payload) &&
+                 file.read(reinterpret_cast<uint8_t*>(payload), header.length) == header.length;
+    file.close();
+
+    if (!valid) {
+        LOG_ERROR("[MQTT] Registro corrupto en el spool - se descarta el resto del archivo");
+        SPIFFS.remove(MqttConfig::SPOOL_REPLAY_PATH);
+        replayOffset = 0;
+        droppedCount++;
+        return;
+    }
+
+    MessageKind kind = static_cast<MessageKind>(header.kind);
+    int msgId = esp_mqtt_client_enqueue(client, topicFor(kind), payload, header.length, 1,
+                                        kind == MessageKind::STATE ? 1 : 0, true);
+    if (msgId <= 0) {
+        return;     // Bandeja llena: se reintenta en la próxima vuelta
+    }
+
+    replayMsgId = msgId;
+    replaySentAt = now;
+    replayNextOffset = replayOffset + sizeof(header) + header.length;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file StatusPublisher.cpp
+ * @brief Comparación del estado con el último enviado y tabla de pestañas ocultas.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/network/StatusPublisher.h"
+#include <string.h>
+
+using namespace StatusPublisherConfig;
+
+StatusPublisher::StatusPublisher() : hasSent(false), lastSentAt(0) {
+    lastSent.activeZone = 0;
+    lastSent.remainingTime = 0;
+    lastSent.hasErrors = false;
+    memset(hiddenClients, 0, sizeof(hiddenClients));
+    memset(pendingHello, 0, sizeof(pendingHello));
+    memset(sentCount, 0, sizeof(sentCount));
+}
+
+PublishReason StatusPublisher::evaluate(const SystemStatus& status, uint32_t now,
+                                        uint32_t connectedClients, bool forced) const {
+    if (connectedClients == 0) {
+        return PublishReason::NONE;
+    }
+    if (forced) {
+        return PublishReason::FORCED;
+    }
+    if (!hasSent) {
+        return PublishReason::TRANSITION;
+    }
+
+    uint32_t sinceSent = now - lastSentAt;
+    bool transition = isTransition(status);
+
+    // Un error nuevo sale siempre, mire quien mire
+    if (status.hasErrors && !lastSent.hasErrors) {
+        return PublishReason::TRANSITION;
+    }
+
+    // Todas las pestañas ocultas: un resumen de vez en cuando, si algo cambió
+    if (!hasVisibleClients(connectedClients)) {
+        bool changed = transition || status.remainingTime != lastSent.remainingTime;
+        return changed && sinceSent >= HIDDEN_INTERVAL_MS ? PublishReason::REFRESH : PublishReason::NONE;
+    }
+
+    if (transition) {
+        return PublishReason::TRANSITION;
+    }
+    if (status.remainingTime != lastSent.remainingTime &&
+        (sinceSent >= COUNTDOWN_INTERVAL_MS || isCountdownOff(status, now))) {
+        return PublishReason::COUNTDOWN;
+    }
+    if (sinceSent >= IDLE_INTERVAL_MS) {
+        return PublishReason::REFRESH;
+    }
+    return PublishReason::NONE;
+}
+
+void StatusPublisher::markSent(const SystemStatus& status, uint32_t now, PublishReason reason) {
+    lastSent = status;
+    lastSentAt = now;
+    hasSent = true;
+    if (reason < PublishReason::COUNT) {
+        sentCount[static_cast<uint8_t>(reason)]++;
+    }
+}
+
+bool StatusPublisher::isTransition(const SystemStatus& status) const {
+    if (status.irrigationState != lastSent.irrigationState ||
+        status.activeZone != lastSent.activeZone ||
+        status.hasErrors != lastSent.hasErrors ||
+        status.humidityPercent != lastSent.humidityPercent) {
+        return true;
+    }
+    for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+        // La válvula cuenta aunque no cambie el estado del ciclo (un
+        // TimedZoneProgram que cierra solo, una apertura manual)
+        if (status.zonesEnabled[i] != lastSent.zonesEnabled[i] || status.zoneTimes[i] != lastSent.zoneTimes[i] ||
+            status.zoneValveStates[i] != lastSent.zoneValveStates[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StatusPublisher::isCountdownOff(const SystemStatus& status, uint32_t now) const {
+    // Lo que muestra el cliente: el último valor enviado menos el tiempo transcurrido
+    uint32_t elapsed = (now - lastSentAt) / 1000;
+    uint32_t expected = lastSent.remainingTime > elapsed ? lastSent.remainingTime - elapsed : 0;
+    uint32_t drift = status.remainingTime > expected ? status.remainingTime - expected
+                                                     : expected - status.remainingTime;
+    return drift > COUNTDOWN_DRIFT_S;
+}
+
+bool StatusPublisher::hasVisibleClients(uint32_t connectedClients) const {
+    uint32_t hidden = 0;
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (hiddenClients[i] != 0) {
+            hidden++;
+        }
+    }
+    return connectedClients > hidden;
+}
+
+bool StatusPublisher::setClientHidden(uint32_t clientId, bool hidden) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (hiddenClients[i] == clientId) {
+            if (!hidden) {
+                hiddenClients[i] = 0;
+                return true;
+            }
+            return false;               // Ya estaba oculto
+        }
+    }
+    if (!hidden) {
+        return false;                   // Ya estaba visible
+    }
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (hiddenClients[i] == 0) {
+            hiddenClients[i] = clientId;
+            return false;
+        }
+    }
+    return false;                       // Sin hueco: se trata como visible
+}
+
+bool StatusPublisher::awaitHello(uint32_t clientId, uint32_t now) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (pendingHello[i].clientId == 0) {
+            pendingHello[i].connectedAt = now;
+            pendingHello[i].clientId = clientId;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StatusPublisher::helloReceived(uint32_t clientId) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (pendingHello[i].clientId == clientId) {
+            pendingHello[i].clientId = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t StatusPublisher::takeHelloTimeout(uint32_t now) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        uint32_t clientId = pendingHello[i].clientId;
+        if (clientId != 0 && now - pendingHello[i].connectedAt >= HELLO_GRACE_MS) {
+            pendingHello[i].clientId = 0;
+            return clientId;
+        }
+    }
+    return 0;
+}
+
+void StatusPublisher::forgetClient(uint32_t clientId) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (hiddenClients[i] == clientId) {
+            hiddenClients[i] = 0;
+        }
+        if (pendingHello[i].clientId == clientId) {
+            pendingHello[i].clientId = 0;
+        }
+    }
+}
+
+uint32_t StatusPublisher::getSentCount(PublishReason reason) const {
+    return reason < PublishReason::COUNT ? sentCount[static_cast<uint8_t>(reason)] : 0;
+}
+
+const char* StatusPublisher::reasonToString(PublishReason reason) {
+    switch (reason) {
+        case PublishReason::TRANSITION: return "transition";
+        case PublishReason::COUNTDOWN:  return "countdown";
+        case PublishReason::REFRESH:    return "refresh";
+        case PublishReason::FORCED:     return "forced";
+        default:                        return "none";
+    }
+}
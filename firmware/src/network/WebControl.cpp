@@ -23,6 +23,7 @@
 #include "core/SystemManager.h"
 #include "network/WebSocketManager.h"
 #include "network/WebServerManager.h"
+#include "network/MqttTelemetry.h"
 #include "network/WiFiConfig.h"
 #include "network/WebControl.h"
 #include "utils/Utils.h"
@@ -117,6 +118,11 @@ void setupWebControl(SystemManager* systemManager) {
     LOG_ERROR("[WEBCONTROL ERROR] Fallo en creación de WebSocketManager");
   }
   
+  // **FASE 3.5: TELEMETRÍA MQTT** (no espera al broker; sin URI queda desactivada)
+  if (MqttTelemetry::getInstance().begin(servo)) {
+    LOG_INFO("[WEBCONTROL] Telemetría MQTT activa como " + String(MqttTelemetry::getInstance().getDeviceId()));
+  }
+  
   // **FASE 4: CREACIÓN E INICIALIZACIÓN DEL WEBSERVER MANAGER**
   LOG_INFO("[WEBCONTROL] Creando e inicializando WebServerManager...");
   
@@ -16,21 +16,292 @@
 #include "core/SystemManager.h"
 #include "core/EventBus.h"
 #include "utils/Logger.h"
+#include "utils/LogStore.h"
+#include "utils/Trace.h"
 #include "drivers/ServoPWMController.h"
 #include "core/ConfigManager.h"
+#include "core/ConfigCodec.h"
+#include "core/ConfigBackupStore.h"
+#include "core/ConfigStreamParser.h"
 #include "core/SystemConfig.h"
+#include "core/StateMetrics.h"
+#include "core/MetricsRegistry.h"
+#include "core/HistoryExport.h"
+#include "core/TaskDiagnostics.h"
+#include "core/EventHistory.h"
+#include "core/ProjectConfig.h"
+#include "network/AdmissionControl.h"
+#include "network/WebSocketManager.h"
+#include "network/WebSocketCompression.h"
 #include <SPIFFS.h>
 #include <ESPmDNS.h>
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
 
+namespace {
+    /**
+     * @brief Lo que onBody decidió con el primer trozo de un PUT /api/config.
+     */
+    enum class UploadState : uint8_t {
+        UNAUTHORIZED,   // Sin credenciales válidas: no se analiza nada
+        NOT_JSON,       // Content-Type distinto de application/json
+        BUSY,           // Había otra subida en curso
+        PARSING         // Analizador reservado
+    };
+    
+    /**
+     * @brief Estado de un PUT /api/config entre onBody y onRequest (en _tempObject).
+     */
+    struct ConfigUpload {
+        UploadState state;
+        ConfigStreamParser* parser;     // Solo en PARSING
+        uint32_t token;
+    };
+    
+    constexpr const char* NOT_JSON_ERROR = "{\"error\":\"Content-Type debe ser application/json\"}";
+    
+    /**
+     * @brief ¿El Content-Type es JSON? Compara solo el tipo de medio.
+     *
+     * "application/json; charset=utf-8" también vale: los parámetros tras
+     * ';' se ignoran y el tipo no distingue mayúsculas (RFC 9110).
+     */
+    bool isJsonContentType(const String& contentType) {
+        int separator = contentType.indexOf(';');
+        String mediaType = separator >= 0 ? contentType.substring(0, separator) : contentType;
+        mediaType.trim();
+        return mediaType.equalsIgnoreCase("application/json");
+    }
+    
+    /**
+     * @brief Primer manejador del servidor: responde 503 a lo que no cabe en el heap.
+     *
+     * canHandle() se llama con las cabeceras ya leídas y antes que el resto
+     * de manejadores (incluido el handshake de /ws). Si la conexión se admite
+     * devuelve false y la petición sigue su camino; si no, se queda con ella.
+     */
+    class AdmissionGate : public AsyncWebHandler {
+    public:
+        bool canHandle(AsyncWebServerRequest *request) override {
+            AdmissionDecision decision = AdmissionControl::getInstance().admit(classify(request));
+            if (decision == AdmissionDecision::ADMIT) {
+                return false;
+            }
+            
+            // El motivo viaja hasta handleRequest() en _tempObject (lo libera la biblioteca)
+            AdmissionDecision* stored = static_cast<AdmissionDecision*>(malloc(sizeof(AdmissionDecision)));
+            if (stored != nullptr) {
+                *stored = decision;
+            }
+            request->_tempObject = stored;
+            return true;
+        }
+        
+        void handleRequest(AsyncWebServerRequest *request) override {
+            AdmissionDecision* stored = static_cast<AdmissionDecision*>(request->_tempObject);
+            AdmissionDecision decision = stored != nullptr ? *stored : AdmissionDecision::LOW_HEAP;
+            uint32_t retryAfter = AdmissionControl::retryAfterSeconds(decision);
+            
+            AsyncWebServerResponse *response = request->beginResponse(503, "application/json",
+                "{\"error\":\"Servidor ocupado\",\"reason\":\"" + String(AdmissionControl::decisionToString(decision)) +
+                "\",\"retryAfter\":" + String(retryAfter) + "}");
+            response->addHeader("Retry-After", String(retryAfter));
+            request->send(response);
+        }
+        
+    private:
+        static AdmissionClass classify(AsyncWebServerRequest *request) {
+            if (request->url() == WebSocketConfig::PATH) {
+                return AdmissionClass::WEBSOCKET;
+            }
+            if ((request->method() == HTTP_PUT || request->method() == HTTP_POST) && request->contentLength() > 0) {
+                return AdmissionClass::UPLOAD;
+            }
+            return AdmissionClass::HTTP;
+        }
+    };
+    
+    constexpr uint8_t BOOTSTRAP_HISTORY_RECORDS = 20;      // Eventos recientes en /api/v1/bootstrap
+    
+    /**
+     * @brief Documento de arranque del panel, generado sección a sección.
+     *
+     * El servidor pide la respuesta chunked a trozos (fill); cada sección
+     * se compone cuando se ha enviado la anterior, así en memoria solo hay
+     * una (la mayor es la configuración exportada, ~1-2 KB), nunca el
+     * documento entero. El estado es el mismo mensaje (con su "seq") que
+     * difunde el WebSocket, así el cliente puede pedir en el hello que no
+     * se lo repitan.
+     *
+     * Un solo cursor: las peticiones y las desconexiones llegan todas por la
+     * tarea AsyncTCP, así que el pool no necesita mutex. El token cumple el
+     * mismo papel que en PrometheusCursor.
+     */
+    class BootstrapCursor {
+    public:
+        static BootstrapCursor* acquire(uint32_t& tokenOut, SystemManager* manager) {
+            if (instance.inUse) {
+                return nullptr;
+            }
+            instance.inUse = true;
+            if (++instance.token == 0) {
+                instance.token = 1;
+            }
+            tokenOut = instance.token;
+            instance.systemManager = manager;
+            instance.section = Section::STATUS;
+            instance.pending = "";
+            instance.pendingPos = 0;
+            return &instance;
+        }
+        
+        void release(uint32_t releaseToken) {
+            if (inUse && token == releaseToken) {
+                inUse = false;
+                pending = String();     // Devolver la sección al heap
+            }
+        }
+        
+        size_t fill(uint8_t* out, size_t maxLen) {
+            size_t written = 0;
+            while (written < maxLen) {
+                size_t available = pending.length() - pendingPos;
+                if (available > 0) {
+                    size_t chunk = available < maxLen - written ? available : maxLen - written;
+                    memcpy(out + written, pending.c_str() + pendingPos, chunk);
+                    pendingPos += chunk;
+                    written += chunk;
+                    continue;
+                }
+                if (!nextSection()) {
+                    break;
+                }
+            }
+            return written;
+        }
+        
+    private:
+        enum class Section : uint8_t { STATUS, CONFIG, ZONE_NAMES, HISTORY, CAPABILITIES, DONE };
+        
+        BootstrapCursor() : inUse(false), token(0), systemManager(nullptr), section(Section::DONE), pendingPos(0) {}
+        
+        /**
+         * @brief Compone la siguiente sección en pending.
+         * @return false cuando el documento ha terminado
+         */
+        bool nextSection() {
+            pending = "";
+            pendingPos = 0;
+            
+            switch (section) {
+                case Section::STATUS: {
+                    WebSocketManager* wsManager = systemManager->getWebSocketManager();
+                    pending = "{\"status\":";
+                    pending += wsManager != nullptr ? wsManager->getStatusJson() : String("null");
+                    section = Section::CONFIG;
+                    break;
+                }
+                case Section::CONFIG:
+                    pending = ",\"config\":";
+                    pending += ConfigManager::getInstance().exportConfig();
+                    section = Section::ZONE_NAMES;
+                    break;
+                case Section::ZONE_NAMES: {
+                    StaticJsonDocument<256> names;
+                    JsonArray nameArray = names.to<JsonArray>();
+                    for (const char* name : HardwarePins::Servos::ZONE_NAMES) {
+                        nameArray.add(name);
+                    }
+                    pending = ",\"zoneNames\":";
+                    serializeJson(names, pending);
+                    section = Section::HISTORY;
+                    break;
+                }
+                case Section::HISTORY: {
+                    // Solo la cola del archivo, no un recorrido completo
+                    HistoryRecord records[BOOTSTRAP_HISTORY_RECORDS];
+                    uint8_t count = EventHistory::getInstance().readRecent(records, BOOTSTRAP_HISTORY_RECORDS);
+                    pending = ",\"history\":[";
+                    for (uint8_t i = 0; i < count; i++) {
+                        StaticJsonDocument<128> entry;
+                        entry["t"] = records[i].timestamp;
+                        entry["event"] = EventHistory::eventToString(static_cast<HistoryEvent>(records[i].event));
+                        entry["zone"] = records[i].zone;
+                        entry["value"] = records[i].value;
+                        entry["uptime"] = (records[i].flags & HistoryFlags::UPTIME_CLOCK) != 0;
+                        if (i > 0) {
+                            pending += ',';
+                        }
+                        serializeJson(entry, pending);
+                    }
+                    pending += ']';
+                    section = Section::CAPABILITIES;
+                    break;
+                }
+                case Section::CAPABILITIES: {
+                    // Lo que negotiate() concede a quien pide compresión en el hello
+                    StaticJsonDocument<384> caps;
+                    caps["api"] = "v1";
+                    caps["websocket"] = WebSocketConfig::PATH;
+                    caps["compression"] = WebSocketCompressor::modeToString(WsCompression::PER_MESSAGE);
+                    caps["windowBits"] = WebSocketCompressionConfig::WINDOW_BITS;
+                    caps["contextTakeover"] = false;
+                    caps["maxWebSocketClients"] = AdmissionConfig::MAX_WS_CLIENTS;
+                    caps["statusResume"] = true;
+                    JsonArray endpoints = caps.createNestedArray("endpoints");
+                    endpoints.add("/api/v1/status");
+                    endpoints.add("/api/v1/metrics");
+                    endpoints.add("/api/v1/history/export");
+                    endpoints.add("/api/v1/logs");
+                    endpoints.add("/api/config");
+                    endpoints.add("/metrics");
+                    pending = ",\"capabilities\":";
+                    serializeJson(caps, pending);
+                    pending += '}';
+                    section = Section::DONE;
+                    break;
+                }
+                case Section::DONE:
+                    return false;
+            }
+            return true;
+        }
+        
+        bool inUse;
+        uint32_t token;
+        SystemManager* systemManager;
+        Section section;
+        String pending;                 // Sección en curso
+        size_t pendingPos;              // Bytes de pending ya enviados
+        
+        static BootstrapCursor instance;
+    };
+    
+    BootstrapCursor BootstrapCursor::instance;
+}
+
 /**
  * @brief Autenticar una solicitud HTTP
  * @param request Petición HTTP a autenticar
- * @return true si la autenticación es exitosa, false en caso contrario
+ * @return true si la autenticación es exitosa; si no, ya se pidieron credenciales
  */
 bool WebServerManager::authenticateRequest(AsyncWebServerRequest *request) {
+    if (isAuthorized(request)) {
+        return true;
+    }
+    
+    requestCredentials(request);
+    return false;
+}
+
+/**
+ * @brief Decide si la petición puede pasar, sin responder nada.
+ *
+ * PUT /api/config lo usa desde onBody, antes de que exista respuesta, y
+ * guarda la decisión en su ConfigUpload para que onRequest no la repita.
+ */
+bool WebServerManager::isAuthorized(AsyncWebServerRequest *request) {
     // Si la autenticación web está deshabilitada, permitir acceso
     if (!SecurityConfig::ENABLE_WEB_AUTHENTICATION) {
         return true;
@@ -41,25 +312,21 @@ bool WebServerManager::authenticateRequest(AsyncWebServerRequest *request) {
         return true;
     }
 
-    // Requerir autenticación para todos los endpoints de configuración
-    if (request->url().startsWith("/api/config")) {
-        if (!request->authenticate(SecurityConfig::DEFAULT_WEB_USERNAME, SecurityConfig::DEFAULT_WEB_PASSWORD)) {
-            LOG_WARNING("[WEBSERVER] Intento de acceso no autenticado a configuración desde: " + 
-                       request->client()->remoteIP().toString());
-            request->requestAuthentication();
-            return false;
-        }
-        return true;
-    }
+    // El resto (configuración incluida) requiere credenciales
+    return request->authenticate(SecurityConfig::DEFAULT_WEB_USERNAME, SecurityConfig::DEFAULT_WEB_PASSWORD);
+}
 
-    // Comportamiento por defecto para otros endpoints
-    if (request->authenticate(SecurityConfig::DEFAULT_WEB_USERNAME, SecurityConfig::DEFAULT_WEB_PASSWORD)) {
-        return true;
+/**
+ * @brief Registra el intento y responde 401 pidiendo credenciales.
+ */
+void WebServerManager::requestCredentials(AsyncWebServerRequest *request) {
+    if (request->url().startsWith("/api/config")) {
+        LOG_WARNING("[WEBSERVER] Intento de acceso no autenticado a configuración desde: " + 
+                   request->client()->remoteIP().toString());
+    } else {
+        LOG_WARNING("[WEBSERVER] Intento de acceso no autenticado desde: " + request->client()->remoteIP().toString());
     }
-    
-    LOG_WARNING("[WEBSERVER] Intento de acceso no autenticado desde: " + request->client()->remoteIP().toString());
     request->requestAuthentication();
-    return false;
 }
 
 /**
@@ -88,6 +355,10 @@ void WebServerManager::initialize(SystemManager* sysManager) {
     systemManager = sysManager;
     LOG_INFO("[WEBSERVER] Inicializando servidor web...");
     
+    // Antes que ningún otro manejador: cada conexión nueva pasa por la admisión
+    AdmissionControl::getInstance().begin();
+    server->addHandler(new AdmissionGate());
+    
     setupStaticFiles();
     setupRESTEndpoints();
     setupErrorHandling();
@@ -132,11 +403,19 @@ void WebServerManager::setupRESTEndpoints() {
             return;
         }
         
-        // Obtener información del sistema
+        // Obtener información del sistema: desde AsyncTCP solo la foto
+        // publicada por el loop (coherente y sin bloquear el control)
         ServoPWMController* ctrl = systemManager->getIrrigationController();
-        String state = ctrl ? ServoPWMController::stateToString(ctrl->getCurrentState()) : "UNKNOWN";
-        int activeZone = ctrl ? ctrl->getCurrentActiveZone() : 0;
-        int remaining = ctrl ? ctrl->getRemainingIrrigationTime() : 0;
+        String state = "UNKNOWN";
+        int activeZone = 0;
+        int remaining = 0;
+        if (ctrl) {
+            ControllerSnapshot snapshot;
+            ctrl->getSnapshot(snapshot);
+            state = ServoPWMController::stateToString(snapshot.state);
+            activeZone = snapshot.activeZone;
+            remaining = snapshot.remainingTime;
+        }
         
         // Crear respuesta JSON
         String json = "{\"state\":\"" + state + "\",";
@@ -148,6 +427,272 @@ void WebServerManager::setupRESTEndpoints() {
         request->send(200, "application/json", json);
     });
     
+    // Arranque del panel en una sola petición: estado, configuración,
+    // nombres de zona, historial reciente y capacidades del servidor,
+    // en una respuesta chunked generada sección a sección
+    server->on("/api/v1/bootstrap", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        if (!systemManager) {
+            request->send(503, "application/json", "{\"error\":\"Sistema no inicializado\"}");
+            return;
+        }
+        
+        uint32_t token = 0;
+        BootstrapCursor* cursor = BootstrapCursor::acquire(token, systemManager);
+        if (cursor == nullptr) {
+            request->send(503, "application/json", "{\"error\":\"Arranque de otro panel en curso\"}");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // Métricas de permanencia y transiciones de estados (diagnóstico)
+    server->on("/api/v1/metrics", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        // Respuesta chunked: el cursor compone un bloque (un estado, una
+        // fila de transiciones) cada vez, sin el documento en memoria
+        uint32_t token = 0;
+        StateMetricsCursor* cursor = StateMetricsCursor::acquire(token);
+        if (cursor == nullptr) {
+            request->send(503, "application/json", "{\"error\":\"Exportación de métricas ocupada\"}");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // Exposición Prometheus: respuesta chunked generada línea a línea desde
+    // MetricsRegistry, sin construir el documento en memoria
+    server->on("/metrics", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        uint32_t token = 0;
+        PrometheusCursor* cursor = PrometheusCursor::acquire(token);
+        if (cursor == nullptr) {
+            request->send(503, "text/plain", "Exportación de métricas ocupada\n");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse(MetricsConfig::CONTENT_TYPE,
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        
+        // Si el cliente se desconecta a mitad, el cursor vuelve al pool
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // Exportación del historial de eventos en formato columnar (RHC1),
+    // generada columna a columna desde SPIFFS. ?deflate=1 comprime el
+    // cuerpo y ?since=<hora Unix> limita el rango. Ver scripts/history_to_csv.py
+    server->on("/api/v1/history/export", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        bool compress = request->hasParam("deflate") && request->getParam("deflate")->value() == "1";
+        uint32_t since = request->hasParam("since")
+            ? static_cast<uint32_t>(strtoul(request->getParam("since")->value().c_str(), nullptr, 10))
+            : 0;
+        
+        uint32_t token = 0;
+        HistoryExportCursor* cursor = HistoryExportCursor::acquire(token, compress, since);
+        if (cursor == nullptr) {
+            request->send(503, "text/plain", "Exportación del historial ocupada\n");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse(HistoryExportConfig::CONTENT_TYPE,
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=history.rhc");
+        
+        // Liberar el historial aunque el cliente corte la descarga
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // Consulta del log en flash: ?since=<hora Unix>&level=<error|warning|...>.
+    // El índice de segmentos evita leer (y descomprimir) lo que no encaja
+    server->on("/api/v1/logs", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        LogQuery query = { 0, LogStoreConfig::MAX_LEVEL };
+        if (request->hasParam("since")) {
+            query.since = static_cast<uint32_t>(strtoul(request->getParam("since")->value().c_str(), nullptr, 10));
+        }
+        if (request->hasParam("level") &&
+            !LogQueryCursor::parseLevel(request->getParam("level")->value().c_str(), query.maxLevel)) {
+            request->send(400, "text/plain", "Nivel desconocido: use error, warning, info, debug o verbose\n");
+            return;
+        }
+        
+        uint32_t token = 0;
+        LogQueryCursor* cursor = LogQueryCursor::acquire(token, query);
+        if (cursor == nullptr) {
+            request->send(503, "text/plain", "Consulta de logs ocupada\n");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse(LogStoreConfig::CONTENT_TYPE,
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // Traza de ejecución en formato Chrome/Perfetto (chrome://tracing, ui.perfetto.dev).
+    // La traza se pausa mientras se descarga
+    server->on("/api/v1/trace", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        uint32_t token = 0;
+        TraceExportCursor* cursor = TraceExportCursor::acquire(token);
+        if (cursor == nullptr) {
+            request->send(503, "text/plain", "Exportación de la traza ocupada\n");
+            return;
+        }
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse(TraceConfig::CONTENT_TYPE,
+            [cursor, token](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+                size_t written = cursor->fill(buffer, maxLen);
+                if (written == 0) {
+                    cursor->release(token);
+                }
+                return written;
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=trace.json");
+        
+        request->onDisconnect([cursor, token](){
+            cursor->release(token);
+        });
+        request->send(response);
+    });
+    
+    // POST /api/v1/trace?enabled=0|1&clear=1 - Activar/pausar la traza y vaciarla
+    server->on("/api/v1/trace", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        if (request->hasParam("enabled")) {
+            Trace::setEnabled(request->getParam("enabled")->value() == "1");
+        }
+        if (request->hasParam("clear") && request->getParam("clear")->value() == "1") {
+            Trace::clear();
+        }
+        request->send(200, "application/json",
+            "{\"enabled\":" + String(Trace::isEnabled() ? "true" : "false") +
+            ",\"recorded\":" + String(Trace::getRecordedCount()) + "}");
+    });
+    
+    // CPU por tarea (% de un núcleo en la ventana) y pila libre mínima.
+    // "cpu"/"load" son null si el firmware no tiene estadísticas de tiempo
+    server->on("/api/v1/system/tasks", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!this->authenticateRequest(request)) {
+            return;
+        }
+        
+        TaskDiagnostics& diagnostics = TaskDiagnostics::getInstance();
+        TaskSnapshot tasks[TaskDiagnosticsConfig::MAX_TASKS];
+        uint8_t count = diagnostics.copyTasks(tasks, TaskDiagnosticsConfig::MAX_TASKS);
+        
+        DynamicJsonDocument doc(384 + count * 128);
+        doc["runtime_stats"] = TaskDiagnostics::hasRuntimeStats();
+        doc["window_s"] = diagnostics.getWindowMs() / 1000;
+        JsonArray cores = doc.createNestedArray("cores");
+        for (uint8_t c = 0; c < TaskDiagnosticsConfig::CORES; c++) {
+            JsonObject entry = cores.createNestedObject();
+            entry["core"] = c;
+            uint16_t load = diagnostics.getCoreLoadPermille(c);
+            if (load == TaskDiagnosticsConfig::CPU_UNKNOWN) {
+                entry["load"] = nullptr;
+            } else {
+                entry["load"] = load / 10.0f;
+            }
+        }
+        JsonArray list = doc.createNestedArray("tasks");
+        for (uint8_t i = 0; i < count; i++) {
+            JsonObject entry = list.createNestedObject();
+            entry["name"] = tasks[i].name;
+            if (tasks[i].core == TaskDiagnosticsConfig::CORE_ANY) {
+                entry["core"] = nullptr;
+            } else {
+                entry["core"] = tasks[i].core;
+            }
+            entry["priority"] = tasks[i].priority;
+            if (tasks[i].cpuPermille == TaskDiagnosticsConfig::CPU_UNKNOWN) {
+                entry["cpu"] = nullptr;
+            } else {
+                entry["cpu"] = tasks[i].cpuPermille / 10.0f;
+            }
+            entry["stack_free"] = tasks[i].stackFreeBytes;
+        }
+        
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+    
     // Endpoint para configurar RTC
     server->on("/api/config/rtc", HTTP_POST, [this](AsyncWebServerRequest *request){
         LOG_INFO("[WEBSERVER] Configuración RTC desde web");
@@ -209,28 +754,53 @@ void WebServerManager::setupConfigurationEndpoints() {
         request->send(200, "application/json", jsonConfig);
     });
     
-    // PUT /api/config - Actualizar configuración completa
+    // PUT /api/config - Actualizar configuración completa. El cuerpo no se
+    // junta en memoria: onBody entrega cada trozo a ConfigStreamParser, que
+    // lo aplica sobre una copia de la configuración y corta en el primer
+    // error. onRequest llega al final, con el resultado ya calculado
     server->on("/api/config", HTTP_PUT, [this, &configManager](AsyncWebServerRequest *request){
         LOG_INFO("[WEBSERVER] Petición PUT de configuración completa");
         
-        // Verificar autenticación
-        if (!this->authenticateRequest(request)) {
-            return;
-        }
-        
-        if (request->contentType() != "application/json") {
-            request->send(400, "application/json", "{\"error\":\"Content-Type debe ser application/json\"}");
+        ConfigUpload* upload = static_cast<ConfigUpload*>(request->_tempObject);
+        if (upload == nullptr) {
+            // onBody no llegó a correr (cuerpo vacío) o no pudo reservar el estado
+            if (!this->authenticateRequest(request)) {
+                return;
+            }
+            if (!isJsonContentType(request->contentType())) {
+                request->send(400, "application/json", NOT_JSON_ERROR);
+            } else if (request->contentLength() == 0) {
+                request->send(400, "application/json", "{\"error\":\"Cuerpo de solicitud vacío\"}");
+            } else {
+                request->send(500, "application/json", "{\"error\":\"Sin memoria para analizar la configuración\"}");
+            }
             return;
         }
         
-        if (request->contentLength() == 0) {
-            request->send(400, "application/json", "{\"error\":\"Cuerpo de solicitud vacío\"}");
-            return;
+        // Autenticación y Content-Type ya se decidieron en onBody
+        switch (upload->state) {
+            case UploadState::UNAUTHORIZED:
+                this->requestCredentials(request);
+                return;
+            case UploadState::NOT_JSON:
+                request->send(400, "application/json", NOT_JSON_ERROR);
+                return;
+            case UploadState::BUSY:
+                request->send(503, "application/json", "{\"error\":\"Otra actualización de configuración en curso\"}");
+                return;
+            case UploadState::PARSING:
+                break;
         }
         
-        String jsonBody = request->getParam("plain", true)->value();
-        
-        if (configManager.importConfig(jsonBody)) {
+        ConfigStreamParser* parser = upload->parser;
+        ConfigParseResult result = parser->finish();
+        if (result == ConfigParseResult::TOO_LARGE) {
+            request->send(413, "application/json", "{\"error\":\"Configuración demasiado grande\"}");
+        } else if (result != ConfigParseResult::COMPLETE) {
+            LOG_WARNING("[WEBSERVER] Configuración rechazada: " + parser->getError());
+            request->send(400, "application/json",
+                          "{\"error\":\"Configuración inválida\",\"field\":\"" + parser->getError() + "\"}");
+        } else if (configManager.updateConfig(parser->getConfig())) {
             request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Configuración actualizada\"}");
             
             // Publicar evento de configuración actualizada
@@ -238,6 +808,45 @@ void WebServerManager::setupConfigurationEndpoints() {
         } else {
             request->send(400, "application/json", "{\"error\":\"Configuración inválida o error al guardar\"}");
         }
+        parser->release(upload->token);
+    }, nullptr, [this, &configManager](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+        if (index == 0) {
+            // _tempObject lo libera la biblioteca con free() al destruir la petición.
+            // Sin él, onRequest responde por su cuenta
+            ConfigUpload* upload = static_cast<ConfigUpload*>(malloc(sizeof(ConfigUpload)));
+            if (upload == nullptr) {
+                return;
+            }
+            upload->parser = nullptr;
+            upload->token = 0;
+            
+            // Sin credenciales o sin JSON no se analiza nada: responde onRequest
+            if (!this->isAuthorized(request)) {
+                upload->state = UploadState::UNAUTHORIZED;
+            } else if (!isJsonContentType(request->contentType())) {
+                upload->state = UploadState::NOT_JSON;
+            } else {
+                // Copia publicada: el loop puede estar aplicando otro cambio
+                SystemConfig base;
+                configManager.copyConfig(base);
+                upload->parser = ConfigStreamParser::acquire(upload->token, base, total);
+                upload->state = upload->parser != nullptr ? UploadState::PARSING : UploadState::BUSY;
+            }
+            request->_tempObject = upload;
+            
+            if (upload->parser != nullptr) {
+                ConfigStreamParser* parser = upload->parser;
+                uint32_t token = upload->token;
+                request->onDisconnect([parser, token](){
+                    parser->release(token);
+                });
+            }
+        }
+        
+        ConfigUpload* upload = static_cast<ConfigUpload*>(request->_tempObject);
+        if (upload != nullptr && upload->parser != nullptr) {
+            upload->parser->feed(data, len);
+        }
     });
     
     // GET /api/config/defaults - Obtener configuración por defecto
@@ -251,8 +860,11 @@ void WebServerManager::setupConfigurationEndpoints() {
         
         // Crear configuración por defecto sin alterar la configuración actual
         SystemConfig defaultConfig;
-        ConfigManager::getInstance().resetToDefaults(); // Esto carga los valores por defecto
-        String jsonConfig = configManager.exportConfig();
+        ConfigCodec::applyDefaults(defaultConfig);
+        DynamicJsonDocument doc(2048);
+        ConfigCodec::toJson(defaultConfig, doc.to<JsonObject>());
+        String jsonConfig;
+        serializeJson(doc, jsonConfig);
         request->send(200, "application/json", jsonConfig);
     });
     
@@ -275,8 +887,8 @@ void WebServerManager::setupConfigurationEndpoints() {
         }
     });
     
-    // GET /api/config/backup - Listar backups disponibles
-    server->on("/api/config/backup", HTTP_GET, [this, &configManager](AsyncWebServerRequest *request){
+    // GET /api/config/backup - Listar versiones guardadas (índice en RAM, sin leer la flash)
+    server->on("/api/config/backup", HTTP_GET, [this](AsyncWebServerRequest *request){
         LOG_INFO("[WEBSERVER] Petición GET de lista de backups");
         
         // Verificar autenticación
@@ -284,17 +896,29 @@ void WebServerManager::setupConfigurationEndpoints() {
             return;
         }
         
-        // Por ahora, solo tenemos un backup, pero podemos expandir esto
-        DynamicJsonDocument doc(256);
-        doc["backups"] = 1;
-        doc["last_backup"] = "config_backup.json";
+        ConfigBackupStore& store = ConfigBackupStore::getInstance();
+        BackupVersionInfo versions[BackupStoreConfig::MAX_RECORDS];
+        uint8_t count = store.listVersions(versions, BackupStoreConfig::MAX_RECORDS);
+        
+        DynamicJsonDocument doc(256 + count * 96);
+        doc["backups"] = count;
+        doc["latest"] = store.getLatestVersion();
+        doc["stored_bytes"] = store.getStoredBytes();
+        JsonArray list = doc.createNestedArray("versions");
+        for (uint8_t i = 0; i < count; i++) {
+            JsonObject entry = list.createNestedObject();
+            entry["version"] = versions[i].header.version;
+            entry["timestamp"] = versions[i].header.timestamp;
+            entry["kind"] = versions[i].header.kind == static_cast<uint8_t>(BackupKind::FULL) ? "full" : "delta";
+            entry["bytes"] = versions[i].header.payloadLength;
+        }
         
         String response;
         serializeJson(doc, response);
         request->send(200, "application/json", response);
     });
     
-    // POST /api/config/backup - Crear nuevo backup
+    // POST /api/config/backup - Crear nuevo backup (no escribe si no hay cambios)
     server->on("/api/config/backup", HTTP_POST, [this, &configManager](AsyncWebServerRequest *request){
         LOG_INFO("[WEBSERVER] Petición POST para crear backup");
         
@@ -303,14 +927,16 @@ void WebServerManager::setupConfigurationEndpoints() {
             return;
         }
         
-        if (configManager.createBackup()) {
-            request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Backup creado exitosamente\"}");
+        uint32_t version = 0;
+        if (configManager.createBackup(&version)) {
+            request->send(200, "application/json",
+                "{\"status\":\"success\",\"message\":\"Backup creado exitosamente\",\"version\":" + String(version) + "}");
         } else {
             request->send(500, "application/json", "{\"error\":\"Error al crear backup\"}");
         }
     });
     
-    // POST /api/config/backup/restore - Restaurar desde backup
+    // POST /api/config/backup/restore?version=N - Restaurar una versión (sin versión: la última)
     server->on("/api/config/backup/restore", HTTP_POST, [this, &configManager](AsyncWebServerRequest *request){
         LOG_INFO("[WEBSERVER] Petición POST para restaurar backup");
         
@@ -319,13 +945,20 @@ void WebServerManager::setupConfigurationEndpoints() {
             return;
         }
         
-        if (configManager.restoreBackup()) {
+        uint32_t version = 0;
+        if (request->hasParam("version")) {
+            version = strtoul(request->getParam("version")->value().c_str(), nullptr, 10);
+        } else if (request->hasParam("version", true)) {
+            version = strtoul(request->getParam("version", true)->value().c_str(), nullptr, 10);
+        }
+        
+        if (configManager.restoreBackup(version)) {
             request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Backup restaurado exitosamente\"}");
             
             // Publicar evento de configuración restaurada
             EventBus::getInstance().publishSimple(EventType::CONFIG_RESTORED);
         } else {
-            request->send(500, "application/json", "{\"error\":\"Error al restaurar backup\"}");
+            request->send(404, "application/json", "{\"error\":\"Versión de backup no disponible\"}");
         }
     });
     
@@ -0,0 +1,138 @@
+/**
+ * @file WebSocketCompression.cpp
+ * @brief Tabla de modos por cliente y compresión de las difusiones WebSocket.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/network/WebSocketCompression.h"
+#include <string.h>
+
+using namespace WebSocketCompressionConfig;
+
+WebSocketCompressor::WebSocketCompressor()
+    : compressedClients(0), unregisteredClients(0), rawBytes(0), compressedBytes(0) {
+    memset(clients, 0, sizeof(clients));
+    lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+}
+
+WebSocketCompressor::Client* WebSocketCompressor::findClient(uint32_t clientId) {
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        if (clients[i].clientId == clientId) {
+            return &clients[i];
+        }
+    }
+    return nullptr;
+}
+
+void WebSocketCompressor::addClient(uint32_t clientId) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Client* client = findClient(0);
+    if (client) {
+        client->clientId = clientId;
+        client->mode = WsCompression::NONE;
+    } else {
+        unregisteredClients++;          // Recibirá texto (textAll) mientras siga conectado
+    }
+    xSemaphoreGive(lock);
+}
+
+WsCompression WebSocketCompressor::negotiate(uint32_t clientId, bool deflate) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Client* client = findClient(clientId);
+    if (!client) {
+        xSemaphoreGive(lock);
+        return WsCompression::NONE;
+    }
+
+    WsCompression previous = client->mode;
+    WsCompression mode = deflate ? WsCompression::PER_MESSAGE : WsCompression::NONE;
+
+    if (previous == WsCompression::NONE && mode != WsCompression::NONE) {
+        compressedClients++;
+    } else if (previous != WsCompression::NONE && mode == WsCompression::NONE) {
+        compressedClients--;
+    }
+    client->mode = mode;
+    xSemaphoreGive(lock);
+    return mode;
+}
+
+void WebSocketCompressor::forgetClient(uint32_t clientId) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Client* client = findClient(clientId);
+    if (client) {
+        if (client->mode != WsCompression::NONE) {
+            compressedClients--;
+        }
+        client->clientId = 0;
+        client->mode = WsCompression::NONE;
+    } else if (unregisteredClients > 0) {
+        unregisteredClients--;
+    }
+    xSemaphoreGive(lock);
+}
+
+bool WebSocketCompressor::broadcast(const char* text, size_t length, SendFn send, void* context) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text);
+    bool compressible = length >= MIN_MESSAGE_BYTES && length <= MAX_MESSAGE_BYTES;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (unregisteredClients > 0) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    // **TRAMA COMPARTIDA**: se comprime una vez para todos los PER_MESSAGE.
+    // Si no gana nada, esos clientes reciben el texto (0 = no comprimido).
+    size_t sharedLength = 0;
+    bool sharedDone = false;
+    for (uint8_t i = 0; i < CLIENT_SLOTS; i++) {
+        Client& client = clients[i];
+        if (client.clientId == 0) {
+            continue;
+        }
+        if (client.mode == WsCompression::PER_MESSAGE && compressible && !sharedDone) {
+            sharedLength = compressShared(data, length);
+            sharedDone = true;
+        }
+        if (client.mode == WsCompression::PER_MESSAGE && sharedLength > 0) {
+            send(client.clientId, frame, sharedLength, true, context);
+            rawBytes += length;
+            compressedBytes += sharedLength;
+        } else {
+            send(client.clientId, data, length, false, context);
+        }
+    }
+
+    xSemaphoreGive(lock);
+    return true;
+}
+
+size_t WebSocketCompressor::compressShared(const uint8_t* data, size_t length) {
+    shared.begin();
+    size_t written = 0;
+    size_t accepted = 0;
+    while (!shared.finished()) {
+        if (shared.pendingOutput() > 0) {
+            if (written == length) {
+                return 0;               // Ya ocupa lo mismo que el texto: no compensa
+            }
+            written += shared.read(frame + written, length - written);
+        } else if (accepted < length) {
+            accepted += shared.write(data + accepted, length - accepted);
+        } else {
+            shared.finish();
+        }
+    }
+    return written < length ? written : 0;
+}
+
+const char* WebSocketCompressor::modeToString(WsCompression mode) {
+    switch (mode) {
+        case WsCompression::PER_MESSAGE: return "deflate";
+        default:                         return "none";
+    }
+}
@@ -11,6 +11,10 @@
 #include "WebSocketManager.h"
 #include "SET_PIN.h"
 #include "IN_DIGITAL.h"
+#include "MetricsRegistry.h"
+#include "AdmissionControl.h"
+#include "Trace.h"
+#include <string.h>
 #include <ArduinoJson.h>
 
 // =============================================================================
@@ -23,18 +27,19 @@ WebSocketManager::WebSocketManager(const char* path, ServoPWMController* control
     , lastStatusUpdate(0)
     , lastHeartbeat(0)
     , statusChanged(false)
+    , statusSequence(1)
+    , lastPulseSequenceSent(0)
     , totalConnectionsCount(0)
     , messagesSentCount(0)
     , messagesReceivedCount(0)
 {
     // Crear instancia del servidor WebSocket
     webSocket = new AsyncWebSocket(path);
-    
-    // Inicializar estructura de estado
-    memset(&lastKnownStatus, 0, sizeof(SystemStatus));
 }
 
 WebSocketManager::~WebSocketManager() {
+    MetricsRegistry::getInstance().removeContext(this);
+    
     if (webSocket) {
         webSocket->closeAll();
         delete webSocket;
@@ -58,6 +63,59 @@ bool WebSocketManager::initialize() {
         this->handleWebSocketEvent(server, client, type, arg, data, len);
     });
     
+    // **MÉTRICAS PROMETHEUS** (mismos contadores que getConnectionStatistics)
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    registry.add("riego_websocket_clients", "Clientes WebSocket conectados", MetricType::GAUGE,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->webSocket ? ws->webSocket->count() : 0);
+        }, this);
+    registry.add("riego_websocket_connections_total", "Conexiones WebSocket aceptadas", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->totalConnectionsCount);
+        }, this);
+    registry.add("riego_websocket_messages_sent_total", "Mensajes WebSocket enviados", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->messagesSentCount);
+        }, this);
+    registry.add("riego_websocket_messages_received_total", "Mensajes WebSocket recibidos", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->messagesReceivedCount);
+        }, this);
+    registry.add("riego_websocket_messages_dropped_total", "Mensajes WebSocket descartados por superar el tope",
+        MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->reassembler.getDroppedCount());
+        }, this);
+    registry.add("riego_websocket_status_updates_total", "Difusiones del estado por motivo", MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            if (index >= static_cast<uint8_t>(PublishReason::COUNT)) {
+                return MetricSample::DONE;
+            }
+            PublishReason reason = static_cast<PublishReason>(index);
+            line.begin(family.name);
+            line.label("reason", StatusPublisher::reasonToString(reason));
+            line.value(ws->statusPublisher.getSentCount(reason));
+            return MetricSample::EMITTED;
+        }, this);
+    registry.add("riego_websocket_compressed_input_bytes_total", "Bytes de texto de los mensajes enviados comprimidos",
+        MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->compressor.getRawBytes());
+        }, this);
+    registry.add("riego_websocket_compressed_output_bytes_total", "Bytes enviados en su lugar (DEFLATE)",
+        MetricType::COUNTER,
+        [](const MetricFamily& family, uint16_t index, MetricLine& line) {
+            const WebSocketManager* ws = static_cast<const WebSocketManager*>(family.context);
+            return singleSample(family, index, line, ws->compressor.getCompressedBytes());
+        }, this);
+    
     DEBUG_PRINTLN("✅ [WebSocket] Servidor WebSocket inicializado correctamente");
     return true;
 }
@@ -68,15 +126,40 @@ bool WebSocketManager::initialize() {
 
 void WebSocketManager::update() {
     if (!webSocket) return;
+    TRACE_SCOPE("ws.update");
     
     unsigned long currentTime = millis();
     
-    // **ACTUALIZACIÓN PERIÓDICA DE ESTADO**
-    if (currentTime - lastStatusUpdate >= WebSocketConfig::STATUS_UPDATE_INTERVAL_MS) {
-        if (hasStatusChanged()) {
-            broadcastStatusUpdate();
-        }
+    // **COMANDOS PENDIENTES** (antes del estado, para difundir ya su efecto)
+    processQueuedCommands();
+    
+    // **ESTADO ADAPTATIVO**: se compara a menudo pero se envía solo cuando
+    // StatusPublisher lo decide (transición, cuenta atrás, refresco)
+    if (currentTime - lastStatusUpdate >= StatusPublisherConfig::POLL_INTERVAL_MS) {
         lastStatusUpdate = currentTime;
+        uint32_t clients = webSocket->count();
+        if (clients > 0) {
+            SystemStatus status = getCurrentSystemStatus();
+            PublishReason reason = statusPublisher.evaluate(status, currentTime, clients, statusChanged);
+            if (reason != PublishReason::NONE) {
+                publishStatus(status, reason);
+            }
+        }
+    }
+    
+    // **ESTADO INICIAL** de los clientes que no mandaron hello a tiempo
+    for (uint32_t id = statusPublisher.takeHelloTimeout(currentTime); id != 0;
+         id = statusPublisher.takeHelloTimeout(currentTime)) {
+        AsyncWebSocketClient* client = webSocket->client(id);
+        if (client) {
+            client->text(getStatusJson());
+            messagesSentCount++;
+        }
+    }
+    
+    // **TELEMETRÍA DE PULSOS** (modo ciclo y remojo)
+    if (irrigationController && irrigationController->getPulseSequence() != lastPulseSequenceSent) {
+        broadcastPulseTelemetry();
     }
     
     // **HEARTBEAT PERIÓDICO**
@@ -103,22 +186,31 @@ void WebSocketManager::update() {
 void WebSocketManager::broadcastStatusUpdate() {
     if (!webSocket || webSocket->count() == 0) return;
     
-    String statusJson = serializeSystemStatus();
+    publishStatus(getCurrentSystemStatus(), PublishReason::FORCED);
+}
+
+void WebSocketManager::publishStatus(const SystemStatus& status, PublishReason reason) {
+    TRACE_SCOPE("ws.broadcast_status");
+    
+    statusSequence++;
+    String statusJson = serializeSystemStatus(status);
     
     if (statusJson.length() > 0) {
-        webSocket->textAll(statusJson);
+        broadcastMessage(statusJson);
         messagesSentCount++;
         
-        VERBOSE_PRINTLN("[WebSocket] Estado enviado a " + String(webSocket->count()) + " clientes");
+        VERBOSE_PRINTLN("[WebSocket] Estado (" + String(StatusPublisher::reasonToString(reason)) + ") enviado a " +
+                        String(webSocket->count()) + " clientes");
         
-        // Actualizar último estado conocido
-        lastKnownStatus = getCurrentSystemStatus();
+        // Las siguientes decisiones comparan con este estado
+        statusPublisher.markSent(status, millis(), reason);
         statusChanged = false;
     }
 }
 
 void WebSocketManager::broadcastError(const String& errorMessage, const String& severity) {
     if (!webSocket || webSocket->count() == 0) return;
+    TRACE_SCOPE("ws.broadcast_error");
     
     // **CREAR MENSAJE DE ERROR ESTRUCTURADO**
     StaticJsonDocument<384> doc;
@@ -130,32 +222,99 @@ void WebSocketManager::broadcastError(const String& errorMessage, const String&
     String message;
     serializeJson(doc, message);
     
-    webSocket->textAll(message);
+    broadcastMessage(message);
     messagesSentCount++;
     
     DEBUG_PRINTLN("🚨 [WebSocket] Error enviado: " + errorMessage);
 }
 
+void WebSocketManager::broadcastPulseTelemetry() {
+    uint32_t latest = irrigationController->getPulseSequence();
+    
+    // Sin clientes no hay a quién enviar: solo avanzar el cursor
+    if (!webSocket || webSocket->count() == 0) {
+        lastPulseSequenceSent = latest;
+        return;
+    }
+    
+    TRACE_SCOPE("ws.broadcast_pulses");
+    PulseRecord record;
+    for (uint32_t seq = lastPulseSequenceSent + 1; seq <= latest; seq++) {
+        if (!irrigationController->getPulseRecord(seq, record)) {
+            continue; // Sobrescrito en el buffer circular
+        }
+        
+        StaticJsonDocument<256> doc;
+        doc["type"] = "irrigation_pulse";
+        doc["sequence"] = record.sequence;
+        doc["zone"] = record.zoneNumber;
+        doc["pulse"] = record.pulseIndex;
+        doc["pulses"] = record.pulseCount;
+        doc["startedAt"] = record.startedAt;
+        doc["duration"] = record.durationSec;
+        doc["soaked"] = record.soakedSec;
+        
+        String message;
+        serializeJson(doc, message);
+        broadcastMessage(message);
+        messagesSentCount++;
+    }
+    
+    lastPulseSequenceSent = latest;
+}
+
+void WebSocketManager::broadcastMessage(const String& message) {
+    // Sin clientes comprimidos (lo habitual) textAll basta; si la tabla de
+    // compresión se desbordó, también: todos entienden el texto
+    if (!compressor.isActive() ||
+        !compressor.broadcast(message.c_str(), message.length(), sendToClient, this)) {
+        webSocket->textAll(message);
+    }
+}
+
+void WebSocketManager::sendToClient(uint32_t clientId, const uint8_t* data, size_t length, bool binary, void* context) {
+    WebSocketManager* ws = static_cast<WebSocketManager*>(context);
+    AsyncWebSocketClient* client = ws->webSocket->client(clientId);
+    if (!client) {
+        return;                         // Se desconectó entre tanto
+    }
+    if (binary) {
+        client->binary(reinterpret_cast<const char*>(data), length);
+    } else {
+        client->text(reinterpret_cast<const char*>(data), length);
+    }
+}
+
 void WebSocketManager::forceStatusUpdate() {
     statusChanged = true;
 }
 
+String WebSocketManager::getStatusJson() {
+    return serializeSystemStatus(getCurrentSystemStatus());
+}
+
 // =============================================================================
 // Manejo de eventos WebSocket
 // =============================================================================
 
 void WebSocketManager::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, 
                                            AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    // Corre en la tarea AsyncTCP: en la traza se ve intercalado con loopTask
+    TRACE_SCOPE("ws.event");
     switch(type) {
         case WS_EVT_CONNECT:
             {
                 totalConnectionsCount++;
+                AdmissionControl::getInstance().webSocketConnected();
+                compressor.addClient(client->id());
                 logWebSocketEvent("Cliente conectado", client->id());
                 
-                // **ENVIAR ESTADO ACTUAL AL NUEVO CLIENTE**
-                String statusJson = serializeSystemStatus();
-                client->text(statusJson);
-                messagesSentCount++;
+                // **ESTADO ACTUAL AL NUEVO CLIENTE**: espera a su hello, que
+                // puede decir que ya lo tiene (bootstrap); sin hueco, ya
+                if (!statusPublisher.awaitHello(client->id(), millis())) {
+                    client->text(getStatusJson());
+                    messagesSentCount++;
+                }
                 
                 DEBUG_PRINTLN("🔗 [WebSocket] Cliente " + String(client->id()) + " conectado desde " + 
                              client->remoteIP().toString());
@@ -163,18 +322,28 @@ void WebSocketManager::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSock
             break;
             
         case WS_EVT_DISCONNECT:
+            reassembler.forget(client->id());
+            statusPublisher.forgetClient(client->id());
+            compressor.forgetClient(client->id());
+            AdmissionControl::getInstance().webSocketDisconnected();
             logWebSocketEvent("Cliente desconectado", client->id());
             DEBUG_PRINTLN("🔌 [WebSocket] Cliente " + String(client->id()) + " desconectado");
             break;
             
         case WS_EVT_DATA:
             {
+                // Mensajes fragmentados (o repartidos en varios paquetes TCP) se
+                // reensamblan; el JSON se analiza sobre el buffer, sin copiarlo
                 AwsFrameInfo* info = (AwsFrameInfo*)arg;
-                if(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-                    data[len] = 0; // Null terminator
-                    String message = (char*)data;
-                    handleClientMessage(client, message);
+                char* message = nullptr;
+                size_t length = 0;
+                ReassemblyResult result = reassembler.feed(client->id(), *info, data, len, message, length);
+                if (result == ReassemblyResult::COMPLETE) {
+                    handleClientMessage(client, message, length);
                     messagesReceivedCount++;
+                } else if (result == ReassemblyResult::TOO_LARGE) {
+                    DEBUG_PRINTLN("❌ [WebSocket] Mensaje de cliente " + String(client->id()) + " demasiado grande");
+                    sendClientError(client, "Mensaje demasiado grande");
                 }
             }
             break;
@@ -190,44 +359,164 @@ void WebSocketManager::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSock
     }
 }
 
-void WebSocketManager::handleClientMessage(AsyncWebSocketClient* client, const String& message) {
-    DEBUG_PRINTLN("📥 [WebSocket] Mensaje de cliente " + String(client->id()) + ": " + message);
+void WebSocketManager::sendClientError(AsyncWebSocketClient* client, const char* message) {
+    StaticJsonDocument<128> errorDoc;
+    errorDoc["type"] = "error";
+    errorDoc["message"] = message;
+    String errorMsg;
+    serializeJson(errorDoc, errorMsg);
+    client->text(errorMsg);
+}
+
+void WebSocketManager::handleClientMessage(AsyncWebSocketClient* client, char* message, size_t length) {
+    VERBOSE_PRINTLN("📥 [WebSocket] Mensaje de cliente " + String(client->id()) + " (" + String(length) + " bytes)");
     
-    // **PARSEAR MENSAJE JSON**
-    StaticJsonDocument<WebSocketConfig::MAX_MESSAGE_SIZE> doc;
-    DeserializationError error = deserializeJson(doc, message);
+    // **PARSEAR MENSAJE JSON** in situ: con char* modificable ArduinoJson no
+    // duplica las cadenas, así que la capacidad solo cubre los nodos. Se
+    // dimensiona con el tope del reensamblado (también el de los mensajes
+    // de una sola trama): todo lo que llega aquí cabe
+    DynamicJsonDocument doc(WebSocketConfig::MESSAGE_DOC_CAPACITY);
+    DeserializationError error = deserializeJson(doc, message, length);
     
+    if (error == DeserializationError::NoMemory) {
+        DEBUG_PRINTLN("❌ [WebSocket] Mensaje de cliente " + String(client->id()) + " sin memoria para analizarlo");
+        sendClientError(client, "Mensaje demasiado complejo");
+        return;
+    }
     if (error) {
         DEBUG_PRINTLN("❌ [WebSocket] Error parsing JSON: " + String(error.c_str()));
-        
-        // Enviar mensaje de error al cliente
-        DynamicJsonDocument errorDoc(256);
-        errorDoc["type"] = "error";
-        errorDoc["message"] = "JSON inválido";
-        String errorMsg;
-        serializeJson(errorDoc, errorMsg);
-        client->text(errorMsg);
+        sendClientError(client, "JSON inválido");
         return;
     }
     
-    // **PROCESAR COMANDO**
-    String command = doc["command"] | "";
-    String parameters = doc["parameters"] | "";
+    // **VISIBILIDAD DE LA PESTAÑA**: no es un comando, no pasa por la cola
+    const char* type = doc["type"] | "";
+    if (strcmp(type, "visibility") == 0) {
+        handleVisibility(client, doc["hidden"] | false);
+        return;
+    }
+    if (strcmp(type, "hello") == 0) {
+        handleHello(client, doc["compression"] | "", doc["statusSeq"] | 0u);
+        return;
+    }
+    
+    // **PROCESAR COMANDO**: uno suelto o un lote {"commands":[{...},{...}]}
+    JsonArrayConst batch = doc["commands"].as<JsonArrayConst>();
+    if (batch.isNull()) {
+        queueClientCommand(client, doc.as<JsonObjectConst>());
+        return;
+    }
+    for (JsonVariantConst entry : batch) {
+        queueClientCommand(client, entry.as<JsonObjectConst>());
+    }
+}
+
+void WebSocketManager::handleVisibility(AsyncWebSocketClient* client, bool hidden) {
+    VERBOSE_PRINTLN("[WebSocket] Cliente " + String(client->id()) + (hidden ? " oculto" : " visible"));
     
-    if (command.length() > 0) {
-        bool success = processClientCommand(client->id(), command, parameters);
+    // Mientras estuvo oculto pudo perder transiciones: estado completo al volver
+    if (statusPublisher.setClientHidden(client->id(), hidden)) {
+        client->text(getStatusJson());
+        messagesSentCount++;
+    }
+}
+
+void WebSocketManager::handleHello(AsyncWebSocketClient* client, const char* compression, uint32_t statusSeq) {
+    WsCompression mode = compressor.negotiate(client->id(), strcmp(compression, "deflate") == 0);
+    
+    // Sin takeover: aunque el cliente lo pida, cada trama es un DEFLATE completo
+    StaticJsonDocument<128> reply;
+    reply["type"] = "hello";
+    reply["compression"] = WebSocketCompressor::modeToString(mode);
+    reply["contextTakeover"] = false;
+    reply["windowBits"] = WebSocketCompressionConfig::WINDOW_BITS;
+    String message;
+    serializeJson(reply, message);
+    client->text(message);
+    
+    DEBUG_PRINTLN("🗜️ [WebSocket] Cliente " + String(client->id()) + " compresión: " + 
+                 String(WebSocketCompressor::modeToString(mode)));
+    
+    // Estado inicial, salvo que el cliente ya tenga el último difundido
+    if (statusPublisher.helloReceived(client->id()) && (statusSeq == 0 || statusSeq != statusSequence)) {
+        client->text(getStatusJson());
+        messagesSentCount++;
+    }
+}
+
+void WebSocketManager::queueClientCommand(AsyncWebSocketClient* client, JsonObjectConst entry) {
+    const char* command = entry["command"] | "";
+    const char* parameters = entry["parameters"] | "";
+    size_t commandLength = strlen(command);
+    
+    if (commandLength > 0) {
+        // **ENCOLAR**: este callback corre en la tarea AsyncTCP; el comando se
+        // ejecuta en el loop y la respuesta sale en onWebSocketCommandCompleted
+        bool queued = CommandQueue::getInstance().push(CommandSource::WEBSOCKET, client->id(),
+                                                       command, commandLength,
+                                                       parameters, strlen(parameters),
+                                                       &WebSocketManager::onWebSocketCommandCompleted, this);
+        if (!queued) {
+            DEBUG_PRINTLN("❌ [WebSocket] Cola de comandos llena, descartado: " + String(command));
+            
+            DynamicJsonDocument responseDoc(256);
+            responseDoc["type"] = "response";
+            responseDoc["command"] = command;
+            responseDoc["success"] = false;
+            responseDoc["error"] = "busy";
+            responseDoc["timestamp"] = millis();
+            
+            String response;
+            serializeJson(responseDoc, response);
+            client->text(response);
+        }
+    }
+}
+
+void WebSocketManager::processQueuedCommands() {
+    CommandQueue& queue = CommandQueue::getInstance();
+    QueuedCommand queued;
+    
+    uint8_t executed = 0;
+    for (; executed < CommandQueueConfig::MAX_COMMANDS_PER_UPDATE && queue.pop(queued); executed++) {
+        bool success = processClientCommand(queued.clientId, String(queued.command), String(queued.parameters));
         
-        // **ENVIAR RESPUESTA AL CLIENTE**
-        DynamicJsonDocument responseDoc(256);
-        responseDoc["type"] = "response";
-        responseDoc["command"] = command;
-        responseDoc["success"] = success;
-        responseDoc["timestamp"] = millis();
+        // Un comando ejecutado es una transición: su efecto se difunde ya
+        if (success) {
+            statusChanged = true;
+        }
         
-        String response;
-        serializeJson(responseDoc, response);
-        client->text(response);
+        if (queued.onComplete) {
+            queued.onComplete(queued, success, queued.context);
+        }
     }
+    
+    // Los comandos cambian el controlador fuera de su update(): se publica
+    // ya, para que el estado que sale a continuación refleje su efecto
+    if (executed > 0 && irrigationController) {
+        irrigationController->publishSnapshot();
+    }
+}
+
+void WebSocketManager::onWebSocketCommandCompleted(const QueuedCommand& command, bool success, void* context) {
+    WebSocketManager* manager = static_cast<WebSocketManager*>(context);
+    if (!manager || !manager->webSocket) return;
+    
+    // El cliente pudo desconectarse mientras el comando esperaba en la cola
+    AsyncWebSocketClient* client = manager->webSocket->client(command.clientId);
+    if (!client) return;
+    
+    // **ENVIAR RESPUESTA AL CLIENTE**
+    DynamicJsonDocument responseDoc(256);
+    responseDoc["type"] = "response";
+    responseDoc["command"] = command.command;
+    responseDoc["success"] = success;
+    responseDoc["timestamp"] = millis();
+    
+    String response;
+    serializeJson(responseDoc, response);
+    client->text(response);
+    manager->messagesSentCount++;
 }
 
 // =============================================================================
@@ -252,6 +541,21 @@ static void parseQueryParams(const String& params, String& zoneStr, String& time
     }
 }
 
+// Helper: obtener un único parámetro de una query string "k1=v1&k2=v2"
+static String getQueryParam(const String& params, const char* key) {
+    int start = 0;
+    while (start < (int)params.length()) {
+        int eq = params.indexOf('=', start);
+        if (eq < 0) break;
+        int amp = params.indexOf('&', eq + 1);
+        if (params.substring(start, eq) == key) {
+            return amp >= 0 ? params.substring(eq + 1, amp) : params.substring(eq + 1);
+        }
+        if (amp < 0) break; else start = amp + 1;
+    }
+    return String();
+}
+
 bool WebSocketManager::processClientCommand(uint32_t clientId, const String& command, const String& parameters) {
     DEBUG_PRINTLN("🎯 [WebSocket] Ejecutando comando: " + command);
     
@@ -313,6 +617,27 @@ bool WebSocketManager::processClientCommand(uint32_t clientId, const String& com
             return irrigationController->setZoneEnabled(zone, enabled);
         }
     }
+    else if (command == "set_handoff_mode") {
+        String zoneStr, timeStr, durationStr, enabledStr; parseQueryParams(parameters, zoneStr, timeStr, durationStr, enabledStr);
+        bool enabled = enabledStr.length() ? (enabledStr == "true" || enabledStr == "1") : true;
+        
+        irrigationController->setOverlappedHandoff(enabled);
+        return true;
+    }
+    else if (command == "set_watering_mode") {
+        String modeStr = getQueryParam(parameters, "mode");
+        String pulsesStr = getQueryParam(parameters, "pulses");
+        String soakStr = getQueryParam(parameters, "soak");
+        
+        if (modeStr == "continuous") {
+            return irrigationController->setWateringMode(WateringMode::CONTINUOUS);
+        }
+        if (modeStr == "soak") {
+            uint8_t pulses = pulsesStr.length() ? (uint8_t) pulsesStr.toInt() : SOAK_DEFAULT_PULSES;
+            uint32_t soak = soakStr.length() ? (uint32_t) soakStr.toInt() : SOAK_MIN_INTERVAL_SECONDS;
+            return irrigationController->setWateringMode(WateringMode::SOAK_CYCLE, pulses, soak);
+        }
+    }
     else if (command == "get_status") {
         // Forzar actualización de estado
         forceStatusUpdate();
@@ -327,13 +652,12 @@ bool WebSocketManager::processClientCommand(uint32_t clientId, const String& com
 // Serialización y estado
 // =============================================================================
 
-String WebSocketManager::serializeSystemStatus() {
-    SystemStatus status = getCurrentSystemStatus();
-
+String WebSocketManager::serializeSystemStatus(const SystemStatus& status) {
     StaticJsonDocument<1024> doc;
 
     // Tipo y tiempos
     doc["type"] = "status_update";
+    doc["seq"] = statusSequence.load();
     doc["timestamp"] = status.timestamp;
 
     // Sistema
@@ -348,6 +672,9 @@ String WebSocketManager::serializeSystemStatus() {
     irrigation["activeZone"] = status.activeZone;
     irrigation["remainingTime"] = status.remainingTime;
     irrigation["totalCycles"] = status.totalCycles;
+    if (status.wateringMode != nullptr) {
+        irrigation["wateringMode"] = status.wateringMode;
+    }
 
     // Sensores
     JsonObject sensors = doc["sensors"].to<JsonObject>();
@@ -361,6 +688,7 @@ String WebSocketManager::serializeSystemStatus() {
         zone["number"] = i + 1;
         zone["enabled"] = status.zonesEnabled[i];
         zone["irrigationTime"] = status.zoneTimes[i];
+        zone["valve"] = ServoPWMController::servoStateToString(static_cast<ServoState>(status.zoneValveStates[i]));
     }
 
     String result;
@@ -378,25 +706,24 @@ SystemStatus WebSocketManager::getCurrentSystemStatus() {
     status.hasErrors = false;
     
     if (irrigationController) {
-        // Estado del sistema de riego
-        IrrigationState currentState = irrigationController->getCurrentState();
-        status.irrigationState = String(ServoPWMController::stateToString(currentState));
-        status.activeZone = irrigationController->getCurrentActiveZone();
-        status.remainingTime = irrigationController->getRemainingIrrigationTime();
-        status.hasErrors = irrigationController->hasErrors();
+        // Se llama también desde AsyncTCP (conexión, visibilidad): se lee la
+        // foto publicada por el loop, nunca los campos vivos del controlador
+        ControllerSnapshot snapshot;
+        irrigationController->getSnapshot(snapshot);
         
-        // Estadísticas
-        uint32_t cycles, totalTime, uptime;
-        irrigationController->getSystemStatistics(cycles, totalTime, uptime);
-        status.totalCycles = cycles;
+        // Estado del sistema de riego
+        status.irrigationState = String(ServoPWMController::stateToString(snapshot.state));
+        status.activeZone = snapshot.activeZone;
+        status.remainingTime = snapshot.remainingTime;
+        status.hasErrors = snapshot.hasErrors;
+        status.totalCycles = snapshot.totalCycles;
+        status.wateringMode = ServoPWMController::wateringModeToString(snapshot.wateringMode);
         
         // Estado de zonas
-        for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-            const ZoneInfo* zoneInfo = irrigationController->getZoneInfo(i + 1);
-            if (zoneInfo) {
-                status.zonesEnabled[i] = zoneInfo->isEnabled;
-                status.zoneTimes[i] = zoneInfo->config.irrigationTime;
-            }
+        for (uint8_t i = 0; i < snapshot.zoneCount; i++) {
+            status.zonesEnabled[i] = snapshot.zones[i].enabled;
+            status.zoneTimes[i] = snapshot.zones[i].irrigationTime;
+            status.zoneValveStates[i] = static_cast<uint8_t>(snapshot.zones[i].state);
         }
     }
     
@@ -409,19 +736,6 @@ SystemStatus WebSocketManager::getCurrentSystemStatus() {
     return status;
 }
 
-bool WebSocketManager::hasStatusChanged() {
-    if (statusChanged) return true;
-    
-    SystemStatus currentStatus = getCurrentSystemStatus();
-    
-    // **COMPARACIÓN OPTIMIZADA** - Solo campos críticos
-    return (currentStatus.irrigationState != lastKnownStatus.irrigationState ||
-            currentStatus.activeZone != lastKnownStatus.activeZone ||
-            currentStatus.remainingTime != lastKnownStatus.remainingTime ||
-            currentStatus.hasErrors != lastKnownStatus.hasErrors ||
-            currentStatus.humidityPercent != lastKnownStatus.humidityPercent);
-}
-
 // =============================================================================
 // Métodos de utilidad
 // =============================================================================
@@ -455,7 +769,8 @@ bool WebSocketManager::validateCommand(const String& command, const String& para
     // Lista de comandos válidos
     const String validCommands[] = {
         "start_irrigation", "stop_irrigation", "emergency_stop",
-        "open_zone", "close_zone", "set_zone_time", "enable_zone", "get_status"
+        "open_zone", "close_zone", "set_zone_time", "enable_zone", "get_status",
+        "set_handoff_mode", "set_watering_mode"
     };
     
     for (const String& validCmd : validCommands) {
@@ -496,7 +811,7 @@ AsyncWebSocket* WebSocketManager::getAsyncWebSocket() const {
 // =============================================================================
 
 WebSocketManager* createWebSocketManager(ServoPWMController* controller) {
-    WebSocketManager* manager = new WebSocketManager("/ws", controller);
+    WebSocketManager* manager = new WebSocketManager(WebSocketConfig::PATH, controller);
     
     if (!manager->initialize()) {
         delete manager;
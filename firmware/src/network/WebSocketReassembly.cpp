@@ -0,0 +1,110 @@
+/**
+ * @file WebSocketReassembly.cpp
+ * @brief Acumulación de fragmentos por cliente y vista directa del mensaje.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/network/WebSocketReassembly.h"
+#include <string.h>
+
+using namespace WebSocketReassemblyConfig;
+
+WebSocketReassembler::WebSocketReassembler() : droppedCount(0) {
+    for (uint8_t i = 0; i < SLOTS; i++) {
+        slots[i].clientId = 0;
+        slots[i].inUse = false;
+        slots[i].discarding = false;
+        slots[i].length = 0;
+    }
+}
+
+WebSocketReassembler::Slot* WebSocketReassembler::findSlot(uint32_t clientId, bool allocate) {
+    Slot* freeSlot = nullptr;
+    for (uint8_t i = 0; i < SLOTS; i++) {
+        if (slots[i].inUse && slots[i].clientId == clientId) {
+            return &slots[i];
+        }
+        if (!slots[i].inUse && freeSlot == nullptr) {
+            freeSlot = &slots[i];
+        }
+    }
+    if (!allocate || freeSlot == nullptr) {
+        return nullptr;
+    }
+    freeSlot->clientId = clientId;
+    freeSlot->inUse = true;
+    freeSlot->discarding = false;
+    freeSlot->length = 0;
+    return freeSlot;
+}
+
+ReassemblyResult WebSocketReassembler::feed(uint32_t clientId, const AwsFrameInfo& info, uint8_t* data,
+                                            size_t len, char*& message, size_t& length) {
+    bool first = info.num == 0 && info.index == 0;
+    bool last = info.final && info.index + len == info.len;
+
+    if (info.message_opcode != WS_TEXT) {
+        return ReassemblyResult::IGNORED;
+    }
+
+    // Mensaje entero en una sola llamada: se analiza sobre el buffer de la
+    // biblioteca, con el mismo tope que los reensamblados
+    if (first && last) {
+        if (len > MAX_MESSAGE_BYTES) {
+            droppedCount++;
+            return ReassemblyResult::TOO_LARGE;
+        }
+        message = reinterpret_cast<char*>(data);
+        length = len;
+        return ReassemblyResult::COMPLETE;
+    }
+
+    Slot* slot = findSlot(clientId, first);
+    if (slot == nullptr) {
+        if (first) {
+            droppedCount++;
+            return ReassemblyResult::TOO_LARGE;     // Sin hueco libre
+        }
+        return ReassemblyResult::IGNORED;           // Continuación de un mensaje no seguido
+    }
+    if (first) {
+        slot->length = 0;
+        slot->discarding = false;
+    }
+
+    if (slot->discarding) {
+        if (last) {
+            slot->inUse = false;
+        }
+        return ReassemblyResult::IGNORED;
+    }
+    if (slot->length + len > MAX_MESSAGE_BYTES) {
+        droppedCount++;
+        slot->discarding = !last;
+        slot->inUse = !last;
+        return ReassemblyResult::TOO_LARGE;
+    }
+
+    memcpy(slot->buffer + slot->length, data, len);
+    slot->length += len;
+    if (!last) {
+        return ReassemblyResult::PENDING;
+    }
+
+    // El hueco queda libre, pero su contenido sigue intacto hasta el próximo
+    // mensaje fragmentado: solo entonces podría reutilizarse
+    slot->inUse = false;
+    message = slot->buffer;
+    length = slot->length;
+    return ReassemblyResult::COMPLETE;
+}
+
+void WebSocketReassembler::forget(uint32_t clientId) {
+    Slot* slot = findSlot(clientId, false);
+    if (slot != nullptr) {
+        slot->inUse = false;
+    }
+}
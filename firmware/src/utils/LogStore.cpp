@@ -0,0 +1,515 @@
+/**
+ * @file LogStore.cpp
+ * @brief Implementación del log en segmentos comprimidos con índice disperso.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "LogStore.h"
+#include "MiniInflate.h"
+#include <new>
+#include <string.h>
+#include <stdio.h>
+
+namespace {
+    void summarizeText(const char* text, size_t length, LogBlockHeader& header) {
+        size_t start = 0;
+        while (start < length) {
+            const char* newline = static_cast<const char*>(memchr(text + start, '\n', length - start));
+            size_t end = newline ? static_cast<size_t>(newline - text) : length;
+
+            LogLineInfo line;
+            if (LogStore::parseLine(text + start, end - start, line)) {
+                header.levelMask |= static_cast<uint8_t>(1u << line.level);
+                if (line.uptimeClock) {
+                    header.flags |= LogSummaryFlags::HAS_UPTIME_LINES;
+                } else {
+                    if (header.firstTime == 0) {
+                        header.firstTime = line.time;
+                    }
+                    if (line.time > header.lastTime) {
+                        header.lastTime = line.time;
+                    }
+                }
+            }
+            start = end + 1;
+        }
+    }
+}
+
+// =============================================================================
+// LogQuery
+// =============================================================================
+
+bool LogQuery::matchesLine(const LogLineInfo& line) const {
+    if (line.level > maxLevel) {
+        return false;
+    }
+    return since == 0 || (!line.uptimeClock && line.time >= since);
+}
+
+bool LogQuery::matchesSummary(uint32_t lastTime, uint8_t levelMask) const {
+    uint8_t wanted = static_cast<uint8_t>((2u << maxLevel) - 1);
+    if ((levelMask & wanted) == 0) {
+        return false;
+    }
+    // lastTime == 0: el bloque solo tiene líneas sin hora Unix
+    return since == 0 || lastTime >= since;
+}
+
+// =============================================================================
+// LogStore
+// =============================================================================
+
+/**
+ * @brief Memoria de trabajo de una rotación (~7 KB, solo mientras dura).
+ */
+struct LogStore::RotationScratch {
+    MiniDeflate deflater;
+    uint8_t raw[LogStoreConfig::BLOCK_RAW_BYTES];
+    uint8_t packed[LogStoreConfig::BLOCK_PACKED_MAX];
+};
+
+LogStore::LogStore()
+    : segmentCount(0)
+    , nextSequence(1)
+    , segmentBytes(LogStoreConfig::DEFAULT_SEGMENT_BYTES)
+    , pinCount(0)
+    , started(false)
+    , rotationCount(0)
+{
+    lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+}
+
+bool LogStore::begin() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (started) {
+        xSemaphoreGive(lock);
+        return true;
+    }
+
+    segmentCount = 0;
+    if (SPIFFS.exists(LogStoreConfig::INDEX_PATH)) {
+        File index = SPIFFS.open(LogStoreConfig::INDEX_PATH, "r");
+        if (index) {
+            size_t bytes = index.read(reinterpret_cast<uint8_t*>(segments), sizeof(segments));
+            segmentCount = static_cast<uint8_t>(bytes / sizeof(LogSegmentInfo));
+            index.close();
+        }
+    }
+    nextSequence = segmentCount > 0 ? segments[segmentCount - 1].sequence + 1 : 1;
+    started = true;
+    xSemaphoreGive(lock);
+    return true;
+}
+
+void LogStore::setSegmentBytes(size_t bytes) {
+    if (bytes < LogStoreConfig::MIN_SEGMENT_BYTES) {
+        bytes = LogStoreConfig::MIN_SEGMENT_BYTES;
+    }
+    segmentBytes = bytes;
+}
+
+bool LogStore::append(const char* data, size_t length) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (!started) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    File active = SPIFFS.open(LogStoreConfig::ACTIVE_PATH, "a");
+    if (!active) {
+        xSemaphoreGive(lock);
+        Serial.println("[LOGSTORE ERROR] No se pudo abrir " + String(LogStoreConfig::ACTIVE_PATH));
+        return false;
+    }
+    bool ok = active.write(reinterpret_cast<const uint8_t*>(data), length) == length;
+    size_t size = active.size();
+    active.close();
+
+    // Con una consulta en curso la rotación espera al siguiente append
+    if (size >= segmentBytes && pinCount == 0) {
+        rotateLocked();
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+void LogStore::pin() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    pinCount++;
+    xSemaphoreGive(lock);
+}
+
+void LogStore::unpin() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (pinCount > 0) {
+        pinCount--;
+    }
+    xSemaphoreGive(lock);
+}
+
+uint8_t LogStore::copySegments(LogSegmentInfo* out, uint8_t maxSegments) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t count = segmentCount < maxSegments ? segmentCount : maxSegments;
+    memcpy(out, segments, count * sizeof(LogSegmentInfo));
+    xSemaphoreGive(lock);
+    return count;
+}
+
+void LogStore::segmentPath(uint32_t sequence, char* out, size_t outLength) {
+    snprintf(out, outLength, "%s%lu.z", LogStoreConfig::SEGMENT_PREFIX, static_cast<unsigned long>(sequence));
+}
+
+bool LogStore::parseLine(const char* line, size_t length, LogLineInfo& info) {
+    size_t pos = 0;
+    uint32_t value = 0;
+    while (pos < length && line[pos] >= '0' && line[pos] <= '9') {
+        value = value * 10 + static_cast<uint32_t>(line[pos] - '0');
+        pos++;
+    }
+    // "<hora> <reloj> <nivel> " ocupa al menos 7 caracteres
+    if (pos == 0 || pos + 6 > length || line[pos] != ' ' || line[pos + 2] != ' ' || line[pos + 4] != ' ') {
+        return false;
+    }
+    char clock = line[pos + 1];
+    char level = line[pos + 3];
+    if ((clock != 'e' && clock != 'u') || level < '0' || level > '0' + LogStoreConfig::MAX_LEVEL) {
+        return false;
+    }
+    info.time = value;
+    info.uptimeClock = clock == 'u';
+    info.level = static_cast<uint8_t>(level - '0');
+    return true;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * La rotación se hace en tres pasos y en este orden para que un corte de
+ * corriente nunca pierda el índice: 1) se escribe el segmento comprimido,
+ * 2) se guarda el índice que lo incluye, 3) se borra el texto original. Si
+ * se corta entre 2 y 3, las líneas quedan duplicadas, no perdidas.
+ */
+bool LogStore::rotateLocked() {
+    RotationScratch* scratch = new (std::nothrow) RotationScratch();
+    if (scratch == nullptr) {
+        Serial.println("[LOGSTORE ERROR] Sin memoria para rotar el log");
+        return false;
+    }
+
+    LogSegmentInfo info = {};
+    info.sequence = nextSequence;
+    char path[24];
+    segmentPath(info.sequence, path, sizeof(path));
+
+    File source = SPIFFS.open(LogStoreConfig::ACTIVE_PATH, "r");
+    File target = SPIFFS.open(path, "w");
+    bool ok = source && target;
+    if (ok) {
+        ok = compressActiveLocked(*scratch, source, target, info);
+    }
+    if (source) {
+        source.close();
+    }
+    if (target) {
+        target.close();
+    }
+    delete scratch;
+
+    if (!ok) {
+        SPIFFS.remove(path);
+        Serial.println("[LOGSTORE ERROR] Fallo comprimiendo el segmento " + String(info.sequence));
+        return false;
+    }
+
+    // Retención: el segmento más antiguo deja sitio al nuevo
+    if (segmentCount == LogStoreConfig::MAX_SEGMENTS) {
+        char oldPath[24];
+        segmentPath(segments[0].sequence, oldPath, sizeof(oldPath));
+        SPIFFS.remove(oldPath);
+        memmove(segments, segments + 1, (segmentCount - 1) * sizeof(LogSegmentInfo));
+        segmentCount--;
+    }
+    segments[segmentCount++] = info;
+    nextSequence++;
+    rotationCount++;
+
+    saveIndexLocked();
+    SPIFFS.remove(LogStoreConfig::ACTIVE_PATH);
+    return true;
+}
+
+bool LogStore::compressActiveLocked(RotationScratch& scratch, File& source, File& target, LogSegmentInfo& info) {
+    bool ok = true;
+    while (ok) {
+        size_t n = source.read(scratch.raw, sizeof(scratch.raw));
+        if (n == 0) {
+            break;
+        }
+
+        // Cortar el bloque en el último fin de línea: cada bloque se puede
+        // filtrar por sí solo. Una línea más larga que el bloque se parte.
+        size_t cut = n;
+        if (n == sizeof(scratch.raw)) {
+            for (size_t i = n; i > 0; i--) {
+                if (scratch.raw[i - 1] == '\n') {
+                    cut = i;
+                    break;
+                }
+            }
+            if (cut < n) {
+                source.seek(source.position() - (n - cut));
+            }
+        }
+
+        LogBlockHeader header = {};
+        header.rawLength = static_cast<uint16_t>(cut);
+        summarizeText(reinterpret_cast<const char*>(scratch.raw), cut, header);
+
+        // Un bloque de WINDOW_SIZE bytes se comprime entero en finish()
+        scratch.deflater.begin();
+        scratch.deflater.write(scratch.raw, cut);
+        scratch.deflater.finish();
+        header.packedLength = static_cast<uint16_t>(scratch.deflater.read(scratch.packed, sizeof(scratch.packed)));
+
+        ok = target.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+             target.write(scratch.packed, header.packedLength) == header.packedLength;
+
+        if (info.firstTime == 0) {
+            info.firstTime = header.firstTime;
+        }
+        if (header.lastTime > info.lastTime) {
+            info.lastTime = header.lastTime;
+        }
+        info.levelMask |= header.levelMask;
+        info.flags |= header.flags;
+        info.blockCount++;
+    }
+
+    return ok && info.blockCount > 0;
+}
+
+bool LogStore::saveIndexLocked() {
+    File index = SPIFFS.open(LogStoreConfig::INDEX_PATH, "w");
+    if (!index) {
+        Serial.println("[LOGSTORE ERROR] No se pudo escribir " + String(LogStoreConfig::INDEX_PATH));
+        return false;
+    }
+    size_t bytes = segmentCount * sizeof(LogSegmentInfo);
+    bool ok = index.write(reinterpret_cast<const uint8_t*>(segments), bytes) == bytes;
+    index.close();
+    return ok;
+}
+
+// =============================================================================
+// LogQueryCursor
+// =============================================================================
+
+LogQueryCursor LogQueryCursor::instance;
+uint32_t LogQueryCursor::nextToken = 0;
+
+LogQueryCursor* LogQueryCursor::acquire(uint32_t& tokenOut, const LogQuery& query) {
+    if (instance.inUse) {
+        return nullptr;
+    }
+
+    LogStore::getInstance().pin();
+    instance.reset(query);
+    instance.inUse = true;
+    if (++nextToken == 0) {
+        nextToken = 1;
+    }
+    instance.token = nextToken;
+    tokenOut = nextToken;
+    return &instance;
+}
+
+void LogQueryCursor::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        if (file) {
+            file.close();
+        }
+        LogStore::getInstance().unpin();
+        inUse = false;
+    }
+}
+
+void LogQueryCursor::reset(const LogQuery& newQuery) {
+    query = newQuery;
+    phase = Phase::SEGMENTS;
+    segmentCount = LogStore::getInstance().copySegments(segments, LogStoreConfig::MAX_SEGMENTS);
+    segmentIndex = 0;
+    activeRemaining = 0;
+    textLength = 0;
+    textPos = 0;
+    emitPos = 0;
+    emitEnd = 0;
+}
+
+bool LogQueryCursor::parseLevel(const char* text, uint8_t& level) {
+    static const char* const NAMES[] = { "error", "warning", "info", "debug", "verbose" };
+    if (text[0] >= '0' && text[0] <= '0' + LogStoreConfig::MAX_LEVEL && text[1] == '\0') {
+        level = static_cast<uint8_t>(text[0] - '0');
+        return true;
+    }
+    for (uint8_t i = 0; i <= LogStoreConfig::MAX_LEVEL; i++) {
+        if (strcasecmp(text, NAMES[i]) == 0) {
+            level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Aquí está el ahorro de la búsqueda: un segmento cuyo resumen no encaja no
+ * se abre, y dentro de un segmento se leen solo las cabeceras de 16 bytes
+ * de los bloques que no encajan, saltando sus datos con seek().
+ */
+bool LogQueryCursor::loadNextBlock() {
+    while (segmentIndex < segmentCount) {
+        const LogSegmentInfo& segment = segments[segmentIndex];
+        if (!file) {
+            if (!query.matchesSummary(segment.lastTime, segment.levelMask)) {
+                segmentIndex++;
+                continue;
+            }
+            char path[24];
+            LogStore::segmentPath(segment.sequence, path, sizeof(path));
+            file = SPIFFS.open(path, "r");
+            if (!file) {
+                segmentIndex++;
+                continue;
+            }
+        }
+
+        LogBlockHeader header;
+        if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)) {
+            file.close();
+            segmentIndex++;
+            continue;
+        }
+        if (header.packedLength > sizeof(packed) || header.rawLength > sizeof(text) ||
+            !query.matchesSummary(header.lastTime, header.levelMask)) {
+            file.seek(file.position() + header.packedLength);
+            continue;
+        }
+
+        size_t inflated = 0;
+        if (file.read(packed, header.packedLength) != header.packedLength ||
+            !MiniInflate::inflate(packed, header.packedLength,
+                                  reinterpret_cast<uint8_t*>(text), sizeof(text), inflated)) {
+            // Bloque dañado: se salta el resto del segmento
+            file.close();
+            segmentIndex++;
+            continue;
+        }
+        textLength = inflated;
+        textPos = 0;
+        return true;
+    }
+    return false;
+}
+
+bool LogQueryCursor::loadActiveText() {
+    if (!file) {
+        if (!SPIFFS.exists(LogStoreConfig::ACTIVE_PATH)) {
+            return false;
+        }
+        file = SPIFFS.open(LogStoreConfig::ACTIVE_PATH, "r");
+        if (!file) {
+            return false;
+        }
+        // Lo que se añada durante la consulta queda para la siguiente
+        activeRemaining = file.size();
+        textLength = 0;
+        textPos = 0;
+    }
+    if (activeRemaining == 0) {
+        return false;
+    }
+
+    // Conservar la línea a medias del trozo anterior
+    size_t carry = textLength - textPos;
+    memmove(text, text + textPos, carry);
+    textLength = carry;
+    textPos = 0;
+
+    size_t wanted = sizeof(text) - textLength;
+    if (wanted > activeRemaining) {
+        wanted = activeRemaining;
+    }
+    size_t n = file.read(reinterpret_cast<uint8_t*>(text + textLength), wanted);
+    if (n == 0) {
+        activeRemaining = 0;
+        return textLength > 0;
+    }
+    textLength += n;
+    activeRemaining -= n;
+    return true;
+}
+
+bool LogQueryCursor::nextMatchingLine() {
+    while (true) {
+        while (textPos < textLength) {
+            const char* newline = static_cast<const char*>(memchr(text + textPos, '\n', textLength - textPos));
+            size_t end;
+            if (newline != nullptr) {
+                end = static_cast<size_t>(newline - text) + 1;
+            } else if (phase == Phase::ACTIVE && activeRemaining > 0 && textPos > 0) {
+                break;      // Línea a medias: leer más del segmento activo
+            } else {
+                end = textLength;
+            }
+
+            size_t start = textPos;
+            textPos = end;
+            LogLineInfo line;
+            if (LogStore::parseLine(text + start, end - start, line) && query.matchesLine(line)) {
+                emitPos = start;
+                emitEnd = end;
+                return true;
+            }
+        }
+
+        if (phase == Phase::SEGMENTS) {
+            if (loadNextBlock()) {
+                continue;
+            }
+            phase = Phase::ACTIVE;
+            textLength = 0;
+            textPos = 0;
+        }
+        if (phase == Phase::ACTIVE && loadActiveText()) {
+            continue;
+        }
+        if (file) {
+            file.close();
+        }
+        phase = Phase::DONE;
+        return false;
+    }
+}
+
+size_t LogQueryCursor::fill(uint8_t* out, size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+        if (emitPos < emitEnd) {
+            size_t chunk = emitEnd - emitPos;
+            if (chunk > maxLength - written) {
+                chunk = maxLength - written;
+            }
+            memcpy(out + written, text + emitPos, chunk);
+            emitPos += chunk;
+            written += chunk;
+            continue;
+        }
+        if (phase == Phase::DONE || !nextMatchingLine()) {
+            break;
+        }
+    }
+    return written;
+}
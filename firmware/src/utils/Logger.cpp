@@ -4,8 +4,11 @@
  */
 
 #include "Logger.h"
+#include "LogStore.h"
+#include "Trace.h"
 #include <SPIFFS.h>
 #include <Arduino.h>
+#include <time.h>
 
 // Instancia singleton
 Logger* Logger::instance = nullptr;
@@ -38,6 +41,8 @@ void Logger::initialize(LogLevel level, bool serial, bool file, bool web) {
         if (!SPIFFS.begin(true)) {
             Serial.println("[LOGGER ERROR] No se pudo inicializar SPIFFS para logging");
             logToFile = false;
+        } else {
+            LogStore::getInstance().begin();
         }
     }
     
@@ -78,15 +83,29 @@ void Logger::setSerialLogging(bool enabled) {
     info("Logging a serial " + String(enabled ? "habilitado" : "deshabilitado"));
 }
 
+bool Logger::isSerialLogging() const {
+    return logToSerial;
+}
+
 void Logger::setFileLogging(bool enabled) {
     logToFile = enabled;
-    if (enabled && !SPIFFS.begin(true)) {
-        Serial.println("[LOGGER ERROR] No se pudo inicializar SPIFFS para logging");
-        logToFile = false;
+    if (enabled) {
+        if (!SPIFFS.begin(true)) {
+            Serial.println("[LOGGER ERROR] No se pudo inicializar SPIFFS para logging");
+            logToFile = false;
+        } else {
+            LogStore::getInstance().begin();
+        }
     }
     info("Logging a archivo " + String(enabled ? "habilitado" : "deshabilitado"));
 }
 
+void Logger::setMaxFileSize(uint32_t kilobytes) {
+    if (kilobytes > 0) {
+        LogStore::getInstance().setSegmentBytes(kilobytes * 1024);
+    }
+}
+
 void Logger::setWebLogging(bool enabled) {
     logToWeb = enabled;
     info("Logging a web " + String(enabled ? "habilitado" : "deshabilitado"));
@@ -94,10 +113,10 @@ void Logger::setWebLogging(bool enabled) {
 
 void Logger::flush() {
     if (logBuffer.length() > 0 && logToFile) {
-        File logFile = SPIFFS.open("/system.log", "a");
-        if (logFile) {
-            logFile.println(logBuffer);
-            logFile.close();
+        TRACE_SCOPE("log.flush");
+        // LogStore añade al segmento activo y lo rota/comprime al llenarse
+        // (si falla se reintenta, pero sin dejar crecer el buffer sin límite)
+        if (LogStore::getInstance().append(logBuffer.c_str(), logBuffer.length()) || bufferSize > 4096) {
             logBuffer = "";
             bufferSize = 0;
         }
@@ -128,8 +147,9 @@ void Logger::log(LogLevel level, const String& message) {
     
     // Manejar buffer para logging a archivo
     if (logToFile) {
-        logBuffer += formattedMessage + "\n";
-        bufferSize += formattedMessage.length() + 1;
+        String line = formatStorePrefix(level) + formattedMessage + "\n";
+        logBuffer += line;
+        bufferSize += line.length();
         
         // Vaciar buffer si excede el tamaño o ha pasado el tiempo
         if (bufferSize > 1024 || millis() - lastFlushTime > 5000) {
@@ -151,6 +171,23 @@ String Logger::formatTimestamp() {
     return String(timestamp);
 }
 
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * En flash cada línea empieza por "<hora> <reloj> <nivel> " (ver LogStore.h).
+ * Es lo que permite a /api/v1/logs filtrar por hora y nivel sin interpretar
+ * el texto libre del mensaje.
+ */
+String Logger::formatStorePrefix(LogLevel level) {
+    char prefix[24];
+    time_t now = time(nullptr);
+    if (now >= static_cast<time_t>(LogStoreConfig::MIN_VALID_EPOCH)) {
+        snprintf(prefix, sizeof(prefix), "%lu e %d ", static_cast<unsigned long>(now), static_cast<int>(level));
+    } else {
+        snprintf(prefix, sizeof(prefix), "%lu u %d ", static_cast<unsigned long>(millis() / 1000), static_cast<int>(level));
+    }
+    return String(prefix);
+}
+
 void Logger::writeToSerial(const String& formattedMessage) {
     Serial.println(formattedMessage);
 }
@@ -0,0 +1,268 @@
+/**
+ * @file MiniDeflate.cpp
+ * @brief Implementación del compresor DEFLATE con Huffman fijo.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "MiniDeflate.h"
+#include <string.h>
+
+namespace {
+    constexpr uint16_t MIN_MATCH = 3;
+    constexpr uint16_t MAX_MATCH = 258;
+
+    // RFC 1951 §3.2.5: longitudes 257..285
+    const uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    const uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+
+    // Distancias 0..29 (solo se usan hasta la ventana de 1 KB, código 19)
+    const uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577
+    };
+    const uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+}
+
+MiniDeflate::MiniDeflate() {
+    begin();
+}
+
+void MiniDeflate::begin() {
+    bufferFill = 0;
+    historyLength = 0;
+    bufferBase = 0;
+    memset(head, 0, sizeof(head));
+    outLength = 0;
+    outPos = 0;
+    bitBuffer = 0;
+    bitCount = 0;
+    closed = false;
+
+    // Cabecera del primer bloque: BFINAL=0, BTYPE=01 (Huffman fijo). El
+    // bloque queda abierto hasta finish(): no hace falta saber el tamaño.
+    putBits(0, 1);
+    putBits(1, 2);
+}
+
+size_t MiniDeflate::write(const uint8_t* data, size_t length) {
+    if (closed) {
+        return 0;
+    }
+
+    size_t accepted = 0;
+    while (accepted < length) {
+        if (bufferFill - historyLength == MiniDeflateConfig::WINDOW_SIZE) {
+            // Bloque lleno: comprimir solo si cabe el peor caso en la salida
+            if (pendingOutput() > 0) {
+                break;
+            }
+            compressPending();
+        }
+
+        size_t space = MiniDeflateConfig::WINDOW_SIZE - (bufferFill - historyLength);
+        size_t chunk = length - accepted < space ? length - accepted : space;
+        memcpy(buffer + bufferFill, data + accepted, chunk);
+        bufferFill += chunk;
+        accepted += chunk;
+    }
+    return accepted;
+}
+
+bool MiniDeflate::finish() {
+    if (closed) {
+        return true;
+    }
+    if (pendingOutput() > 0) {
+        return false;
+    }
+
+    compressPending();
+
+    // Fin del bloque abierto y un último bloque vacío con BFINAL=1
+    putHuffman(0, 7);               // Símbolo 256 (fin de bloque)
+    putBits(1, 1);
+    putBits(1, 2);
+    putHuffman(0, 7);
+    flushBits();
+    closed = true;
+    return true;
+}
+
+bool MiniDeflate::flush() {
+    if (closed) {
+        return true;
+    }
+    if (pendingOutput() > 0) {
+        return false;
+    }
+
+    compressPending();
+
+    // Fin del bloque fijo, bloque almacenado vacío (BFINAL=0, BTYPE=00,
+    // LEN=0, NLEN=0xFFFF) alineado a byte y apertura del siguiente bloque
+    // fijo, cuya cabecera queda en bitBuffer hasta el próximo mensaje
+    putHuffman(0, 7);
+    putBits(0, 3);
+    flushBits();
+    putBits(0x0000, 16);
+    putBits(0xFFFF, 16);
+    putBits(0, 1);
+    putBits(1, 2);
+    return true;
+}
+
+size_t MiniDeflate::read(uint8_t* dest, size_t maxLength) {
+    size_t available = pendingOutput();
+    size_t chunk = available < maxLength ? available : maxLength;
+    memcpy(dest, out + outPos, chunk);
+    outPos += chunk;
+    if (outPos == outLength) {
+        outPos = 0;
+        outLength = 0;
+    }
+    return chunk;
+}
+
+uint16_t MiniDeflate::hashAt(size_t index) const {
+    uint32_t v = (static_cast<uint32_t>(buffer[index]) << 16) |
+                 (static_cast<uint32_t>(buffer[index + 1]) << 8) |
+                 buffer[index + 2];
+    return static_cast<uint16_t>((v * 2654435761u) >> (32 - MiniDeflateConfig::HASH_BITS));
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Se comprime todo lo que hay tras la historia. Para cada posición se busca
+ * en la tabla hash la última vez que aparecieron esos 3 bytes; si está
+ * dentro de la ventana se mide cuánto coinciden y se emite (longitud,
+ * distancia). Después, el bloque recién comprimido pasa a ser la historia
+ * del siguiente.
+ */
+void MiniDeflate::compressPending() {
+    size_t pos = historyLength;
+    const size_t end = bufferFill;
+
+    while (pos < end) {
+        uint16_t bestLength = 0;
+        uint16_t bestDistance = 0;
+
+        if (pos + MIN_MATCH <= end) {
+            uint16_t h = hashAt(pos);
+            uint32_t absolute = bufferBase + pos;
+            uint32_t candidate = head[h];       // Posición absoluta + 1
+            head[h] = absolute + 1;
+
+            if (candidate != 0 && candidate - 1 >= bufferBase &&
+                absolute - (candidate - 1) <= MiniDeflateConfig::WINDOW_SIZE) {
+                size_t from = candidate - 1 - bufferBase;
+                size_t limit = end - pos < MAX_MATCH ? end - pos : MAX_MATCH;
+                size_t n = 0;
+                while (n < limit && buffer[from + n] == buffer[pos + n]) {
+                    n++;
+                }
+                if (n >= MIN_MATCH) {
+                    bestLength = static_cast<uint16_t>(n);
+                    bestDistance = static_cast<uint16_t>(absolute - (candidate - 1));
+                }
+            }
+        }
+
+        if (bestLength > 0) {
+            putMatch(bestLength, bestDistance);
+            // Registrar también las posiciones cubiertas por la coincidencia
+            for (size_t i = 1; i < bestLength; i++) {
+                if (pos + i + MIN_MATCH <= end) {
+                    head[hashAt(pos + i)] = bufferBase + pos + i + 1;
+                }
+            }
+            pos += bestLength;
+        } else {
+            putLiteral(buffer[pos]);
+            pos++;
+        }
+    }
+
+    // Conservar como historia los últimos WINDOW_SIZE bytes
+    size_t keep = end < MiniDeflateConfig::WINDOW_SIZE ? end : MiniDeflateConfig::WINDOW_SIZE;
+    size_t drop = end - keep;
+    if (drop > 0) {
+        memmove(buffer, buffer + drop, keep);
+        bufferBase += drop;
+    }
+    bufferFill = keep;
+    historyLength = keep;
+}
+
+void MiniDeflate::putBits(uint32_t value, uint8_t count) {
+    bitBuffer |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        if (outLength < sizeof(out)) {
+            out[outLength++] = static_cast<uint8_t>(bitBuffer);
+        }
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Los códigos Huffman se definen empezando por el bit más significativo,
+ * pero DEFLATE empaqueta los bits desde el menos significativo. Por eso el
+ * código se invierte antes de escribirlo.
+ */
+void MiniDeflate::putHuffman(uint16_t code, uint8_t length) {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        reversed = static_cast<uint16_t>((reversed << 1) | ((code >> i) & 1));
+    }
+    putBits(reversed, length);
+}
+
+void MiniDeflate::putLiteral(uint8_t literal) {
+    if (literal < 144) {
+        putHuffman(static_cast<uint16_t>(0x30 + literal), 8);
+    } else {
+        putHuffman(static_cast<uint16_t>(0x190 + literal - 144), 9);
+    }
+}
+
+void MiniDeflate::putMatch(uint16_t length, uint16_t distance) {
+    uint8_t code = 28;
+    while (code > 0 && LENGTH_BASE[code] > length) {
+        code--;
+    }
+    uint16_t symbol = static_cast<uint16_t>(257 + code);
+    if (symbol < 280) {
+        putHuffman(static_cast<uint16_t>(symbol - 256), 7);
+    } else {
+        putHuffman(static_cast<uint16_t>(0xC0 + symbol - 280), 8);
+    }
+    putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+    uint8_t dcode = 29;
+    while (dcode > 0 && DISTANCE_BASE[dcode] > distance) {
+        dcode--;
+    }
+    putHuffman(dcode, 5);
+    putBits(distance - DISTANCE_BASE[dcode], DISTANCE_EXTRA[dcode]);
+}
+
+void MiniDeflate::flushBits() {
+    if (bitCount > 0) {
+        putBits(0, static_cast<uint8_t>(8 - bitCount));
+    }
+}
@@ -0,0 +1,195 @@
+/**
+ * @file MiniInflate.cpp
+ * @brief Implementación del descompresor DEFLATE mínimo.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "MiniInflate.h"
+#include <string.h>
+
+namespace {
+    // RFC 1951 §3.2.5 (las mismas tablas que MiniDeflate)
+    const uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    const uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    const uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577
+    };
+    const uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+}
+
+MiniInflate::MiniInflate(const uint8_t* in, size_t inLength)
+    : input(in)
+    , inputLength(inLength)
+    , inputPos(0)
+    , bitBuffer(0)
+    , bitCount(0)
+{
+}
+
+bool MiniInflate::bit(uint32_t& value) {
+    if (bitCount == 0) {
+        if (inputPos >= inputLength) {
+            return false;
+        }
+        bitBuffer = input[inputPos++];
+        bitCount = 8;
+    }
+    value = bitBuffer & 1;
+    bitBuffer >>= 1;
+    bitCount--;
+    return true;
+}
+
+bool MiniInflate::bits(uint8_t count, uint32_t& value) {
+    value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t b;
+        if (!bit(b)) {
+            return false;
+        }
+        value |= b << i;
+    }
+    return true;
+}
+
+/**
+ * EXPLICACIÓN EDUCATIVA:
+ * Los bits extra se leen desde el menos significativo, pero los códigos
+ * Huffman llegan empezando por el más significativo: se van desplazando a
+ * la izquierda según entran.
+ */
+bool MiniInflate::huffmanBits(uint8_t count, uint32_t& code) {
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t b;
+        if (!bit(b)) {
+            return false;
+        }
+        code = (code << 1) | b;
+    }
+    return true;
+}
+
+bool MiniInflate::literalLength(uint16_t& symbol) {
+    uint32_t code = 0;
+    if (!huffmanBits(7, code)) {
+        return false;
+    }
+    if (code <= 0x17) {
+        symbol = static_cast<uint16_t>(256 + code);
+        return true;
+    }
+    if (!huffmanBits(1, code)) {
+        return false;
+    }
+    if (code >= 0x30 && code <= 0xBF) {
+        symbol = static_cast<uint16_t>(code - 0x30);
+        return true;
+    }
+    if (code >= 0xC0 && code <= 0xC7) {
+        symbol = static_cast<uint16_t>(280 + code - 0xC0);
+        return true;
+    }
+    if (!huffmanBits(1, code)) {
+        return false;
+    }
+    if (code >= 0x190 && code <= 0x1FF) {
+        symbol = static_cast<uint16_t>(144 + code - 0x190);
+        return true;
+    }
+    return false;
+}
+
+bool MiniInflate::inflate(const uint8_t* in, size_t inLength,
+                          uint8_t* out, size_t outCapacity, size_t& outLength) {
+    MiniInflate state(in, inLength);
+    outLength = 0;
+
+    uint32_t final = 0;
+    while (!final) {
+        uint32_t type;
+        if (!state.bit(final) || !state.bits(2, type)) {
+            return false;
+        }
+
+        if (type == 0) {
+            // Bloque sin comprimir: alineado a byte, LEN y ~LEN
+            state.bitCount = 0;
+            if (state.inputPos + 4 > inLength) {
+                return false;
+            }
+            uint16_t len = static_cast<uint16_t>(in[state.inputPos] | (in[state.inputPos + 1] << 8));
+            uint16_t nlen = static_cast<uint16_t>(in[state.inputPos + 2] | (in[state.inputPos + 3] << 8));
+            state.inputPos += 4;
+            if (static_cast<uint16_t>(~nlen) != len ||
+                state.inputPos + len > inLength || outLength + len > outCapacity) {
+                return false;
+            }
+            memcpy(out + outLength, in + state.inputPos, len);
+            state.inputPos += len;
+            outLength += len;
+            continue;
+        }
+
+        if (type != 1) {
+            return false;       // Huffman dinámico o tipo reservado
+        }
+
+        while (true) {
+            uint16_t symbol;
+            if (!state.literalLength(symbol)) {
+                return false;
+            }
+            if (symbol < 256) {
+                if (outLength >= outCapacity) {
+                    return false;
+                }
+                out[outLength++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+
+            uint8_t lengthCode = static_cast<uint8_t>(symbol - 257);
+            if (lengthCode >= 29) {
+                return false;
+            }
+            uint32_t extra;
+            if (!state.bits(LENGTH_EXTRA[lengthCode], extra)) {
+                return false;
+            }
+            size_t length = LENGTH_BASE[lengthCode] + extra;
+
+            uint32_t distanceCode = 0;
+            if (!state.huffmanBits(5, distanceCode) || distanceCode >= 30 ||
+                !state.bits(DISTANCE_EXTRA[distanceCode], extra)) {
+                return false;
+            }
+            size_t distance = DISTANCE_BASE[distanceCode] + extra;
+            if (distance > outLength || outLength + length > outCapacity) {
+                return false;
+            }
+
+            // Copia byte a byte: origen y destino pueden solaparse
+            for (size_t i = 0; i < length; i++) {
+                out[outLength] = out[outLength - distance];
+                outLength++;
+            }
+        }
+    }
+    return true;
+}
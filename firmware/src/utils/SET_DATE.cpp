@@ -17,7 +17,7 @@ void SetDate::init() {
 }
 
 // parseDigits: Función de ayuda para convertir una subcadena de caracteres a un número.
-uint8_t SetDate::parseDigits(char* str, uint8_t count) {
+uint8_t SetDate::parseDigits(const char* str, uint8_t count) {
     uint8_t val = 0;
     while (count-- > 0) {
         val = (val * 10) + (*str++ - '0');
@@ -47,31 +47,9 @@ bool SetDate::setDateFromSerial() {
 
         if (c == '\n' || c == '\r') {
             if (char_idx > 0) {
-                buffer[char_idx] = '\0';
-                
-                if (char_idx != 13) {
-                    Serial.println("Error: Entrada inválida. Se esperaban 13 dígitos.");
-                    char_idx = 0;
-                    return false;
-                }
-
-                DateTime dt;
-                dt.year = parseDigits(buffer, 2);
-                dt.month = parseDigits(buffer + 2, 2);
-                dt.day = parseDigits(buffer + 4, 2);
-                dt.dayOfWeek = parseDigits(buffer + 6, 1);
-                dt.hour = parseDigits(buffer + 7, 2);
-                dt.minute = parseDigits(buffer + 9, 2);
-                dt.second = parseDigits(buffer + 11, 2);
-
+                uint8_t length = char_idx;
                 char_idx = 0;
-                if (isValidDateTime(dt)) {
-                    rtc->setDateTime(dt);
-                    return true;
-                } else {
-                    Serial.println("Error: La fecha u hora introducida no es válida.");
-                    return false;
-                }
+                return setDateFromString(buffer, length);
             }
         } else if (isDigit(c)) {
             if (char_idx < 13) {
@@ -82,3 +60,35 @@ bool SetDate::setDateFromSerial() {
     }
     return false;
 }
+
+// setDateFromString: Convierte los 13 dígitos AAMMDDWHHMMSS y los establece en el RTC.
+bool SetDate::setDateFromString(const char* digits, uint8_t length) {
+    if (length != 13) {
+        Serial.println("Error: Entrada inválida. Se esperaban 13 dígitos.");
+        return false;
+    }
+
+    DateTime dt;
+    dt.year = parseDigits(digits, 2);
+    dt.month = parseDigits(digits + 2, 2);
+    dt.day = parseDigits(digits + 4, 2);
+    dt.dayOfWeek = parseDigits(digits + 6, 1);
+    dt.hour = parseDigits(digits + 7, 2);
+    dt.minute = parseDigits(digits + 9, 2);
+    dt.second = parseDigits(digits + 11, 2);
+
+    if (!setDate(dt)) {
+        Serial.println("Error: La fecha u hora introducida no es válida.");
+        return false;
+    }
+    return true;
+}
+
+// setDate: Valida la fecha y, si es correcta, la escribe en el RTC.
+bool SetDate::setDate(const DateTime& dt) {
+    if (!isValidDateTime(dt)) {
+        return false;
+    }
+    rtc->setDateTime(dt);
+    return true;
+}
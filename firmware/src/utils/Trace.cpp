@@ -0,0 +1,222 @@
+/**
+ * @file Trace.cpp
+ * @brief Buffers de traza y exportación en formato Chrome Trace Event.
+ *
+ * EXPLICACIÓN EDUCATIVA:
+ * El documento exportado tiene esta forma:
+ *
+ *     {"displayTimeUnit":"ms","traceEvents":[
+ *     {"name":"servo.move","ph":"B","ts":1234,"pid":1,"tid":2},
+ *     ...
+ *     {"name":"process_name","ph":"M","pid":1,"args":{"name":"core 0"}},
+ *     {"name":"thread_name","ph":"M","pid":1,"tid":2,"args":{"name":"loopTask"}}
+ *     ]}
+ *
+ * "ts" son microsegundos desde el evento más antiguo (de cualquier núcleo:
+ * comparten reloj). Se genera línea a
+ * línea en un buffer de 160 bytes: nunca se construye el JSON entero.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include "../../include/utils/Trace.h"
+#include <string.h>
+#include <stdio.h>
+
+using namespace TraceConfig;
+
+Trace::Ring Trace::rings[CORES];
+volatile bool Trace::enabled = ENABLED_AT_BOOT;
+
+TraceExportCursor TraceExportCursor::instance;
+uint32_t TraceExportCursor::nextToken = 0;
+
+void Trace::clear() {
+    bool wasEnabled = enabled;
+    enabled = false;
+    for (uint8_t c = 0; c < CORES; c++) {
+        rings[c].head = 0;
+    }
+    enabled = wasEnabled;
+}
+
+uint32_t Trace::getRecordedCount() {
+    uint32_t total = 0;
+    for (uint8_t c = 0; c < CORES; c++) {
+        total += rings[c].head;
+    }
+    return total;
+}
+
+// =============================================================================
+// Exportación
+// =============================================================================
+
+TraceExportCursor* TraceExportCursor::acquire(uint32_t& tokenOut) {
+    if (instance.inUse) {
+        return nullptr;
+    }
+
+    instance.wasEnabled = Trace::isEnabled();
+    Trace::setEnabled(false);
+    instance.reset();
+    instance.inUse = true;
+    if (++nextToken == 0) {
+        nextToken = 1;
+    }
+    instance.token = nextToken;
+    tokenOut = nextToken;
+    return &instance;
+}
+
+void TraceExportCursor::release(uint32_t releaseToken) {
+    if (inUse && token == releaseToken) {
+        Trace::setEnabled(wasEnabled);
+        inUse = false;
+    }
+}
+
+void TraceExportCursor::reset() {
+    phase = Phase::HEADER;
+    core = 0;
+    firstEvent = true;
+    metaIndex = 0;
+    taskCount = 0;
+    lineLength = 0;
+    linePos = 0;
+
+    // Solo los últimos EVENTS_PER_CORE eventos de cada núcleo siguen en el buffer
+    bool haveOrigin = false;
+    originMicros = 0;
+    for (uint8_t c = 0; c < CORES; c++) {
+        uint32_t head = Trace::rings[c].head;
+        end[c] = head;
+        position[c] = head > EVENTS_PER_CORE ? head - EVENTS_PER_CORE : 0;
+        if (position[c] < end[c]) {
+            int64_t first = Trace::rings[c].events[position[c] & (EVENTS_PER_CORE - 1)].micros;
+            if (!haveOrigin || first < originMicros) {
+                originMicros = first;
+                haveOrigin = true;
+            }
+        }
+    }
+}
+
+uint8_t TraceExportCursor::taskIndex(TaskHandle_t task) {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i] == task) {
+            return i + 1;
+        }
+    }
+    if (taskCount < MAX_TASKS) {
+        tasks[taskCount] = task;
+        taskCount++;
+        return taskCount;
+    }
+    return 0;   // Sin hueco: fila común "tid 0"
+}
+
+bool TraceExportCursor::produceLine() {
+    lineLength = 0;
+    linePos = 0;
+    const char* separator = firstEvent ? "" : ",\n";
+
+    switch (phase) {
+        case Phase::HEADER:
+            lineLength = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            phase = Phase::EVENTS;
+            return true;
+
+        case Phase::EVENTS: {
+            while (core < CORES && position[core] >= end[core]) {
+                core++;
+            }
+            if (core >= CORES) {
+                phase = Phase::PROCESSES;
+                return produceLine();
+            }
+            const TraceEvent& event = Trace::rings[core].events[position[core] & (EVENTS_PER_CORE - 1)];
+            position[core]++;
+
+            int64_t elapsed = event.micros - originMicros;
+            if (elapsed < 0) {
+                elapsed = 0;
+            }
+
+            lineLength = snprintf(line, sizeof(line),
+                "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%u,\"tid\":%u%s}",
+                separator, event.name != nullptr ? event.name : "?", static_cast<char>(event.phase),
+                static_cast<unsigned long long>(elapsed),
+                static_cast<unsigned>(core + 1), static_cast<unsigned>(taskIndex(event.task)),
+                event.phase == static_cast<uint8_t>(TracePhase::INSTANT) ? ",\"s\":\"t\"" : "");
+            firstEvent = false;
+            return true;
+        }
+
+        case Phase::PROCESSES:
+            if (metaIndex >= CORES) {
+                metaIndex = 0;
+                phase = Phase::THREADS;
+                return produceLine();
+            }
+            lineLength = snprintf(line, sizeof(line),
+                "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+                separator, static_cast<unsigned>(metaIndex + 1), static_cast<unsigned>(metaIndex));
+            metaIndex++;
+            firstEvent = false;
+            return true;
+
+        case Phase::THREADS: {
+            // Una fila por tarea en cada núcleo (la tarea puede haber corrido en ambos)
+            if (metaIndex >= taskCount * CORES) {
+                phase = Phase::FOOTER;
+                return produceLine();
+            }
+            uint8_t task = metaIndex / CORES;
+            uint8_t c = metaIndex % CORES;
+            lineLength = snprintf(line, sizeof(line),
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                separator, static_cast<unsigned>(c + 1), static_cast<unsigned>(task + 1),
+                pcTaskGetTaskName(tasks[task]));
+            metaIndex++;
+            firstEvent = false;
+            return true;
+        }
+
+        case Phase::FOOTER:
+            lineLength = snprintf(line, sizeof(line), "\n]}\n");
+            phase = Phase::DONE;
+            return true;
+
+        case Phase::DONE:
+        default:
+            return false;
+    }
+}
+
+size_t TraceExportCursor::fill(uint8_t* out, size_t maxLength) {
+    if (!inUse) {
+        return 0;
+    }
+    size_t written = 0;
+    while (written < maxLength) {
+        if (linePos >= lineLength) {
+            if (!produceLine()) {
+                break;
+            }
+            if (lineLength >= sizeof(line)) {
+                lineLength = sizeof(line) - 1;     // snprintf truncó
+            }
+        }
+        size_t count = lineLength - linePos;
+        if (count > maxLength - written) {
+            count = maxLength - written;
+        }
+        memcpy(out + written, line + linePos, count);
+        linePos += count;
+        written += count;
+    }
+    return written;
+}
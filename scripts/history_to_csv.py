@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Convierte una exportación del historial (formato columnar RHC1) a CSV.
+
+Uso:
+    curl -u admin:clave -o historial.rhc "http://riego-inteligente.local/api/v1/history/export?deflate=1"
+    python3 scripts/history_to_csv.py historial.rhc > historial.csv
+
+El formato está descrito en firmware/include/core/HistoryExport.h.
+"""
+
+import csv
+import sys
+import zlib
+from datetime import datetime, timezone
+
+# HistoryExportCursor::ColumnKind (firmware/include/core/HistoryExport.h)
+KIND_DELTA = 1
+KIND_DICT = 2
+KIND_VARINT = 3
+KIND_LABELED = 4
+
+# Nombres de las columnas (COLUMNS en firmware/src/core/HistoryExport.cpp)
+COL_TIME = "t"
+COL_ZONE = "zone"
+COL_EVENT = "event"
+COL_FLAGS = "flags"
+COL_VALUE = "value"
+
+# HistoryExportConfig::FLAG_DEFLATE y HistoryFlags::UPTIME_CLOCK
+FLAG_DEFLATE = 0x01
+FLAG_UPTIME_CLOCK = 0x01
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise ValueError("exportación truncada")
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def bytes(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("exportación truncada")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if b < 0x80:
+                return value
+            shift += 7
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def read_packed(reader, count, bits):
+    """Lee `count` índices de `bits` bits empaquetados desde el bit menos significativo."""
+    if bits == 0:
+        return [0] * count
+    total_bytes = (count * bits + 7) // 8
+    packed = int.from_bytes(reader.bytes(total_bytes), "little")
+    mask = (1 << bits) - 1
+    return [(packed >> (i * bits)) & mask for i in range(count)]
+
+
+def decode(blob):
+    if len(blob) < 8 or blob[:4] != b"RHC1":
+        raise ValueError("no es una exportación RHC1")
+    version, flags = blob[4], blob[5]
+    if version != 1:
+        raise ValueError("versión de formato no soportada: %d" % version)
+
+    body = blob[8:]
+    if flags & FLAG_DEFLATE:
+        body = zlib.decompressobj(-15).decompress(body)
+
+    r = Reader(body)
+    count = r.varint()
+    columns = {}
+    labels = {}
+    for _ in range(r.byte()):
+        kind = r.byte()
+        name = r.bytes(r.byte()).decode("ascii")
+
+        if kind == KIND_DELTA:
+            values, previous = [], 0
+            for _ in range(count):
+                previous = (previous + unzigzag(r.varint())) & 0xFFFFFFFF
+                values.append(previous)
+        elif kind == KIND_VARINT:
+            values = [r.varint() for _ in range(count)]
+        elif kind in (KIND_DICT, KIND_LABELED):
+            size = r.varint()
+            dictionary = []
+            for _ in range(size):
+                value = r.byte()
+                dictionary.append(value)
+                if kind == KIND_LABELED:
+                    labels.setdefault(name, {})[value] = r.bytes(r.byte()).decode("ascii")
+            bits = max(size - 1, 0).bit_length()
+            values = [dictionary[i] if i < len(dictionary) else 0 for i in read_packed(r, count, bits)]
+        else:
+            raise ValueError("tipo de columna desconocido: %d" % kind)
+
+        columns[name] = values
+
+    return count, columns, labels
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+
+    with open(sys.argv[1], "rb") as f:
+        blob = f.read()
+    count, columns, labels = decode(blob)
+
+    writer = csv.writer(sys.stdout)
+    writer.writerow(["time", "uptime_s", "zone", "event", "value"])
+    event_names = labels.get(COL_EVENT, {})
+    for i in range(count):
+        t = columns[COL_TIME][i]
+        uptime = columns.get(COL_FLAGS, [0] * count)[i] & FLAG_UPTIME_CLOCK
+        when = "" if uptime else datetime.fromtimestamp(t, timezone.utc).isoformat()
+        zone = columns[COL_ZONE][i]
+        event = columns[COL_EVENT][i]
+        writer.writerow([
+            when,
+            t if uptime else "",
+            zone if zone else "",
+            event_names.get(event, str(event)),
+            columns[COL_VALUE][i],
+        ])
+
+    sys.stderr.write("%d eventos, %d bytes (%.1f bytes/evento)\n" %
+                     (count, len(blob), len(blob) / count if count else 0))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+Aprovisionamiento por puerto serie con el protocolo de tramas COBS + CRC.
+
+Uso:
+    python3 scripts/provision.py --port COM3 --time --config config.json
+    python3 scripts/provision.py --port /dev/ttyUSB0 --port /dev/ttyUSB1 --time
+    python3 scripts/provision.py --port COM3 --metrics
+    python3 scripts/provision.py --port COM3 --logs --level warning > log.txt
+
+Cada puerto se procesa por turno: HELLO a 115200 baudios, cambio a la
+velocidad negociada (921600 por defecto), comandos pedidos y BYE. El JSON
+de --config tiene el formato de GET /api/config (se admiten solo algunos
+campos). Requiere pyserial.
+
+El protocolo está descrito en firmware/include/core/SerialProvisioning.h.
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+import time
+from datetime import datetime
+
+import serial
+
+DEFAULT_BAUD = 115200
+
+CMD_HELLO = 0x01
+CMD_PING = 0x02
+CMD_BYE = 0x03
+CMD_SET_TIME = 0x10
+CMD_GET_TIME = 0x11
+CMD_CONFIG_BEGIN = 0x20
+CMD_CONFIG_DATA = 0x21
+CMD_CONFIG_COMMIT = 0x22
+CMD_METRICS = 0x30
+CMD_LOGS = 0x31
+
+STATUS_OK = 0x00
+STATUS_MORE = 0x01
+STATUS_NAMES = {
+    0x02: "comando desconocido",
+    0x03: "longitud incorrecta",
+    0x04: "ocupado",
+    0x05: "rechazado",
+    0x06: "demasiado grande",
+    0x07: "offset incorrecto",
+    0x08: "no disponible",
+}
+
+LEVELS = {"error": 0, "warning": 1, "info": 2, "debug": 3, "verbose": 4}
+
+
+class ProvisioningError(Exception):
+    pass
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+    out[code_index] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16(data):
+    # CRC-16/CCITT-FALSE, igual que SerialProvisioning::crc16
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+class Link:
+    def __init__(self, port, timeout=0.5, retries=3):
+        # Sin DTR/RTS para no reiniciar el ESP32 al abrir el puerto
+        self.ser = serial.Serial()
+        self.ser.port = port
+        self.ser.baudrate = DEFAULT_BAUD
+        self.ser.timeout = 0.05
+        self.ser.dsrdtr = False
+        self.ser.rtscts = False
+        self.ser.dtr = False
+        self.ser.rts = False
+        self.ser.open()
+        self.timeout = timeout
+        self.retries = retries
+        self.seq = 0
+        self.pending = bytearray()
+
+    def close(self):
+        self.ser.close()
+
+    def send(self, command, data=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        body = bytes([command, self.seq]) + data
+        frame = body + struct.pack("<H", crc16(body))
+        self.ser.write(b"\x00" + cobs_encode(frame) + b"\x00")
+
+    def receive(self, command, timeout):
+        """Devuelve (estado, datos) de la siguiente respuesta a command/seq."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            chunk = self.ser.read(self.ser.in_waiting or 1)
+            if chunk:
+                self.pending += chunk
+            while b"\x00" in self.pending:
+                raw, _, rest = bytes(self.pending).partition(b"\x00")
+                self.pending = bytearray(rest)
+                frame = cobs_decode(raw) if raw else None
+                # Lo que no es una trama válida (texto del log, arranque) se ignora
+                if frame is None or len(frame) < 5:
+                    continue
+                if crc16(frame[:-2]) != struct.unpack("<H", frame[-2:])[0]:
+                    continue
+                if frame[0] == command | 0x80 and frame[1] == self.seq:
+                    return frame[2], frame[3:-2]
+        return None
+
+    def request(self, command, data=b""):
+        for _ in range(self.retries):
+            self.send(command, data)
+            response = self.receive(command, self.timeout)
+            if response is None:
+                # Reintento con el mismo seq (un CONFIG_DATA repetido se confirma sin copiarse)
+                self.seq = (self.seq - 1) & 0xFF
+                continue
+            status, payload = response
+            if status != STATUS_OK:
+                raise ProvisioningError("comando 0x%02x: %s" % (command, STATUS_NAMES.get(status, status)))
+            return payload
+        raise ProvisioningError("comando 0x%02x: sin respuesta" % command)
+
+    def stream(self, command, data=b""):
+        self.send(command, data)
+        out = bytearray()
+        while True:
+            response = self.receive(command, self.timeout * 4)
+            if response is None:
+                raise ProvisioningError("comando 0x%02x: volcado interrumpido" % command)
+            status, payload = response
+            if status == STATUS_MORE:
+                out += payload
+            elif status == STATUS_OK:
+                return bytes(out)
+            else:
+                raise ProvisioningError("comando 0x%02x: %s" % (command, STATUS_NAMES.get(status, status)))
+
+    def hello(self, baud):
+        payload = self.request(CMD_HELLO, struct.pack("<I", baud))
+        version, accepted, max_data = struct.unpack("<BIH", payload[:7])
+        firmware = payload[7:].decode(errors="replace")
+        if accepted != self.ser.baudrate:
+            self.ser.baudrate = accepted
+            time.sleep(0.05)
+            self.pending.clear()
+            self.ser.reset_input_buffer()
+            self.request(CMD_PING)
+        return version, accepted, max_data, firmware
+
+
+def set_time(link, now):
+    payload = struct.pack("7B", now.year % 100, now.month, now.day, now.isoweekday(),
+                          now.hour, now.minute, now.second)
+    link.request(CMD_SET_TIME, payload)
+    y, mo, d, w, h, mi, s = struct.unpack("7B", link.request(CMD_GET_TIME))
+    return "20%02d-%02d-%02d %02d:%02d:%02d (día %d)" % (y, mo, d, h, mi, s, w)
+
+
+def import_config(link, blob, max_data):
+    link.request(CMD_CONFIG_BEGIN, struct.pack("<H", len(blob)))
+    step = max_data - 2
+    for offset in range(0, len(blob), step):
+        link.request(CMD_CONFIG_DATA, struct.pack("<H", offset) + blob[offset:offset + step])
+    generation = struct.unpack("<I", link.request(CMD_CONFIG_COMMIT))[0]
+    return generation
+
+
+def provision(port, args, config_blob):
+    started = time.monotonic()
+    link = Link(port)
+    try:
+        version, baud, max_data, firmware = link.hello(args.baud)
+        print("[%s] firmware %s, protocolo v%d, %d baudios" % (port, firmware, version, baud), file=sys.stderr)
+
+        if args.time:
+            print("[%s] RTC: %s" % (port, set_time(link, datetime.now())), file=sys.stderr)
+        if config_blob is not None:
+            generation = import_config(link, config_blob, max_data)
+            print("[%s] configuración importada (generación %d)" % (port, generation), file=sys.stderr)
+        if args.metrics:
+            sys.stdout.write(link.stream(CMD_METRICS).decode(errors="replace"))
+        if args.logs:
+            query = struct.pack("<IB", args.since, LEVELS[args.level])
+            sys.stdout.write(link.stream(CMD_LOGS, query).decode(errors="replace"))
+
+        link.request(CMD_BYE)
+    finally:
+        link.close()
+    print("[%s] listo en %.1f s" % (port, time.monotonic() - started), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Aprovisionamiento por serie del sistema de riego")
+    parser.add_argument("--port", action="append", required=True, help="puerto serie (repetible para un lote)")
+    parser.add_argument("--baud", type=int, default=921600, help="velocidad a negociar (defecto 921600)")
+    parser.add_argument("--time", action="store_true", help="poner el RTC en la hora local del PC")
+    parser.add_argument("--config", help="JSON de configuración a importar")
+    parser.add_argument("--metrics", action="store_true", help="volcar las métricas Prometheus")
+    parser.add_argument("--logs", action="store_true", help="volcar el log en flash")
+    parser.add_argument("--since", type=int, default=0, help="hora Unix mínima de --logs")
+    parser.add_argument("--level", choices=sorted(LEVELS, key=LEVELS.get), default="verbose",
+                        help="nivel máximo de --logs")
+    args = parser.parse_args()
+
+    config_blob = None
+    if args.config:
+        with open(args.config, "rb") as f:
+            config_blob = f.read()
+
+    failed = 0
+    for port in args.port:
+        try:
+            provision(port, args, config_blob)
+        except (ProvisioningError, serial.SerialException) as error:
+            print("[%s] ERROR: %s" % (port, error), file=sys.stderr)
+            failed += 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,141 @@
+/**
+ * @file test_main.cpp
+ * @brief Pruebas de la firma de corriente con trazas sintéticas.
+ *
+ * No necesitan servos ni sensor: cada traza se reproduce con una
+ * TraceCurrentSource (que repite su última muestra hasta llenar la ventana)
+ * y se clasifica con CurrentSignatureDetector::classify. Se comprueba cada
+ * veredicto y los dos lados de cada umbral de SERVO_CONFIG.h.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "ServoCurrentMonitor.h"
+
+namespace {
+    constexpr uint16_t WINDOW_SAMPLES = SERVO_CURRENT_WINDOW_MS / SERVO_CURRENT_SAMPLE_INTERVAL_MS;
+    constexpr uint16_t STALL_SAMPLES = SERVO_CURRENT_STALL_MIN_MS / SERVO_CURRENT_SAMPLE_INTERVAL_MS;
+    constexpr uint16_t PEAK_MA = 400;      // Pico de arranque normal
+    constexpr uint16_t PEAK_SAMPLES = 20;  // 100 ms de pico
+
+    TraceCurrentSource source;
+    uint16_t trace[WINDOW_SAMPLES];
+    uint16_t window[WINDOW_SAMPLES];
+
+    // Reproduce la traza como lo haría el monitor tras un armMove y la clasifica
+    MoveVerdict replay(uint16_t length) {
+        source.setTrace(0, trace, length);
+        source.onMoveStarted(0);
+        for (uint16_t i = 0; i < WINDOW_SAMPLES; i++) {
+            TEST_ASSERT_TRUE(source.readMilliamps(0, window[i]));
+        }
+        return CurrentSignatureDetector::classify(window, WINDOW_SAMPLES);
+    }
+
+    // `count` muestras a `level` y luego `rest` hasta el final de la ventana
+    MoveVerdict replayStep(uint16_t level, uint16_t count, uint16_t rest) {
+        for (uint16_t i = 0; i < count; i++) {
+            trace[i] = level;
+        }
+        trace[count] = rest;
+        return replay(count + 1);
+    }
+
+    MoveVerdict replayConstant(uint16_t level) {
+        trace[0] = level;
+        return replay(1);
+    }
+
+    void assertVerdict(MoveVerdict expected, MoveVerdict actual) {
+        TEST_ASSERT_EQUAL_STRING(ServoCurrentMonitor::verdictToString(expected),
+                                 ServoCurrentMonitor::verdictToString(actual));
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_trace_source_repeats_last_sample_and_restarts() {
+    const uint16_t samples[] = {10, 20, 30};
+    const uint16_t expected[] = {10, 20, 30, 30, 30};
+    uint16_t milliamps = 0;
+
+    TEST_ASSERT_FALSE(source.readMilliamps(1, milliamps));
+
+    source.setTrace(1, samples, 3);
+    for (uint8_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_TRUE(source.readMilliamps(1, milliamps));
+        TEST_ASSERT_EQUAL(expected[i], milliamps);
+    }
+
+    source.onMoveStarted(1);
+    TEST_ASSERT_TRUE(source.readMilliamps(1, milliamps));
+    TEST_ASSERT_EQUAL(10, milliamps);
+    source.setTrace(1, nullptr, 0);
+}
+
+void test_peak_then_rest_is_ok() {
+    assertVerdict(MoveVerdict::OK, replayStep(PEAK_MA, PEAK_SAMPLES, 100));
+}
+
+void test_no_current_is_no_load() {
+    assertVerdict(MoveVerdict::NO_LOAD, replayConstant(0));
+}
+
+void test_no_load_threshold_boundary() {
+    // NO_LOAD si el pico medio queda por debajo del umbral; en el umbral ya hay carga
+    assertVerdict(MoveVerdict::NO_LOAD, replayConstant(SERVO_CURRENT_NO_LOAD_MAX_MA - 1));
+    assertVerdict(MoveVerdict::OK, replayConstant(SERVO_CURRENT_NO_LOAD_MAX_MA));
+}
+
+void test_sustained_stall_current_is_stall() {
+    assertVerdict(MoveVerdict::STALL, replayConstant(SERVO_CURRENT_STALL_MA + 200));
+}
+
+void test_stall_current_threshold_boundary() {
+    // Justo en el umbral cuenta como bloqueo; por debajo es un atasco
+    assertVerdict(MoveVerdict::STALL, replayConstant(SERVO_CURRENT_STALL_MA));
+    assertVerdict(MoveVerdict::JAMMED, replayConstant(SERVO_CURRENT_STALL_MA - 1));
+}
+
+void test_stall_duration_boundary() {
+    // La media de un escalón sube en la primera muestra y baja en la siguiente
+    // a su final: el escalón dura exactamente `count` muestras sobre el umbral
+    assertVerdict(MoveVerdict::STALL, replayStep(SERVO_CURRENT_STALL_MA, STALL_SAMPLES, 100));
+    assertVerdict(MoveVerdict::OK, replayStep(SERVO_CURRENT_STALL_MA, STALL_SAMPLES - 1, 100));
+}
+
+void test_no_return_to_rest_is_jammed() {
+    assertVerdict(MoveVerdict::JAMMED, replayStep(PEAK_MA, PEAK_SAMPLES, 300));
+}
+
+void test_hold_threshold_boundary() {
+    // Reposo justo en el máximo permitido es normal; un miliamperio más, atasco
+    assertVerdict(MoveVerdict::OK, replayStep(PEAK_MA, PEAK_SAMPLES, SERVO_CURRENT_HOLD_MAX_MA));
+    assertVerdict(MoveVerdict::JAMMED, replayStep(PEAK_MA, PEAK_SAMPLES, SERVO_CURRENT_HOLD_MAX_MA + 1));
+}
+
+void setup() {
+    delay(2000);    // Da tiempo al monitor serie a conectarse
+    UNITY_BEGIN();
+    RUN_TEST(test_trace_source_repeats_last_sample_and_restarts);
+    RUN_TEST(test_peak_then_rest_is_ok);
+    RUN_TEST(test_no_current_is_no_load);
+    RUN_TEST(test_no_load_threshold_boundary);
+    RUN_TEST(test_sustained_stall_current_is_stall);
+    RUN_TEST(test_stall_current_threshold_boundary);
+    RUN_TEST(test_stall_duration_boundary);
+    RUN_TEST(test_no_return_to_rest_is_jammed);
+    RUN_TEST(test_hold_threshold_boundary);
+    UNITY_END();
+}
+
+void loop() {
+}
@@ -0,0 +1,151 @@
+/**
+ * @file test_main.cpp
+ * @brief Pruebas en placa: detener el ciclo deja todas las válvulas cerradas.
+ *
+ * Se ejecutan con `pio test -e esp32dev` (necesitan los servos montados
+ * o, al menos, los canales LEDC libres). La prueba del traspaso espera el
+ * tiempo mínimo de riego de la primera zona (MIN_IRRIGATION_TIME_SECONDS).
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "ServoPWMController.h"
+#include "MetricsRegistry.h"
+
+namespace {
+    ServoPWMController* controller = nullptr;
+
+    // Avanza el controlador hasta `state` o hasta agotar el plazo
+    bool runUntil(IrrigationState state, uint32_t timeoutMs) {
+        uint32_t start = millis();
+        while (millis() - start < timeoutMs) {
+            controller->update();
+            if (controller->getCurrentState() == state) {
+                return true;
+            }
+            delay(10);
+        }
+        return false;
+    }
+
+    void assertAllZonesClosed() {
+        for (uint8_t zone = 1; zone <= controller->getZoneCount(); zone++) {
+            const ZoneInfo* info = controller->getZoneInfo(zone);
+            TEST_ASSERT_NOT_NULL(info);
+            TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(ServoState::CLOSED), static_cast<int>(info->currentState),
+                                      ("zona " + String(zone)).c_str());
+        }
+        TEST_ASSERT_TRUE(controller->isQuiescent());
+    }
+
+    uint8_t familiesOf(const void* context) {
+        MetricsRegistry& registry = MetricsRegistry::getInstance();
+        uint8_t found = 0;
+        for (uint8_t i = 0; i < registry.size(); i++) {
+            if (registry.family(i)->context == context) {
+                found++;
+            }
+        }
+        return found;
+    }
+}
+
+void setUp() {
+    controller = new ServoPWMController(NUM_SERVOS);
+    TEST_ASSERT_TRUE(controller->init());
+    for (uint8_t zone = 1; zone <= controller->getZoneCount(); zone++) {
+        const ZoneInfo* info = controller->getZoneInfo(zone);
+        TEST_ASSERT_TRUE(controller->applyZoneSettings(zone, true, MIN_IRRIGATION_TIME_SECONDS,
+                                                       info->config.openAngle, info->transitionTimeMs));
+    }
+}
+
+void tearDown() {
+    delete controller;
+    controller = nullptr;
+}
+
+void test_stop_while_irrigating_closes_all_zones() {
+    controller->setOverlappedHandoff(false);
+    controller->startCycle(false);
+    TEST_ASSERT_TRUE(runUntil(IrrigationState::IRRIGATING, 10000));
+
+    controller->stopIrrigationCycle();
+
+    TEST_ASSERT_EQUAL(static_cast<int>(IrrigationState::IDLE), static_cast<int>(controller->getCurrentState()));
+    assertAllZonesClosed();
+}
+
+void test_stop_during_handoff_closes_all_zones() {
+    // Necesita al menos dos zonas: la saliente queda CLOSING a mitad de rampa
+    TEST_ASSERT_TRUE(controller->getZoneCount() >= 2);
+    controller->setOverlappedHandoff(true);
+    controller->startCycle(false);
+    TEST_ASSERT_TRUE(runUntil(IrrigationState::HANDOFF, (MIN_IRRIGATION_TIME_SECONDS + 30) * 1000));
+
+    controller->stopIrrigationCycle();
+
+    TEST_ASSERT_EQUAL(static_cast<int>(IrrigationState::IDLE), static_cast<int>(controller->getCurrentState()));
+    assertAllZonesClosed();
+
+    // Nada sigue moviendo válvulas después de la parada
+    for (uint8_t i = 0; i < 50; i++) {
+        controller->update();
+        delay(10);
+    }
+    assertAllZonesClosed();
+}
+
+void test_handoff_keeps_outgoing_open_until_ramp_down() {
+    TEST_ASSERT_TRUE(controller->getZoneCount() >= 2);
+    controller->setOverlappedHandoff(true);
+    controller->startCycle(false);
+    TEST_ASSERT_TRUE(runUntil(IrrigationState::HANDOFF, (MIN_IRRIGATION_TIME_SECONDS + 30) * 1000));
+
+    // Primera mitad de la rampa: la saliente sigue regando
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::OPEN), static_cast<int>(controller->getZoneInfo(1)->currentState));
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::OPENING), static_cast<int>(controller->getZoneInfo(2)->currentState));
+
+    // Segunda mitad: empieza a cerrar
+    uint32_t start = millis();
+    while (millis() - start < HANDOFF_RAMP_TIME_MS / 2 + 200) {
+        controller->update();
+        delay(10);
+    }
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::CLOSING), static_cast<int>(controller->getZoneInfo(1)->currentState));
+
+    TEST_ASSERT_TRUE(runUntil(IrrigationState::IRRIGATING, HANDOFF_RAMP_TIME_MS));
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::CLOSED), static_cast<int>(controller->getZoneInfo(1)->currentState));
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::OPEN), static_cast<int>(controller->getZoneInfo(2)->currentState));
+
+    controller->stopIrrigationCycle();
+    assertAllZonesClosed();
+}
+
+void test_delete_unregisters_metrics() {
+    // Un /metrics tras el delete no debe llamar a muestreadores con el objeto liberado
+    const void* old = controller;
+    TEST_ASSERT_TRUE(familiesOf(old) > 0);
+
+    delete controller;
+    controller = nullptr;
+
+    TEST_ASSERT_EQUAL(0, familiesOf(old));
+}
+
+void setup() {
+    delay(2000);    // Da tiempo al monitor serie a conectarse
+    UNITY_BEGIN();
+    RUN_TEST(test_stop_while_irrigating_closes_all_zones);
+    RUN_TEST(test_stop_during_handoff_closes_all_zones);
+    RUN_TEST(test_handoff_keeps_outgoing_open_until_ramp_down);
+    RUN_TEST(test_delete_unregisters_metrics);
+    UNITY_END();
+}
+
+void loop() {
+}
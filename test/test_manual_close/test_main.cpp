@@ -0,0 +1,87 @@
+/**
+ * @file test_main.cpp
+ * @brief Pruebas en placa: un cierre manual termina en CLOSED y solo
+ *        entonces el controlador queda en reposo.
+ *
+ * Se ejecutan con `pio test -e esp32dev` (necesitan los servos montados
+ * o, al menos, los canales LEDC libres). PowerManager entra en light sleep
+ * con isQuiescent(), y parkOutputs() solo deja sin pulso las zonas CLOSED:
+ * una zona que se quedara en CLOSING tendría su canal congelado a medias.
+ *
+ * @author Sistema de Riego Inteligente
+ * @version 1.0
+ * @date 2025
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "ServoPWMController.h"
+
+namespace {
+    ServoPWMController* controller = nullptr;
+
+    ServoState zoneState(uint8_t zone) {
+        const ZoneInfo* info = controller->getZoneInfo(zone);
+        TEST_ASSERT_NOT_NULL(info);
+        return info->currentState;
+    }
+
+    // Avanza el controlador hasta que la zona llegue a `state` o se agote el plazo
+    bool runUntilZone(uint8_t zone, ServoState state, uint32_t timeoutMs) {
+        uint32_t start = millis();
+        while (millis() - start < timeoutMs) {
+            controller->update();
+            if (zoneState(zone) == state) {
+                return true;
+            }
+            delay(10);
+        }
+        return false;
+    }
+}
+
+void setUp() {
+    controller = new ServoPWMController(NUM_SERVOS);
+    TEST_ASSERT_TRUE(controller->init());
+}
+
+void tearDown() {
+    delete controller;
+    controller = nullptr;
+}
+
+void test_manual_close_settles_before_quiescent() {
+    TEST_ASSERT_TRUE(controller->openZoneValve(1, 0));
+    TEST_ASSERT_TRUE(runUntilZone(1, ServoState::OPEN, SERVO_MOVEMENT_TIME_MS + 2000));
+    TEST_ASSERT_FALSE(controller->isQuiescent());
+
+    TEST_ASSERT_TRUE(controller->closeZoneValve(1));
+
+    // Mientras el servo se mueve sigue necesitando pulsos: nada de reposo
+    TEST_ASSERT_EQUAL(static_cast<int>(ServoState::CLOSING), static_cast<int>(zoneState(1)));
+    TEST_ASSERT_FALSE(controller->isQuiescent());
+
+    TEST_ASSERT_TRUE(runUntilZone(1, ServoState::CLOSED, SERVO_MOVEMENT_TIME_MS + 2000));
+    TEST_ASSERT_TRUE(controller->isQuiescent());
+}
+
+void test_timed_close_settles_before_quiescent() {
+    // Cierre automático (TimedZoneProgram) a los 2 s
+    TEST_ASSERT_TRUE(controller->openZoneValve(1, 2));
+    TEST_ASSERT_TRUE(runUntilZone(1, ServoState::CLOSING, 2000 + SERVO_MOVEMENT_TIME_MS + 2000));
+    TEST_ASSERT_FALSE(controller->isQuiescent());
+
+    TEST_ASSERT_TRUE(runUntilZone(1, ServoState::CLOSED, SERVO_MOVEMENT_TIME_MS + 2000));
+    TEST_ASSERT_TRUE(controller->isQuiescent());
+}
+
+void setup() {
+    delay(2000);    // Da tiempo al monitor serie a conectarse
+    UNITY_BEGIN();
+    RUN_TEST(test_manual_close_settles_before_quiescent);
+    RUN_TEST(test_timed_close_settles_before_quiescent);
+    UNITY_END();
+}
+
+void loop() {
+}
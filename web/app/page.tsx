@@ -1,6 +1,6 @@
 "use client"
 
-import { useState } from "react"
+import { useEffect, useState } from "react"
 import { Card, CardContent, CardDescription, CardHeader, CardTitle } from "@/components/ui/card"
 import { Button } from "@/components/ui/button"
 import { Badge } from "@/components/ui/badge"
@@ -15,6 +15,7 @@ import { ConnectionStatus } from "@/components/connection-status"
 import { ScheduleConfig } from "@/components/schedule-config"
 import { SystemConfig } from "@/components/system-config"
 import { useIrrigationWebSocket } from "@/hooks/use-irrigation-websocket"
+import { apiClient, type TaskStats } from "@/lib/api"
 import {
   Droplets,
   Settings,
@@ -40,6 +41,31 @@ export default function IrrigationDashboard() {
     useIrrigationWebSocket()
 
   const [activeTab, setActiveTab] = useState("dashboard")
+  const [taskStats, setTaskStats] = useState<TaskStats | null>(null)
+
+  // The firmware samples its tasks every 5 s; poll at the same rate while the monitor tab is open
+  useEffect(() => {
+    if (activeTab !== "monitor") return
+
+    let cancelled = false
+    const load = () => {
+      apiClient
+        .getTaskStats()
+        .then((stats) => {
+          if (!cancelled) setTaskStats(stats)
+        })
+        .catch(() => {
+          if (!cancelled) setTaskStats(null)
+        })
+    }
+
+    load()
+    const timer = setInterval(load, 5000)
+    return () => {
+      cancelled = true
+      clearInterval(timer)
+    }
+  }, [activeTab])
 
   const formatUptime = (seconds: number) => {
     const hours = Math.floor(seconds / 3600)
@@ -466,11 +492,39 @@ export default function IrrigationDashboard() {
                   <CardDescription>Métricas de rendimiento en tiempo real</CardDescription>
                 </CardHeader>
                 <CardContent className="space-y-4">
-                  <div className="flex justify-between">
-                    <span className="text-sm">CPU Usage:</span>
-                    <span className="text-sm font-mono">23%</span>
-                  </div>
-                  <Progress value={23} />
+                  {(taskStats?.cores ?? [{ core: 0, load: null }, { core: 1, load: null }]).map((core) => (
+                    <div key={core.core} className="space-y-2">
+                      <div className="flex justify-between">
+                        <span className="text-sm">CPU núcleo {core.core}:</span>
+                        <span className="text-sm font-mono">{core.load === null ? "—" : `${core.load.toFixed(1)}%`}</span>
+                      </div>
+                      <Progress value={core.load ?? 0} />
+                    </div>
+                  ))}
+
+                  {taskStats && (
+                    <div className="space-y-1">
+                      <div className="flex justify-between text-xs text-muted-foreground">
+                        <span>Tarea</span>
+                        <span>
+                          CPU ({taskStats.window_s}s) / Pila libre
+                        </span>
+                      </div>
+                      {[...taskStats.tasks]
+                        .sort((a, b) => (b.cpu ?? 0) - (a.cpu ?? 0))
+                        .map((task, index) => (
+                          <div key={`${task.name}-${index}`} className="flex justify-between text-xs font-mono">
+                            <span>
+                              {task.name}
+                              {task.core !== null && ` [${task.core}]`}
+                            </span>
+                            <span className={task.stack_free < 512 ? "text-destructive" : undefined}>
+                              {task.cpu === null ? "—" : `${task.cpu.toFixed(1)}%`} / {task.stack_free} B
+                            </span>
+                          </div>
+                        ))}
+                    </div>
+                  )}
 
                   <div className="flex justify-between">
                     <span className="text-sm">Temperatura:</span>
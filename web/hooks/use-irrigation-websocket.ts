@@ -4,11 +4,12 @@ import { useEffect, useState, useCallback, useRef } from "react"
 import {
   getWebSocketInstance,
   type StateUpdateMessage,
+  type StatusUpdateMessage,
   type LogEntryMessage,
   type RTCTimeMessage,
   type WiFiStatusMessage,
 } from "@/lib/websocket"
-import { irrigationAPI, type IrrigationStatus } from "@/lib/api"
+import { irrigationAPI, type BootstrapResponse, type IrrigationStatus } from "@/lib/api"
 
 export interface SystemStatus {
   system: string
@@ -19,6 +20,7 @@ export interface SystemStatus {
     name: string
     state: "OPEN" | "CLOSED" | "OPENING" | "CLOSING"
     remaining_s: number
+    ends_at?: number // Date.now() en que llega a 0 (extrapolado)
     last_watered?: string
   }>
   wifi: {
@@ -57,6 +59,7 @@ export function useIrrigationWebSocket() {
     cycle: "AUTO",
   })
   const [logs, setLogs] = useState<LogEntry[]>([])
+  const [history, setHistory] = useState<BootstrapResponse["history"]>([])
   const wsRef = useRef(getWebSocketInstance())
 
   const fetchStatusViaAPI = useCallback(async () => {
@@ -96,9 +99,28 @@ export function useIrrigationWebSocket() {
       if (!connected) {
         console.log("[v0] WebSocket disconnected, starting API fallback")
         fetchStatusViaAPI()
+      } else if (document.hidden) {
+        ws.sendVisibility(true)
       }
     })
 
+    const applyStatus = (message: StatusUpdateMessage) => {
+      const receivedAt = Date.now()
+      const { activeZone, remainingTime } = message.irrigation
+      setSystemStatus((prev) => ({
+        ...prev,
+        uptime_s: message.system.uptime,
+        mem_free: message.system.freeMemory,
+        zones: prev.zones.map((zone) =>
+          zone.zone === activeZone && remainingTime > 0
+            ? { ...zone, state: "OPEN" as const, remaining_s: remainingTime, ends_at: receivedAt + remainingTime * 1000 }
+            : { ...zone, state: "CLOSED" as const, remaining_s: 0, ends_at: undefined },
+        ),
+      }))
+    }
+
+    ws.onMessage<StatusUpdateMessage>("status_update", applyStatus)
+
     ws.onMessage<StateUpdateMessage>("state_update", (message) => {
       console.log("[v0] Processing state update:", message)
       setSystemStatus((prev) => ({
@@ -141,12 +163,40 @@ export function useIrrigationWebSocket() {
       }))
     })
 
-    ws.connect().catch((error) => {
-      console.log("[v0] WebSocket connection failed, continuing in demo mode:", error)
-      // Don't call fetchStatusViaAPI here to avoid double API calls
-    })
+    // Una sola petición pinta el panel; el WebSocket arranca después y, con
+    // la secuencia del estado recibido, el firmware no lo vuelve a enviar
+    let cancelled = false
+    irrigationAPI
+      .getBootstrap()
+      .then((bootstrap) => {
+        if (cancelled) {
+          return
+        }
+        if (bootstrap.status) {
+          applyStatus(bootstrap.status)
+          ws.setResumeSequence(bootstrap.status.seq)
+        }
+        setSystemStatus((prev) => ({
+          ...prev,
+          zones: prev.zones.map((zone) => ({ ...zone, name: bootstrap.zoneNames[zone.zone - 1] ?? zone.name })),
+        }))
+        setHistory(bootstrap.history)
+      })
+      .catch((error) => {
+        console.log("[v0] Bootstrap unavailable, waiting for WebSocket status:", error)
+      })
+      .finally(() => {
+        if (cancelled) {
+          return
+        }
+        ws.connect().catch((error) => {
+          console.log("[v0] WebSocket connection failed, continuing in demo mode:", error)
+          // Don't call fetchStatusViaAPI here to avoid double API calls
+        })
+      })
 
     return () => {
+      cancelled = true
       ws.disconnect()
     }
   }, [fetchStatusViaAPI])
@@ -157,10 +207,17 @@ export function useIrrigationWebSocket() {
       setConnectionState(ws.getConnectionState())
 
       if (ws.isConnected()) {
+        // Cuenta atrás local: el firmware solo la corrige de vez en cuando
+        const now = Date.now()
         setSystemStatus((prev) => ({
           ...prev,
           uptime_s: prev.uptime_s + 1,
           rtc_time: new Date().toISOString(),
+          zones: prev.zones.map((zone) =>
+            zone.ends_at !== undefined
+              ? { ...zone, remaining_s: Math.max(0, Math.ceil((zone.ends_at - now) / 1000)) }
+              : zone,
+          ),
         }))
       } else {
         const timeSinceLastUpdate = Date.now() - lastApiUpdate
@@ -179,6 +236,18 @@ export function useIrrigationWebSocket() {
     return () => clearInterval(interval)
   }, [lastApiUpdate, fetchStatusViaAPI])
 
+  useEffect(() => {
+    const handleVisibilityChange = () => {
+      const ws = wsRef.current
+      if (ws.isConnected()) {
+        ws.sendVisibility(document.hidden)
+      }
+    }
+
+    document.addEventListener("visibilitychange", handleVisibilityChange)
+    return () => document.removeEventListener("visibilitychange", handleVisibilityChange)
+  }, [])
+
   const controlZone = useCallback(
     async (zone: number, action: "open" | "close", duration_s?: number) => {
       const ws = wsRef.current
@@ -341,6 +410,7 @@ export function useIrrigationWebSocket() {
     connectionState,
     systemStatus,
     logs,
+    history,
     apiStatus,
     lastApiUpdate,
     controlZone,
@@ -36,4 +36,19 @@ describe('IrrigationAPI', () => {
       expect(global.fetch).toHaveBeenCalledWith('http://localhost/api/v1/status', expect.any(Object));
     });
   });
+
+  describe('getBootstrap', () => {
+    it('should fetch the dashboard bootstrap in a single request', async () => {
+      const api = new IrrigationAPI('http://localhost');
+      const bootstrap = { status: { type: 'status_update', seq: 7 }, zoneNames: ['Jardín Frontal'], history: [] };
+      global.fetch = jest.fn().mockResolvedValue({
+        ok: true,
+        json: () => Promise.resolve(bootstrap),
+      });
+
+      await expect(api.getBootstrap()).resolves.toEqual(bootstrap);
+      expect(global.fetch).toHaveBeenCalledTimes(1);
+      expect(global.fetch).toHaveBeenCalledWith('http://localhost/api/v1/bootstrap', expect.any(Object));
+    });
+  });
 });
@@ -1,5 +1,7 @@
 "use client"
 
+import type { StatusUpdateMessage } from "./websocket"
+
 export interface IrrigationStatus {
   state: string
   activeZone: number
@@ -8,6 +10,31 @@ export interface IrrigationStatus {
   status: string
 }
 
+// Documento de /api/v1/bootstrap: todo lo que el panel necesita al arrancar.
+// status.seq se pasa al WebSocket para que no repita ese mismo estado
+export interface BootstrapResponse {
+  status: StatusUpdateMessage | null
+  config: SystemConfig
+  zoneNames: string[]
+  history: Array<{
+    t: number
+    event: string
+    zone: number
+    value: number
+    uptime: boolean
+  }>
+  capabilities: {
+    api: string
+    websocket: string
+    compression: string
+    windowBits: number
+    contextTakeover: boolean
+    maxWebSocketClients: number
+    statusResume: boolean
+    endpoints: string[]
+  }
+}
+
 export interface RTCConfig {
   year: number
   month: number
@@ -28,6 +55,22 @@ export interface ZoneConfig {
   servoCloseAngle: number
 }
 
+export interface TaskStats {
+  runtime_stats: boolean
+  window_s: number
+  cores: Array<{
+    core: number
+    load: number | null
+  }>
+  tasks: Array<{
+    name: string
+    core: number | null
+    priority: number
+    cpu: number | null
+    stack_free: number
+  }>
+}
+
 export interface SystemConfig {
   irrigation: {
     zones: Array<{
@@ -141,6 +184,11 @@ class IrrigationAPI {
     return response.json()
   }
 
+  async getBootstrap(): Promise<BootstrapResponse> {
+    const response = await this.makeRequest("/bootstrap")
+    return response.json()
+  }
+
   // RTC configuration endpoints
   async setRTCDateTime(config: RTCConfig): Promise<{ status: string; message: string }> {
     const formData = new URLSearchParams()
@@ -212,6 +260,12 @@ class IrrigationAPI {
     return response.json()
   }
 
+  // Diagnostics endpoints
+  async getTaskStats(): Promise<TaskStats> {
+    const response = await this.makeRequest("/system/tasks")
+    return response.json()
+  }
+
   // Backup management endpoints
   async listBackups(): Promise<{ backups: number; last_backup: string }> {
     const response = await this.makeRequest("/config/backup")
@@ -19,6 +19,41 @@ export interface StateUpdateMessage extends WebSocketMessage {
   mem_free: number
 }
 
+// Estado tal como lo difunde el firmware (WebSocketManager::serializeSystemStatus).
+// Se envía solo en transiciones y cada ~15 s durante un riego: remainingTime
+// se extrapola en el cliente desde el instante de recepción
+export interface StatusUpdateMessage extends WebSocketMessage {
+  type: "status_update"
+  seq?: number
+  timestamp: number
+  system: { uptime: number; freeMemory: number; hasErrors: boolean }
+  irrigation: {
+    state: string
+    activeZone: number
+    remainingTime: number
+    totalCycles: number
+    wateringMode?: string
+  }
+  sensors: { humidity: number; humidityThreshold: number }
+  zones: Array<{ number: number; enabled: boolean; irrigationTime: number; valve?: string }>
+}
+
+export interface VisibilityMessage extends WebSocketMessage {
+  type: "visibility"
+  hidden: boolean
+}
+
+// Negociación de la compresión (WebSocketCompression.h en el firmware). Con
+// "deflate" los mensajes largos llegan como tramas binarias en DEFLATE crudo
+export interface HelloMessage extends WebSocketMessage {
+  type: "hello"
+  compression: "deflate" | "none"
+  contextTakeover: boolean
+  windowBits?: number
+  // Último estado que ya tiene el cliente (bootstrap): el firmware no lo repite
+  statusSeq?: number
+}
+
 export interface LogEntryMessage extends WebSocketMessage {
   type: "log_entry"
   level: "INFO" | "WARN" | "ERROR"
@@ -65,6 +100,11 @@ export class IrrigationWebSocket {
   private messageHandlers: Map<string, (message: WebSocketMessage) => void> = new Map()
   private connectionStateHandlers: Array<(connected: boolean) => void> = []
   private apiVersion = "v1"
+  // Los mensajes binarios se descomprimen de forma asíncrona: la cadena de
+  // promesas mantiene el orden de llegada
+  private inbound: Promise<void> = Promise.resolve()
+  // Secuencia del último status_update conocido (bootstrap o WebSocket)
+  private statusSeq: number | null = null
 
   constructor(private baseUrl: string) {}
 
@@ -85,6 +125,7 @@ export class IrrigationWebSocket {
         const wsUrl = `${wsProtocol}://${parsed.host}/ws`
         console.log("[API] Connecting to WebSocket:", wsUrl)
         this.ws = new WebSocket(wsUrl)
+        this.ws.binaryType = "arraybuffer"
         // Note: For versioning, could use /api/v1/ws in the future
 
         this.ws.onopen = () => {
@@ -93,17 +134,21 @@ export class IrrigationWebSocket {
           this.reconnectAttempts = 0
           this.baseReconnectDelay = 1000
           this.notifyConnectionState(true)
+          this.sendHello()
           resolve()
         }
 
         this.ws.onmessage = (event) => {
-          try {
-            const message: WebSocketMessage = JSON.parse(event.data)
-            console.log("[API] Received WebSocket message:", message.type, message)
-            this.handleMessage(message)
-          } catch (error) {
-            console.error("[API] Error parsing WebSocket message:", error)
-          }
+          this.inbound = this.inbound
+            .then(() => this.decodeMessage(event.data))
+            .then((text) => {
+              const message: WebSocketMessage = JSON.parse(text)
+              console.log("[API] Received WebSocket message:", message.type, message)
+              this.handleMessage(message)
+            })
+            .catch((error) => {
+              console.error("[API] Error parsing WebSocket message:", error)
+            })
         }
 
         this.ws.onclose = (event) => {
@@ -150,7 +195,45 @@ export class IrrigationWebSocket {
     }, delay)
   }
 
+  // Sin context takeover cada trama binaria es un flujo DEFLATE completo
+  private decodeMessage(data: string | ArrayBuffer): Promise<string> {
+    if (typeof data === "string") {
+      return Promise.resolve(data)
+    }
+    const stream = new Blob([data])
+      .stream()
+      .pipeThrough(new DecompressionStream("deflate-raw" as CompressionFormat))
+    return new Response(stream).text()
+  }
+
+  // Siempre se envía: aunque no haya compresión, el firmware espera el hello
+  // (con un margen) para saber si tiene que mandar el estado inicial
+  private sendHello() {
+    const message: HelloMessage = {
+      type: "hello",
+      // Sin DecompressionStream el firmware sigue enviando texto
+      compression: typeof DecompressionStream === "undefined" ? "none" : "deflate",
+      contextTakeover: false,
+      ...(this.statusSeq !== null && { statusSeq: this.statusSeq }),
+    }
+    this.send(message)
+  }
+
+  // El estado de /api/v1/bootstrap ya está pintado: no hace falta repetirlo
+  setResumeSequence(seq: number | undefined) {
+    if (typeof seq === "number") {
+      this.statusSeq = seq
+    }
+  }
+
   private handleMessage(message: WebSocketMessage) {
+    if (message.type === "hello") {
+      console.log("[API] WebSocket compression:", message.compression)
+      return
+    }
+    if (message.type === "status_update" && typeof message.seq === "number") {
+      this.statusSeq = message.seq
+    }
     const handler = this.messageHandlers.get(message.type)
     if (handler) {
       handler(message)
@@ -198,6 +281,15 @@ export class IrrigationWebSocket {
     this.send(message)
   }
 
+  // Con la pestaña oculta el firmware agrupa los envíos de estado
+  sendVisibility(hidden: boolean) {
+    const message: VisibilityMessage = {
+      type: "visibility",
+      hidden,
+    }
+    this.send(message)
+  }
+
   sendRequestLogs(limit = 100) {
     const message: RequestLogsMessage = {
       type: "request_logs",